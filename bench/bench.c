@@ -0,0 +1,180 @@
+/**
+ * @file bench.c
+ *
+ * Runs every benchmark, or only those whose names contain the passed filter;
+ * with -json, also writes the results to a file, for comparing runs across releases:
+ *
+ *   bench [-json results.json] [filter]
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "bench.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+//---------------------------------------------------------------------------
+typedef void (*benchfn_t)();
+
+// more than enough for every report of every benchmark.
+#define BENCH_RESULTS 1024
+
+typedef struct bench_result_rec bench_result_t;
+struct bench_result_rec {
+  const char * bench;
+  char name[64];
+  long ops;
+  double seconds;
+};
+
+static bench_result_t gResults[ BENCH_RESULTS ];
+static int gResultCount;
+static const char * gBench;
+
+//---------------------------------------------------------------------------
+double BenchSeconds()
+{
+#ifdef WIN32
+  LARGE_INTEGER freq, now;
+  QueryPerformanceFrequency( &freq );
+  QueryPerformanceCounter( &now );
+  return (double) now.QuadPart / (double) freq.QuadPart;
+#else
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+  return now.tv_sec + now.tv_nsec * 1e-9;
+#endif
+}
+
+//---------------------------------------------------------------------------
+void BenchReport( const char * name, long ops, double seconds )
+{
+  printf( "  %-40s %10ld ops %8.3f s %8.1f ns/op\n", 
+    name, ops, seconds, ops ? (seconds * 1e9) / ops : 0.0 );
+  if (gResultCount < BENCH_RESULTS) {
+    bench_result_t* result= gResults + gResultCount++;
+    result->bench= gBench;
+    strncpy( result->name, name, sizeof(result->name)-1 );
+    result->ops= ops;
+    result->seconds= seconds;
+  }
+}
+
+//---------------------------------------------------------------------------
+// names are plain text, but escape anything json would choke on.
+static void BenchJsonString( FILE* out, const char * s )
+{
+  fputc( '"', out );
+  for (; *s; ++s) {
+    if (*s == '"' || *s == '\\') {
+      fprintf( out, "\\%c", *s );
+    }
+    else
+    if ((unsigned char) *s < 0x20) {
+      fprintf( out, "\\u%04x", *s );
+    }
+    else {
+      fputc( *s, out );
+    }
+  }
+  fputc( '"', out );
+}
+
+//---------------------------------------------------------------------------
+static int BenchWriteJson( const char * path )
+{
+  FILE* out= fopen( path, "w" );
+  if (out) {
+    int i;
+    fprintf( out, "{\n  \"events\": %d,\n  \"results\": [", BENCH_EVENTS );
+    for (i=0; i<gResultCount; ++i) {
+      const bench_result_t* result= gResults+i;
+      fprintf( out, "%s\n    { \"bench\": ", i ? "," : "" );
+      BenchJsonString( out, result->bench );
+      fprintf( out, ", \"name\": " );
+      BenchJsonString( out, result->name );
+      fprintf( out, ", \"ops\": %ld, \"seconds\": %.6f, \"ns_per_op\": %.2f }",
+        result->ops, result->seconds, result->ops ? (result->seconds * 1e9) / result->ops : 0.0 );
+    }
+    fprintf( out, "\n  ]\n}\n" );
+    fclose( out );
+  }
+  else {
+    printf( "couldn't write %s\n", path );
+  }
+  return out != NULL;
+}
+
+//---------------------------------------------------------------------------
+// Benchmarks from other files
+//---------------------------------------------------------------------------
+
+void BenchDispatch();
+void BenchTransition();
+void BenchScheduler();
+void BenchPool();
+void BenchBuilder();
+void BenchSlab();
+void BenchContext();
+void BenchActive();
+void BenchRegion();
+void BenchRegionThreads();
+void BenchDefer();
+void BenchTimer();
+void BenchTrace();
+void BenchStats();
+void BenchHula();
+
+//---------------------------------------------------------------------------
+static const char * gFilter;
+
+static void RunBench( const char * name, benchfn_t bench )
+{
+  if (!gFilter || strstr( name, gFilter )) {
+    printf( "%s\n", name );
+    gBench= name;
+    bench();
+  }
+}
+
+#define RUN_BENCH( x ) RunBench( #x, x )
+
+//---------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  const char * json= NULL;
+  int i;
+  for (i=1; i<argc; ++i) {
+    if (!strcmp( argv[i], "-json" ) && i+1 < argc) {
+      json= argv[++i];
+    }
+    else {
+      gFilter= argv[i];
+    }
+  }
+  RUN_BENCH( BenchDispatch );
+  RUN_BENCH( BenchTransition );
+  RUN_BENCH( BenchScheduler );
+  RUN_BENCH( BenchPool );
+  RUN_BENCH( BenchBuilder );
+  RUN_BENCH( BenchSlab );
+  RUN_BENCH( BenchContext );
+  RUN_BENCH( BenchActive );
+  RUN_BENCH( BenchRegion );
+  RUN_BENCH( BenchRegionThreads );
+  RUN_BENCH( BenchDefer );
+  RUN_BENCH( BenchTimer );
+  RUN_BENCH( BenchTrace );
+  RUN_BENCH( BenchStats );
+  RUN_BENCH( BenchHula );
+  return (json && !BenchWriteJson( json )) ? 1 : 0;
+}
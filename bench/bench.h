@@ -0,0 +1,35 @@
+/**
+ * @file bench.h
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ * 
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#pragma once
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <hsm/hsm_machine.h>
+
+//---------------------------------------------------------------------------
+/**
+ * Seconds elapsed on a monotonic clock; only useful for differences.
+ */
+double BenchSeconds();
+
+/**
+ * Print the result of a timed loop.
+ *
+ * @param name Name of the measurement.
+ * @param ops Number of operations performed.
+ * @param seconds Time those operations took.
+ */
+void BenchReport( const char * name, long ops, double seconds );
+
+// number of events each benchmark sends, unless otherwise noted.
+#define BENCH_EVENTS 2000000
+
+#endif // #ifndef __BENCH_H__
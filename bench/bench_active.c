@@ -0,0 +1,94 @@
+/**
+ * @file bench_active.c
+ *
+ * Measure HsmIsInState(), walking the parents versus testing an active set,
+ * and counting the machines in a state across a crowd of machines.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "bench.h"
+#include <hsm/hsm_active.h>
+#include <hsm/hsm_chart.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+#define ACTIVE_DEPTH 16
+#define ACTIVE_CROWD 1024
+static struct hsm_state_rec gChain[ ACTIVE_DEPTH ];
+
+//---------------------------------------------------------------------------
+static hsm_state IgnoreEvent( hsm_status status )
+{
+  return NULL;
+}
+
+//---------------------------------------------------------------------------
+static void BuildChain()
+{
+  int i;
+  memset( gChain, 0, sizeof(gChain) );
+  for (i=0; i<ACTIVE_DEPTH; ++i) {
+    struct hsm_state_rec* state= &gChain[i];
+    state->name= "chain";
+    state->process= IgnoreEvent;
+    state->parent= i ? &gChain[i-1] : NULL;
+    state->depth= i;
+  }
+}
+
+//---------------------------------------------------------------------------
+/**
+ * Ask every machine in the crowd whether it's in the root state;
+ * the worst case for the walk, since it has to go all the way up.
+ */
+static double TimeCounting( hsm_machine* machines, long count, int* found )
+{
+  double start= BenchSeconds();
+  long i;
+  for (i=0; i<count; i+= ACTIVE_CROWD) {
+    *found+= HsmCountInState( machines, ACTIVE_CROWD, &gChain[0], NULL );
+  }
+  return BenchSeconds()-start;
+}
+
+//---------------------------------------------------------------------------
+void BenchActive()
+{
+  const long count= BENCH_EVENTS;
+  hsm_chart_t chart;
+  hsm_state states[ ACTIVE_DEPTH ];
+  hsm_machine_t* walk= (hsm_machine_t*) malloc( ACTIVE_CROWD * sizeof(hsm_machine_t) );
+  hsm_machine_t* bits= (hsm_machine_t*) malloc( ACTIVE_CROWD * sizeof(hsm_machine_t) );
+  hsm_active_t* active= (hsm_active_t*) malloc( ACTIVE_CROWD * sizeof(hsm_active_t) );
+  hsm_uint64* words= (hsm_uint64*) malloc( ACTIVE_CROWD * HSM_ACTIVE_WORDS( ACTIVE_DEPTH ) * sizeof(hsm_uint64) );
+  hsm_machine* walkers= (hsm_machine*) malloc( ACTIVE_CROWD * sizeof(hsm_machine) );
+  hsm_machine* testers= (hsm_machine*) malloc( ACTIVE_CROWD * sizeof(hsm_machine) );
+  int i, found=0;
+
+  BuildChain();
+  for (i=0; i<ACTIVE_DEPTH; ++i) {
+    states[i]= &gChain[i];
+  }
+  if (HsmChartCompile( &chart, states, ACTIVE_DEPTH )) {
+    char name[64];
+    for (i=0; i<ACTIVE_CROWD; ++i) {
+      walkers[i]= HsmMachine( &walk[i] );
+      testers[i]= HsmMachine( &bits[i] );
+      HsmMachineActive( testers[i], &active[i], &chart, words + i*HSM_ACTIVE_WORDS( ACTIVE_DEPTH ) );
+      HsmStart( walkers[i], &gChain[ ACTIVE_DEPTH-1 ] );
+      HsmStart( testers[i], &gChain[ ACTIVE_DEPTH-1 ] );
+    }
+    sprintf( name, "in state walk depth %d", ACTIVE_DEPTH );
+    BenchReport( name, count, TimeCounting( walkers, count, &found ) );
+    sprintf( name, "in state active set depth %d", ACTIVE_DEPTH );
+    BenchReport( name, count, TimeCounting( testers, count, &found ) );
+    HsmChartRelease( &chart );
+  }
+  free( walk ); free( bits ); free( active ); free( words ); free( walkers ); free( testers );
+}
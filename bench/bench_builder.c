@@ -0,0 +1,168 @@
+/**
+ * @file bench_builder.c
+ *
+ * Measure builder states with many event handlers.
+ *
+ * One state has a handler for each of HANDLER_COUNT event types.
+ * With hsmIf every event tests the guards in turn; 
+ * with hsmOnEventId the state's dispatch table finds the right handler directly.
+ *
+ * Also, time building, and freeing, a chart with BUILD_COUNT states;
+ * then larger synthetic trees: every state a nest of children, each with a guarded transition back to the root.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "bench.h"
+#include <hsm/builder/hsm_builder.h>
+#include <stdio.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+struct hsm_event_rec {
+  int type;
+};
+
+#define HANDLER_COUNT 32
+#define BUILD_COUNT 5000
+
+//---------------------------------------------------------------------------
+static hsm_bool MatchType( hsm_status status, void * type )
+{
+  return status->evt->type == (int)(size_t) type;
+}
+
+//---------------------------------------------------------------------------
+static int EventType( hsm_event evt )
+{
+  return evt->type;
+}
+
+//---------------------------------------------------------------------------
+static void Count( hsm_status status, void * counter )
+{
+  ++*(long*)counter;
+}
+
+//---------------------------------------------------------------------------
+static double TimeHandlers( const char * name, hsm_bool keyed, long * counter, long count )
+{
+  double start;
+  hsm_machine_t machine;
+  hsm_machine hsm= HsmMachine( &machine );
+  struct hsm_event_rec evt;
+  int i;
+  long n;
+
+  hsmEventIds( EventType );
+  hsmBegin( name, 0 );
+  for (i=0; i<HANDLER_COUNT; ++i) {
+    if (keyed) {
+      hsmOnEventId( i );
+    }
+    else {
+      hsmIfUD( MatchType, (void*)(size_t) i );
+    }
+    hsmRunUD( Count, counter );
+  }
+  hsmEnd();
+
+  hsmStart( hsm, name );
+  start= BenchSeconds();
+  for (n=0; n<count; ++n) {
+    evt.type= (int)(n % HANDLER_COUNT);
+    HsmSignalEvent( hsm, &evt );
+  }
+  return BenchSeconds()-start;
+}
+
+//---------------------------------------------------------------------------
+static double TimeBuild( long * counter )
+{
+  double start= BenchSeconds();
+  int i;
+  hsmStartup();
+  hsmBegin( "root", 0 );
+  for (i=0; i<BUILD_COUNT; ++i) {
+    char name[32];
+    sprintf( name, "state%d", i );
+    hsmBegin( name, (int) strlen( name ) );
+    hsmIfUD( MatchType, (void*)(size_t) 0 );
+    hsmRunUD( Count, counter );
+    hsmGoto( "root" );
+    hsmIfUD( MatchType, (void*)(size_t) 1 );
+    hsmAndUD( MatchType, (void*)(size_t) 1 );
+    hsmRunUD( Count, counter );
+    hsmEnd();
+  }
+  hsmEnd();
+  hsmShutdown();
+  return BenchSeconds()-start;
+}
+
+//---------------------------------------------------------------------------
+// begin a state, and below it, levels more of fanout children each; returns the number of states built.
+static long BuildTree( int fanout, int levels, long * counter, long next )
+{
+  char name[32];
+  long built=1;
+  sprintf( name, "tree%ld", next );
+  hsmBegin( name, (int) strlen( name ) );
+  hsmIfUD( MatchType, (void*)(size_t) 0 );
+  hsmRunUD( Count, counter );
+  hsmGoto( "tree0" );
+  if (levels > 0) {
+    int i;
+    for (i=0; i<fanout; ++i) {
+      built+= BuildTree( fanout, levels-1, counter, next+built );
+    }
+  }
+  hsmEnd();
+  return built;
+}
+
+//---------------------------------------------------------------------------
+static double TimeBuildTree( int fanout, int levels, long * counter, long * built )
+{
+  double start= BenchSeconds();
+  hsmStartup();
+  *built= BuildTree( fanout, levels, counter, 0 );
+  hsmShutdown();
+  return BenchSeconds()-start;
+}
+
+//---------------------------------------------------------------------------
+void BenchBuilder()
+{
+  const long count= BENCH_EVENTS;
+  long counter=0;
+  char name[64];
+  hsmStartup();
+
+  sprintf( name, "hsmIf, %d handlers", HANDLER_COUNT );
+  BenchReport( name, count, TimeHandlers( "guarded", HSM_FALSE, &counter, count ) );
+
+  sprintf( name, "hsmOnEventId, %d handlers", HANDLER_COUNT );
+  BenchReport( name, count, TimeHandlers( "keyed", HSM_TRUE, &counter, count ) );
+
+  hsmShutdown();
+
+  sprintf( name, "build and free %d states", BUILD_COUNT );
+  BenchReport( name, BUILD_COUNT, TimeBuild( &counter ) );
+  {
+    const int trees[][2]= { { 4, 4 }, { 4, 6 }, { 8, 5 }, { 16, 4 } };
+    int t;
+    for (t=0; t< sizeof(trees)/sizeof(trees[0]); ++t) {
+      long built;
+      const double seconds= TimeBuildTree( trees[t][0], trees[t][1], &counter, &built );
+      sprintf( name, "build and free tree %dx%d, %ld states", trees[t][0], trees[t][1], built );
+      BenchReport( name, built, seconds );
+    }
+  }
+  if (counter != 2*count) {
+    printf( "  lost events: %ld\n", 2*count-counter );
+  }
+}
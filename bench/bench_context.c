@@ -0,0 +1,147 @@
+/**
+ * @file bench_context.c
+ *
+ * Measure events bubbling through states which each have their own context.
+ *
+ * Compares the default context stack with the wide stack at shallow depths ( where both work ),
+ * then shows the wide stack at depths the default stack can't reach,
+ * and the cost with a dense array of contexts indexed by depth.
+ * Also, pushing and popping the stack directly, the way entering and exiting states does.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "bench.h"
+#include <hsm/hsm_stack.h>
+#include <stdio.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+struct hsm_event_rec {
+  int unused;
+};
+
+#define DEEP_MAX 96
+static struct hsm_state_rec gDeep[ DEEP_MAX ];
+static hsm_context_t gDeepCtx[ DEEP_MAX ];
+
+//---------------------------------------------------------------------------
+static hsm_state PassEvent( hsm_status status )
+{
+  return NULL;
+}
+
+//---------------------------------------------------------------------------
+static hsm_state RootEvent( hsm_status status )
+{
+  return HsmStateHandled();
+}
+
+//---------------------------------------------------------------------------
+static hsm_context OwnContext( hsm_status status )
+{
+  return &gDeepCtx[ status->state - gDeep ];
+}
+
+//---------------------------------------------------------------------------
+static void BuildDeep( int depth )
+{
+  int i;
+  memset( gDeep, 0, sizeof(gDeep) );
+  memset( gDeepCtx, 0, sizeof(gDeepCtx) );
+  for (i=0; i<depth; ++i) {
+    struct hsm_state_rec* state= &gDeep[i];
+    state->name= "deep";
+    state->process= i ? PassEvent : RootEvent;
+    state->enter= OwnContext;
+    state->parent= i ? &gDeep[i-1] : NULL;
+    state->depth= i;
+  }
+}
+
+//---------------------------------------------------------------------------
+static double TimeBubbling( int depth, hsm_context_wide_t* wide, hsm_bool dense, long count )
+{
+  double start;
+  struct hsm_event_rec evt={0};
+  hsm_context_machine_t machine;
+  hsm_machine hsm= wide ? HsmMachineWithWideContext( &machine, wide, NULL ) : HsmMachineWithContext( &machine, NULL );
+  static hsm_context dense_contexts[ DEEP_MAX ];
+  long i;
+  if (dense) {
+    HsmContextStackDense( &machine.stack, dense_contexts, DEEP_MAX );
+  }
+  HsmStart( hsm, &gDeep[depth-1] );
+  start= BenchSeconds();
+  for (i=0; i<count; ++i) {
+    HsmSignalEvent( hsm, &evt );
+  }
+  return BenchSeconds()-start;
+}
+
+//---------------------------------------------------------------------------
+// push depth unique contexts, then pop them all; count is the total number of pushes.
+static double TimePushPop( int depth, hsm_context_wide_t* wide, long count )
+{
+  double start;
+  hsm_context_stack_t stack;
+  const long rounds= count / depth;
+  long r;
+  if (wide) {
+    HsmContextStackWide( &stack, wide, NULL );
+  }
+  else {
+    HsmContextStack( &stack, NULL );
+  }
+  start= BenchSeconds();
+  for (r=0; r<rounds; ++r) {
+    int i;
+    for (i=0; i<depth; ++i) {
+      HsmContextPush( &stack, &gDeepCtx[i] );
+    }
+    for (i=0; i<depth; ++i) {
+      HsmContextPop( &stack );
+    }
+  }
+  return BenchSeconds()-start;
+}
+
+//---------------------------------------------------------------------------
+void BenchContext()
+{
+  const int depths[]= { 1, 4, 8, HSM_MAX_DEPTH, 64, DEEP_MAX };
+  const long count= BENCH_EVENTS;
+  int d;
+  for (d=0; d< sizeof(depths)/sizeof(depths[0]); ++d) {
+    char name[64];
+    hsm_context_wide_t wide;
+    const int depth= depths[d];
+    BuildDeep( depth );
+    if (depth <= HSM_MAX_DEPTH) {
+      sprintf( name, "context depth %d", depth );
+      BenchReport( name, count, TimeBubbling( depth, NULL, HSM_FALSE, count ) );
+    }
+    sprintf( name, "wide context depth %d", depth );
+    BenchReport( name, count, TimeBubbling( depth, &wide, HSM_FALSE, count ) );
+    HsmContextWideRelease( &wide );
+    sprintf( name, "dense wide context depth %d", depth );
+    BenchReport( name, count, TimeBubbling( depth, &wide, HSM_TRUE, count ) );
+    HsmContextWideRelease( &wide );
+  }
+  for (d=0; d< sizeof(depths)/sizeof(depths[0]); ++d) {
+    char name[64];
+    hsm_context_wide_t wide;
+    const int depth= depths[d];
+    const long pushes= (count / depth) * depth;
+    if (depth <= HSM_MAX_DEPTH) {
+      sprintf( name, "push and pop depth %d", depth );
+      BenchReport( name, pushes, TimePushPop( depth, NULL, count ) );
+    }
+    sprintf( name, "wide push and pop depth %d", depth );
+    BenchReport( name, pushes, TimePushPop( depth, &wide, count ) );
+    HsmContextWideRelease( &wide );
+  }
+}
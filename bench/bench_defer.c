@@ -0,0 +1,83 @@
+/**
+ * @file bench_defer.c
+ *
+ * Measure deferring an event, and replaying it after a transition.
+ *
+ * A busy state defers a burst of events; a transition to ready replays them all, and ready goes back to busy.
+ * The cost per event covers the copy into the ring, the copy back out, and the second dispatch.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "bench.h"
+#include <hsm/hsm_defer.h>
+#include <stdio.h>
+
+//---------------------------------------------------------------------------
+struct hsm_event_rec {
+  int kind;   // one of the values below
+  int data[3];
+};
+
+enum { WORK, READY, BUSY };
+
+#define BURST 16
+
+static hsm_state BusyEvent( hsm_status status );
+static hsm_state ReadyEvent( hsm_status status );
+static struct hsm_state_rec gTop= { "top" };
+static struct hsm_state_rec gBusy= { "busy", BusyEvent };
+static struct hsm_state_rec gReady= { "ready", ReadyEvent };
+static long gWorked;
+
+//---------------------------------------------------------------------------
+static hsm_state BusyEvent( hsm_status status )
+{
+  switch (status->evt->kind) {
+    case WORK: return HsmDefer( status, sizeof(struct hsm_event_rec) );
+    case READY: return &gReady;
+  }
+  return NULL;
+}
+
+//---------------------------------------------------------------------------
+static hsm_state ReadyEvent( hsm_status status )
+{
+  switch (status->evt->kind) {
+    case WORK: gWorked+= status->evt->data[0]; return HsmStateHandled();
+    case BUSY: return &gBusy;
+  }
+  return NULL;
+}
+
+//---------------------------------------------------------------------------
+void BenchDefer()
+{
+  const long bursts= BENCH_EVENTS / BURST;
+  struct hsm_event_rec work= { WORK, { 1 } }, ready= { READY }, busy= { BUSY };
+  hsm_defer_slot_t slots[ BURST ];
+  hsm_defer_t defer;
+  hsm_machine_t machine;
+  hsm_machine hsm= HsmMachine( &machine );
+  double start;
+  long i;
+  int j;
+  // siblings, so that each transition is a single exit and enter.
+  gBusy.parent= gReady.parent= &gTop;
+  gBusy.depth= gReady.depth= 1;
+  HsmMachineDefer( hsm, &defer, slots, BURST );
+  HsmStart( hsm, &gBusy );
+  gWorked= 0;
+  start= BenchSeconds();
+  for (i=0; i<bursts; ++i) {
+    for (j=0; j<BURST; ++j) {
+      HsmSignalEvent( hsm, &work );
+    }
+    HsmSignalEvent( hsm, &ready );
+    HsmSignalEvent( hsm, &busy );
+  }
+  BenchReport( gWorked == bursts*BURST ? "defer and replay, per event" : "defer and replay: LOST EVENTS", bursts*BURST, BenchSeconds()-start );
+}
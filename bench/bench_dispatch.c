@@ -0,0 +1,107 @@
+/**
+ * @file bench_dispatch.c
+ *
+ * Measure events bubbling from a leaf up to the state that handles them.
+ *
+ * The chart is a single chain of states; only the root handles the event,
+ * so every event visits every state in the chain.
+ * Unless: the chart knows the root is the only state interested in the event.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "bench.h"
+#include <hsm/hsm_chart.h>
+#include <stdio.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+struct hsm_event_rec {
+  int unused;
+};
+
+#define CHAIN_MAX (HSM_MAX_DEPTH-1)
+static struct hsm_state_rec gChain[ CHAIN_MAX ];
+
+//---------------------------------------------------------------------------
+static hsm_state PassEvent( hsm_status status )
+{
+  return NULL;
+}
+
+//---------------------------------------------------------------------------
+static hsm_state RootEvent( hsm_status status )
+{
+  return HsmStateHandled();
+}
+
+//---------------------------------------------------------------------------
+static void BuildChain( int depth )
+{
+  int i;
+  memset( gChain, 0, sizeof(gChain) );
+  for (i=0; i<depth; ++i) {
+    struct hsm_state_rec* state= &gChain[i];
+    state->name= "chain";
+    state->process= i ? PassEvent : RootEvent;
+    state->parent= i ? &gChain[i-1] : NULL;
+    state->depth= i;
+    state->interests= HSM_INTEREST( i ? 1 : 0 );
+  }
+}
+
+//---------------------------------------------------------------------------
+static int EventType( hsm_event evt )
+{
+  return 0;
+}
+
+//---------------------------------------------------------------------------
+static double TimeBubbling( int depth, long count )
+{
+  double start;
+  struct hsm_event_rec evt={0};
+  hsm_machine_t machine;
+  hsm_machine hsm= HsmMachine( &machine );
+  long i;
+  HsmStart( hsm, &gChain[depth-1] );
+  start= BenchSeconds();
+  for (i=0; i<count; ++i) {
+    HsmSignalEvent( hsm, &evt );
+  }
+  return BenchSeconds()-start;
+}
+
+//---------------------------------------------------------------------------
+void BenchDispatch()
+{
+  const int depths[]= { 1, 4, 8, CHAIN_MAX };
+  const long count= BENCH_EVENTS;
+  int d;
+  for (d=0; d< sizeof(depths)/sizeof(depths[0]); ++d) {
+    char name[64];
+    hsm_state states[ CHAIN_MAX ];
+    hsm_chart_t chart;
+    int i, depth= depths[d];
+    BuildChain( depth );
+
+    sprintf( name, "bubble depth %d", depth );
+    BenchReport( name, count, TimeBubbling( depth, count ) );
+
+    for (i=0; i<depth; ++i) {
+      states[i]= &gChain[i];
+    }
+    if (HsmChartCompile( &chart, states, depth )) {
+      sprintf( name, "compiled bubble depth %d", depth );
+      BenchReport( name, count, TimeBubbling( depth, count ) );
+      if (HsmChartEventTypes( &chart, EventType )) {
+        sprintf( name, "interested bubble depth %d", depth );
+        BenchReport( name, count, TimeBubbling( depth, count ) );
+      }
+      HsmChartRelease( &chart );
+    }
+  }
+}
@@ -0,0 +1,91 @@
+/**
+ * @file bench_hula.c
+ *
+ * Measure events signaled from lua to a chart described in lua.
+ *
+ * A lua loop toggles a machine between two states, first by naming the target state,
+ * then with a lua function handling the event; the loop's own cost is measured separately.
+ * Needs lua 5.1 and the hula sources: only built with BENCH_HULA defined ( make HULA=1 ).
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "bench.h"
+#include <stdio.h>
+
+#ifdef BENCH_HULA
+#include <hsm/builder/hsm_builder.h>
+#include <lua.h>
+#include <lauxlib.h>
+#include <lualib.h>
+#include <hsm/hula/hula.h>
+
+//---------------------------------------------------------------------------
+// each chunk gets the event count as its argument.
+static const char * gToggles=
+  "local count= ...\n"
+  "local chart= { toggles= { init= 'off', off= { toggle= 'on' }, on= { toggle= 'off' } } }\n"
+  "local hsm= hsm_statechart.new{ chart }\n"
+  "for i=1,count do hsm:signal( 'toggle' ) end\n";
+
+static const char * gHandled=
+  "local count= ...\n"
+  "local chart= { handled= { init= 'idle', idle= { toggle= function() return true end } } }\n"
+  "local hsm= hsm_statechart.new{ chart }\n"
+  "for i=1,count do hsm:signal( 'toggle' ) end\n";
+
+static const char * gLoop=
+  "local count= ...\n"
+  "local t= { signal= function() end }\n"
+  "for i=1,count do t:signal( 'toggle' ) end\n";
+
+//---------------------------------------------------------------------------
+static double TimeChunk( lua_State* L, const char * chunk, long count )
+{
+  double start, seconds= 0;
+  if (luaL_loadstring( L, chunk )) {
+    printf( "  %s\n", lua_tostring( L, -1 ) );
+    lua_pop( L, 1 );
+  }
+  else {
+    lua_pushnumber( L, (lua_Number) count );
+    start= BenchSeconds();
+    if (lua_pcall( L, 1, 0, 0 )) {
+      printf( "  %s\n", lua_tostring( L, -1 ) );
+      lua_pop( L, 1 );
+    }
+    seconds= BenchSeconds()-start;
+  }
+  return seconds;
+}
+
+//---------------------------------------------------------------------------
+void BenchHula()
+{
+  const long count= BENCH_EVENTS / 10;
+  lua_State* L= lua_open();
+  if (L) {
+    luaL_openlibs( L );
+    if (hsmStartup()) {
+      double loop;
+      HulaRegister( L, NULL );
+      loop= TimeChunk( L, gLoop, count );
+      BenchReport( "lua loop alone", count, loop );
+      BenchReport( "signal, named target", count, TimeChunk( L, gToggles, count ) - loop );
+      BenchReport( "signal, lua handler", count, TimeChunk( L, gHandled, count ) - loop );
+      hsmShutdown();
+    }
+    lua_close( L );
+  }
+}
+
+#else
+//---------------------------------------------------------------------------
+void BenchHula()
+{
+  printf( "  skipped: build with BENCH_HULA, and lua, to measure hula.\n" );
+}
+#endif
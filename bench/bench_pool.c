@@ -0,0 +1,93 @@
+/**
+ * @file bench_pool.c
+ *
+ * Broadcast a tick to many machines: one HsmSignalEvent() per machine, versus HsmPoolBroadcast().
+ *
+ * The machines are spread across four leaf states which share a parent.
+ * The tick is handled either by the leaf, or by bubbling up to the parent.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "bench.h"
+#include <hsm/hsm_pool.h>
+#include <stdio.h>
+
+//---------------------------------------------------------------------------
+struct hsm_event_rec {
+  int bubble; // non-zero if the leaves should ignore the tick
+};
+
+#define MACHINES 10000
+
+static long gTicks;
+
+static hsm_state TickParent( hsm_status status )
+{
+  ++gTicks;
+  return HsmStateHandled();
+}
+
+static hsm_state TickLeaf( hsm_status status )
+{
+  if (status->evt->bubble) {
+    return NULL;
+  }
+  ++gTicks;
+  return HsmStateHandled();
+}
+
+static struct hsm_state_rec gParent= { "parent", TickParent };
+static struct hsm_state_rec gLeaves[4]= {
+  { "leaf0", TickLeaf, 0, 0, 0, &gParent, 1 },
+  { "leaf1", TickLeaf, 0, 0, 0, &gParent, 1 },
+  { "leaf2", TickLeaf, 0, 0, 0, &gParent, 1 },
+  { "leaf3", TickLeaf, 0, 0, 0, &gParent, 1 },
+};
+
+//---------------------------------------------------------------------------
+static double TimeLoop( hsm_pool_t* pool, hsm_event evt, int rounds )
+{
+  const double start= BenchSeconds();
+  int r, i;
+  for (r=0; r<rounds; ++r) {
+    for (i=0; i<pool->count; ++i) {
+      HsmSignalEvent( HsmPoolMachine( pool, i ), evt );
+    }
+  }
+  return BenchSeconds()-start;
+}
+
+static double TimeBroadcast( hsm_pool_t* pool, hsm_event evt, int rounds )
+{
+  const double start= BenchSeconds();
+  int r;
+  for (r=0; r<rounds; ++r) {
+    HsmPoolBroadcast( pool, evt );
+  }
+  return BenchSeconds()-start;
+}
+
+//---------------------------------------------------------------------------
+void BenchPool()
+{
+  const int rounds= BENCH_EVENTS / MACHINES;
+  const long events= (long) rounds * MACHINES;
+  hsm_pool_t pool;
+  if (HsmPool( &pool, MACHINES )) {
+    struct hsm_event_rec leaf= { 0 }, bubble= { 1 };
+    int i;
+    for (i=0; i<MACHINES; ++i) {
+      HsmStart( HsmPoolMachine( &pool, i ), &gLeaves[i%4] );
+    }
+    HsmPoolRefresh( &pool );
+    BenchReport( "leaf tick, per machine", events, TimeLoop( &pool, &leaf, rounds ) );
+    BenchReport( "leaf tick, broadcast", events, TimeBroadcast( &pool, &leaf, rounds ) );
+    BenchReport( "parent tick, per machine", events, TimeLoop( &pool, &bubble, rounds ) );
+    BenchReport( "parent tick, broadcast", events, TimeBroadcast( &pool, &bubble, rounds ) );
+    HsmPoolRelease( &pool );
+  }
+}
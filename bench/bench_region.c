@@ -0,0 +1,104 @@
+/**
+ * @file bench_region.c
+ *
+ * Measure one event fanning out across the regions of a parallel state.
+ *
+ * Every region's leaf handles the event, so each event visits every region;
+ * the cost per region shows the overhead of the fan-out itself.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "bench.h"
+#include <hsm/hsm_region.h>
+#include <stdio.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+struct hsm_event_rec {
+  int unused;
+};
+
+#define REGION_MAX 64
+static struct hsm_state_rec gTop;
+static struct hsm_state_rec gRegions[ REGION_MAX ];
+static struct hsm_state_rec gLeaves[ REGION_MAX ];
+static hsm_region_t gInstances[ REGION_MAX ];
+
+//---------------------------------------------------------------------------
+static hsm_state PassEvent( hsm_status status )
+{
+  return NULL;
+}
+
+//---------------------------------------------------------------------------
+static hsm_state LeafEvent( hsm_status status )
+{
+  return HsmStateHandled();
+}
+
+//---------------------------------------------------------------------------
+static void BuildParallel( int count )
+{
+  int i;
+  memset( &gTop, 0, sizeof(gTop) );
+  memset( gRegions, 0, sizeof(gRegions) );
+  memset( gLeaves, 0, sizeof(gLeaves) );
+  gTop.name= "parallel";
+  gTop.process= PassEvent;
+  gTop.regions= &gRegions[0];
+  for (i=0; i<count; ++i) {
+    struct hsm_state_rec* region= &gRegions[i];
+    struct hsm_state_rec* leaf= &gLeaves[i];
+    region->name= "region";
+    region->parent= &gTop;
+    region->depth= 1;
+    region->initial= leaf;
+    region->next_region= (i+1 < count) ? &gRegions[i+1] : NULL;
+    leaf->name= "leaf";
+    leaf->process= LeafEvent;
+    leaf->parent= region;
+    leaf->depth= 2;
+  }
+}
+
+//---------------------------------------------------------------------------
+static double TimeFanOut( int count, long events )
+{
+  double start;
+  struct hsm_event_rec evt={0};
+  hsm_region_pool_t pool;
+  hsm_context_machine_t machine;
+  hsm_machine hsm= HsmMachineWithContext( &machine, NULL );
+  long i;
+  BuildParallel( count );
+  HsmRegionPool( &pool, gInstances, count );
+  HsmMachineRegions( hsm, &pool );
+  HsmStart( hsm, &gTop );
+  start= BenchSeconds();
+  for (i=0; i<events; ++i) {
+    HsmSignalEvent( hsm, &evt );
+  }
+  return BenchSeconds()-start;
+}
+
+//---------------------------------------------------------------------------
+void BenchRegion()
+{
+  const int counts[]= { 1, 2, 8, REGION_MAX };
+  int c;
+  for (c=0; c< sizeof(counts)/sizeof(counts[0]); ++c) {
+    char name[64];
+    const int count= counts[c];
+    // keep the total number of region visits the same for every size
+    const long events= BENCH_EVENTS / count;
+    const double seconds= TimeFanOut( count, events );
+    sprintf( name, "fan out %d regions, per event", count );
+    BenchReport( name, events, seconds );
+    sprintf( name, "fan out %d regions, per region", count );
+    BenchReport( name, events*count, seconds );
+  }
+}
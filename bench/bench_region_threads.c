@@ -0,0 +1,125 @@
+/**
+ * @file bench_region_threads.c
+ *
+ * Measure regions with expensive handlers, run one after another and then on threads.
+ *
+ * Every region's leaf burns a fixed amount of work on each event, standing in for something like protocol parsing;
+ * with threads, one event's regions share the cores.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "bench.h"
+#include <hsm/hsm_region.h>
+#include <hsm/sched/hsm_region_threads.h>
+#include <hsm/sched/hsm_thread.h>
+#include <stdio.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+struct hsm_event_rec {
+  int unused;
+};
+
+#define REGIONS 8
+// iterations of busy work per region per event
+#define WORK 20000
+static struct hsm_state_rec gTop;
+static struct hsm_state_rec gRegions[ REGIONS ];
+static struct hsm_state_rec gLeaves[ REGIONS ];
+static hsm_region_t gInstances[ REGIONS ];
+static volatile unsigned gSink[ REGIONS*16 ]; // spaced out, so regions dont share a cache line
+
+//---------------------------------------------------------------------------
+static hsm_state PassEvent( hsm_status status )
+{
+  return NULL;
+}
+
+//---------------------------------------------------------------------------
+static hsm_state WorkEvent( hsm_status status )
+{
+  const int which= (int)(status->state - gLeaves);
+  unsigned hash= 2166136261u;
+  int i;
+  for (i=0; i<WORK; ++i) {
+    hash= (hash ^ (unsigned) i) * 16777619u;
+  }
+  gSink[ which*16 ]+= hash;
+  return HsmStateHandled();
+}
+
+//---------------------------------------------------------------------------
+static void BuildParallel()
+{
+  int i;
+  memset( &gTop, 0, sizeof(gTop) );
+  memset( gRegions, 0, sizeof(gRegions) );
+  memset( gLeaves, 0, sizeof(gLeaves) );
+  gTop.name= "parallel";
+  gTop.process= PassEvent;
+  gTop.regions= &gRegions[0];
+  for (i=0; i<REGIONS; ++i) {
+    struct hsm_state_rec* region= &gRegions[i];
+    struct hsm_state_rec* leaf= &gLeaves[i];
+    region->name= "region";
+    region->parent= &gTop;
+    region->depth= 1;
+    region->initial= leaf;
+    region->next_region= (i+1 < REGIONS) ? &gRegions[i+1] : NULL;
+    leaf->name= "leaf";
+    leaf->process= WorkEvent;
+    leaf->parent= region;
+    leaf->depth= 2;
+  }
+}
+
+//---------------------------------------------------------------------------
+// threads: 0 runs the regions one after another on the calling thread.
+static double TimeRegions( int threads, long events )
+{
+  double start, seconds;
+  struct hsm_event_rec evt={0};
+  hsm_region_pool_t pool;
+  hsm_context_machine_t machine;
+  hsm_machine hsm= HsmMachineWithContext( &machine, NULL );
+  hsm_region_threads_t* workers= threads ? HsmRegionThreadsCreate( threads ) : NULL;
+  long i;
+  BuildParallel();
+  HsmRegionPool( &pool, gInstances, REGIONS );
+  if (workers) {
+    HsmRegionThreadsAttach( workers, &pool );
+  }
+  HsmMachineRegions( hsm, &pool );
+  HsmStart( hsm, &gTop );
+  start= BenchSeconds();
+  for (i=0; i<events; ++i) {
+    HsmSignalEvent( hsm, &evt );
+  }
+  seconds= BenchSeconds()-start;
+  HsmRegionThreadsDestroy( workers );
+  return seconds;
+}
+
+//---------------------------------------------------------------------------
+void BenchRegionThreads()
+{
+  // always try at least one thread, if only to see the cost of handing off.
+  const int cores= HsmThreadCores() > 1 ? HsmThreadCores() : 2;
+  const long events= BENCH_EVENTS / 1000;
+  int threads;
+  for (threads=0; threads < REGIONS && threads < cores; threads= threads ? threads*2 : 1) {
+    char name[64];
+    const double seconds= TimeRegions( threads, events );
+    if (threads) {
+      sprintf( name, "%d regions, 1+%d thread(s)", REGIONS, threads );
+    }
+    else {
+      sprintf( name, "%d regions, in turn", REGIONS );
+    }
+    BenchReport( name, events, seconds );
+  }
+}
@@ -0,0 +1,118 @@
+/**
+ * @file bench_scheduler.c
+ *
+ * Events per second through the scheduler, at one thread up to one per core.
+ *
+ * A few thousand small machines toggle between two states on every event.
+ * The main thread posts events round robin, each machine posts a follow up event to its neighbour:
+ * so work arrives both from outside the pool, and from inside it.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "bench.h"
+#include <hsm/hsm_queue.h>
+#include <hsm/sched/hsm_scheduler.h>
+#include <hsm/sched/hsm_thread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+//---------------------------------------------------------------------------
+struct hsm_event_rec {
+  int relay; // non-zero if the receiving machine should post to its neighbour
+};
+
+#define MACHINES 4096
+#define SLOTS 64
+
+typedef struct toggle_rec toggle_t;
+struct toggle_rec {
+  hsm_machine_t machine; // first, so the machine pointer is the toggle pointer
+  hsm_queue_t queue;
+  hsm_queue_slot_t slots[SLOTS];
+  toggle_t* next;
+  hsm_atomic dropped;
+};
+
+static struct hsm_event_rec gRelay= { 1 };
+static struct hsm_event_rec gFinal= { 0 };
+
+static hsm_state ToggleEvent( hsm_status status );
+static struct hsm_state_rec gOff= { "off", ToggleEvent };
+static struct hsm_state_rec gOn=  { "on", ToggleEvent };
+
+//---------------------------------------------------------------------------
+static hsm_state ToggleEvent( hsm_status status )
+{
+  if (status->evt->relay) {
+    toggle_t* toggle= (toggle_t*) status->hsm;
+    // neighbour's queue full? drop the relay, the count is corrected below.
+    if (!HsmPostEvent( &toggle->next->machine, &gFinal )) {
+      HsmAtomicAdd( &toggle->dropped, 1 );
+    }
+  }
+  return status->state == &gOff ? &gOn : &gOff;
+}
+
+//---------------------------------------------------------------------------
+// returns the number of events processed
+static long RunScheduler( toggle_t* toggles, int threads, long posts, double* seconds )
+{
+  hsm_scheduler_t* scheduler= HsmSchedulerCreate( threads );
+  long i, dropped=0;
+  double start;
+  if (!scheduler) {
+    *seconds= 0;
+    return 0;
+  }
+  for (i=0; i<MACHINES; ++i) {
+    hsm_machine hsm= HsmMachine( &toggles[i].machine );
+    toggles[i].dropped= 0;
+    HsmMachineQueue( hsm, &toggles[i].queue, toggles[i].slots, SLOTS );
+    HsmStart( hsm, &gOff );
+    HsmSchedulerAttach( scheduler, hsm );
+  }
+  start= BenchSeconds();
+  for (i=0; i<posts; ++i) {
+    hsm_machine hsm= &toggles[ i % MACHINES ].machine;
+    while (!HsmPostEvent( hsm, &gRelay )) {
+      HsmAtomicPause();
+    }
+  }
+  HsmSchedulerWait( scheduler );
+  *seconds= BenchSeconds()-start;
+  HsmSchedulerDestroy( scheduler );
+
+  for (i=0; i<MACHINES; ++i) {
+    dropped+= toggles[i].dropped;
+  }
+  return 2*posts - dropped;
+}
+
+//---------------------------------------------------------------------------
+void BenchScheduler()
+{
+  const int cores= HsmThreadCores();
+  const long posts= BENCH_EVENTS/2;
+  toggle_t* toggles= (toggle_t*) calloc( MACHINES, sizeof(toggle_t) );
+  int threads;
+  if (toggles) {
+    for (threads=0; threads<MACHINES; ++threads) {
+      toggles[threads].next= &toggles[ (threads+1) % MACHINES ];
+    }
+    for (threads=1; threads<=cores; threads= threads < cores && threads*2 > cores ? cores : threads*2) {
+      char name[64];
+      double seconds;
+      long events= RunScheduler( toggles, threads, posts, &seconds );
+      sprintf( name, "%d thread(s), %.1f M events/s", threads, seconds > 0 ? events / seconds * 1e-6 : 0.0 );
+      BenchReport( name, events, seconds );
+      if (threads == cores) {
+        break;
+      }
+    }
+    free( toggles );
+  }
+}
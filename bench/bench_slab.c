@@ -0,0 +1,94 @@
+/**
+ * @file bench_slab.c
+ *
+ * Measure transitions between two states which each allocate a context on entry.
+ *
+ * Compares HsmContextAlloc(), which goes to the heap on every entry and exit,
+ * with a machine slab, which recycles the same blocks.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "bench.h"
+#include <hsm/hsm_slab.h>
+#include <stdio.h>
+
+//---------------------------------------------------------------------------
+struct hsm_event_rec {
+  int quit;
+};
+
+typedef struct bench_context_rec bench_context_t;
+struct bench_context_rec {
+  hsm_context_t ctx;
+  int data[8];
+};
+
+HSM_STATE( SlabRoot, HsmTopState, SlabPing );
+  HSM_STATE_ENTER( SlabPing, SlabRoot, 0 );
+  HSM_STATE_ENTER( SlabPong, SlabRoot, 0 );
+
+//---------------------------------------------------------------------------
+hsm_state SlabRootEvent( hsm_status status )
+{
+  return status->evt->quit ? HsmStateFinal() : NULL;
+}
+
+hsm_context SlabPingEnter( hsm_status status )
+{
+  return HsmMachineContextAlloc( status->hsm, sizeof(bench_context_t) );
+}
+
+hsm_state SlabPingEvent( hsm_status status )
+{
+  return status->evt->quit ? NULL : SlabPong();
+}
+
+hsm_context SlabPongEnter( hsm_status status )
+{
+  return HsmMachineContextAlloc( status->hsm, sizeof(bench_context_t) );
+}
+
+hsm_state SlabPongEvent( hsm_status status )
+{
+  return status->evt->quit ? NULL : SlabPing();
+}
+
+//---------------------------------------------------------------------------
+static double TimeContexts( hsm_slab_t* slab, long count )
+{
+  double start;
+  struct hsm_event_rec evt={0};
+  hsm_context_machine_t machine;
+  hsm_machine hsm= HsmMachineWithContext( &machine, NULL );
+  long i;
+  HsmMachineSlab( hsm, slab );
+  HsmStart( hsm, SlabRoot() );
+  start= BenchSeconds();
+  for (i=0; i<count; ++i) {
+    HsmSignalEvent( hsm, &evt );
+  }
+  start= BenchSeconds()-start;
+  // exit every state, returning the contexts
+  evt.quit= 1;
+  HsmSignalEvent( hsm, &evt );
+  return start;
+}
+
+//---------------------------------------------------------------------------
+void BenchSlab()
+{
+  const long count= BENCH_EVENTS;
+  hsm_slab_t slab;
+  hsm_slab_stats_t stats;
+  BenchReport( "HsmContextAlloc", count, TimeContexts( NULL, count ) );
+
+  HsmSlab( &slab, 0 );
+  BenchReport( "slab", count, TimeContexts( &slab, count ) );
+  HsmSlabStats( &slab, &stats );
+  printf( "  slab hit rate %.4f, %ld bytes\n", stats.allocs ? (double) stats.hits / stats.allocs : 0.0, stats.bytes );
+  HsmSlabRelease( &slab );
+}
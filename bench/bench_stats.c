@@ -0,0 +1,110 @@
+/**
+ * @file bench_stats.c
+ *
+ * Measure the cost of latency histograms.
+ *
+ * First, times recorded directly; then, when built with HSM_USE_STATS, a machine toggling between two compiled states,
+ * with and without stats attached: each event times a run, a process, an exit and an enter.
+ * Without HSM_USE_STATS, the machine has no hooks to measure.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "bench.h"
+#include <hsm/hsm_chart.h>
+#include <hsm/hsm_stats.h>
+#include <stdio.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+struct hsm_event_rec {
+  int type;
+};
+
+static hsm_state ToggleEvent( hsm_status status );
+static hsm_context ToggleEnter( hsm_status status );
+static void ToggleExit( hsm_status status );
+static struct hsm_state_rec gTop= { "top" };
+static struct hsm_state_rec gOff= { "off", ToggleEvent, ToggleEnter, ToggleExit };
+static struct hsm_state_rec gOn= { "on", ToggleEvent, ToggleEnter, ToggleExit };
+
+//---------------------------------------------------------------------------
+static hsm_state ToggleEvent( hsm_status status )
+{
+  return status->state == &gOff ? &gOn : &gOff;
+}
+
+static hsm_context ToggleEnter( hsm_status status )
+{
+  return status->ctx;
+}
+
+static void ToggleExit( hsm_status status )
+{
+}
+
+#ifdef HSM_USE_STATS
+//---------------------------------------------------------------------------
+static double TimeToggles( hsm_stats_t* stats, long events )
+{
+  struct hsm_event_rec evt= { 1 };
+  hsm_machine_t machine;
+  hsm_machine_stats_t machine_stats;
+  hsm_machine hsm= HsmMachine( &machine );
+  double start;
+  long i;
+  if (stats) {
+    HsmMachineStats( hsm, &machine_stats, stats );
+  }
+  HsmStart( hsm, &gOff );
+  start= BenchSeconds();
+  for (i=0; i<events; ++i) {
+    HsmSignalEvent( hsm, &evt );
+  }
+  return BenchSeconds()-start;
+}
+#endif
+
+//---------------------------------------------------------------------------
+void BenchStats()
+{
+  hsm_state states[]= { &gTop, &gOff, &gOn };
+  static hsm_histogram_t histogram;
+  hsm_chart_t chart;
+  hsm_stats_t stats;
+  double start;
+  long i;
+  gOff.parent= gOn.parent= &gTop;
+  gOff.depth= gOn.depth= 1;
+  HsmChartCompile( &chart, states, 3 );
+  HsmStatsCreate( &stats, &chart );
+
+  memset( &histogram, 0, sizeof(histogram) );
+  start= BenchSeconds();
+  for (i=0; i<BENCH_EVENTS; ++i) {
+    HsmHistogramRecord( &histogram, i & 0xffff );
+  }
+  BenchReport( "record a time", BENCH_EVENTS, BenchSeconds()-start );
+
+  start= BenchSeconds();
+  for (i=0; i<BENCH_EVENTS; ++i) {
+    histogram.total+= HsmStatsClock();
+  }
+  BenchReport( "read the clock", BENCH_EVENTS, BenchSeconds()-start );
+
+#ifdef HSM_USE_STATS
+  {
+    const double off= TimeToggles( NULL, BENCH_EVENTS );
+    const double on= TimeToggles( &stats, BENCH_EVENTS );
+    BenchReport( "toggle, untimed", BENCH_EVENTS, off );
+    BenchReport( "toggle, timed", BENCH_EVENTS, on );
+    BenchReport( "toggle, timing cost per callback", BENCH_EVENTS*4, on-off );
+    HsmStatsDump( &stats, stdout );
+  }
+#endif
+  HsmStatsRelease( &stats );
+  HsmChartRelease( &chart );
+}
@@ -0,0 +1,125 @@
+/**
+ * @file bench_timer.c
+ *
+ * Measure state timeouts: broadcasting ticks to every machine, versus a timing wheel.
+ *
+ * Thousands of machines each wait for a timeout of a few hundred ticks, then start waiting again.
+ * Broadcasting visits every machine on every tick, and each machine counts down on its own;
+ * the wheel only visits machines whose timers expire.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "bench.h"
+#include <hsm/hsm_timer.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+//---------------------------------------------------------------------------
+struct hsm_event_rec {
+  int timeout; // non-zero for the wheel's timeout, zero for a broadcast tick
+};
+
+#define MACHINES 10000
+#define TICKS 2000
+// each machine waits this many ticks, give or take its own offset
+#define WAIT 256
+
+typedef struct waiter_rec waiter_t;
+struct waiter_rec {
+  hsm_machine_t machine; // first, so the machine pointer is the waiter pointer
+  hsm_timers_t timers;
+  hsm_timer_t timer;
+  int wait;      // ticks per timeout
+  int remaining; // countdown, when broadcasting
+};
+
+static struct hsm_event_rec gTick= { 0 };
+static struct hsm_event_rec gTimeout= { 1 };
+static long gTimeouts;
+
+static hsm_state WaitEvent( hsm_status status );
+static hsm_context WaitEnter( hsm_status status );
+static struct hsm_state_rec gTop= { "top" };
+static struct hsm_state_rec gWait= { "wait", WaitEvent, WaitEnter };
+
+//---------------------------------------------------------------------------
+static hsm_context WaitEnter( hsm_status status )
+{
+  waiter_t* waiter= (waiter_t*) status->hsm;
+  if (waiter->timers.wheel) {
+    HsmArmTimer( status, waiter->wait, &gTimeout );
+  }
+  else {
+    waiter->remaining= waiter->wait;
+  }
+  return status->ctx;
+}
+
+//---------------------------------------------------------------------------
+static hsm_state WaitEvent( hsm_status status )
+{
+  waiter_t* waiter= (waiter_t*) status->hsm;
+  hsm_state ret= HsmStateHandled();
+  // a timeout restarts the wait, and re-arms the timer.
+  if (status->evt->timeout || --waiter->remaining == 0) {
+    ++gTimeouts;
+    ret= &gWait;
+  }
+  return ret;
+}
+
+//---------------------------------------------------------------------------
+static double RunWaiters( waiter_t* waiters, hsm_wheel_t* wheel )
+{
+  double start;
+  unsigned long tick;
+  int i;
+  gWait.parent= &gTop;
+  gWait.depth= 1;
+  gTimeouts= 0;
+  if (wheel) {
+    HsmWheel( wheel, 0 );
+  }
+  for (i=0; i<MACHINES; ++i) {
+    hsm_machine hsm= HsmMachine( &waiters[i].machine );
+    waiters[i].timers.wheel= NULL;
+    waiters[i].wait= WAIT + (i % 64);
+    if (wheel) {
+      HsmMachineTimers( hsm, &waiters[i].timers, wheel, &waiters[i].timer, 1 );
+    }
+    HsmStart( hsm, &gWait );
+  }
+  start= BenchSeconds();
+  for (tick=1; tick<=TICKS; ++tick) {
+    if (wheel) {
+      HsmWheelAdvance( wheel, tick );
+    }
+    else {
+      for (i=0; i<MACHINES; ++i) {
+        HsmSignalEvent( &waiters[i].machine, &gTick );
+      }
+    }
+  }
+  return BenchSeconds()-start;
+}
+
+//---------------------------------------------------------------------------
+void BenchTimer()
+{
+  waiter_t* waiters= (waiter_t*) calloc( MACHINES, sizeof(waiter_t) );
+  if (waiters) {
+    hsm_wheel_t wheel;
+    char name[64];
+    double seconds= RunWaiters( waiters, NULL );
+    sprintf( name, "broadcast ticks, %ld timeouts", gTimeouts );
+    BenchReport( name, TICKS, seconds );
+    seconds= RunWaiters( waiters, &wheel );
+    sprintf( name, "timing wheel, %ld timeouts", gTimeouts );
+    BenchReport( name, TICKS, seconds );
+    free( waiters );
+  }
+}
@@ -0,0 +1,91 @@
+/**
+ * @file bench_trace.c
+ *
+ * Measure the cost of binary tracing.
+ *
+ * First, records written directly; then a machine toggling between two compiled states,
+ * with and without the trace's callbacks installed: each event writes a transition, an exit and an enter.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "bench.h"
+#include <hsm/hsm_chart.h>
+#include <hsm/trace/hsm_trace.h>
+#include <stdio.h>
+
+//---------------------------------------------------------------------------
+struct hsm_event_rec {
+  int type;
+};
+
+static hsm_state ToggleEvent( hsm_status status );
+static struct hsm_state_rec gTop= { "top" };
+static struct hsm_state_rec gOff= { "off", ToggleEvent };
+static struct hsm_state_rec gOn= { "on", ToggleEvent };
+
+//---------------------------------------------------------------------------
+static hsm_state ToggleEvent( hsm_status status )
+{
+  return status->state == &gOff ? &gOn : &gOff;
+}
+
+static int EventType( hsm_event evt )
+{
+  return evt->type;
+}
+
+//---------------------------------------------------------------------------
+static double TimeToggles( const hsm_info_t* info, long events )
+{
+  struct hsm_event_rec evt= { 1 };
+  hsm_machine_t machine;
+  hsm_machine hsm= HsmMachine( &machine );
+  double start;
+  long i;
+  HsmSetMachineInfo( hsm, info );
+  HsmStart( hsm, &gOff );
+  start= BenchSeconds();
+  for (i=0; i<events; ++i) {
+    HsmSignalEvent( hsm, &evt );
+  }
+  return BenchSeconds()-start;
+}
+
+//---------------------------------------------------------------------------
+void BenchTrace()
+{
+  hsm_trace_t* trace= HsmTraceCreate( 1<<16 );
+  if (trace) {
+    hsm_state states[]= { &gTop, &gOff, &gOn };
+    struct hsm_event_rec evt= { 1 };
+    hsm_machine_t machine;
+    hsm_chart_t chart;
+    double start, off, on;
+    long i;
+    HsmMachine( &machine );
+    gOff.parent= gOn.parent= &gTop;
+    gOff.depth= gOn.depth= 1;
+    HsmChartCompile( &chart, states, 3 );
+    HsmChartEventTypes( &chart, EventType );
+    HsmTraceChart( trace, &chart );
+
+    start= BenchSeconds();
+    for (i=0; i<BENCH_EVENTS; ++i) {
+      HsmTraceWrite( trace, HSM_TRACE_USER, &machine, &gOn, &evt );
+    }
+    BenchReport( "write a record", BENCH_EVENTS, BenchSeconds()-start );
+
+    off= TimeToggles( NULL, BENCH_EVENTS );
+    BenchReport( "toggle, untraced", BENCH_EVENTS, off );
+    on= TimeToggles( HsmTraceInfo( trace ), BENCH_EVENTS );
+    BenchReport( "toggle, traced", BENCH_EVENTS, on );
+    BenchReport( "toggle, tracing cost per record", BENCH_EVENTS*3, on-off );
+
+    HsmTraceDestroy( trace );
+    HsmChartRelease( &chart );
+  }
+}
@@ -0,0 +1,124 @@
+/**
+ * @file bench_transition.c
+ *
+ * Compare the tree walk in HsmTransition against a compiled chart.
+ *
+ * The chart is a root with two branches of equal depth,
+ * the leaf of each branch transitions to the leaf of the other on every event:
+ * so every transition exits, then enters, the full depth of a branch.
+ *
+ * Then, at the deepest depth, the branches share a trunk:
+ * the leaves stay put, but their lowest common ancestor moves closer, so each transition exits and enters less.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "bench.h"
+#include <hsm/hsm_chart.h>
+#include <stdio.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+struct hsm_event_rec {
+  int unused;
+};
+
+// root, plus two branches of up to HSM_MAX_DEPTH-1 states each
+#define BRANCH_MAX (HSM_MAX_DEPTH-1)
+static struct hsm_state_rec gStates[ 1 + 2*BRANCH_MAX ];
+static hsm_state gLeaves[2];
+
+//---------------------------------------------------------------------------
+static hsm_state LeafEvent( hsm_status status )
+{
+  return status->state == gLeaves[0] ? gLeaves[1] : gLeaves[0];
+}
+
+//---------------------------------------------------------------------------
+// leaves at depth, distance states below their common ancestor; returns the number of states used
+static int BuildBranches( int depth, int distance )
+{
+  struct hsm_state_rec* trunk= &gStates[0];
+  int b, i, n=1;
+  memset( gStates, 0, sizeof(gStates) );
+  gStates[0].name= "root";
+  for (i=distance; i<depth; ++i, ++n) {
+    struct hsm_state_rec* state= &gStates[n];
+    state->name= "trunk";
+    state->parent= trunk;
+    state->depth= trunk->depth+1;
+    trunk= state;
+  }
+  for (b=0; b<2; ++b) {
+    struct hsm_state_rec* parent= trunk;
+    for (i=0; i<distance; ++i, ++n) {
+      struct hsm_state_rec* state= &gStates[n];
+      state->name= b ? "right" : "left";
+      state->parent= parent;
+      state->depth= parent->depth+1;
+      parent= state;
+    }
+    parent->process= LeafEvent;
+    gLeaves[b]= parent;
+  }
+  return n;
+}
+
+//---------------------------------------------------------------------------
+static double TimeTransitions( long count )
+{
+  double start;
+  struct hsm_event_rec evt={0};
+  hsm_machine_t machine;
+  hsm_machine hsm= HsmMachine( &machine );
+  long i;
+  HsmStart( hsm, gLeaves[0] );
+  start= BenchSeconds();
+  for (i=0; i<count; ++i) {
+    HsmSignalEvent( hsm, &evt );
+  }
+  return BenchSeconds()-start;
+}
+
+//---------------------------------------------------------------------------
+static void TimeBoth( const char * label, int depth, int distance, long count )
+{
+  char name[64];
+  hsm_state states[ 1 + 2*BRANCH_MAX ];
+  hsm_chart_t chart;
+  int i, n= BuildBranches( depth, distance );
+
+  sprintf( name, "walk %s", label );
+  BenchReport( name, count, TimeTransitions( count ) );
+
+  for (i=0; i<n; ++i) {
+    states[i]= &gStates[i];
+  }
+  if (HsmChartCompile( &chart, states, n )) {
+    sprintf( name, "compiled %s", label );
+    BenchReport( name, count, TimeTransitions( count ) );
+    HsmChartRelease( &chart );
+  }
+}
+
+//---------------------------------------------------------------------------
+void BenchTransition()
+{
+  const int depths[]= { 1, 4, 8, BRANCH_MAX };
+  const int distances[]= { 1, 2, 4, 8 };
+  const long count= BENCH_EVENTS;
+  int d;
+  for (d=0; d< sizeof(depths)/sizeof(depths[0]); ++d) {
+    char label[64];
+    sprintf( label, "depth %d", depths[d] );
+    TimeBoth( label, depths[d], depths[d], count );
+  }
+  for (d=0; d< sizeof(distances)/sizeof(distances[0]); ++d) {
+    char label[64];
+    sprintf( label, "depth %d, lca distance %d", BRANCH_MAX, distances[d] );
+    TimeBoth( label, BRANCH_MAX, distances[d], count );
+  }
+}
@@ -0,0 +1,90 @@
+/**
+ * @file arena.c
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ * 
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_DEFAULT_BLOCK (16*1024)
+
+//---------------------------------------------------------------------------
+/**
+ * header for each block; the union keeps the allocations after it aligned.
+ */
+struct arena_block_rec
+{
+    union {
+        arena_block_t* next;
+        double align_double;
+        void* align_ptr;
+        long align_long;
+    } u;
+};
+
+// round up to the alignment of the block header 
+#define ARENA_ALIGN( size ) (((size) + sizeof(arena_block_t)-1) & ~(sizeof(arena_block_t)-1))
+
+//---------------------------------------------------------------------------
+void Arena_Init( arena_t* arena, size_t block_size )
+{
+    arena->blocks= NULL;
+    arena->next= arena->end= NULL;
+    arena->block_size= block_size ? ARENA_ALIGN( block_size ) : ARENA_DEFAULT_BLOCK;
+}
+
+//---------------------------------------------------------------------------
+void* Arena_Alloc( arena_t* arena, size_t size )
+{
+    void* ret= NULL;
+    size= ARENA_ALIGN( size ? size : 1 );
+    if (size <= (size_t)(arena->end - arena->next)) {
+        ret= arena->next;
+        arena->next+= size;
+    }
+    else {
+        // big requests get their own block, so they dont waste the rest of the current one.
+        const int own= size > arena->block_size/4;
+        const size_t bytes= sizeof(arena_block_t) + (own ? size : arena->block_size);
+        arena_block_t* block= (arena_block_t*) malloc( bytes );
+        if (block) {
+            char* start= (char*) (block+1);
+            ret= start;
+            if (own && arena->blocks) {
+                // tuck it behind the current block
+                block->u.next= arena->blocks->u.next;
+                arena->blocks->u.next= block;
+            }
+            else {
+                block->u.next= arena->blocks;
+                arena->blocks= block;
+                arena->next= start + size;
+                arena->end= start + (own ? size : arena->block_size);
+            }
+        }
+    }
+    if (ret) {
+        memset( ret, 0, size );
+    }
+    return ret;
+}
+
+//---------------------------------------------------------------------------
+void Arena_Release( arena_t* arena )
+{
+    arena_block_t* block= arena->blocks;
+    while (block) {
+        arena_block_t* next= block->u.next;
+        free( block );
+        block= next;
+    }
+    arena->blocks= NULL;
+    arena->next= arena->end= NULL;
+}
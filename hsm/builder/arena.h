@@ -0,0 +1,58 @@
+/**
+ * @file arena.h
+ *
+ * Block allocator for the builder.
+ *
+ * Every object the builder creates lives until hsmShutdown(), 
+ * so rather than allocating, and freeing, each one separately, 
+ * objects are carved out of large blocks in the order they are declared
+ * ( which keeps a state's handlers, guards, and actions near the state ), 
+ * and the blocks are all freed together.
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ * 
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#pragma once
+#ifndef __HSM_ARENA_H__
+#define __HSM_ARENA_H__
+
+#include <stddef.h>
+
+typedef struct arena_rec arena_t;
+typedef struct arena_block_rec arena_block_t;
+
+/**
+ * a list of blocks, and the unused part of the newest one.
+ */
+struct arena_rec
+{
+    arena_block_t* blocks;  // newest first
+    char* next;             // next free byte in the current block
+    char* end;              // end of the current block
+    size_t block_size;      // size of each new block
+};
+
+/**
+ * Prepare an empty arena.
+ * @param arena Arena to initialize.
+ * @param block_size Bytes per block; 0 for a default size.
+ */
+void Arena_Init( arena_t* arena, size_t block_size );
+
+/**
+ * Allocate zeroed memory, aligned for any of the builder's objects.
+ * Requests bigger than a quarter block get a block of their own.
+ * @return NULL if out of memory.
+ */
+void* Arena_Alloc( arena_t* arena, size_t size );
+
+/**
+ * Free every allocation made from the arena; the arena can be reused afterwards.
+ */
+void Arena_Release( arena_t* arena );
+
+#endif // #ifndef __HSM_ARENA_H__
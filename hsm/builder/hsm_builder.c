@@ -9,6 +9,8 @@
  * See License.txt for complete information.
  */
 #include <hsm/hsm_machine.h>
+#include <hsm/hsm_chart.h>
+#include "arena.h"
 #include "hash.h"
 #include "hsm_builder.h"
 
@@ -46,6 +48,8 @@ typedef struct process_rec  process_t;
 typedef struct process_rec_ud  process_ud_t;
 typedef struct process_rec_raw process_raw_t;
 typedef struct handler_rec  handler_t;
+typedef struct dispatch_rec dispatch_t;
+typedef struct dispatch_slot_rec dispatch_slot_t;
 
 //---------------------------------------------------------------------------
 /**
@@ -67,12 +71,16 @@ struct state_rec
     void * exit_ud;
 
     process_t* process;   // list of processors to handle events
+
+    hsm_callback_event_id event_id; // keys events for the dispatch table
+    dispatch_t* dispatch;           // the process list sorted by event key; null if no handler has a key
 };
 
 // querries for build status
 #define Entry_ReadyToBuild( e )     ((e) && !(e)->clientData)
 #define Entry_FinishedBuilding( e ) ((e) &&  (e)->clientData && (((hsm_state)(e)->clientData)->process== RunGenericEvent))
 #define Entry_BuildInProgress( e )  ((e) &&  (e)->clientData && (((hsm_state)(e)->clientData)->process!= RunGenericEvent))
+#define Entry_IsHistory( e )        ((e) &&  (e)->clientData && (((hsm_state)(e)->clientData)->history_type))
 
 //---------------------------------------------------------------------------
 /**
@@ -136,6 +144,7 @@ enum process_flags
     ProcessCallback=1<<0,           // user has specified a callback
     ProcessHandler= 1<<1,           // user has constructed a list of guards and actions via the builder interface
     ProcessUd     = 1<<2,           // there's user data to send to the callback
+    ProcessKeyed  = 1<<3,           // handler only reacts to events with a particular key ( hsmOnEventId )
     // now: you can already see, and i've already thought: 
     // can't the guards and actions all share the ud of the processor?
     // maybe so -- needs some investigation.
@@ -196,8 +205,33 @@ struct handler_rec
     guard_t *guard;
     action_t *actions;      // if we do match: we may have things to do
     hash_entry_t* target;   //             not to mention, places to '.
+    int event_id;           // with ProcessKeyed, the key of the events we react to.
+};
+
+/**
+ * one key in a dispatch table.
+ */
+struct dispatch_slot_rec
+{
+    int id;
+    const process_t** run;  // null terminated, in process list order; null for an unused slot.
+};
+
+/**
+ * a state's process list, pre-filtered by event key, built by hsmEnd().
+ * each key's list holds the handlers for that key, interleaved with the processors that have no key,
+ * so running a list gives the same results as walking the whole process list, minus the handlers that couldnt match.
+ * it's allocated as a single block: the slots, then the lists.
+ */
+struct dispatch_rec
+{
+    int mask;                   // number of slots minus one
+    const process_t** others;   // null terminated list of processors without a key, for keys not in the table.
+    dispatch_slot_t slots[1];
 };
 
+#define DISPATCH_HASH( id ) (((unsigned int)(id) * 2654435761u) >> 16)
+
 /**
  * state_t extends hsm_status directly
  */
@@ -223,6 +257,65 @@ static void RunGenericExit( hsm_status status )
     state->exit( status, state->exit_ud );
 }
 
+//---------------------------------------------------------------------------
+/**
+ * run time helper to run a single event processor
+ */
+static hsm_state RunProcess( const process_t* et, hsm_status status )
+{
+    hsm_state next_state=NULL;
+    if (et->flags & ProcessCallback) {
+        next_state= CALL_PROCESS( et, status );
+    }
+    // this block of code could have been installed as a custom process callback
+    // but this avoids a separate function call, and is pretty straight forward
+    // dont know, maybe i will revist for improved code aethetics
+    else {
+        const handler_t * handler= (const handler_t*)et;
+        // determine if some guard blocks the event from running
+        guard_t* guard;
+        for (guard= handler->guard; guard; guard=guard->next) {
+            if (!CALL_GUARD( guard, status )) {
+                break;
+            }
+        }
+        // no guard blocks this handler from running,:
+        if (!guard) {
+            // run action(s)
+            action_t* at;
+            for (at= handler->actions; at; at=at->next) {
+                at->run( status, at->action_data );
+            }
+            // transition to target, or flag as handled.
+            if (handler->target) {
+                next_state= (hsm_state) handler->target->clientData;
+            }
+            else {
+                next_state= HsmStateHandled();
+            }
+        }
+    }
+    return next_state;
+}
+
+//---------------------------------------------------------------------------
+/**
+ * run time helper to find the processors for an event key.
+ */
+static const process_t** FindDispatch( const dispatch_t* dispatch, int id )
+{
+    const process_t** run= dispatch->others;
+    unsigned int i;
+    for (i= DISPATCH_HASH( id ); dispatch->slots[ i & dispatch->mask ].run; ++i) {
+        const dispatch_slot_t* slot= &dispatch->slots[ i & dispatch->mask ];
+        if (slot->id == id) {
+            run= slot->run;
+            break;
+        }
+    }
+    return run;
+}
+
 //---------------------------------------------------------------------------
 /**
  * run time helper to reflect singal event calls to the right guards and actions
@@ -231,53 +324,110 @@ static hsm_state RunGenericEvent( hsm_status status )
 {
     hsm_state next_state=NULL;
     state_t* state= StateFromStatus( status );
+    if (state->dispatch) {
+        // only the processors that could possibly match
+        const process_t** run= FindDispatch( state->dispatch, state->event_id( status->evt ) );
+        for (; *run && !next_state; ++run) {
+            next_state= RunProcess( *run, status );
+        }
+    }
+    else {
+        // look through the specified event processors
+        const process_t* et;
+        for (et= state->process; et && !next_state; et=et->next) {
+            next_state= RunProcess( et, status );
+        }
+    }
+    return next_state;
+}
+
+//---------------------------------------------------------------------------
+/**
+ * @internal sort a finished state's processors by event key.
+ * @return HSM_FALSE if there are keyed handlers, but no way to key events, or no memory.
+ */
+static hsm_bool NewDispatch( arena_t* arena, state_t* state, hsm_callback_event_id event_id )
+{
+    hsm_bool okay= HSM_TRUE;
+    int keyed=0, others=0, ids=0;
     const process_t* et;
-    // look through the specified event processors
-    for (et= state->process; et && !next_state; et=et->next) {
-        if (et->flags & ProcessCallback) {
-            next_state= CALL_PROCESS( et, status );
+    for (et= state->process; et; et=et->next) {
+        if (!(et->flags & ProcessKeyed)) {
+            ++others;
         }
-        // this block of code could have been installed as a custom process callback
-        // but this avoids a separate function call, and is pretty straight forward
-        // dont know, maybe i will revist for improved code aethetics
         else {
-            handler_t * handler= (handler_t*)et;
-            // determine if some guard blocks the event from running
-            guard_t* guard;
-            for (guard= handler->guard; guard; guard=guard->next) {
-                if (!CALL_GUARD( guard, status )) {
+            // count each key only the first time we see it
+            const process_t* prev;
+            for (prev= state->process; prev!=et; prev=prev->next) {
+                if ((prev->flags & ProcessKeyed) && ((const handler_t*)prev)->event_id == ((const handler_t*)et)->event_id) {
                     break;
                 }
             }
-            // no guard blocks this handler from running,:
-            if (!guard) {
-                // run action(s)
-                action_t* at;
-                for (at= handler->actions; at; at=at->next) {
-                    at->run( status, at->action_data );
-                }
-                // transition to target, or flag as handled.
-                if (handler->target) {
-                    next_state= (hsm_state) handler->target->clientData;
+            if (prev==et) {
+                ++ids;
+            }
+            ++keyed;
+        }
+    }
+    if (keyed) {
+        okay= HSM_FALSE;
+        if (event_id) {
+            // at most half full, so that misses end quickly
+            int slots=2, lists= (ids+1)*(others+1) + keyed;
+            dispatch_t* dispatch;
+            while (slots < 2*ids) {
+                slots<<=1;
+            }
+            dispatch= (dispatch_t*) Arena_Alloc( arena, sizeof(dispatch_t) + (slots-1)*sizeof(dispatch_slot_t) + lists*sizeof(process_t*) );
+            if (dispatch) {
+                const process_t** out= (const process_t**) (dispatch->slots + slots);
+                dispatch->mask= slots-1;
+                dispatch->others= out;
+                for (et= state->process; et; et=et->next) {
+                    if (!(et->flags & ProcessKeyed)) {
+                        *out++= et;
+                    }
                 }
-                else {
-                    next_state= HsmStateHandled();
+                *out++= NULL;
+                for (et= state->process; et; et=et->next) {
+                    if (et->flags & ProcessKeyed) {
+                        const int id= ((const handler_t*)et)->event_id;
+                        unsigned int i= DISPATCH_HASH( id );
+                        dispatch_slot_t* slot;
+                        for (slot= &dispatch->slots[ i & dispatch->mask ]; slot->run && slot->id != id; slot= &dispatch->slots[ ++i & dispatch->mask ]) {
+                        }
+                        if (!slot->run) {
+                            const process_t* match;
+                            slot->id= id;
+                            slot->run= out;
+                            for (match= state->process; match; match=match->next) {
+                                if (!(match->flags & ProcessKeyed) || ((const handler_t*)match)->event_id == id) {
+                                    *out++= match;
+                                }
+                            }
+                            *out++= NULL;
+                        }
+                    }
                 }
+                state->event_id= event_id;
+                state->dispatch= dispatch;
+                okay= HSM_TRUE;
             }
-        }            
+        }
     }
-    return next_state;
+    return okay;
 }
+
 //---------------------------------------------------------------------------
 /**
  * @internal construct a new state object
  * @param name State's name
  * @param namelen if non-zero, that number of name chars gets copied.
  */
-static state_t* NewState( state_t* parent, const char * name, int namelen )
+static state_t* NewState( arena_t* arena, state_t* parent, const char * name, int namelen )
 {   
-    // note: calloc is keeping strncpy null terminated
-    state_t* state=(state_t*) calloc( 1, sizeof( state_t ) + namelen + 1 );
+    // note: the arena's zeroed memory is keeping strncpy null terminated
+    state_t* state=(state_t*) Arena_Alloc( arena, sizeof( state_t ) + namelen + 1 );
     if (state) {
         if (!namelen) {
             state->desc.name= name;
@@ -306,15 +456,37 @@ static state_t* NewState( state_t* parent, const char * name, int namelen )
     return state;
 }
 
+//---------------------------------------------------------------------------
+/**
+ * @internal construct a new history pseudo-state.
+ * unlike NewState, the pseudo-state never becomes its parent's initial state.
+ */
+static hsm_state_t* NewHistory( arena_t* arena, state_t* parent, const char * name, int type )
+{
+    const size_t namelen= name ? strlen( name ) : 0;
+    hsm_state_t* history= (hsm_state_t*) Arena_Alloc( arena, sizeof( hsm_state_t ) + namelen + 1 );
+    if (history) {
+        char* dest= (char*) ((size_t)history) + sizeof( hsm_state_t );
+        if (name) {
+            strncpy( dest, name, namelen );
+        }
+        history->name= dest;
+        history->parent= &(parent->desc);
+        history->depth= parent->desc.depth+1;
+        history->history_type= type;
+    }
+    return history;
+}
+
 //---------------------------------------------------------------------------
 /**
  * @internal construct a new event object
  */
-static process_t* NewProcessUD( state_t* state, hsm_callback_process_ud process, void * process_data )
+static process_t* NewProcessUD( arena_t* arena, state_t* state, hsm_callback_process_ud process, void * process_data )
 {
     process_t* ret= NULL;
     if (state && process) {
-        process_ud_t * processor= (process_ud_t*) calloc( 1, sizeof( process_ud_t ) );
+        process_ud_t * processor= (process_ud_t*) Arena_Alloc( arena, sizeof( process_ud_t ) );
         if (processor) {
             ret= &(processor->core);
             // set up the processor cbs
@@ -333,11 +505,11 @@ static process_t* NewProcessUD( state_t* state, hsm_callback_process_ud process,
 /**
  * @internal construct a new event object
  */
-static process_t* NewProcessRaw( state_t* state, hsm_callback_process_event process )
+static process_t* NewProcessRaw( arena_t* arena, state_t* state, hsm_callback_process_event process )
 {
     process_t* ret= NULL;
     if (state && process) {
-        process_raw_t* processor= (process_raw_t*) calloc( 1, sizeof( process_raw_t ) );
+        process_raw_t* processor= (process_raw_t*) Arena_Alloc( arena, sizeof( process_raw_t ) );
         if (processor) {
             ret= &(processor->core);
             // set up the processor cbs
@@ -355,11 +527,11 @@ static process_t* NewProcessRaw( state_t* state, hsm_callback_process_event proc
 /**
  * @internal construct a new event object
  */
-static process_t* NewHandler( state_t* state )
+static process_t* NewHandler( arena_t* arena, state_t* state )
 {   
     process_t* ret=0;
     if (state) {
-        handler_t* handler= (handler_t*) calloc( 1, sizeof( handler_t ) );
+        handler_t* handler= (handler_t*) Arena_Alloc( arena, sizeof( handler_t ) );
         if (handler) {
             ret= &(handler->core);
             // link to the list of (other) processors for this state:
@@ -375,11 +547,11 @@ static process_t* NewHandler( state_t* state )
 /**
  * @internal construct a new action object
  */
-static action_t* NewAction( handler_t* handler, hsm_callback_action_ud run, void * action_data )
+static action_t* NewAction( arena_t* arena, handler_t* handler, hsm_callback_action_ud run, void * action_data )
 {
     action_t* action= NULL;
     if (handler && run) {
-        action= (action_t*) calloc( 1, sizeof( action_t ) );
+        action= (action_t*) Arena_Alloc( arena, sizeof( action_t ) );
         if (action) {
             // set:
             action->run= run;
@@ -396,11 +568,11 @@ static action_t* NewAction( handler_t* handler, hsm_callback_action_ud run, void
 /**
  * @internal construct a new guard
  */
-static guard_t* NewGuardUD( handler_t* handler, hsm_callback_guard_ud match, void * guard_data )
+static guard_t* NewGuardUD( arena_t* arena, handler_t* handler, hsm_callback_guard_ud match, void * guard_data )
 {   
     guard_t *ret= NULL;
     if (handler && match) {
-        guard_ud_t* guard= (guard_ud_t*) calloc( 1, sizeof( guard_ud_t ) );
+        guard_ud_t* guard= (guard_ud_t*) Arena_Alloc( arena, sizeof( guard_ud_t ) );
         if (guard) {
             // set the default matching function
             guard->match= match;
@@ -415,11 +587,11 @@ static guard_t* NewGuardUD( handler_t* handler, hsm_callback_guard_ud match, voi
     return ret;
 }
 
-static guard_t* NewGuardRaw( handler_t* handler, hsm_callback_guard match )
+static guard_t* NewGuardRaw( arena_t* arena, handler_t* handler, hsm_callback_guard match )
 {   
     guard_t *ret= NULL;
     if (handler && match) {
-        guard_raw_t* guard= (guard_raw_t*) calloc( 1, sizeof( guard_raw_t ) );
+        guard_raw_t* guard= (guard_raw_t*) Arena_Alloc( arena, sizeof( guard_raw_t ) );
         if (guard) {
             // set the default matching function
             guard->match= match;
@@ -461,10 +633,12 @@ enum builder_events
 
     _hsm_guard_ud,
     _hsm_guard_raw,
+    _hsm_event_id,
     
     _hsm_action_ud,
     //_hsm_action_raw,
     _hsm_goto,
+    _hsm_history,
 };
 
 /**
@@ -477,6 +651,8 @@ struct builder_rec
     state_t * current;          // inner most state that's b/t begin,end.
     int count;                  // nested count of states
     hash_table_t hash;          // a hash of states
+    arena_t arena;              // memory for the states and their handlers
+    hsm_callback_event_id event_id; // how to key events for hsmOnEventId()
 };
 
 /**
@@ -584,6 +760,15 @@ struct raw_action_event_rec
     hsm_callback_action  action;
 };
 
+typedef struct history_event_rec HistoryEvent;
+struct history_event_rec
+{
+    BuildEvent core;
+    int id;
+    const char * name;
+    int history_type;
+};
+
 typedef struct action_event_rec ActionEvent;
 struct action_event_rec
 {
@@ -623,6 +808,10 @@ hsm_state HsmBuildingEvent( hsm_status status )
                 if (Entry_FinishedBuilding( entry )) {
                     Builder_Error( builder, "state already finished building via hsmEnd.");    
                 }
+                else
+                if (Entry_IsHistory( entry )) {
+                    Builder_Error( builder, "history states can't be built.");
+                }
                 else {
                     Builder_Error( builder, "state already being built via hsmBegin.");
                 }
@@ -663,7 +852,7 @@ hsm_context HsmBuildingStateEnter( hsm_status status )
     
     HSM_ASSERT( status->evt->type == _hsm_begin );
     entry= Hash_CreateEntry( &(builder->hash), evt->id, 0 );
-    new_state= NewState( parent, evt->name, evt->namelen );
+    new_state= NewState( &builder->arena, parent, evt->name, evt->namelen );
         
     HSM_ASSERT( new_state && entry->clientData == 0);
     if (new_state && entry->clientData == 0) 
@@ -755,7 +944,7 @@ hsm_state HsmBuildingStateEvent( hsm_status status )
         case _hsm_process_raw: {
             const RawProcessEvent* event= (const RawProcessEvent*)status->evt;
             if (event->process) {
-                NewProcessRaw( current, event->process );
+                NewProcessRaw( &builder->arena, current, event->process );
                 ret= HsmBuildingBody();
             }
             else {
@@ -767,7 +956,7 @@ hsm_state HsmBuildingStateEvent( hsm_status status )
         case _hsm_process_ud: {
             const ProcessEventUd* event= (const ProcessEventUd*)status->evt;
             if (event->process) {
-                NewProcessUD( current, event->process, event->process_data );
+                NewProcessUD( &builder->arena, current, event->process, event->process_data );
                 ret= HsmBuildingBody();
             }
             else {
@@ -779,11 +968,32 @@ hsm_state HsmBuildingStateEvent( hsm_status status )
         // start building a event handler
         case _hsm_guard_raw: 
         case _hsm_guard_ud: 
+        case _hsm_event_id: 
         {
             ret= HsmBuildingHandler();
         }
         break;
+        case _hsm_history: {
+            const HistoryEvent* event= (const HistoryEvent*)status->evt;
+            hash_entry_t* entry= Hash_FindEntry( &builder->hash, event->id );
+            hsm_state_t* history= (!current->desc.history && Entry_ReadyToBuild( entry )) ?
+                NewHistory( &builder->arena, current, event->name, event->history_type ) : NULL;
+            if (history) {
+                entry->clientData= history;
+                current->desc.history= history;
+                ret= HsmBuildingBody();
+            }
+            else {
+                Builder_Error( builder, current->desc.history ? "history already specified." : 
+                                        !Entry_ReadyToBuild( entry ) ? "history name already in use." : "couldn't allocate history." );
+                ret= HsmStateError();
+            }
+        }
+        break;
         case _hsm_end: {
+            if (!NewDispatch( &builder->arena, current, builder->event_id )) {
+                Builder_Error( builder, builder->event_id ? "couldnt allocate dispatch table." : "hsmOnEventId requires hsmEventIds." );
+            }
             // setup the event handler, this also a key that the state is good to go.
             current->desc.process= RunGenericEvent;
 
@@ -809,16 +1019,17 @@ hsm_state HsmBuildingStateEvent( hsm_status status )
 
 static guard_t* NewGuardFromEvent( hsm_status status, handler_t* handler )
 {
+    builder_t* builder= ((builder_t*)status->ctx);
     guard_t* guard=0;
     if (handler) {
         if (status->evt->type == _hsm_guard_ud) {
             const GuardEventUD* event= (const GuardEventUD*)status->evt;
-            guard= NewGuardUD( handler, event->guard, event->guard_data );
+            guard= NewGuardUD( &builder->arena, handler, event->guard, event->guard_data );
         }
         else 
         if (status->evt->type ==  _hsm_guard_raw) {
             const RawGuardEvent * event= (const RawGuardEvent*)status->evt;
-            guard= NewGuardRaw( handler, event->guard  );
+            guard= NewGuardRaw( &builder->arena, handler, event->guard  );
         }
         else {
             HSM_ASSERT(0 && "unexpected event");
@@ -832,9 +1043,18 @@ hsm_context HsmBuildingHandlerEnter( hsm_status status )
     builder_t * builder= ((builder_t*)status->ctx);
     state_t* state= Builder_CurrentState( builder );
     guard_t* guard=0;
-    handler_t* handler= (handler_t*) NewHandler( state );
+    handler_t* handler= (handler_t*) NewHandler( &builder->arena, state );
     HSM_ASSERT( handler );
-    guard= NewGuardFromEvent( status, handler );
+    if (status->evt->type == _hsm_event_id) {
+        // the key acts as the handler's first guard
+        if (handler) {
+            handler->core.flags|= ProcessKeyed;
+            handler->event_id= ((const StateEvent*)status->evt)->id;
+        }
+    }
+    else {
+        guard= NewGuardFromEvent( status, handler );
+    }
     // keep the original context
     return status->ctx;
 }
@@ -855,7 +1075,8 @@ hsm_state HsmBuildingHandlerEvent( hsm_status status )
             case _hsm_goto: {
                 const StateEvent* event= (const StateEvent*)status->evt;
                 const int go= event->id;
-                hash_entry_t* target= Hash_FindEntry( &(builder->hash), go );
+                // like hsmGoto(), an id can name a state before its hsmBegin(): ex. one computed by hsm::Id().
+                hash_entry_t* target= go ? Hash_CreateEntry( &(builder->hash), go, 0 ) : NULL;
                 if (!handler->target && target) {
                     handler->target= target;
                     ret= HsmStateHandled();
@@ -886,7 +1107,7 @@ hsm_state HsmBuildingHandlerEvent( hsm_status status )
             break;
             case _hsm_action_ud: {
                 const ActionEvent* action_event= (const ActionEvent*)status->evt;
-                if (NewAction( handler, action_event->action, action_event->action_data )) {
+                if (NewAction( &builder->arena, handler, action_event->action, action_event->action_data )) {
                     ret= HsmStateHandled();
                 }
                 else {
@@ -916,6 +1137,7 @@ int hsmStartup()
 {
     if (!gStartCount) {
         Hash_InitTable( &gBuilder.hash );
+        Arena_Init( &gBuilder.arena, 0 );
         HsmStart( HsmMachineWithContext( &gMachine, &(gBuilder.ctx) ), HsmBuilding() );
     }
     return ++gStartCount;
@@ -925,9 +1147,13 @@ int hsmStartup()
 int hsmShutdown()
 {
     if (gStartCount>0) {
-        const hsm_bool free_client_data= HSM_TRUE;
+        // the states live in the arena
+        const hsm_bool free_client_data= HSM_FALSE;
         Hash_DeleteTable( &gBuilder.hash, free_client_data );
-        --gStartCount;
+        Arena_Release( &gBuilder.arena );
+        if (--gStartCount==0) {
+            gBuilder.event_id= 0;
+        }
     }        
     return gStartCount;
 }
@@ -939,7 +1165,7 @@ hsm_state hsmResolveId( int id )
     HSM_ASSERT( gStartCount );
     if ( gStartCount && HsmIsRunning(&gMachine.core) ) {
         const hash_entry_t* entry= Hash_FindEntry( &(gBuilder.hash), id );
-        ret= Entry_FinishedBuilding( entry ) ? (hsm_state) entry->clientData : (hsm_state) 0;
+        ret= (Entry_FinishedBuilding( entry ) || Entry_IsHistory( entry )) ? (hsm_state) entry->clientData : (hsm_state) 0;
     }        
     return ret;
 }
@@ -950,6 +1176,44 @@ hsm_state hsmResolve( const char * name )
     return hsmResolveId( hsmState( name ) );
 }
 
+//---------------------------------------------------------------------------
+hsm_bool hsmCompileId( int id, hsm_chart_t* chart )
+{
+    hsm_bool okay= HSM_FALSE;
+    hsm_state top= hsmResolveId( id );
+    if (top && chart) {
+        hsm_state* states= (hsm_state*) malloc( gBuilder.hash.numEntries * sizeof(hsm_state) );
+        if (states) {
+            int i, count=0;
+            // every finished state that has 'top' somewhere above it
+            for (i=0; i< gBuilder.hash.size; ++i) {
+                const hash_entry_t* entry;
+                for (entry= gBuilder.hash.bucketPtr[i]; entry; entry= entry->next) {
+                    if (Entry_FinishedBuilding( entry )) {
+                        hsm_state state= (hsm_state) entry->clientData;
+                        hsm_state track;
+                        for (track= state; track && track->depth >= top->depth; track= track->parent) {
+                            if (track == top) {
+                                states[count++]= state;
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+            okay= HsmChartCompile( chart, states, count );
+            free( states );
+        }
+    }
+    return okay;
+}
+
+//---------------------------------------------------------------------------
+hsm_bool hsmCompile( const char * name, hsm_chart_t* chart )
+{
+    return hsmCompileId( hsmState( name ), chart );
+}
+
 //---------------------------------------------------------------------------
 hsm_bool hsmStartId( hsm_machine hsm, int id )
 {
@@ -1096,6 +1360,25 @@ void hsmIfUD( hsm_callback_guard_ud guard, void *guard_data )
     }        
 }
 
+//---------------------------------------------------------------------------
+void hsmOnEventId( int id )
+{
+    HSM_ASSERT( gStartCount );
+    if ( gStartCount ) {
+        StateEvent evt= { _hsm_event_id, id }; 
+        HsmSignalEvent( &gMachine.core, &evt.core );
+    }        
+}
+
+//---------------------------------------------------------------------------
+void hsmEventIds( hsm_callback_event_id event_id )
+{
+    HSM_ASSERT( gStartCount );
+    if ( gStartCount ) {
+        gBuilder.event_id= event_id;
+    }        
+}
+
 //---------------------------------------------------------------------------
 void hsmAndUD( hsm_callback_guard_ud guard, void *guard_data )
 {
@@ -1122,6 +1405,32 @@ void hsmGotoId( int id )
     }        
 }
 
+//---------------------------------------------------------------------------
+static int hsmHistoryType( const char * name, int history_type )
+{
+    int ret=0;
+    const int id= hsmState( name );
+    if (id) {
+        HistoryEvent evt= { _hsm_history, id, name, history_type };
+        if (HsmSignalEvent( &gMachine.core, &evt.core )) {
+            ret= id;
+        }
+    }
+    return ret;
+}
+
+//---------------------------------------------------------------------------
+int hsmHistory( const char * name )
+{
+    return hsmHistoryType( name, HSM_HISTORY_SHALLOW );
+}
+
+//---------------------------------------------------------------------------
+int hsmDeepHistory( const char * name )
+{
+    return hsmHistoryType( name, HSM_HISTORY_DEEP );
+}
+
 //---------------------------------------------------------------------------
 void hsmRunUD( hsm_callback_action_ud action, void *action_data )
 {
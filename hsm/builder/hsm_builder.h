@@ -68,6 +68,16 @@ typedef hsm_bool(*hsm_callback_guard_ud)( hsm_status status, void *guard_data );
  */
 typedef hsm_callback_action_ud hsm_callback_exit_ud;
 
+/**
+ * Event key callback.
+ * 
+ * @param evt An event sent to a builder state.
+ * @return The key hsmOnEventId() handlers match against; for instance: the event's type.
+ * 
+ * @see hsmEventIds, hsmOnEventId
+ */
+typedef int(*hsm_callback_event_id)( hsm_event evt );
+
 /**
  * Builder initialization.
  * <b>Must</b> be called before the very first.
@@ -207,6 +217,29 @@ void hsmIf( hsm_callback_guard guard );
  */
 void hsmIfUD( hsm_callback_guard_ud guard, void* guard_data );
 
+/**
+ * Begin the declaration of a new event handler which only reacts to events with the passed key.
+ * 
+ * Works like hsmIf() with the key as the guard; hsmAndUD, hsmRunUD, and hsmGoto all apply.
+ * hsmEnd() sorts the state's handlers into a table by key, so an event only visits the handlers for its key 
+ * ( plus any handlers and callbacks declared without a key ), rather than testing every guard in turn.
+ * Handlers still run in the same order they would without the table.
+ * 
+ * @param id Key returned by the hsm_callback_event_id for events this handler reacts to.
+ * @note Requires hsmEventIds() before the state's hsmEnd().
+ * @see hsmEventIds, hsmIf
+ */
+void hsmOnEventId( int id );
+
+/**
+ * Tell the builder how to find the key of an event.
+ * 
+ * @param event_id Callback which returns the key for an event; 
+ * applies to every state finished with hsmEnd() until hsmShutdown().
+ * @see hsmOnEventId
+ */
+void hsmEventIds( hsm_callback_event_id event_id );
+
 /*! Not Implemented. Use hsmAndUD with NULL userdata instead.
  *  @see hsmAndUD
  */
@@ -233,12 +266,31 @@ void hsmGoto( const char * name );
 /**
  * An event handler started by hsmIf(UD) should transition to the id'd state.
  * 
- * @param state The id of a state returned by hsmState() or hsmRef() to transition to. 
+ * @param state The id of a state returned by hsmState() or hsmRef() to transition to; 
+ * or one computed ahead of time, by hsm::Id() or tools/hsmids.c.
  *
  * @see hsmGoto, hsmState, hsmEnd
  */
 void hsmGotoId( int state );
 
+/**
+ * Declare a shallow history pseudo-state for the state currently being built.
+ * Transitions to the history ( via hsmGoto ) return to whichever child was last active;
+ * when there's nothing to return to yet, they enter the state itself, and its first child.
+ * @param name Name of the pseudo-state; just like state names, it must be unique.
+ * @return Id of the pseudo-state, usable with hsmGotoId() and hsmResolveId(); 0 on error.
+ * @note Machines only remember history given a history table, see HsmMachineHistory().
+ * @see HSM_HISTORY, hsmDeepHistory
+ */
+int hsmHistory( const char * name );
+
+/**
+ * Declare a deep history pseudo-state for the state currently being built.
+ * Transitions to the history return to the innermost state last active, however deep.
+ * @see hsmHistory, HSM_DEEP_HISTORY
+ */
+int hsmDeepHistory( const char * name );
+
 
 /*! Not Implemented. Use hsmRunUD with NULL userdata instead.
  *  @see hsmRunUD
@@ -283,6 +335,24 @@ hsm_state hsmResolve( const char * name );
  */
 hsm_state hsmResolveId( int id );
 
+struct hsm_chart_rec;
+
+/**
+ * Freeze a built state, and all of its descendants, into a compiled chart.
+ *
+ * @param id A state id returned by hsmState() or hsmRef().
+ * @param chart Chart to compile; release with HsmChartRelease() before hsmShutdown().
+ * @return #HSM_FALSE if the state hasn't finished building, or the chart couldn't compile.
+ *
+ * @see HsmChartCompile, hsmCompile
+ */
+hsm_bool hsmCompileId( int id, struct hsm_chart_rec* chart );
+
+/**
+ * @see hsmCompileId
+ */
+hsm_bool hsmCompile( const char * name, struct hsm_chart_rec* chart );
+
 /**
  * Macro for seeding hsmStringHash
  * @param string String to hash.
@@ -0,0 +1,75 @@
+/**
+ * @file hsm_builder.hpp
+ *
+ * Header only C++ ( C++14 ) helpers for the builder: state ids computed at compile time.
+ *
+ * hsmState() hashes a name every time it's called. hsm::Id() computes the very same hash
+ * as a constant expression, so the *Id flavors of the builder functions never touch a string at run time:
+ *
+ * @code
+ * hsmBegin( "Top", 0 );
+ *     hsmIf( IsGo );
+ *     hsmGotoId( HSM_ID( "Go" ) );     // the target can be declared later, just like hsmGoto()
+ *     hsmBegin( "Go", 0 );
+ *     hsmEnd();
+ * hsmEnd();
+ * hsmStartId( hsm, HSM_ID( "Top" ) );
+ * @endcode
+ *
+ * For C, tools/hsmids.c writes the same ids to a header.
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#pragma once
+#ifndef __HSM_BUILDER_HPP__
+#define __HSM_BUILDER_HPP__
+
+#include <type_traits>
+
+extern "C" {
+#include <hsm/hsm_machine.h>
+#include "hsm_builder.h"
+}
+
+namespace hsm {
+
+namespace detail {
+// HsmLowerTable: only ascii letters change.
+constexpr unsigned int Lower( char ch ) {
+    return (ch >= 'A' && ch <= 'Z') ? (unsigned int)(ch - 'A' + 'a') : (unsigned int)(unsigned char) ch;
+}
+} // namespace detail
+
+//---------------------------------------------------------------------------
+/**
+ * hsmStringHash(), as a constant expression.
+ */
+constexpr unsigned int Hash32( const char * string, unsigned int seed= 0x811c9dc5u )
+{
+    for (; *string; ++string) {
+        seed= (seed ^ detail::Lower( *string )) * 0x01000193u;
+    }
+    return seed;
+}
+
+/**
+ * The id hsmState() returns for a name.
+ */
+constexpr int Id( const char * name )
+{
+    return (int) Hash32( name );
+}
+
+} // namespace hsm
+
+/**
+ * A state id, guaranteed to be computed by the compiler.
+ */
+#define HSM_ID( name ) (std::integral_constant< int, hsm::Id( name ) >::value)
+
+#endif // #ifndef __HSM_BUILDER_HPP__
@@ -0,0 +1,47 @@
+/**
+ * @file hsm_active.c
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "hsm_machine.h"
+#include "hsm_active.h"
+#include "hsm_chart.h"
+
+#include <assert.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+hsm_bool HsmMachineActive( hsm_machine hsm, hsm_active_t* active, const hsm_chart_t* chart, hsm_uint64* bits )
+{
+  const hsm_bool okay= hsm && active && chart && bits && !hsm->current;
+  HSM_ASSERT( okay && "active sets need a compiled chart, and an unstarted machine" );
+  if (okay) {
+    memset( bits, 0, HSM_ACTIVE_WORDS( chart->count ) * sizeof(hsm_uint64) );
+    active->chart= chart;
+    active->bits= bits;
+    hsm->active= active;
+  }
+  return okay;
+}
+
+//---------------------------------------------------------------------------
+int HsmCountInState( const hsm_machine* machines, int count, hsm_state state, hsm_bool* results )
+{
+  int found=0;
+  if (machines && state) {
+    int i;
+    for (i=0; i<count; ++i) {
+      const hsm_bool in= HsmIsInState( machines[i], state );
+      found+= in;
+      if (results) {
+        results[i]= in;
+      }
+    }
+  }
+  return found;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file hsm_active.h
+ *
+ * Active configuration: a bit per state of a compiled chart, set while the state is active.
+ *
+ * Normally HsmIsInState() walks from the current state up to the root.
+ * A machine with an active set answers with a single bit test instead,
+ * and the sets of many machines can be scanned in bulk ( HsmCountInState ).
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#pragma once
+#ifndef __HSM_ACTIVE_H__
+#define __HSM_ACTIVE_H__
+
+#include "hsm_forwards.h"
+
+typedef struct hsm_active_rec hsm_active_t;
+
+/**
+ * Number of words needed for a chart of count states.
+ */
+#define HSM_ACTIVE_WORDS( count ) (((count)+63) >> 6)
+
+/**
+ * Bit of a chart index, within its word.
+ */
+#define HSM_ACTIVE_BIT( index ) (((hsm_uint64)1) << ((index) & 63))
+
+/**
+ * Test whether the chart state at the passed index is active.
+ */
+#define HsmActiveTest( active, index ) (((active)->bits[ (index) >> 6 ] & HSM_ACTIVE_BIT( index )) != 0)
+
+/**
+ * The active states of one machine, for the states of one chart.
+ * Bit i ( word i/64, bit i%64 ) is set while the state with hsm_state_rec::index i is active.
+ * States outside the chart aren't tracked.
+ *
+ * @see HsmMachineActive
+ */
+struct hsm_active_rec
+{
+    /**
+     * the chart whose states are tracked.
+     */
+    const struct hsm_chart_rec * chart;
+
+    /**
+     * HSM_ACTIVE_WORDS( chart->count ) words of bits, provided by the user.
+     */
+    hsm_uint64 * bits;
+};
+
+/**
+ * Give a machine an active set.
+ * Call before HsmStart(); from then on, HsmIsInState() tests a bit for states of the chart.
+ *
+ * @param hsm Machine to track.
+ * @param active Set to initialize; its lifetime must exceed the machine's use of it.
+ * @param chart Compiled chart whose states get tracked.
+ * @param bits Storage for HSM_ACTIVE_WORDS( chart->count ) words.
+ * @return #HSM_FALSE if the machine has already started.
+ */
+hsm_bool HsmMachineActive( hsm_machine hsm, hsm_active_t* active, const struct hsm_chart_rec* chart, hsm_uint64* bits );
+
+/**
+ * Determine which of many machines are in a state.
+ *
+ * @param machines Machines to test; those with an active set for the state's chart cost a bit test each.
+ * @param count Number of machines.
+ * @param state State to test for.
+ * @param results Optional, filled with HsmIsInState() for each machine.
+ * @return Number of machines in the state.
+ */
+int HsmCountInState( const hsm_machine* machines, int count, hsm_state state, hsm_bool* results );
+
+#endif // #ifndef __HSM_ACTIVE_H__
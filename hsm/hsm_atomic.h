@@ -0,0 +1,69 @@
+/**
+ * @file hsm_atomic.h
+ *
+ * Internal atomic operations used by the lock-free parts of hsm-statechart.
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#pragma once
+#ifndef __HSM_ATOMIC_H__
+#define __HSM_ATOMIC_H__
+
+/**
+ * Integer type for values shared between threads.
+ * Only access via the HsmAtomic macros.
+ */
+typedef volatile long hsm_atomic;
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+// msvc treats volatile reads as acquires, and volatile writes as releases.
+#define HsmAtomicLoad( p )           (*(p))
+#define HsmAtomicStore( p, v )       (*(p)= (v))
+#define HsmAtomicAdd( p, v )         _InterlockedExchangeAdd( (p), (v) )
+#define HsmAtomicCas( p, old, v )    (_InterlockedCompareExchange( (p), (v), (old) ) == (old))
+#define HsmAtomicLoadPtr( p )        (*(p))
+#define HsmAtomicStorePtr( p, v )    (*(p)= (v))
+#define HsmAtomicCasPtr( p, old, v ) (_InterlockedCompareExchangePointer( (void*volatile*)(p), (v), (old) ) == (old))
+#define HsmAtomicPause()             _mm_pause()
+#define HsmAtomicFence()             MemoryBarrier()
+#else
+/**
+ * Read a shared value; later reads wont move before this one.
+ */
+#define HsmAtomicLoad( p )           __atomic_load_n( (p), __ATOMIC_ACQUIRE )
+/**
+ * Publish a shared value; earlier writes wont move after this one.
+ */
+#define HsmAtomicStore( p, v )       __atomic_store_n( (p), (v), __ATOMIC_RELEASE )
+/**
+ * Add to a shared value, returning its previous value.
+ */
+#define HsmAtomicAdd( p, v )         __atomic_fetch_add( (p), (v), __ATOMIC_SEQ_CST )
+/**
+ * Change a shared value from old to v; evaluates to non-zero on success.
+ */
+#define HsmAtomicCas( p, old, v )    __sync_bool_compare_and_swap( (p), (old), (v) )
+#define HsmAtomicLoadPtr( p )        __atomic_load_n( (p), __ATOMIC_ACQUIRE )
+#define HsmAtomicStorePtr( p, v )    __atomic_store_n( (p), (v), __ATOMIC_RELEASE )
+#define HsmAtomicCasPtr( p, old, v ) __sync_bool_compare_and_swap( (p), (old), (v) )
+/**
+ * Full memory barrier.
+ */
+#define HsmAtomicFence()             __atomic_thread_fence( __ATOMIC_SEQ_CST )
+/**
+ * Spin wait hint.
+ */
+#if defined(__i386__) || defined(__x86_64__)
+#define HsmAtomicPause()             __builtin_ia32_pause()
+#else
+#define HsmAtomicPause()             (void)(0)
+#endif
+#endif
+
+#endif // #ifndef __HSM_ATOMIC_H__
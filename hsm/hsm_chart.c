@@ -0,0 +1,248 @@
+/**
+ * @file hsm_chart.c
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "hsm_chart.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+// the state descriptors are handed around as const, but the chart owns the back pointers.
+#define WRITABLE( state ) ((struct hsm_state_rec*)(state))
+
+//---------------------------------------------------------------------------
+/**
+ * @internal
+ * Determine the depth of the deepest state a transition from source to target doesnt exit.
+ * This mirrors the walk in HsmTransition() exactly: see the notes there about the scxml spec.
+ */
+static short HsmChartLcaDepth( const hsm_chart_t* chart, hsm_state source, hsm_state target )
+{
+    short lca;
+    if (source == target) {
+        // self transition: exit and re-enter
+        lca= (short)(source->depth-1);
+    }
+    else {
+        const hsm_state* spath= chart->paths + chart->roots[ source->index ];
+        const hsm_state* tpath= chart->paths + chart->roots[ target->index ];
+        const int min_depth= source->depth < target->depth ? source->depth : target->depth;
+        int d;
+        for (d=0; d<= min_depth && spath[d]==tpath[d]; ++d) {
+        }
+        lca= (short)(d-1);
+    #ifdef HSM_USE_EXTERNAL_TRANSITIONS
+        // source is an ancestor of target: exit and re-enter source
+        if (lca == source->depth) {
+            --lca;
+        }
+    #endif
+    }
+    return lca;
+}
+
+//---------------------------------------------------------------------------
+/**
+ * @internal
+ * Order the claimed states depth first, siblings in the order they were passed.
+ * Parents always come before their children, and every subtree is contiguous.
+ *
+ * @param states States claimed by the chart; hsm_state_rec::index holds their position in this list.
+ * @param order Filled with positions into states.
+ * @param scratch Room for 3*count ints.
+ */
+static void HsmChartDepthFirst( const hsm_state* states, int count, int* order, int* scratch )
+{
+    int* first= scratch;
+    int* next= scratch + count;
+    int* stack= scratch + 2*count;
+    int i, top=0, at=0;
+    for (i=0; i<count; ++i) {
+        first[i]= next[i]= -1;
+    }
+    // linking backwards leaves each list of children in the order passed.
+    for (i=count-1; i>=0; --i) {
+        hsm_state parent= states[i]->parent;
+        if (parent) {
+            next[i]= first[ parent->index ];
+            first[ parent->index ]= i;
+        }
+        else {
+            stack[top++]= i; // top most states, also backwards
+        }
+    }
+    while (top>0) {
+        int child, slot;
+        const int which= stack[--top];
+        order[at++]= which;
+        // push the children so that the first child pops first
+        for (child= first[which]; child>=0; child= next[child]) {
+            ++top;
+        }
+        for (slot= top-1, child= first[which]; child>=0; child= next[child]) {
+            stack[ slot-- ]= child;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+hsm_bool HsmChartCompile( hsm_chart_t* chart, const hsm_state* states, int count )
+{
+    hsm_bool okay= HSM_FALSE;
+    HSM_ASSERT( chart && states && count > 0 );
+    // too big for the table is not an error: the states just stay uncompiled.
+    if (chart && states && count > 0 && count <= HSM_CHART_MAX_STATES) {
+        int i, total=0;
+        int* scratch= NULL;
+        memset( chart, 0, sizeof(hsm_chart_t) );
+
+        // claim the states first, so that we can check the parents belong to us as well.
+        for (i=0; i<count; ++i) {
+            hsm_state state= states[i];
+            if (!state || state->chart) {
+                HSM_ASSERT( 0 && "state missing or already compiled" );
+                break;
+            }
+            WRITABLE( state )->chart= chart;
+            WRITABLE( state )->index= i;
+            total+= state->depth+1;
+        }
+        okay= (i == count);
+        for (i=0; okay && i<count; ++i) {
+            okay= !states[i]->parent || states[i]->parent->chart == chart;
+            HSM_ASSERT( okay && "chart is missing a parent state" );
+        }
+
+        if (okay) {
+            chart->count= count;
+            chart->nodes= (hsm_chart_node_t*) malloc( count * sizeof(hsm_chart_node_t) );
+            chart->states= (hsm_state*) malloc( count * sizeof(hsm_state) );
+            chart->names= (const char**) malloc( count * sizeof(const char*) );
+            chart->roots= (int*) malloc( count * sizeof(int) );
+            chart->paths= (hsm_state*) malloc( total * sizeof(hsm_state) );
+            chart->lca= (short*) malloc( (size_t)count * (size_t)count * sizeof(short) );
+            scratch= (int*) malloc( 4 * count * sizeof(int) );
+            okay= chart->nodes && chart->states && chart->names &&
+                  chart->roots && chart->paths && chart->lca && scratch;
+        }
+
+        if (okay) {
+            int at=0;
+            int* order= scratch + 3*count;
+            HsmChartDepthFirst( states, count, order, scratch );
+            for (i=0; i<count; ++i) {
+                chart->states[i]= states[ order[i] ];
+            }
+            // the final indices; parents come first, so the nodes can refer to them immediately.
+            for (i=0; i<count; ++i) {
+                hsm_state state= chart->states[i];
+                hsm_chart_node_t* node= chart->nodes + i;
+                WRITABLE( state )->index= i;
+                node->process= state->process;
+                node->parent= state->parent ? state->parent->index : -1;
+                node->depth= state->depth;
+                chart->names[i]= state->name;
+            }
+            // record every path from the root: filled from the leaf up
+            for (i=0; i<count; ++i) {
+                hsm_state track;
+                chart->roots[i]= at;
+                for (track= chart->states[i]; track; track= track->parent) {
+                    chart->paths[ at + track->depth ]= track;
+                }
+                at+= chart->states[i]->depth+1;
+            }
+            // every source to every target
+            for (i=0; i<count; ++i) {
+                short* row= chart->lca + (size_t)i*count;
+                int j;
+                for (j=0; j<count; ++j) {
+                    row[j]= HsmChartLcaDepth( chart, chart->states[i], chart->states[j] );
+                }
+            }
+        }
+        else {
+            // unwind whatever we claimed
+            for (i=0; i<count; ++i) {
+                if (states[i] && states[i]->chart == chart) {
+                    WRITABLE( states[i] )->chart= NULL;
+                    WRITABLE( states[i] )->index= 0;
+                }
+            }
+            // the states array isnt filled yet, so release can't walk it
+            free( chart->states );
+            chart->states= NULL;
+            HsmChartRelease( chart );
+        }
+        free( scratch );
+    }
+    return okay;
+}
+
+//---------------------------------------------------------------------------
+hsm_bool HsmChartEventTypes( hsm_chart_t* chart, hsm_callback_event_type event_type )
+{
+    hsm_bool okay= HSM_FALSE;
+    HSM_ASSERT( chart );
+    if (chart) {
+        int* first= NULL;
+        if (event_type) {
+            first= (int*) malloc( chart->count * HSM_EVENT_TYPES * sizeof(int) );
+            if (first) {
+                int i;
+                // parents come before children, so each row can start from its parent's.
+                for (i=0; i<chart->count; ++i) {
+                    const hsm_chart_node_t* node= chart->nodes + i;
+                    const hsm_uint64 interests= chart->states[i]->interests;
+                    int* row= first + i*HSM_EVENT_TYPES;
+                    int t;
+                    for (t=0; t<HSM_EVENT_TYPES; ++t) {
+                        if (node->process && (!interests || (interests & HSM_INTEREST( t )))) {
+                            row[t]= i;
+                        }
+                        else {
+                            row[t]= node->parent >= 0 ? first[ node->parent*HSM_EVENT_TYPES + t ] : -1;
+                        }
+                    }
+                }
+            }
+        }
+        okay= first || !event_type;
+        if (okay) {
+            free( chart->first );
+            chart->first= first;
+            chart->event_type= event_type;
+        }
+    }
+    return okay;
+}
+
+//---------------------------------------------------------------------------
+void HsmChartRelease( hsm_chart_t* chart )
+{
+    if (chart) {
+        if (chart->states) {
+            int i;
+            for (i=0; i<chart->count; ++i) {
+                WRITABLE( chart->states[i] )->chart= NULL;
+                WRITABLE( chart->states[i] )->index= 0;
+            }
+        }
+        free( chart->nodes );
+        free( chart->states );
+        free( chart->names );
+        free( chart->roots );
+        free( chart->paths );
+        free( chart->lca );
+        free( chart->first );
+        memset( chart, 0, sizeof(hsm_chart_t) );
+    }
+}
@@ -0,0 +1,186 @@
+/**
+ * @file hsm_chart.h
+ *
+ * Optional compiled charts: precomputed transition tables for a fixed set of states.
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#pragma once
+#ifndef __HSM_CHART_H__
+#define __HSM_CHART_H__
+
+#include "hsm_state.h"
+
+typedef struct hsm_chart_rec hsm_chart_t;
+typedef struct hsm_chart_node_rec hsm_chart_node_t;
+
+/**
+ * Find the type of an event, for matching against hsm_state_rec::interests.
+ *
+ * @param evt The event being sent.
+ * @return A number from 0 to #HSM_EVENT_TYPES-1; anything else is sent to every state.
+ * @see HsmChartEventTypes
+ */
+typedef int (*hsm_callback_event_type)( hsm_event evt );
+
+//---------------------------------------------------------------------------
+/**
+ * The hot part of a state descriptor, copied into a chart so that event dispatch
+ * can bubble through one contiguous array rather than chasing parent pointers.
+ * Only what bubbling reads is copied: enter, exit, initial, and the name stay behind in the descriptor,
+ * where transitions already look for them.
+ */
+struct hsm_chart_node_rec
+{
+    /**
+     * copy of hsm_state_rec::process
+     */
+    hsm_callback_process_event process;
+
+    /**
+     * index of the parent state; -1 for the top most state.
+     */
+    int parent;
+
+    /**
+     * copy of hsm_state_rec::depth
+     */
+    int depth;
+};
+
+/**
+ * Most states HsmChartCompile() will accept in a single chart.
+ * The transition table holds count*count shorts, so the default caps it at 32 MB.
+ */
+#ifndef HSM_CHART_MAX_STATES
+#define HSM_CHART_MAX_STATES 4096
+#endif
+
+//---------------------------------------------------------------------------
+/**
+ * A compiled chart.
+ *
+ * Normally HsmTransition() finds the least common ancestor of the source and target
+ * by walking both states up the tree on every transition.
+ * Once a chart has been compiled, the depth of that ancestor is known for every (source, target) pair,
+ * and a transition becomes: exit N times, then enter a flat list of states.
+ *
+ * The entry list is never stored per pair; it's always the tail of the target's path from the root.
+ * So the table costs one short per pair, plus one path per state.
+ * That's quadratic: 2 MB at 1000 states, 32 MB at #HSM_CHART_MAX_STATES.
+ * Larger charts should leave their states uncompiled, and transitions walk the tree instead.
+ *
+ * Compiling also freezes the chart: states are re-indexed in depth first order,
+ * and their process callbacks are copied into a single array of nodes that HsmSignalEvent() bubbles through.
+ *
+ * 1. Declare states as usual ( #HSM_STATE, or via the builder. )
+ * 2. Call HsmChartCompile() with every state in the chart, once the states are complete.
+ * 3. Run machines as usual; transitions between states of the same chart use the tables.
+ * 4. Call HsmChartRelease() before the chart's memory goes away.
+ */
+struct hsm_chart_rec
+{
+    /**
+     * hot data for every state in the chart, by hsm_state_rec::index.
+     */
+    hsm_chart_node_t * nodes;
+
+    /**
+     * every state in the chart, by hsm_state_rec::index, in depth first order.
+     */
+    hsm_state * states;
+
+    /**
+     * cold data: the name of every state, by hsm_state_rec::index.
+     */
+    const char ** names;
+
+    /**
+     * number of states in the chart.
+     */
+    int count;
+
+    /**
+     * root paths of every state: paths[ roots[i] + d ] is the ancestor of state i at depth d.
+     */
+    hsm_state * paths;
+
+    /**
+     * offset of each state's root path within paths.
+     */
+    int * roots;
+
+    /**
+     * count*count table: depth of the deepest state that a transition from source (row) to target (column) stays in.
+     * -1 when the transition leaves the top most state.
+     */
+    short * lca;
+
+    /**
+     * optional: how to find an event's type.
+     * @see HsmChartEventTypes
+     */
+    hsm_callback_event_type event_type;
+
+    /**
+     * optional: count*#HSM_EVENT_TYPES table: for each state (row) and event type (column),
+     * the index of the state, or its closest ancestor, interested in that type; -1 if none are.
+     */
+    int * first;
+};
+
+/**
+ * Compile a chart.
+ *
+ * @param chart Chart to fill out.
+ * @param states Every state in the chart; a state's parent must also be in the list.
+ * @param count Number of states.
+ * @return #HSM_FALSE if the states were invalid, already compiled into another chart, there were more than #HSM_CHART_MAX_STATES, or memory ran out;
+ * the states are then left uncompiled, and still work as ordinary states.
+ *
+ * @note Modifies the passed states so that they point back at the chart.
+ * @note Callbacks are copied: changes to a state's callbacks after compilation are ignored by dispatch.
+ */
+hsm_bool HsmChartCompile( hsm_chart_t* chart, const hsm_state* states, int count );
+
+/**
+ * Let dispatch skip states which aren't interested in an event.
+ *
+ * Builds a table of which state, starting from any state in the chart, will first be interested in each type of event,
+ * based on every state's hsm_state_rec::interests. Events then go straight to the states that might handle them;
+ * events no state is interested in are unhandled without calling any callbacks.
+ *
+ * @param chart Previously compiled chart.
+ * @param event_type How to find the type of an event; NULL frees the table, and every state sees every event again.
+ * @return #HSM_FALSE if memory ran out.
+ */
+hsm_bool HsmChartEventTypes( hsm_chart_t* chart, hsm_callback_event_type event_type );
+
+/**
+ * Detach all states from the chart and free its tables.
+ * Transitions return to walking the tree.
+ *
+ * @param chart Previously compiled chart.
+ */
+void HsmChartRelease( hsm_chart_t* chart );
+
+/**
+ * Number of states exited by a transition from source to target.
+ * Both states must belong to the same chart.
+ */
+#define HsmChartExits( chart, source, target ) \
+        ((source)->depth - (chart)->lca[ (source)->index*(chart)->count + (target)->index ])
+
+/**
+ * First state entered by a transition from source to target.
+ * The states entered run from here down to, and including, target.
+ */
+#define HsmChartEntries( chart, source, target ) \
+        ((chart)->paths + (chart)->roots[ (target)->index ] + 1 + (chart)->lca[ (source)->index*(chart)->count + (target)->index ])
+
+#endif // #ifndef __HSM_CHART_H__
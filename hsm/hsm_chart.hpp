@@ -0,0 +1,366 @@
+/**
+ * @file hsm_chart.hpp
+ *
+ * Header only C++ ( C++14 ) front end: states and charts defined entirely at compile time.
+ *
+ * The #HSM_STATE macros build each descriptor on first use, behind a function call and a guard.
+ * Here, each state is a type, and its descriptor is a plain hsm_state_rec which the compiler fills out:
+ * parents, depths and initial states are template parameters, and a hsm::Chart computes its
+ * node array, root paths, and least common ancestor table as constant expressions.
+ * Nothing runs at startup, and nothing needs HsmChartCompile() or HsmChartRelease().
+ *
+ * The results are ordinary #hsm_state pointers, driven by the ordinary hsm_machine_t:
+ * C handlers can return C++ states, C++ handlers can return C states, and the same machine can move between them.
+ * Transitions between states of one hsm::Chart use the chart's table ( see hsm_chart_rec ),
+ * so they run as a fixed number of exits followed by a flat list of enters.
+ *
+ * @code
+ * struct S0; struct S1; struct S11;
+ * typedef hsm::Chart< S0, S1, S11 > MyChart;            // parents first, depth first order
+ *
+ * struct S0  : hsm::State< S0,  hsm::Top, S1,  MyChart > { static hsm_state Process( hsm_status ); };
+ * struct S1  : hsm::State< S1,  S0,       S11, MyChart > { static constexpr const char* name= "S1"; };
+ * struct S11 : hsm::State< S11, S1,       void, MyChart > {
+ *     static hsm_context Enter( hsm_status );
+ *     static void Exit( hsm_status );
+ * };
+ * HSM_CHART_CHECK( MyChart );
+ *
+ * // define the callbacks once every state is complete
+ * hsm_state S0::Process( hsm_status status ) { return hsm::StateOf< S11 >(); }
+ *
+ * HsmStart( hsm, hsm::StateOf< S0 >() );
+ * @endcode
+ *
+ * Optional static members of a state: name, Process, Enter, Exit, interests; missing callbacks are NULL in the descriptor.
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#pragma once
+#ifndef __HSM_CHART_HPP__
+#define __HSM_CHART_HPP__
+
+#include <type_traits>
+
+extern "C" {
+#include "hsm_machine.h"
+#include "hsm_chart.h"
+}
+
+namespace hsm {
+
+//---------------------------------------------------------------------------
+/**
+ * Parent of the top most states.
+ */
+struct Top
+{
+    static constexpr int depth= -1;
+};
+
+/**
+ * The descriptor of a state type, for handing to the C interface.
+ */
+template< class S >
+constexpr hsm_state StateOf() { return &S::rec; }
+
+namespace detail {
+
+//---------------------------------------------------------------------------
+// descriptor pointers for the optional template parameters.
+// constants rather than functions: parents and initial states refer to each other,
+// and a constexpr function still being instantiated can't be evaluated, which would silently
+// turn the descriptors into dynamic initialization.
+template< class S > struct Rec       { static constexpr hsm_state ptr= &S::rec; };
+template<>          struct Rec<Top>  { static constexpr hsm_state ptr= nullptr; };
+template<>          struct Rec<void> { static constexpr hsm_state ptr= nullptr; };
+
+//---------------------------------------------------------------------------
+// optional static members; a state only names what it uses.
+template< class S, class= void > struct NameOf { static constexpr const char* get() { return "state"; } };
+template< class S > struct NameOf< S, decltype((void) S::name) > { static constexpr const char* get() { return S::name; } };
+
+template< class S, class= void > struct ProcessOf { static constexpr hsm_callback_process_event get() { return nullptr; } };
+template< class S > struct ProcessOf< S, decltype((void) &S::Process) > { static constexpr hsm_callback_process_event get() { return &S::Process; } };
+
+template< class S, class= void > struct EnterOf { static constexpr hsm_callback_enter get() { return nullptr; } };
+template< class S > struct EnterOf< S, decltype((void) &S::Enter) > { static constexpr hsm_callback_enter get() { return &S::Enter; } };
+
+template< class S, class= void > struct ExitOf { static constexpr hsm_callback_exit get() { return nullptr; } };
+template< class S > struct ExitOf< S, decltype((void) &S::Exit) > { static constexpr hsm_callback_exit get() { return &S::Exit; } };
+
+template< class S, class= void > struct InterestsOf { static constexpr hsm_uint64 get() { return 0; } };
+template< class S > struct InterestsOf< S, decltype((void) S::interests) > { static constexpr hsm_uint64 get() { return S::interests; } };
+
+//---------------------------------------------------------------------------
+// position of S in a list of types; -1 if absent.
+template< class S, class... List > struct IndexOf;
+template< class S > struct IndexOf< S > { static constexpr int value= -1; };
+template< class S, class... Rest > struct IndexOf< S, S, Rest... > { static constexpr int value= 0; };
+template< class S, class First, class... Rest > struct IndexOf< S, First, Rest... > {
+    static constexpr int value= IndexOf< S, Rest... >::value < 0 ? -1 : 1 + IndexOf< S, Rest... >::value;
+};
+
+//---------------------------------------------------------------------------
+// what a state descriptor needs to know about the chart it belongs to.
+template< class C > struct ChartOf {
+    static constexpr const hsm_chart_t* ptr= &C::chart;
+    template< class S > static constexpr int index() { return C::template IndexOf< S >(); }
+};
+template<> struct ChartOf<void> {
+    static constexpr const hsm_chart_t* ptr= nullptr;
+    template< class S > static constexpr int index() { return 0; }
+};
+
+//---------------------------------------------------------------------------
+// total length of the root paths of a list of states.
+constexpr int PathSize() { return 0; }
+template< class... Depths >
+constexpr int PathSize( int depth, Depths... rest ) { return depth + 1 + PathSize( rest... ); }
+
+//---------------------------------------------------------------------------
+// the arrays behind a hsm_chart_rec, sized at compile time.
+template< int N, int Paths >
+struct ChartTables
+{
+    hsm_chart_node_t nodes[N];
+    hsm_state states[N];
+    const char * names[N];
+    int roots[N];
+    hsm_state paths[Paths];
+    short lca[N*N];
+};
+
+} // namespace detail
+
+//---------------------------------------------------------------------------
+/**
+ * Base for every C++ state.
+ *
+ * @param Self The state being declared.
+ * @param Parent The parent state, or hsm::Top.
+ * @param Initial The initial child state, or void. Can be a forward declaration.
+ * @param InChart The hsm::Chart the state belongs to, or void to have transitions walk the tree.
+ */
+template< class Self, class Parent= Top, class Initial= void, class InChart= void >
+struct State
+{
+    typedef Parent parent_type;
+    typedef Initial initial_type;
+
+    /**
+     * Depth of the state, known at compile time.
+     */
+    static constexpr int depth= Parent::depth + 1;
+
+    /**
+     * The C descriptor, constant initialized.
+     */
+    static hsm_state_t rec;
+};
+
+template< class Self, class Parent, class Initial, class InChart >
+constexpr int State< Self, Parent, Initial, InChart >::depth;
+
+template< class Self, class Parent, class Initial, class InChart >
+hsm_state_t State< Self, Parent, Initial, InChart >::rec= {
+    detail::NameOf< Self >::get(),
+    detail::ProcessOf< Self >::get(),
+    detail::EnterOf< Self >::get(),
+    detail::ExitOf< Self >::get(),
+    detail::Rec< Initial >::ptr,
+    detail::Rec< Parent >::ptr,
+    Parent::depth + 1,
+    detail::ChartOf< InChart >::ptr,
+    detail::ChartOf< InChart >::template index< Self >(),
+    detail::InterestsOf< Self >::get(),
+    nullptr,    // history: the C++ front end has no history pseudo-states
+    0,          // history_type
+    0,          // history_slot
+    nullptr,    // regions: nor parallel states
+    nullptr,    // next_region
+};
+
+//---------------------------------------------------------------------------
+/**
+ * Least common ancestor depth of a transition from Source to Target,
+ * following the same rules as HsmTransition().
+ */
+template< class Source, class Target >
+struct Lca
+{
+private:
+    // ancestor of S at depth D, or S itself
+    template< class S, int D, bool= (S::depth > D) > struct At { typedef typename At< typename S::parent_type, D >::type type; };
+    template< class S, int D > struct At< S, D, false > { typedef S type; };
+
+    template< int D, bool= (D <= Source::depth && D <= Target::depth) >
+    struct Walk {
+        static constexpr int value= std::is_same< typename At< Source, D >::type, typename At< Target, D >::type >::value ?
+            Walk< D+1 >::value : D-1;
+    };
+    template< int D > struct Walk< D, false > { static constexpr int value= D-1; };
+
+    static constexpr int shared= Walk< 0 >::value;
+
+public:
+    /**
+     * depth of the deepest state the transition doesnt exit; -1 if it leaves the top most state.
+     */
+#ifdef HSM_USE_EXTERNAL_TRANSITIONS
+    static constexpr int depth= std::is_same< Source, Target >::value ? Source::depth-1 :
+                                (shared == Source::depth ? shared-1 : shared);
+#else
+    static constexpr int depth= std::is_same< Source, Target >::value ? Source::depth-1 : shared;
+#endif
+
+    /**
+     * number of states exited, counting from Source.
+     */
+    static constexpr int exits= Source::depth - depth;
+
+    /**
+     * number of states entered to reach Target.
+     */
+    static constexpr int entries= Target::depth - depth;
+};
+
+//---------------------------------------------------------------------------
+/**
+ * A chart known at compile time.
+ *
+ * List every state of the chart, parents before children, in depth first order;
+ * each state names the chart as its InChart parameter. Chart::chart is then a complete hsm_chart_rec:
+ * its tables are built by the compiler, and the states point to it from the start.
+ */
+template< class... States >
+struct Chart
+{
+    /**
+     * number of states in the chart.
+     */
+    static constexpr int count= sizeof...(States);
+
+    /**
+     * hsm_state_rec::index of a state.
+     */
+    template< class S >
+    static constexpr int IndexOf() { return detail::IndexOf< S, States... >::value; }
+
+private:
+    typedef detail::ChartTables< sizeof...(States), detail::PathSize( States::depth... ) > tables_t;
+
+    static constexpr tables_t Build()
+    {
+        const int parents[]= { detail::IndexOf< typename States::parent_type, States... >::value... };
+        const int depths[]= { States::depth... };
+        const hsm_state states[]= { &States::rec... };
+        const char * const names[]= { detail::NameOf< States >::get()... };
+        const hsm_callback_process_event process[]= { detail::ProcessOf< States >::get()... };
+        tables_t t{};
+        int at=0;
+        for (int i=0; i<count; ++i) {
+            t.nodes[i].process= process[i];
+            t.nodes[i].parent= parents[i];
+            t.nodes[i].depth= depths[i];
+            t.states[i]= states[i];
+            t.names[i]= names[i];
+            // root paths, filled from the leaf up
+            t.roots[i]= at;
+            for (int p=i; p>=0; p= parents[p]) {
+                t.paths[ at + depths[p] ]= states[p];
+            }
+            at+= depths[i]+1;
+        }
+        // every source to every target, mirroring HsmChartLcaDepth()
+        for (int i=0; i<count; ++i) {
+            for (int j=0; j<count; ++j) {
+                // self transition: exit and re-enter
+                int lca= depths[i]-1;
+                if (i != j) {
+                    const int min_depth= depths[i] < depths[j] ? depths[i] : depths[j];
+                    int d=0;
+                    while (d <= min_depth && t.paths[ t.roots[i]+d ] == t.paths[ t.roots[j]+d ]) {
+                        ++d;
+                    }
+                    lca= d-1;
+                #ifdef HSM_USE_EXTERNAL_TRANSITIONS
+                    if (lca == depths[i]) {
+                        --lca;
+                    }
+                #endif
+                }
+                t.lca[ i*count + j ]= (short) lca;
+            }
+        }
+        return t;
+    }
+
+public:
+    /**
+     * Are the states listed depth first, parents before children? See HSM_CHART_CHECK.
+     */
+    static constexpr bool DepthFirst()
+    {
+        // each state's parent is the previous state, or one of its ancestors: so subtrees are contiguous.
+        const int parents[]= { detail::IndexOf< typename States::parent_type, States... >::value... };
+        const bool tops[]= { std::is_same< typename States::parent_type, Top >::value... };
+        bool okay= true;
+        for (int i=0; okay && i<count; ++i) {
+            if (tops[i]) {
+                continue;
+            }
+            okay= false;
+            for (int p= i-1; !okay && p>=0; p= parents[p]) {
+                okay= (parents[i] == p);
+            }
+        }
+        return okay;
+    }
+
+    static_assert( sizeof...(States) > 0, "a chart needs states" );
+
+    /**
+     * the compiled tables.
+     */
+    static tables_t tables;
+
+    /**
+     * the chart, for hsm_state_rec::chart.
+     */
+    static hsm_chart_t chart;
+};
+
+template< class... States >
+constexpr int Chart< States... >::count;
+
+template< class... States >
+typename Chart< States... >::tables_t Chart< States... >::tables= Chart< States... >::Build();
+
+template< class... States >
+hsm_chart_t Chart< States... >::chart= {
+    tables.nodes,
+    tables.states,
+    tables.names,
+    sizeof...(States),
+    tables.paths,
+    tables.roots,
+    tables.lca,
+    nullptr,    // event_type: see HsmChartEventTypes()
+    nullptr,    // first
+};
+
+} // namespace hsm
+
+/**
+ * Verify, once every state is defined, that a chart lists its states parents first, depth first.
+ */
+#define HSM_CHART_CHECK( Chart ) \
+    static_assert( Chart::DepthFirst(), #Chart ": states must be listed depth first, parents before children" )
+
+#endif // #ifndef __HSM_CHART_HPP__
@@ -46,20 +46,129 @@ hsm_context_stack HsmContextStack( hsm_context_stack_t* stack, hsm_context ctx )
 }
 
 //---------------------------------------------------------------------------
-void HsmContextPush( hsm_context_stack stack, hsm_context ctx )
+hsm_context_stack HsmContextStackWide( hsm_context_stack_t* stack, hsm_context_wide_t* wide, hsm_context ctx )
 {
+    HSM_ASSERT( wide );
+    if (HsmContextStack( stack, ctx ) && wide) {
+        memset( wide, 0, sizeof(hsm_context_wide_t) );
+        stack->wide= wide;
+    }
+    return stack;
+}
+
+//---------------------------------------------------------------------------
+void HsmContextWideRelease( hsm_context_wide_t* wide )
+{
+    if (wide) {
+        free( wide->spill );
+        memset( wide, 0, sizeof(hsm_context_wide_t) );
+    }
+}
+
+//---------------------------------------------------------------------------
+void HsmContextStackDense( hsm_context_stack stack, hsm_context* dense, int size )
+{
+    HSM_ASSERT( stack && !stack->count && "set the dense array before starting the machine" );
+    if (stack && !stack->count) {
+        stack->dense= dense;
+        stack->dense_size= dense ? size : 0;
+    }
+}
+
+//---------------------------------------------------------------------------
+hsm_context HsmContextAt( hsm_context_stack stack, int depth )
+{
+    hsm_context ret= NULL;
+    if (stack && depth >= 0 && depth < stack->count) {
+        if (stack->count <= stack->dense_size) {
+            ret= stack->dense[ depth ];
+        }
+        else {
+            hsm_context_iterator_t it;
+            int index;
+            HsmContextIterator( &it, stack );
+            for (index= stack->count-1; index > depth; --index) {
+                HsmParentContext( &it );
+            }
+            ret= it.context;
+        }
+    }
+    return ret;
+}
+
+//---------------------------------------------------------------------------
+/**
+ * @internal 
+ * Find the word holding the presence bit for the passed push.
+ * @param grow Whether to enlarge the spill array to reach the bit.
+ * @return NULL if the bit lies past the spill array, or the array couldn't grow.
+ */
+static hsm_uint64* HsmContextWideWord( hsm_context_wide_t* wide, int index, hsm_bool grow )
+{
+    hsm_uint64* word= NULL;
+    const int w= index >> 6;
+    if (!w) {
+        word= &wide->presence;
+    }
+    else {
+        if (w > wide->spill_words && grow) {
+            const int words= w*2;
+            hsm_uint64* spill= (hsm_uint64*) realloc( wide->spill, words * sizeof(hsm_uint64) );
+            if (spill) {
+                memset( spill + wide->spill_words, 0, (words - wide->spill_words) * sizeof(hsm_uint64) );
+                wide->spill= spill;
+                wide->spill_words= words;
+            }
+        }
+        if (w <= wide->spill_words) {
+            word= wide->spill + (w-1);
+        }
+    }
+    return word;
+}
+
+#define HSM_WIDE_BIT( index ) (((hsm_uint64)1) << ((index) & 63))
+
+//---------------------------------------------------------------------------
+hsm_bool HsmContextPush( hsm_context_stack stack, hsm_context ctx )
+{
+    hsm_bool okay= HSM_TRUE;
     if (stack) {
         // invalid to push NULL once valid data exists
         HSM_ASSERT( !stack->context || ctx ); 
         if (ctx && (stack->context != ctx)) {
-            ctx->parent    = stack->context;
-            stack->context = ctx;
-            stack->presence |= ( 1<< stack->count );
+            if (!stack->wide) {
+                // levels past the presence bits can share their parent's context, but not have one of their own;
+                // the machine errors out instead, see HsmMachineWithWideContext.
+                okay= stack->count < HSM_MAX_DEPTH;
+                if (okay) {
+                    ctx->parent    = stack->context;
+                    stack->context = ctx;
+                    stack->presence |= ( 1<< stack->count );
+                }
+            }
+            else {
+                hsm_uint64* word= HsmContextWideWord( stack->wide, stack->count, HSM_TRUE );
+                okay= word != NULL;
+                HSM_ASSERT( okay && "couldn't grow the context stack" );
+                if (okay) {
+                    ctx->parent    = stack->context;
+                    stack->context = ctx;
+                    *word |= HSM_WIDE_BIT( stack->count );
+                }
+            }
+        }
+        if (okay) {
+            // regardless, record the context for this level
+            if (stack->count < stack->dense_size) {
+                stack->dense[ stack->count ]= stack->context;
+            }
+            // regardless alway update the count
+            // the presence bits start at zero, so presence[count] by default ==0
+            ++stack->count;
         }
-        // regardless alway update the count
-        // the presence bits start at zero, so presence[count] by default ==0
-        ++stack->count;
     }
+    return okay;
 }
 
 // ---------------------------------------------------------------
@@ -67,12 +176,27 @@ hsm_context HsmContextPop( hsm_context_stack stack )
 {
     hsm_context bye= NULL;
     if (stack && stack->count > 0) {
-        // get the presence tester
-        hsm_uint32 bit= (1 << --stack->count);
-        // was that a unique piece of data in that spot
-        if ((stack->presence & bit) !=0) {
-            // clear that bit
-            stack->presence &= ~bit;
+        hsm_bool present= HSM_FALSE;
+        --stack->count;
+        if (!stack->wide) {
+            // get the presence tester
+            hsm_uint32 bit= (1 << stack->count);
+            // was that a unique piece of data in that spot
+            if ((stack->presence & bit) !=0) {
+                // clear that bit
+                stack->presence &= ~bit;
+                present= HSM_TRUE;
+            }
+        }
+        else {
+            hsm_uint64* word= HsmContextWideWord( stack->wide, stack->count, HSM_FALSE );
+            const hsm_uint64 bit= HSM_WIDE_BIT( stack->count );
+            if (word && (*word & bit)) {
+                *word &= ~bit;
+                present= HSM_TRUE;
+            }
+        }
+        if (present) {
             // get the most recent thing pushed
             bye= stack->context;
             // and remove it 
@@ -118,9 +242,19 @@ hsm_context_t* HsmParentContext( hsm_context_iterator it )
 {
     // pending pointer possess potential parent presence? perhaps.
     if (it->sparse_index>0){
-        hsm_uint32 bit= (1 << --it->sparse_index);
-        if ((it->stack->presence & bit) !=0) {
-            it->context= it->context->parent;
+        const int index= --it->sparse_index;
+        hsm_context_wide_t* wide= it->stack->wide;
+        if (!wide) {
+            hsm_uint32 bit= (1 << index);
+            if ((it->stack->presence & bit) !=0) {
+                it->context= it->context->parent;
+            }
+        }
+        else {
+            const hsm_uint64* word= HsmContextWideWord( wide, index, HSM_FALSE );
+            if (word && (*word & HSM_WIDE_BIT( index ))) {
+                it->context= it->context->parent;
+            }
         }
     }
     return it->context;
@@ -19,6 +19,7 @@
 typedef struct hsm_context_rec hsm_context_t;
 typedef struct hsm_context_stack_rec hsm_context_stack_t;
 typedef struct hsm_context_stack_rec *hsm_context_stack;
+typedef struct hsm_context_wide_rec hsm_context_wide_t;
 
 /**
  * Hear about your context object after just after its been popped.
@@ -89,6 +90,47 @@ struct hsm_context_stack_rec
      * bit flags for whether a push added unique data
      */
     hsm_uint16 presence;
+
+    /**
+     * optional: presence bits for machines deeper than #HSM_MAX_DEPTH; 
+     * when set, the 16 presence bits above go unused.
+     */
+    hsm_context_wide_t* wide;
+
+    /**
+     * optional: the context of every push, indexed by push ( ie. by state depth ).
+     * @see HsmContextStackDense
+     */
+    hsm_context* dense;
+
+    /**
+     * number of entries in the dense array.
+     */
+    int dense_size;
+};
+
+/**
+ * Presence bits for a context stack of any depth.
+ * The first 64 levels live in the record itself; deeper levels spill into an array allocated on demand.
+ *
+ * @see HsmContextStackWide
+ */
+struct hsm_context_wide_rec
+{
+    /**
+     * bit flags for whether a push added unique data, for the first 64 pushes.
+     */
+    hsm_uint64 presence;
+
+    /**
+     * @internal: bit flags for pushes past the first 64, 64 per word.
+     */
+    hsm_uint64* spill;
+
+    /**
+     * @internal: number of words in the spill array.
+     */
+    int spill_words;
 };
 
 /**
@@ -100,4 +142,43 @@ struct hsm_context_stack_rec
  */
 hsm_context_stack HsmContextStack( hsm_context_stack_t* stack, hsm_context init );
 
+/**
+ * Resets the hsm_context_stack structure to track contexts at any depth.
+ * Machines no deeper than #HSM_MAX_DEPTH are better off with HsmContextStack().
+ *
+ * @param stack Stack to initialize.
+ * @param wide Storage for the presence bits; its lifetime must exceed the stack's. 
+ * Reinitializing a wide record that's been used requires HsmContextWideRelease() first.
+ * @param init Optional starting state; pushes record differences from this.
+ * @return The stack passed in.
+ */
+hsm_context_stack HsmContextStackWide( hsm_context_stack_t* stack, hsm_context_wide_t* wide, hsm_context init );
+
+/**
+ * Free the spill array of a wide record.
+ */
+void HsmContextWideRelease( hsm_context_wide_t* wide );
+
+/**
+ * Record every state's context in an array indexed by depth, 
+ * so that HsmContextAt(), and event bubbling, can find the context for any depth directly
+ * rather than stepping through the presence bits one level at a time.
+ *
+ * @param stack Stack to augment; call before the machine starts.
+ * @param dense Storage for one context per level; its lifetime must exceed the stack's.
+ * @param size Number of entries in dense; should exceed the depth of the machine's deepest state.
+ * If the machine ever goes deeper, lookups fall back to stepping through the presence bits.
+ */
+void HsmContextStackDense( hsm_context_stack stack, hsm_context* dense, int size );
+
+/**
+ * Find the context visible to the state at the passed depth.
+ *
+ * @param stack Stack to query.
+ * @param depth Depth of an active state.
+ * @return The context, NULL if no state at that depth is active. 
+ * O(1) with HsmContextStackDense(), otherwise O(distance from the current state).
+ */
+hsm_context HsmContextAt( hsm_context_stack stack, int depth );
+
 #endif // __HSM_CONTEXT_H__
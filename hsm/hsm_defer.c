@@ -0,0 +1,80 @@
+/**
+ * @file hsm_defer.c
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "hsm_machine.h"
+#include "hsm_defer.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+hsm_bool HsmMachineDefer( hsm_machine hsm, hsm_defer_t* defer, hsm_defer_slot_t* slots, int capacity )
+{
+  const hsm_bool okay= hsm && defer && slots && (capacity > 0) && !hsm->current;
+  HSM_ASSERT( okay && "deferral needs slots, and an unstarted machine" );
+  if (okay) {
+    defer->slots= slots;
+    defer->capacity= capacity;
+    defer->head= 0;
+    defer->count= 0;
+    defer->replaying= HSM_FALSE;
+    defer->again= HSM_FALSE;
+    hsm->defer= defer;
+  }
+  return okay;
+}
+
+//---------------------------------------------------------------------------
+hsm_state HsmDefer( hsm_status status, int size )
+{
+  hsm_state ret= NULL;
+  hsm_defer_t* defer= status ? status->hsm->defer : NULL;
+  HSM_ASSERT( (defer || (status && (status->hsm->flags & HSM_FLAGS_REGION))) && "machine has no deferral queue" );
+  if (defer && status->evt) {
+    // full: the event goes unhandled, and bubbles up as any other would.
+    if (defer->count < defer->capacity) {
+      hsm_defer_slot_t* slot= defer->slots + (defer->head + defer->count) % defer->capacity;
+      if (size > 0 && size <= HSM_DEFER_PAYLOAD) {
+        memcpy( slot->payload.bytes, status->evt, size );
+        slot->evt= NULL;
+        slot->size= size;
+      }
+      else {
+        slot->evt= status->evt;
+        slot->size= 0;
+      }
+      ++defer->count;
+      ret= HsmStateHandled();
+    }
+  }
+  return ret;
+}
+
+//---------------------------------------------------------------------------
+int HsmDeferredEvents( const hsm_machine hsm )
+{
+  return (hsm && hsm->defer) ? hsm->defer->count : 0;
+}
+
+//---------------------------------------------------------------------------
+hsm_event HsmDeferPop( hsm_defer_t* defer, hsm_defer_slot_t* slot )
+{
+  const hsm_defer_slot_t* head= defer->slots + defer->head;
+  // only copy as much payload as the event took
+  slot->evt= head->evt;
+  slot->size= head->size;
+  if (head->size) {
+    memcpy( slot->payload.bytes, head->payload.bytes, head->size );
+  }
+  defer->head= (defer->head+1) % defer->capacity;
+  --defer->count;
+  return slot->size ? (hsm_event) slot->payload.bytes : slot->evt;
+}
@@ -0,0 +1,144 @@
+/**
+ * @file hsm_defer.h
+ *
+ * Deferred events: postpone an event until the machine reaches a state that can handle it.
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#pragma once
+#ifndef __HSM_DEFER_H__
+#define __HSM_DEFER_H__
+
+#include "hsm_forwards.h"
+
+typedef struct hsm_defer_rec hsm_defer_t;
+typedef struct hsm_defer_slot_rec hsm_defer_slot_t;
+
+/**
+ * @brief 32
+ *
+ * Bytes of event a deferral slot holds by copy; larger events are held by reference.
+ * Define before including hsm headers to change it; it has to be the same everywhere.
+ */
+#ifndef HSM_DEFER_PAYLOAD
+#define HSM_DEFER_PAYLOAD 32
+#endif
+
+//---------------------------------------------------------------------------
+/**
+ * One deferred event.
+ */
+struct hsm_defer_slot_rec
+{
+    /**
+     * the deferred event, when held by reference.
+     */
+    hsm_event evt;
+
+    /**
+     * bytes copied into payload; 0 when held by reference.
+     */
+    int size;
+
+    /**
+     * the copy of a small event.
+     */
+    union {
+        double align_double;
+        void * align_pointer;
+        hsm_uint64 align_uint64;
+        char bytes[ HSM_DEFER_PAYLOAD ];
+    } payload;
+};
+
+/**
+ * A machine's deferred events, in the order they were deferred.
+ *
+ * A handler defers an event by returning HsmDefer(). After every transition, once the machine has settled into its new state,
+ * each deferred event is signaled again, oldest first; those the new state defers in turn go back to wait for the next transition.
+ * Events deferred while replaying see every transition that happens along the way.
+ *
+ * Slots live in a ring provided by the user: deferring never allocates.
+ *
+ * @see HsmMachineDefer
+ */
+struct hsm_defer_rec
+{
+    /**
+     * ring storage, provided by the user.
+     */
+    hsm_defer_slot_t * slots;
+
+    /**
+     * number of slots.
+     */
+    int capacity;
+
+    /**
+     * @internal: oldest deferred event.
+     */
+    int head;
+
+    /**
+     * number of deferred events.
+     */
+    int count;
+
+    /**
+     * @internal: set while replaying, so transitions along the way don't replay recursively.
+     */
+    hsm_bool replaying;
+
+    /**
+     * @internal: a transition happened while replaying, so the events deferred since deserve another chance.
+     */
+    hsm_bool again;
+};
+
+/**
+ * Give a machine storage for deferred events.
+ * Region machines don't defer: only handlers of the machine's own states can.
+ *
+ * @param hsm Machine which will defer events.
+ * @param defer Queue to initialize. Its lifetime must exceed the machine's use of it.
+ * @param slots Storage for the deferred events.
+ * @param capacity Number of slots.
+ * @return #HSM_FALSE if the machine has already started.
+ */
+hsm_bool HsmMachineDefer( hsm_machine hsm, hsm_defer_t* defer, hsm_defer_slot_t* slots, int capacity );
+
+/**
+ * Defer the event being processed; return the result from a process callback.
+ *
+ * @code
+ *  case EVT_REQUEST: return HsmDefer( status, sizeof(*status->evt) );
+ * @endcode
+ *
+ * @param status The status passed to the process callback.
+ * @param size Size of the event in bytes. Events up to #HSM_DEFER_PAYLOAD bytes are copied;
+ * larger events, or a size of 0, are held by reference and must stay valid until they are replayed.
+ * @return HsmStateHandled() if the event was deferred; NULL if the machine has no deferral queue, or it is full.
+ */
+hsm_state HsmDefer( hsm_status status, int size );
+
+/**
+ * Number of events waiting for replay.
+ */
+int HsmDeferredEvents( const hsm_machine hsm );
+
+/**
+ * @internal
+ * Remove the oldest deferred event.
+ *
+ * @param defer Queue with at least one event.
+ * @param slot Filled with the event's slot; the event can refer to the slot's payload.
+ * @return The event to replay.
+ */
+hsm_event HsmDeferPop( hsm_defer_t* defer, hsm_defer_slot_t* slot );
+
+#endif // #ifndef __HSM_DEFER_H__
@@ -0,0 +1,74 @@
+/**
+ * @file hsm_history.c
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "hsm_machine.h"
+#include "hsm_history.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+//---------------------------------------------------------------------------
+hsm_bool HsmMachineHistory( hsm_machine hsm, hsm_history_t* history, const hsm_state* states, hsm_state* last, int count )
+{
+  hsm_bool okay= hsm && history && states && last && (count > 0) && !hsm->current;
+  int i;
+  for (i=0; okay && i<count; ++i) {
+    okay= states[i] && states[i]->history_type && states[i]->parent && (states[i]->parent->history == states[i]) &&
+          (!states[i]->history_slot || states[i]->history_slot == i+1);
+  }
+  HSM_ASSERT( okay && "history needs pseudo-states, in the same order for every machine, and an unstarted machine" );
+  if (okay) {
+    for (i=0; i<count; ++i) {
+      // the slot lives in the shared state: every machine's table lists the pseudo-state at the same index.
+      ((struct hsm_state_rec*)states[i])->history_slot= i+1;
+      last[i]= NULL;
+    }
+    history->states= states;
+    history->last= last;
+    history->count= count;
+    history->leaf= NULL;
+    hsm->history= history;
+  }
+  return okay;
+}
+
+//---------------------------------------------------------------------------
+hsm_state HsmHistoryTarget( const hsm_machine hsm, hsm_state pseudo )
+{
+  hsm_state target= NULL;
+  if (pseudo && pseudo->history_type) {
+    const hsm_history_t* history= hsm ? hsm->history : NULL;
+    const int slot= pseudo->history_slot-1;
+    // a machine with a shorter table might not remember this pseudo-state at all.
+    if (history && slot >= 0 && slot < history->count && history->states[slot] == pseudo) {
+      target= history->last[slot];
+    }
+    if (!target) {
+      target= pseudo->initial ? pseudo->initial : pseudo->parent;
+    }
+  }
+  return target;
+}
+
+//---------------------------------------------------------------------------
+void HsmHistoryExit( hsm_history_t* history, hsm_state state )
+{
+  // exits run innermost first, and entering clears the leaf: so the first exit since is the leaf.
+  if (!history->leaf) {
+    history->leaf= state;
+  }
+  if (state->parent && state->parent->history) {
+    hsm_state pseudo= state->parent->history;
+    const int slot= pseudo->history_slot-1;
+    if (slot >= 0 && slot < history->count && history->states[slot] == pseudo) {
+      history->last[slot]= (pseudo->history_type == HSM_HISTORY_DEEP) ? history->leaf : state;
+    }
+  }
+}
@@ -0,0 +1,83 @@
+/**
+ * @file hsm_history.h
+ *
+ * History: each machine's memory of where it was when it left a state with a history pseudo-state.
+ *
+ * @see HSM_HISTORY, HSM_DEEP_HISTORY
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#pragma once
+#ifndef __HSM_HISTORY_H__
+#define __HSM_HISTORY_H__
+
+#include "hsm_forwards.h"
+
+typedef struct hsm_history_rec hsm_history_t;
+
+/**
+ * The history of a single machine.
+ * As the machine exits the children of a state with a history pseudo-state, it records the state to return to;
+ * transitions to the pseudo-state then enter the recorded state directly: 
+ * without passing through the parent's initial state, and ( for compiled charts ) along a single precomputed path.
+ *
+ * @see HsmMachineHistory
+ */
+struct hsm_history_rec
+{
+    /**
+     * the history pseudo-states this machine remembers, provided by the user.
+     */
+    const hsm_state * states;
+
+    /**
+     * for each pseudo-state: the state to return to; NULL until the machine first leaves.
+     */
+    hsm_state * last;
+
+    /**
+     * number of pseudo-states.
+     */
+    int count;
+
+    /**
+     * @internal: the innermost state exited since the machine last entered a state.
+     */
+    hsm_state leaf;
+};
+
+/**
+ * Give a machine a history table.
+ * Call before HsmStart(). Without a table, transitions to history pseudo-states go to their fallback.
+ *
+ * @param hsm Machine to remember.
+ * @param history Table to initialize. Its lifetime must exceed the machine's use of it.
+ * @param states The history pseudo-states to remember. Looking them up also registers them with their parents.
+ *        Machines sharing a pseudo-state must list it at the same index; a machine can leave trailing ones off.
+ * @param last Storage for count recorded states.
+ * @param count Number of history pseudo-states.
+ * @return #HSM_FALSE if the machine has already started, some state isn't a history pseudo-state, or another machine listed it elsewhere.
+ */
+hsm_bool HsmMachineHistory( hsm_machine hsm, hsm_history_t* history, const hsm_state* states, hsm_state* last, int count );
+
+/**
+ * Determine the state a transition to a history pseudo-state would enter.
+ *
+ * @param hsm Machine whose history to use.
+ * @param pseudo A history pseudo-state.
+ * @return The recorded state; the pseudo-state's fallback, or parent, if there's nothing recorded.
+ */
+hsm_state HsmHistoryTarget( const hsm_machine hsm, hsm_state pseudo );
+
+/**
+ * @internal
+ * Record the exit of a state: called by the machine just after state exits.
+ */
+void HsmHistoryExit( hsm_history_t* history, hsm_state state );
+
+#endif // #ifndef __HSM_HISTORY_H__
@@ -56,6 +56,17 @@ typedef void(*hsm_callback_exiting)( hsm_status status, void * user_data );
  */
 typedef void (*hsm_callback_unhandled_event)( hsm_status status, void * user_data );
 
+/**
+ * Hear about a state handling an event, before any transition it asked for.
+ * A transition out of a region is reported once, by the region's machine ( hsm_status_rec::hsm is the region's ),
+ * even though the parallel state's machine is the one which then takes it.
+ *
+ * @param status The current state of the machine. hsm_status_rec::state has the state which handled the event.
+ * @param next_state What the state's process callback returned: HsmStateHandled(), or a state to transition to.
+ * @param user_data The #hsm_info_rec.user_data.
+ */
+typedef void (*hsm_callback_handled_event)( hsm_status status, hsm_state next_state, void * user_data );
+
 /**
  * Hear about context objects that have just been popped
  *
@@ -106,16 +117,33 @@ struct hsm_info_rec
      * Called just after the context stack pops its data.
      */
     hsm_callback_context_popped on_context_popped;
+
+    /**
+     * Called whenever a state handles an event
+     */
+    hsm_callback_handled_event on_handled_event;
 };
 
 //---------------------------------------------------------------------------
 /**
  * Install a new set of callbacks for spying on internal statemachine processing.
- * Currently there's just one set of callbacks for all threads; this is not locked or synchronized in anyway.
+ * These are shared by every machine without callbacks of its own ( see HsmSetMachineInfo() );
+ * this is not locked or synchronized in anyway.
  * 
  * @param callbacks  The set of callbacks; individual callbacks can be NULL, as can the callbacks pointer itself.
  * @param old_callbacks The last set of callbacks passed to HsmSetInfoCallbacks. Its recommended that you should record, and later restore the old callbacks.
  */
 void HsmSetInfoCallbacks( hsm_info_t* callbacks, hsm_info_t* old_callbacks );
 
+/**
+ * Install callbacks for a single machine, replacing the global callbacks for that machine.
+ * Share one set of callbacks between several machines to watch them as a group.
+ * Machines without callbacks, global or their own, skip the informational calls entirely.
+ *
+ * @param hsm The machine to watch.
+ * @param info The callbacks; its lifetime must exceed the machine's use of it. NULL returns the machine to the global callbacks.
+ * @return The machine's previous callbacks, or NULL.
+ */
+const hsm_info_t* HsmSetMachineInfo( hsm_machine hsm, const hsm_info_t* info );
+
 #endif // #ifndef __HSM_INFO_H__
@@ -14,9 +14,16 @@
 #include <stdlib.h>
 #include <memory.h>
 
+#include "hsm_active.h"
+#include "hsm_chart.h"
 #include "hsm_context.h"
+#include "hsm_defer.h"
+#include "hsm_history.h"
+#include "hsm_region.h"
 #include "hsm_state.h"
 #include "hsm_stack.h"
+#include "hsm_stats.h"
+#include "hsm_timer.h"
 
 // alloca is technically not an ANSI-C function, though it exists on most platforms
 #ifdef WIN32
@@ -65,13 +72,15 @@ static hsm_bool HsmTransition( hsm_machine hsm, hsm_state source, hsm_state targ
 
 /**
  * @internal
- * Used to start the statemachine going
- * walks up the tree to the top, then 'enter's from top down-to (and including) 'state'
+ * Used to start the statemachine going, and to finish transitions:
+ * walks up the tree to 'stop', then 'enter's from just below 'stop' down-to (and including) 'state'
  
  * @param hsm The #hsm_machine processing the event.
  * @param state Desired first state of the state chart
+ * @param stop Ancestor of state that's already been entered; NULL to enter from the top.
+ * @return HSM_FALSE if a state couldn't be entered: the machine is in HsmStateError().
  */
-static void HsmRecursiveEnter( hsm_machine hsm, hsm_state state, hsm_event evt );
+static hsm_bool HsmRecursiveEnter( hsm_machine hsm, hsm_state state, hsm_state stop, hsm_event evt );
 
 /**
  * @internal
@@ -79,6 +88,7 @@ static void HsmRecursiveEnter( hsm_machine hsm, hsm_state state, hsm_event evt )
  * @param hsm The #hsm_machine processing the event.
  * @param state State transitioing to
  * @param evt Event which caused the transition
+ * @return HSM_FALSE if the state couldn't be entered: the machine is in HsmStateError().
  */
 static hsm_bool HsmEnter( hsm_machine hsm, hsm_state state, hsm_event evt );
 
@@ -97,18 +107,93 @@ static hsm_bool HsmInit( hsm_machine hsm, hsm_event evt );
  * @param hsm The #hsm_machine processing the event.
  * @param evt Event which caused the transition.
  */
-//static  <- disabled for regions test. TODO: renable here and below.
-void HsmExit( hsm_machine hsm, hsm_event evt );
+static void HsmExit( hsm_machine hsm, hsm_event evt );
+
+/**
+ * @internal
+ * Start the regions of a parallel state the machine has just entered.
+ */
+static void HsmRegionsEnter( hsm_machine hsm, hsm_state parallel, hsm_event evt );
+
+/**
+ * @internal
+ * Exit, and return to the pool, the regions of the machine's current parallel state.
+ */
+static void HsmRegionsExit( hsm_machine hsm, hsm_state parallel, hsm_event evt );
+
+/**
+ * @internal
+ * Redirect targets within regions to their parallel state.
+ */
+static hsm_state HsmRegionsOutermost( hsm_machine hsm, hsm_state target );
+
+/**
+ * @internal
+ * Run a single event to completion. Events don't bubble past 'stop': the parallel state of a region.
+ */
+static hsm_bool HsmDispatch( hsm_machine hsm, hsm_event evt, hsm_context_stack stack, const hsm_info_t* info, hsm_state stop );
+
+//---------------------------------------------------------------------------
+// with HSM_USE_STATS, time a call for the machine's stats; otherwise, just make the call.
+#ifdef HSM_USE_STATS
+#define HSM_TIMED( hsm, state, kind, call ) \
+  if ((hsm)->stats) { const hsm_uint64 start= HsmStatsClock(); call; HsmStatsCallback( (hsm), (state), (kind), start ); } else { call; }
+#define HSM_TIMED_RUN( hsm, call ) \
+  if ((hsm)->stats) { const hsm_uint64 start= HsmStatsClock(); call; HsmStatsRun( (hsm), start ); } else { call; }
+#else
+#define HSM_TIMED( hsm, state, kind, call ) call;
+#define HSM_TIMED_RUN( hsm, call ) call;
+#endif
+
+/**
+ * @internal
+ * Signal the machine's deferred events again, now that a transition has completed.
+ */
+static void HsmDeferReplay( hsm_machine hsm, const hsm_info_t* info );
+
+/**
+ * @internal
+ * Act on the response to an event: 'handler' returned 'next_state', or no state did.
+ */
+static hsm_bool HsmFinishEvent( hsm_machine hsm, hsm_state handler, hsm_state next_state, hsm_event evt, const hsm_info_t* info );
+
+/**
+ * @internal
+ * HsmFinishEvent() without reporting the handled event: for escapes from a region, which the region already reported.
+ */
+static hsm_bool HsmFollowEvent( hsm_machine hsm, hsm_state handler, hsm_state next_state, hsm_event evt, const hsm_info_t* info );
 
 //---------------------------------------------------------------------------
 static hsm_info_t hsm_global_callbacks= {0};
 
+// points to hsm_global_callbacks only while some callback is set:
+// machines without callbacks then only pay for a null check.
+static const hsm_info_t* hsm_global_info= NULL;
+
+// a machine's own callbacks take the place of the global ones.
+#define HSM_INFO( hsm ) ((hsm)->info ? (hsm)->info : hsm_global_info)
+
 void HsmSetInfoCallbacks( hsm_info_t* info, hsm_info_t* old_callbacks )
 {
+  static const hsm_info_t empty= {0};
   if (old_callbacks) {
     *old_callbacks= hsm_global_callbacks;
   }
-  hsm_global_callbacks= *info;
+  hsm_global_callbacks= info ? *info : empty;
+  hsm_global_info= (hsm_global_callbacks.on_init || hsm_global_callbacks.on_entered ||
+                    hsm_global_callbacks.on_exiting || hsm_global_callbacks.on_unhandled_event ||
+                    hsm_global_callbacks.on_context_popped || hsm_global_callbacks.on_handled_event) ? &hsm_global_callbacks : NULL;
+}
+
+//---------------------------------------------------------------------------
+const hsm_info_t* HsmSetMachineInfo( hsm_machine hsm, const hsm_info_t* info )
+{
+  const hsm_info_t* old= NULL;
+  if (hsm) {
+    old= hsm->info;
+    hsm->info= info;
+  }
+  return old;
 }
 
 //---------------------------------------------------------------------------
@@ -118,6 +203,18 @@ hsm_machine HsmMachine( hsm_machine_t* hsm )
   if (hsm) {
     hsm->flags=0;
     hsm->current= NULL;
+    hsm->queue= NULL;
+    hsm->info= NULL;
+    hsm->slab= NULL;
+    hsm->active= NULL;
+    hsm->history= NULL;
+    hsm->defer= NULL;
+    hsm->timers= NULL;
+    hsm->region_pool= NULL;
+    hsm->regions= NULL;
+#ifdef HSM_USE_STATS
+    hsm->stats= NULL;
+#endif
   }
   return hsm;
 }
@@ -136,6 +233,16 @@ hsm_machine HsmMachineWithContext( hsm_context_machine_t* hsm, hsm_context ctx )
   return &(hsm->core);
 }
 
+//---------------------------------------------------------------------------
+hsm_machine HsmMachineWithWideContext( hsm_context_machine_t* hsm, hsm_context_wide_t* wide, hsm_context ctx )
+{
+  HSM_ASSERT( hsm && wide );
+  if (HsmMachineWithContext( hsm, ctx )) {
+    HsmContextStackWide( &(hsm->stack), wide, ctx );
+  }
+  return &(hsm->core);
+}
+
 //---------------------------------------------------------------------------
 hsm_bool HsmIsRunning( const hsm_machine hsm )
 {
@@ -147,6 +254,11 @@ hsm_bool HsmIsRunning( const hsm_machine hsm )
 hsm_bool HsmIsInState( const hsm_machine hsm, hsm_state state )
 {
   hsm_bool res=HSM_FALSE;
+  if (hsm && hsm->active && state && (state->chart == hsm->active->chart)) {
+    // final and error states dont exit, so the bits say where the machine used to be.
+    res= HsmActiveTest( hsm->active, state->index ) && HsmIsRunning( hsm );
+  }
+  else
   if (hsm && state) {
     hsm_state test;
     for (test= hsm->current;  test; test=test->parent) {
@@ -155,6 +267,12 @@ hsm_bool HsmIsInState( const hsm_machine hsm, hsm_state state )
       }
     }
   }    
+  if (!res && hsm && hsm->regions) {
+    hsm_region_t* it;
+    for (it= hsm->regions; it && !res; it= it->next) {
+      res= HsmIsInState( HsmRegionMachine( it ), state );
+    }
+  }
   return res;
 }
 
@@ -165,78 +283,354 @@ hsm_bool HsmStart( hsm_machine hsm, hsm_state first_state )
   HSM_ASSERT( first_state && "expected valid first state for init" );
   HSM_ASSERT( (!hsm || !hsm->current) && "already ran init" );
   
+  if (first_state && first_state->history_type) {
+    first_state= HsmHistoryTarget( hsm, first_state );
+  }
+  if (hsm && hsm->region_pool && first_state) {
+    first_state= HsmRegionsOutermost( hsm, first_state );
+  }
   if (hsm && !hsm->current && first_state ) 
   {
     // the specified starting state isn't necessarily the *top* state:
     // we need to walk up to the top state, then walk down to and including our first state
-    HsmRecursiveEnter( hsm, first_state, NULL );
-
     // statecharts run enter *then* init
     // ( note: init can move us into a new state )
-    HsmInit( hsm, NULL );
+    if (HsmRecursiveEnter( hsm, first_state, NULL, NULL )) {
+      HsmInit( hsm, NULL );
+    }
   }
 
   return HsmIsRunning( hsm );
 }
 
 //---------------------------------------------------------------------------
-hsm_bool HsmSignalEvent( hsm_machine hsm, hsm_event evt )
+/**
+ * @internal
+ * Does the passed target lie within the passed region?
+ */
+static hsm_bool HsmRegionContains( hsm_state region, hsm_state target )
+{
+  for (; target && target->depth > region->depth; target= target->parent) {
+  }
+  return target == region;
+}
+
+//---------------------------------------------------------------------------
+/**
+ * @internal
+ * States within a region can only be entered by entering their parallel state:
+ * find the outermost parallel state, between the machine's own region and target, that target lies within.
+ */
+static hsm_state HsmRegionsOutermost( hsm_machine hsm, hsm_state target )
+{
+  const int top= (hsm->flags & HSM_FLAGS_REGION) ? ((hsm_region_t*)hsm)->region->depth : -1;
+  hsm_state track;
+  for (track= target; track && track->depth > top; track= track->parent) {
+    if (track->parent && track->parent->regions) {
+      target= track->parent;
+    }
+  }
+  return target;
+}
+
+//---------------------------------------------------------------------------
+/**
+ * @internal
+ * Hand every region the event at once, via the pool's run callback;
+ * then, in declaration order, take the first escape or error any of them produced.
+ */
+static hsm_bool HsmRegionsRunAll( hsm_machine hsm, hsm_event evt, const hsm_info_t* info )
+{
+  hsm_bool handled= HSM_FALSE;
+  hsm_state parallel= hsm->current;
+  hsm_region_pool_t* pool= hsm->region_pool;
+  hsm_region_t* first= NULL;
+  hsm_region_t* it;
+  for (it= hsm->regions; it; it= it->next) {
+    it->evt= evt;
+    it->handled= HSM_FALSE;
+  }
+  pool->run( hsm->regions, pool->run_data );
+  for (it= hsm->regions; it; it= it->next) {
+    handled|= it->handled;
+    it->evt= NULL;
+    if (!first && (it->escape || HsmRegionMachine( it )->current == HsmStateError())) {
+      first= it;
+    }
+    else {
+      it->escape= NULL;
+    }
+  }
+  if (first) {
+    if (HsmRegionMachine( first )->current == HsmStateError()) {
+      hsm->current= HsmStateError();
+    }
+    else {
+      hsm_state target= first->escape;
+      first->escape= NULL;
+      HsmFollowEvent( hsm, parallel, target, evt, info );
+    }
+  }
+  return handled;
+}
+
+//---------------------------------------------------------------------------
+void HsmRegionRun( hsm_region_t* region )
+{
+  hsm_machine sub= HsmRegionMachine( region );
+  if (region->evt && HsmIsRunning( sub )) {
+    region->handled= HsmDispatch( sub, region->evt, &region->machine.stack, HSM_INFO( sub ), region->region->parent );
+  }
+}
+
+//---------------------------------------------------------------------------
+/**
+ * @internal
+ * Offer an event to each region of the machine's current parallel state, in order.
+ * Each region runs to completion before the next hears the event.
+ *
+ * @return #HSM_TRUE if any region handled the event.
+ */
+static hsm_bool HsmRegionsDispatch( hsm_machine hsm, hsm_event evt, const hsm_info_t* info )
+{
+  hsm_bool handled= HSM_FALSE;
+  hsm_state parallel= hsm->current;
+  hsm_region_t* it;
+  // a lone region has nothing to run alongside.
+  if (hsm->region_pool->run && hsm->regions->next) {
+    return HsmRegionsRunAll( hsm, evt, info );
+  }
+  for (it= hsm->regions; it; it= it->next) {
+    hsm_machine region= HsmRegionMachine( it );
+    if (HsmIsRunning( region )) {
+      handled|= HsmDispatch( region, evt, &it->machine.stack, info, parallel );
+      if (region->current == HsmStateError()) {
+        hsm->current= HsmStateError();
+        break;
+      }
+      if (it->escape) {
+        // leaving the region leaves the parallel state, and all of its regions.
+        // the parallel state acts as the source, and that might in turn escape an outer region.
+        hsm_state target= it->escape;
+        it->escape= NULL;
+        HsmFollowEvent( hsm, parallel, target, evt, info );
+        break;
+      }
+    }
+  }
+  return handled;
+}
+
+//---------------------------------------------------------------------------
+/**
+ * @internal
+ * Run a single event to completion.
+ * The machine's stack and the unhandled event callback are looked up by the caller,
+ * so that HsmSignalEvents() only has to do so once for a whole batch.
+ */
+static hsm_bool HsmDispatch( hsm_machine hsm, hsm_event evt, hsm_context_stack stack, const hsm_info_t* info, hsm_state stop )
 {
   hsm_bool okay= HSM_FALSE;
-  if (hsm && hsm->current) 
-  {
-    // bubble the event up the hierarchy until we get a valid respose 
-    // ( or until we run off the top of the tree. )
-    hsm_state next_state= NULL;
-    hsm_state handler= hsm->current;
-    hsm_context_iterator_t it;
-    HsmContextIterator( &it, HSM_STACK( hsm ) );
-    do {
-      if (handler->process) {
-        hsm_status_t status= { hsm, handler, it.context, evt };
-        next_state= handler->process( &status ) ;
+  // bubble the event up the hierarchy until we get a valid respose 
+  // ( or until we run off the top of the tree. )
+  hsm_state next_state= NULL;
+  hsm_state handler= hsm->current;
+  const int stop_depth= stop ? stop->depth : -1;
+  // with a dense array, every level's context is a simple lookup;
+  // otherwise, step the iterator through the presence bits as we go up.
+  const hsm_context* dense= (stack && stack->count <= stack->dense_size) ? stack->dense : NULL;
+  hsm_context_iterator_t it;
+  // the regions of a parallel state hear events before the parallel state itself;
+  // once one handles it ( or errors out ) there's nothing left for the rest of the machine to do.
+  if (hsm->regions) {
+    okay= HsmRegionsDispatch( hsm, evt, info );
+    if (okay || !HsmIsRunning( hsm )) {
+      return okay;
+    }
+  }
+  HsmContextIterator( &it, stack );
+  if (handler->chart) {
+    // compiled charts bubble through their contiguous array of nodes
+    const hsm_chart_t* chart= handler->chart;
+    int index= handler->index;
+    int depth= handler->depth; // where the context iterator is
+    // with interests, we jump from one interested state to the next;
+    // first points to the event type's column, and each row is a state.
+    const int* first= NULL;
+    if (chart->first) {
+      const int type= chart->event_type( evt );
+      if (type >= 0 && type < HSM_EVENT_TYPES) {
+        first= chart->first + type;
+        index= first[ index*HSM_EVENT_TYPES ];
+      }
+    }
+    handler= NULL;
+    while (index >= 0 && chart->nodes[index].depth > stop_depth) {
+      const hsm_chart_node_t* node= chart->nodes + index;
+      if (stack && !dense) {
+        for (; depth > node->depth; --depth) {
+          HsmParentContext( &it );
+        }
+      }
+      if (node->process) {
+        hsm_status_t status= { hsm, chart->states[index], dense ? dense[ node->depth ] : it.context, evt };
+        HSM_TIMED( hsm, status.state, HSM_STATS_PROCESS, next_state= node->process( &status ) );
         if (next_state) {
+          handler= status.state;
           break;
         }
       }
+      index= node->parent;
+      if (first && index >= 0) {
+        index= first[ index*HSM_EVENT_TYPES ];
+      }
+    }
+  }
+  else do {
+    if (handler->process) {
+      hsm_status_t status= { hsm, handler, dense ? dense[ handler->depth ] : it.context, evt };
+      HSM_TIMED( hsm, handler, HSM_STATS_PROCESS, next_state= handler->process( &status ) );
+      if (next_state) {
+        break;
+      }
+    }
+    if (!dense) {
       HsmParentContext( &it );
-      handler= handler->parent;
     }
-    while (handler);       
+    handler= handler->parent;
+  }
+  while (handler && handler->depth > stop_depth);
 
-    // handlers are supposed to return HsmStateHandled
-    if (!next_state) {
-      if (hsm_global_callbacks.on_unhandled_event) {
-        hsm_status_t status= { hsm, NULL, NULL, evt };
-        hsm_global_callbacks.on_unhandled_event( &status, hsm_global_callbacks.user_data );
-      }
+  return HsmFinishEvent( hsm, handler, next_state, evt, info );
+}
+
+//---------------------------------------------------------------------------
+static hsm_bool HsmFinishEvent( hsm_machine hsm, hsm_state handler, hsm_state next_state, hsm_event evt, const hsm_info_t* info )
+{
+  if (next_state && info && info->on_handled_event) {
+    hsm_status_t status= { hsm, handler, NULL, evt };
+    info->on_handled_event( &status, next_state, info->user_data );
+  }
+  return HsmFollowEvent( hsm, handler, next_state, evt, info );
+}
+
+//---------------------------------------------------------------------------
+static hsm_bool HsmFollowEvent( hsm_machine hsm, hsm_state handler, hsm_state next_state, hsm_event evt, const hsm_info_t* info )
+{
+  hsm_bool okay= HSM_FALSE;
+  // handlers are supposed to return HsmStateHandled
+  if (!next_state) {
+    // a region not handling an event says nothing: another region, or the parallel state, still might.
+    if (info && info->on_unhandled_event && !(hsm->flags & HSM_FLAGS_REGION)) {
+      hsm_status_t status= { hsm, NULL, NULL, evt };
+      info->on_unhandled_event( &status, info->user_data );
     }
-    else 
-    if (next_state== HsmStateHandled()) {
+  }
+  else 
+  if (next_state== HsmStateHandled()) {
+    okay= HSM_TRUE;
+  }
+  else 
+  if (next_state== HsmStateFinal() || next_state==HsmStateError()) {
+    // we say this is okay, in the sense that something happened.
+    // trigger a callback to inform the user?
+    if (hsm->current != next_state) {
+      hsm->current = next_state;
       okay= HSM_TRUE;
     }
-    else 
-    if (next_state== HsmStateFinal() || next_state==HsmStateError()) {
-      // we say this is okay, in the sense that something happened.
-      // trigger a callback to inform the user?
-      if (hsm->current != next_state) {
-        hsm->current = next_state;
-        okay= HSM_TRUE;
-      }
+  }
+  else {
+    // history pseudo-states stand in for the state they remember
+    if (next_state->history_type) {
+      next_state= HsmHistoryTarget( hsm, next_state );
+    }
+    if (hsm->region_pool) {
+      next_state= HsmRegionsOutermost( hsm, next_state );
+    }
+    // regions only transition within themselves; anything else is up to the parallel state.
+    if ((hsm->flags & HSM_FLAGS_REGION) && !HsmRegionContains( ((hsm_region_t*)hsm)->region, next_state )) {
+      ((hsm_region_t*)hsm)->escape= next_state;
+      okay= HSM_TRUE;
+    }
+    else
+    // transition, and if all is well, init
+    if (!HsmTransition( hsm, handler, next_state, evt )) {
+      hsm->current= HsmStateError();
     }
     else {
-      // transition, and if all is well, init
-      if (!HsmTransition( hsm, handler, next_state, evt )) {
-        hsm->current= HsmStateError();
+      okay= HsmInit( hsm, evt );
+      if (hsm->defer && hsm->defer->count) {
+        HsmDeferReplay( hsm, info );
       }
-      else {
-        okay= HsmInit( hsm, evt );
+    }
+  }
+  return okay;
+}
+
+//---------------------------------------------------------------------------
+static void HsmDeferReplay( hsm_machine hsm, const hsm_info_t* info )
+{
+  hsm_defer_t* defer= hsm->defer;
+  if (defer->replaying) {
+    // a replayed event transitioned: the outer loop gives the events deferred so far another go.
+    defer->again= HSM_TRUE;
+  }
+  else {
+    defer->replaying= HSM_TRUE;
+    do {
+      // events deferred again during this pass wait for the next one.
+      int pass= defer->count;
+      defer->again= HSM_FALSE;
+      while (pass-- > 0 && HsmIsRunning( hsm )) {
+        hsm_defer_slot_t slot;
+        hsm_event evt= HsmDeferPop( defer, &slot );
+        HsmDispatch( hsm, evt, HSM_STACK( hsm ), info, NULL );
       }
     }
-  }  
+    while (defer->again && defer->count && HsmIsRunning( hsm ));
+    defer->replaying= HSM_FALSE;
+  }
+}
+
+//---------------------------------------------------------------------------
+hsm_bool HsmCompleteEvent( hsm_machine hsm, hsm_state handler, hsm_state next_state, hsm_event evt )
+{
+  return HsmFinishEvent( hsm, handler, next_state, evt, HSM_INFO( hsm ) );
+}
+
+//---------------------------------------------------------------------------
+hsm_bool HsmSignalEvent( hsm_machine hsm, hsm_event evt )
+{
+  hsm_bool okay= HSM_FALSE;
+  if (hsm && hsm->current) {
+    HSM_TIMED_RUN( hsm, okay= HsmDispatch( hsm, evt, HSM_STACK( hsm ), HSM_INFO( hsm ), NULL ) );
+  }
   return okay;
 }
 
+//---------------------------------------------------------------------------
+int HsmSignalEvents( hsm_machine hsm, const hsm_event* events, int count, hsm_bool* results )
+{
+  int processed=0;
+  if (hsm && hsm->current && events) {
+    // the stack never moves, and callbacks don't change mid-batch: look them up once.
+    hsm_context_stack stack= HSM_STACK( hsm );
+    const hsm_info_t* info= HSM_INFO( hsm );
+    while (processed < count) {
+      hsm_bool okay;
+      HSM_TIMED_RUN( hsm, okay= HsmDispatch( hsm, events[processed], stack, info, NULL ) );
+      if (results) {
+        results[processed]= okay;
+      }
+      ++processed;
+      if (hsm->current == HsmStateFinal() || hsm->current == HsmStateError()) {
+        break;
+      }
+    }
+  }
+  return processed;
+}
+
 //---------------------------------------------------------------------------
 // warning: this indirectly alters the current state and context stack ( via HsmEnter )
 static hsm_bool HsmInit( hsm_machine hsm, hsm_event cause )
@@ -246,12 +640,13 @@ static hsm_bool HsmInit( hsm_machine hsm, hsm_event cause )
   while ( initial_state= hsm->current->initial ) 
   {
     hsm_bool init_moves_to_child= initial_state->parent == hsm->current;
+    const hsm_info_t* info= HSM_INFO( hsm );
     HSM_ASSERT( init_moves_to_child && "malformed statechart: init doesnt move to child state" );
 
-    if (hsm_global_callbacks.on_init) {
+    if (info && info->on_init) {
       hsm_context_stack_t* stack= HSM_STACK( hsm );
       hsm_status_t status= { hsm, hsm->current, stack ? stack->context: 0, cause };
-      hsm_global_callbacks.on_init( &status, hsm_global_callbacks.user_data );
+      info->on_init( &status, info->user_data );
     }     
     
     if (!init_moves_to_child) {
@@ -284,52 +679,85 @@ static hsm_bool HsmEnter( hsm_machine hsm, hsm_state state, hsm_event cause )
     // note: each state gets the context of its parent in entry
     // and can optionally generate a new context in turn
     hsm_context_stack_t* stack= HSM_STACK( hsm );
+    const hsm_info_t* info= HSM_INFO( hsm );
     hsm_status_t status= { hsm, state, stack ? stack->context: 0, cause };
   
     if (state->enter) {
-      status.ctx= state->enter( &status );
+      HSM_TIMED( hsm, state, HSM_STATS_ENTER, status.ctx= state->enter( &status ) );
     }
     
     // push the new context, the stack handles dupes.
-    HsmContextPush( stack, status.ctx ); 
+    // a stack too shallow to hold it stops the machine: the context would be lost otherwise.
+    if (!HsmContextPush( stack, status.ctx )) {
+      if (status.ctx && status.ctx != stack->context && status.ctx->popped) {
+        status.ctx->popped( status.ctx );
+      }
+      hsm->current= HsmStateError();
+      return HSM_FALSE;
+    }
     hsm->current= state;
+    if (hsm->active && state->chart == hsm->active->chart) {
+      hsm->active->bits[ state->index >> 6 ]|= HSM_ACTIVE_BIT( state->index );
+    }
+    if (hsm->history) {
+      hsm->history->leaf= NULL;
+    }
 
     // informational callback, passing in new context
-    if (hsm_global_callbacks.on_entered) {
-      hsm_global_callbacks.on_entered( &status, hsm_global_callbacks.user_data );
+    if (info && info->on_entered) {
+      info->on_entered( &status, info->user_data );
+    }
+
+    // the machine stops at a parallel state, the regions take it from there.
+    if (state->regions && hsm->region_pool) {
+      HsmRegionsEnter( hsm, state, cause );
     }
   }
-  return valid_state;
+  return valid_state && hsm->current != HsmStateError();
 }
 
 //---------------------------------------------------------------------------
 // warning: this directly alters the current state ( and also modifies the context stack. )
-// static 
-void HsmExit( hsm_machine hsm, hsm_event cause )
+static void HsmExit( hsm_machine hsm, hsm_event cause )
 {
   // note: exit, just like process, gets the context enter created
   hsm_context popped;
   hsm_state state= hsm->current;
   hsm_context_stack_t * stack= HSM_STACK( hsm );
+  const hsm_info_t* info= HSM_INFO( hsm );
   hsm_status_t status= { hsm, state, stack ? stack->context: 0, cause };
 
+  // a parallel state's regions exit before it does
+  if (hsm->regions) {
+    HsmRegionsExit( hsm, state, cause );
+  }
+
   // informational callback, passing the old context
-  if (hsm_global_callbacks.on_exiting) {
-    hsm_global_callbacks.on_exiting( &status, hsm_global_callbacks.user_data );
+  if (info && info->on_exiting) {
+    info->on_exiting( &status, info->user_data );
   }
   
   if (state->exit) {
-    state->exit( &status );
+    HSM_TIMED( hsm, state, HSM_STATS_EXIT, state->exit( &status ) );
   }
 
   // exit pops the context that enter had created.
   hsm->current= state->parent;
+  if (hsm->active && state->chart == hsm->active->chart) {
+    hsm->active->bits[ state->index >> 6 ]&= ~HSM_ACTIVE_BIT( state->index );
+  }
+  if (hsm->history) {
+    HsmHistoryExit( hsm->history, state );
+  }
+  if (hsm->timers && hsm->timers->armed) {
+    HsmCancelTimers( hsm, state );
+  }
   popped= HsmContextPop( stack );
 
   // finally: let the user know
   if (popped) {
-    if (hsm_global_callbacks.on_context_popped) {
-      hsm_global_callbacks.on_context_popped( &status, hsm_global_callbacks.user_data );
+    if (info && info->on_context_popped) {
+      info->on_context_popped( &status, info->user_data );
     }
     // call the "hsm_callback_context_popped" of the item thats being popped
     if (popped->popped) {
@@ -339,15 +767,148 @@ void HsmExit( hsm_machine hsm, hsm_event cause )
 }
 
 //---------------------------------------------------------------------------
-// warning: this indirectly alters the current state and context stack ( via HsmEnter  )
-static void HsmRecursiveEnter( hsm_machine hsm, hsm_state state, hsm_event cause )
+// with a run callback, regions on other threads can enter and exit nested parallel states.
+static void HsmRegionPoolLock( hsm_region_pool_t* pool )
+{
+  if (pool->run) {
+    while (!HsmAtomicCas( &pool->lock, 0, 1 )) {
+      HsmAtomicPause();
+    }
+  }
+}
+
+static void HsmRegionPoolUnlock( hsm_region_pool_t* pool )
+{
+  if (pool->run) {
+    HsmAtomicStore( &pool->lock, 0 );
+  }
+}
+
+//---------------------------------------------------------------------------
+void HsmRegionPool( hsm_region_pool_t* pool, hsm_region_t* regions, int count )
+{
+  HSM_ASSERT( pool && (regions || !count) );
+  if (pool) {
+    int i;
+    pool->free= NULL;
+    pool->used= 0;
+    pool->count= count;
+    pool->run= NULL;
+    pool->run_data= NULL;
+    pool->lock= 0;
+    // link backwards so the instances come out in order
+    for (i=count-1; i>=0; --i) {
+      regions[i].next= pool->free;
+      pool->free= &regions[i];
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+hsm_bool HsmMachineRegions( hsm_machine hsm, hsm_region_pool_t* pool )
+{
+  const hsm_bool okay= hsm && pool && !hsm->current;
+  HSM_ASSERT( okay && "regions need a pool, and an unstarted machine" );
+  if (okay) {
+    hsm->region_pool= pool;
+  }
+  return okay;
+}
+
+//---------------------------------------------------------------------------
+// warning: this indirectly alters the region's current state and context stack ( via HsmEnter )
+static void HsmRegionsEnter( hsm_machine hsm, hsm_state parallel, hsm_event cause )
+{
+  hsm_region_pool_t* pool= hsm->region_pool;
+  hsm_context_stack_t* stack= HSM_STACK( hsm );
+  hsm_region_t** tail= &hsm->regions;
+  hsm_state region;
+  for (region= parallel->regions; region; region= region->next_region) {
+    hsm_region_t* it;
+    hsm_machine sub;
+    HsmRegionPoolLock( pool );
+    it= pool->free;
+    if (it) {
+      pool->free= it->next;
+      ++pool->used;
+    }
+    HsmRegionPoolUnlock( pool );
+    HSM_ASSERT( it && "region pool exhausted" );
+    if (!it) {
+      break;
+    }
+    it->region= region;
+    it->escape= NULL;
+    it->evt= NULL;
+    it->handled= HSM_FALSE;
+    it->next= NULL;
+    // link first: the machine is in every region that has started.
+    *tail= it;
+    tail= &it->next;
+    // each region starts from the parallel state's context, and shares the machine's callbacks and pool.
+    sub= HsmMachineWithContext( &it->machine, stack ? stack->context : NULL );
+    sub->flags|= HSM_FLAGS_REGION;
+    sub->info= hsm->info;
+    sub->region_pool= pool;
+    // on a single thread, regions also share the machine's slab, timers, and history.
+    // none of those are thread safe, so with a run callback, the regions go without.
+    if (!pool->run) {
+      sub->slab= hsm->slab;
+      sub->timers= hsm->timers;
+      sub->history= hsm->history;
+    }
+    // a region which can't start stops the whole machine, as an error while running would.
+    if (!HsmRecursiveEnter( sub, region, parallel, cause ) || !HsmInit( sub, cause )) {
+      hsm->current= HsmStateError();
+      break;
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+// warning: this indirectly alters the region's current state and context stack ( via HsmExit )
+static void HsmRegionsExit( hsm_machine hsm, hsm_state parallel, hsm_event cause )
 {
-  if (state) {
-    HsmRecursiveEnter( hsm, state->parent, cause);
-    HsmEnter( hsm, state, cause );
+  hsm_region_pool_t* pool= hsm->region_pool;
+  hsm_region_t* reversed= NULL;
+  hsm_region_t* it;
+  // exit in the opposite order of entry
+  while ((it= hsm->regions)) {
+    hsm->regions= it->next;
+    it->next= reversed;
+    reversed= it;
+  }
+  while ((it= reversed)) {
+    hsm_machine sub= HsmRegionMachine( it );
+    reversed= it->next;
+    // each region has its own innermost state.
+    if (sub->history) {
+      sub->history->leaf= NULL;
+    }
+    // final and error states dont exit
+    while (HsmIsRunning( sub ) && sub->current != parallel) {
+      HsmExit( sub, cause );
+    }
+    HsmRegionPoolLock( pool );
+    it->next= pool->free;
+    pool->free= it;
+    --pool->used;
+    HsmRegionPoolUnlock( pool );
+  }
+  // deep history of an outer state returns to the parallel state, and restarts its regions.
+  if (hsm->history) {
+    hsm->history->leaf= NULL;
   }
 }
 
+//---------------------------------------------------------------------------
+// warning: this indirectly alters the current state and context stack ( via HsmEnter  )
+static hsm_bool HsmRecursiveEnter( hsm_machine hsm, hsm_state state, hsm_state stop, hsm_event cause )
+{
+  return (state == stop) || 
+    (HsmRecursiveEnter( hsm, state->parent, stop, cause ) && HsmEnter( hsm, state, cause ));
+}
+
 //---------------------------------------------------------------------------
 /**
  According to the http://www.w3.org/TR/scxml/#SelectingTransitions:
@@ -387,24 +948,31 @@ static hsm_bool HsmTransition( hsm_machine hsm, hsm_state source, hsm_state targ
     ERROR_IF_FALSE( hsm->current, "jumped past top" );
   }        
 
+  // compiled charts already know how far to exit, and what to enter.
+  if (source->chart && (source->chart == target->chart)) {
+    const hsm_chart_t* chart= source->chart;
+    const hsm_state* path= HsmChartEntries( chart, source, target );
+    int exits= HsmChartExits( chart, source, target );
+    while (exits-- > 0) {
+      HsmExit( hsm, cause );
+    }
+    // ( <--- note: in uml transitions actions would take place here )
+    for (; hsm->current != target; ++path) {
+      ERROR_IF_FALSE( HsmEnter( hsm, *path, cause ), "couldn't enter" );
+    }
+  }
+  else
   // quick check for self transition: the source targeted itself ( III. above )
   if ( hsm->current == target ) {
     HsmExit( hsm, cause );
     // ( <--- note: in uml transitions actions would take place here )
     // ( in hsm_statechart, they've already happened by now )
-    HsmEnter( hsm, target, cause );
+    ERROR_IF_FALSE( HsmEnter( hsm, target, cause ), "couldn't enter" );
   }
   else {
-    // the easiest entry path record is an object on the stack... 
-    // doesnt worry too much about stack overflow, 
-    // instead it lets the user control it via HSM_MAX_DEPTH...
-    int pt=0;
+    // the path to target gets recorded by HsmRecursiveEnter() on the c stack,
+    // so there's no limit on depth, and no array to size.
     hsm_state track= target;
-    // change to help simplify lua rocks
-    //hsm_state* path_to_target=(hsm_state*) alloca( target->depth * sizeof(hsm_state) );
-    hsm_state path_to_target[ HSM_MAX_DEPTH ];
-    //ERROR_IF_FALSE( path_to_target, "out of space" );
-    ERROR_IF_FALSE( target->depth < HSM_MAX_DEPTH, "transition max depth exceeded" );
  
     // source deep than target?
     if (hsm->current->depth > track->depth) {
@@ -416,9 +984,8 @@ static hsm_bool HsmTransition( hsm_machine hsm, hsm_state source, hsm_state targ
     }
     // target deeper than source?
     else {
-      // *record* its path up to the same level
+      // *track* its path up to the same level
       while (track->depth > hsm->current->depth ) {
-        path_to_target[pt++]= track;
         track= track->parent;
         ERROR_IF_FALSE( track, "jumped past top" );
       }
@@ -431,17 +998,15 @@ static hsm_bool HsmTransition( hsm_machine hsm, hsm_state source, hsm_state targ
       // if they are the same node, then source was an ancestor of target.
       if (hsm->current == track) {
         HsmExit( hsm, cause );     // this bumps the current state up
-        path_to_target[pt++]= track; // record that we need to renter it
-        track= hsm->current;     // and bump track up to the same level
+        track= hsm->current;     // and bump track up to the same level, so we re-enter the source
       }
     #endif      
     }
       
     // keep going up together till current and track have found each other
-    // ( keep exiting 'current' as it goes up; keep recording 'track' as *it* goes up )
+    // ( keep exiting 'current' as it goes up; keep tracking 'track' as *it* goes up )
     while (hsm->current!= track) {
       HsmExit( hsm, cause ); 
-      path_to_target[pt++]= track;
       track= track->parent;
       ERROR_IF_FALSE( hsm->current&&track, "jumped past top" );
     }      
@@ -449,12 +1014,9 @@ static hsm_bool HsmTransition( hsm_machine hsm, hsm_state source, hsm_state targ
     // ( <--- note: in uml transitions actions would take place here )
     // ( in hsm_statechart, they've already happened by now )
 
-    // now have current use path the we just recorded:
+    // now enter from the common ancestor back down to target:
     // it's turtles all the way down.
-    while (pt>0) {
-      track= path_to_target[--pt];
-      HsmEnter( hsm, track, cause );
-    }
+    ERROR_IF_FALSE( HsmRecursiveEnter( hsm, target, track, cause ), "couldn't enter" );
   }
   // note: on error we will have already returned HSM_FALSE
   return HSM_TRUE;
@@ -51,7 +51,7 @@ typedef struct hsm_context_machine_rec hsm_context_machine_t;
 #define HSM_FLAGS_CTX      (1<<16)   // is the machine a context machine
 #define HSM_FLAGS_HULA     (1<<17)   // is the machine a hula machine
 //#define HSM_FLAGS_INFO   (1<<17)   // flags per thing to log?
-//#define HSM_FLAGS_REGION (1<<18)
+#define HSM_FLAGS_REGION   (1<<18)   // is the machine a region of some parallel state
 
 //---------------------------------------------------------------------------
 /**
@@ -73,6 +73,67 @@ struct hsm_machine_rec
      * NULL until HsmStart() called.
      */
     hsm_state current;
+
+    /**
+     * Optional queue for posted events.
+     * @see HsmMachineQueue
+     */
+    struct hsm_queue_rec * queue;
+
+    /**
+     * Optional callbacks for this machine alone; NULL uses the global callbacks.
+     * @see HsmSetMachineInfo
+     */
+    const struct hsm_info_rec * info;
+
+    /**
+     * Optional slab for per-state contexts.
+     * @see HsmMachineSlab, HsmMachineContextAlloc
+     */
+    struct hsm_slab_rec * slab;
+
+    /**
+     * Optional set of active states.
+     * @see HsmMachineActive
+     */
+    struct hsm_active_rec * active;
+
+    /**
+     * Optional table of history.
+     * @see HsmMachineHistory
+     */
+    struct hsm_history_rec * history;
+
+    /**
+     * Optional queue of deferred events.
+     * @see HsmMachineDefer
+     */
+    struct hsm_defer_rec * defer;
+
+    /**
+     * Optional timers.
+     * @see HsmMachineTimers
+     */
+    struct hsm_timers_rec * timers;
+
+    /**
+     * Optional pool for the regions of parallel states.
+     * @see HsmMachineRegions
+     */
+    struct hsm_region_pool_rec * region_pool;
+
+    /**
+     * The regions of the current state, when the current state is a parallel state.
+     */
+    struct hsm_region_rec * regions;
+
+#ifdef HSM_USE_STATS
+    /**
+     * Optional latency histograms.
+     * @see HsmMachineStats
+     */
+    struct hsm_machine_stats_rec * stats;
+#endif
 };
 
 /**
@@ -112,6 +173,18 @@ hsm_machine HsmMachine( struct hsm_machine_rec* machine );
  */
 hsm_machine HsmMachineWithContext( struct hsm_context_machine_rec* machine, hsm_context ctx );
 
+/**
+ * Initialize a statemachine with a context stack that can track contexts at any depth.
+ * Use this for machines with states deeper than #HSM_MAX_DEPTH.
+ *
+ * @param machine hsm_context_machine_rec to initialize.
+ * @param wide Storage for the stack's presence bits; see HsmContextStackWide().
+ * @param ctx Optional context for the entire machine.
+ *
+ * @return #hsm_machine pointer
+ */
+hsm_machine HsmMachineWithWideContext( struct hsm_context_machine_rec* machine, struct hsm_context_wide_rec* wide, hsm_context ctx );
+
 /**
  * Start a machine.
  *
@@ -132,6 +205,35 @@ hsm_bool HsmStart( hsm_machine hsm, hsm_state state );
  */
 hsm_bool HsmSignalEvent( hsm_machine hsm, hsm_event evt );
 
+/**
+ * Send a batch of events to the machine, one after the other.
+ * Each event runs to completion, exactly as if passed to HsmSignalEvent(),
+ * but the per-call setup happens once for the whole batch.
+ *
+ * @param hsm The #hsm_machine targeted.
+ * @param events Array of user defined events.
+ * @param count Number of events in the array.
+ * @param results Optional, filled with what HsmSignalEvent() would have returned for each event processed.
+ *
+ * @return Number of events processed. Processing stops early after an event moves the machine
+ * to HsmStateFinal() or HsmStateError(); the remaining events, and their results, are untouched.
+ *
+ * @note The info callbacks ( see HsmSetInfoCallbacks() ) are read once per batch.
+ */
+int HsmSignalEvents( hsm_machine hsm, const hsm_event* events, int count, hsm_bool* results );
+
+/**
+ * Finish an event whose handler was found outside of HsmSignalEvent(), ex. by HsmPoolBroadcast().
+ * Transitions, runs init, or reports the event unhandled, exactly as HsmSignalEvent() would.
+ *
+ * @param hsm The #hsm_machine targeted.
+ * @param handler The state whose process callback responded; NULL if no state did.
+ * @param next_state What the handler returned; NULL if the event went unhandled.
+ * @param evt The event.
+ * @return #HSM_TRUE if handled
+ */
+hsm_bool HsmCompleteEvent( hsm_machine hsm, hsm_state handler, hsm_state next_state, hsm_event evt );
+
 /**
  * Determine if a machine has been started, and has not reached a terminal, nor an error state.
  *
@@ -142,6 +244,7 @@ hsm_bool HsmIsRunning( const hsm_machine hsm );
 
 /**
  * Traverses the active state hierarchy to determine if hsm is possibly in the passed state.
+ * Machines with an active set ( HsmMachineActive ) just test a bit for states in the set's chart.
  *
  * @param hsm  #hsm_machine
  * @param state #hsm_state
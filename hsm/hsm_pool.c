@@ -0,0 +1,298 @@
+/**
+ * @file hsm_pool.c
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "hsm_chart.h"
+#include "hsm_pool.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+hsm_bool HsmPool( hsm_pool_t* pool, int count )
+{
+  hsm_bool okay= HSM_FALSE;
+  HSM_ASSERT( pool && count > 0 );
+  if (pool && count > 0) {
+    // at most one group per machine; keep the table at most half full.
+    int buckets= 1;
+    while (buckets < 2*count) {
+      buckets<<= 1;
+    }
+    memset( pool, 0, sizeof(hsm_pool_t) );
+    pool->count= count;
+    pool->mask= buckets-1;
+    pool->machines= (hsm_machine_t*) malloc( count * sizeof(hsm_machine_t) );
+    pool->current= (hsm_state*) calloc( count, sizeof(hsm_state) );
+    pool->group_of= (int*) malloc( count * sizeof(int) );
+    pool->order= (int*) malloc( count * sizeof(int) );
+    pool->waiting= (int*) malloc( count * sizeof(int) );
+    pool->group_state= (hsm_state*) malloc( count * sizeof(hsm_state) );
+    pool->group_start= (int*) malloc( (count+1) * sizeof(int) );
+    pool->keys= (hsm_state*) malloc( buckets * sizeof(hsm_state) );
+    pool->values= (int*) malloc( buckets * sizeof(int) );
+    pool->stamps= (int*) calloc( buckets, sizeof(int) );
+    okay= pool->machines && pool->current && pool->group_of && pool->order && pool->waiting && pool->group_state &&
+          pool->group_start && pool->keys && pool->values && pool->stamps;
+    if (!okay) {
+      HsmPoolRelease( pool );
+    }
+    else {
+      int i;
+      for (i=0; i<count; ++i) {
+        HsmMachine( &pool->machines[i] );
+      }
+      pool->stale= HSM_TRUE;
+    }
+  }
+  return okay;
+}
+
+//---------------------------------------------------------------------------
+void HsmPoolRelease( hsm_pool_t* pool )
+{
+  if (pool) {
+    free( pool->machines );
+    free( pool->current );
+    free( pool->group_of );
+    free( pool->order );
+    free( pool->waiting );
+    free( pool->group_state );
+    free( pool->group_start );
+    free( pool->keys );
+    free( pool->values );
+    free( pool->stamps );
+    memset( pool, 0, sizeof(hsm_pool_t) );
+  }
+}
+
+//---------------------------------------------------------------------------
+int HsmPoolStart( hsm_pool_t* pool, hsm_state first_state )
+{
+  int running=0;
+  if (pool) {
+    int i;
+    for (i=0; i<pool->count; ++i) {
+      running+= HsmStart( &pool->machines[i], first_state ) ? 1 : 0;
+    }
+    HsmPoolRefresh( pool );
+  }
+  return running;
+}
+
+//---------------------------------------------------------------------------
+void HsmPoolRefresh( hsm_pool_t* pool )
+{
+  if (pool) {
+    int i;
+    for (i=0; i<pool->count; ++i) {
+      pool->current[i]= pool->machines[i].current;
+    }
+    pool->stale= HSM_TRUE;
+  }
+}
+
+//---------------------------------------------------------------------------
+/**
+ * @internal
+ * Catch up with a machine the pool just signalled: while its cache line is still warm.
+ */
+static void HsmPoolNote( hsm_pool_t* pool, int index )
+{
+  const hsm_state current= pool->machines[index].current;
+  if (current != pool->current[index]) {
+    pool->current[index]= current;
+    pool->stale= HSM_TRUE;
+  }
+}
+
+//---------------------------------------------------------------------------
+hsm_bool HsmPoolSignal( hsm_pool_t* pool, int index, hsm_event evt )
+{
+  hsm_bool handled= HSM_FALSE;
+  HSM_ASSERT( pool && index >= 0 && index < pool->count );
+  if (pool && index >= 0 && index < pool->count) {
+    handled= HsmSignalEvent( &pool->machines[index], evt );
+    HsmPoolNote( pool, index );
+  }
+  return handled;
+}
+
+//---------------------------------------------------------------------------
+/**
+ * @internal
+ * Find the group for a state, adding a new group if needed.
+ */
+static int HsmPoolGroup( hsm_pool_t* pool, hsm_state state, int* groups )
+{
+  // pointers are aligned, so skip the low bits; fibonacci hashing spreads the rest.
+  unsigned int at= (unsigned int)(((size_t) state >> 3) * 2654435761u) & pool->mask;
+  for (;; at= (at+1) & pool->mask) {
+    if (pool->stamps[at] != pool->generation) {
+      const int group= (*groups)++;
+      pool->stamps[at]= pool->generation;
+      pool->keys[at]= state;
+      pool->values[at]= group;
+      pool->group_state[group]= state;
+      pool->group_start[group]= 0;
+      return group;
+    }
+    if (pool->keys[at] == state) {
+      return pool->values[at];
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+/**
+ * @internal
+ * Sort the running machines into groups by current state: a counting sort, keyed by the table.
+ */
+static void HsmPoolRegroup( hsm_pool_t* pool )
+{
+  const hsm_state final_state= HsmStateFinal();
+  const hsm_state error_state= HsmStateError();
+  int i, g, groups=0, total;
+
+  // a new generation empties the table without touching it.
+  if (++pool->generation <= 0) {
+    memset( pool->stamps, 0, (pool->mask+1) * sizeof(int) );
+    pool->generation= 1;
+  }
+
+  // count the machines in each state...
+  for (i=0; i<pool->count; ++i) {
+    hsm_state current= pool->current[i];
+    if (!current || current == final_state || current == error_state) {
+      pool->group_of[i]= -1;
+    }
+    else {
+      const int group= HsmPoolGroup( pool, current, &groups );
+      pool->group_of[i]= group;
+      ++pool->group_start[group];
+    }
+  }
+  // ...turn the counts into starting offsets...
+  for (g=0, total=0; g<groups; ++g) {
+    const int n= pool->group_start[g];
+    pool->group_start[g]= total;
+    total+= n;
+  }
+  // ...and lay out the machines group by group, using the offsets as cursors.
+  for (i=0; i<pool->count; ++i) {
+    const int group= pool->group_of[i];
+    if (group >= 0) {
+      pool->order[ pool->group_start[group]++ ]= i;
+    }
+  }
+  // every cursor now sits at the start of the next group.
+  for (g=groups; g>0; --g) {
+    pool->group_start[g]= pool->group_start[g-1];
+  }
+  pool->group_start[0]= 0;
+  pool->groups= groups;
+  pool->stale= HSM_FALSE;
+}
+
+//---------------------------------------------------------------------------
+/**
+ * @internal
+ * The state, or its closest ancestor, interested in the event; the state itself without an interest table.
+ */
+static hsm_state HsmPoolInterested( const int* first, hsm_state state )
+{
+  if (first && state) {
+    const int index= first[ state->index*HSM_EVENT_TYPES ];
+    state= (index >= 0) ? state->chart->states[ index ] : NULL;
+  }
+  return state;
+}
+
+//---------------------------------------------------------------------------
+int HsmPoolBroadcast( hsm_pool_t* pool, hsm_event evt )
+{
+  int handled=0;
+  if (pool && pool->count) {
+    int g;
+    if (pool->stale) {
+      HsmPoolRegroup( pool );
+    }
+    // bubble each group up the hierarchy together:
+    // at every level, machines which got a response finish, the rest move on to the parent.
+    for (g=0; g<pool->groups; ++g) {
+      const hsm_state state= pool->group_state[g];
+      const hsm_chart_t* chart= state->chart;
+      const int* first= NULL;
+      int* waiting= pool->waiting;
+      int left= pool->group_start[g+1] - pool->group_start[g];
+      int i;
+      hsm_state handler;
+      memcpy( waiting, pool->order + pool->group_start[g], left * sizeof(int) );
+      for (i=0; i<left; ++i) {
+        HSM_ASSERT( pool->machines[ waiting[i] ].current == state && "pool machine changed without HsmPoolRefresh()" );
+      }
+      // every machine in a parallel state has regions of its own, which hear the event first.
+      if (state->regions) {
+        for (i=0; i<left; ++i) {
+          handled+= HsmPoolSignal( pool, waiting[i], evt ) ? 1 : 0;
+        }
+        continue;
+      }
+      // compiled charts with interests skip the states that can't handle the event, as HsmSignalEvent() does.
+      if (chart && chart->first) {
+        const int type= chart->event_type( evt );
+        if (type >= 0 && type < HSM_EVENT_TYPES) {
+          first= chart->first + type;
+        }
+      }
+#ifdef HSM_USE_STATS
+      // machines keeping stats run on their own, so that their callbacks and runs get timed as usual.
+      {
+        int k, kept=0;
+        for (k=0; k<left; ++k) {
+          hsm_machine hsm= &pool->machines[ waiting[k] ];
+          if (hsm->stats) {
+            handled+= HsmPoolSignal( pool, waiting[k], evt ) ? 1 : 0;
+          }
+          else {
+            waiting[kept++]= waiting[k];
+          }
+        }
+        left= kept;
+      }
+#endif
+      for (handler= HsmPoolInterested( first, state ); handler && left; handler= HsmPoolInterested( first, handler->parent )) {
+        if (handler->process) {
+          int k, kept=0;
+          for (k=0; k<left; ++k) {
+            hsm_machine hsm= &pool->machines[ waiting[k] ];
+            hsm_status_t status= { hsm, handler, NULL, evt };
+            hsm_state next_state= handler->process( &status );
+            if (!next_state) {
+              waiting[kept++]= waiting[k];
+            }
+            else {
+              // even a plain HsmStateHandled() goes through here, so the info callbacks hear about it.
+              handled+= HsmCompleteEvent( hsm, handler, next_state, evt ) ? 1 : 0;
+              HsmPoolNote( pool, waiting[k] );
+            }
+          }
+          left= kept;
+        }
+      }
+      // ran off the top of the tree
+      for (i=0; i<left; ++i) {
+        HsmCompleteEvent( &pool->machines[ waiting[i] ], NULL, NULL, evt );
+        HsmPoolNote( pool, waiting[i] );
+      }
+    }
+  }
+  return handled;
+}
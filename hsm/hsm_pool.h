@@ -0,0 +1,149 @@
+/**
+ * @file hsm_pool.h
+ *
+ * Send one event to many machines at once.
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#pragma once
+#ifndef __HSM_POOL_H__
+#define __HSM_POOL_H__
+
+#include "hsm_machine.h"
+
+typedef struct hsm_pool_rec hsm_pool_t;
+
+//---------------------------------------------------------------------------
+/**
+ * A block of machines which all receive the same events.
+ *
+ * HsmPoolBroadcast() groups the machines by their current state,
+ * then runs each state's process callback over every machine of a group in one pass,
+ * rather than walking the hierarchy separately for every machine.
+ *
+ * The machines are plain #hsm_machine_t, without context stacks: handlers receive a NULL context.
+ * Machines are independent, so the order they see a broadcast event in is unspecified.
+ *
+ * The pool keeps its own dense copy of every machine's current state, so that grouping doesn't
+ * stride through the machines themselves. Changing a machine behind the pool's back needs HsmPoolRefresh().
+ *
+ * 1. HsmPool()
+ * 2. HsmPoolStart(), or HsmStart() each HsmPoolMachine() then HsmPoolRefresh()
+ * 3. HsmPoolBroadcast() ( or HsmPoolSignal() any single machine. )
+ * 4. HsmPoolRelease()
+ */
+struct hsm_pool_rec
+{
+    /**
+     * the machines, contiguously.
+     */
+    hsm_machine_t * machines;
+
+    /**
+     * number of machines.
+     */
+    int count;
+
+    /**
+     * @internal: per machine, its current state as of the pool's last look.
+     */
+    hsm_state * current;
+
+    /**
+     * @internal: true when some machine has left the state it was grouped by.
+     */
+    hsm_bool stale;
+
+    /**
+     * @internal: per machine, the group it was placed in for the current broadcast.
+     */
+    int * group_of;
+
+    /**
+     * @internal: machine indices, grouped by state; kept between broadcasts while no machine changes state.
+     */
+    int * order;
+
+    /**
+     * @internal: scratch for the machines of a group still looking for a handler.
+     */
+    int * waiting;
+
+    /**
+     * @internal: per group, the shared state, and the group's first entry in order.
+     */
+    hsm_state * group_state;
+    int * group_start;
+    int groups;
+
+    /**
+     * @internal: open addressed table from state to group, valid only when stamp matches generation.
+     */
+    hsm_state * keys;
+    int * values;
+    int * stamps;
+    int mask;
+    int generation;
+};
+
+/**
+ * Allocate a pool of machines, each initialized with HsmMachine().
+ *
+ * @param pool The pool to initialize.
+ * @param count Number of machines.
+ * @return #HSM_FALSE if out of memory.
+ */
+hsm_bool HsmPool( hsm_pool_t* pool, int count );
+
+/**
+ * Free the pool's memory.
+ * Doesn't exit the machines: states with exit callbacks should be exited first.
+ */
+void HsmPoolRelease( hsm_pool_t* pool );
+
+/**
+ * Access a single machine.
+ */
+#define HsmPoolMachine( pool, index ) (&(pool)->machines[index])
+
+/**
+ * Start every machine in the passed state.
+ *
+ * @return Number of machines running.
+ */
+int HsmPoolStart( hsm_pool_t* pool, hsm_state first_state );
+
+/**
+ * Look at every machine's current state again.
+ * Call after changing machines directly, ex. with HsmStart() or HsmSignalEvent(), before the next broadcast.
+ */
+void HsmPoolRefresh( hsm_pool_t* pool );
+
+/**
+ * Send the passed event to a single machine, as HsmSignalEvent() would, keeping the pool up to date.
+ *
+ * @param pool The pool.
+ * @param index Which machine.
+ * @param evt A user defined event.
+ * @return #HSM_TRUE if the machine handled the event.
+ */
+hsm_bool HsmPoolSignal( hsm_pool_t* pool, int index, hsm_event evt );
+
+/**
+ * Send the passed event to every running machine in the pool.
+ * Each machine handles the event exactly as HsmSignalEvent() would.
+ * Machines in a parallel state ( see hsm_region.h ) are signalled one at a time, outside of their group,
+ * as are, under #HSM_USE_STATS, machines with stats.
+ *
+ * @param pool The pool.
+ * @param evt A user defined event.
+ * @return Number of machines which handled the event.
+ */
+int HsmPoolBroadcast( hsm_pool_t* pool, hsm_event evt );
+
+#endif // #ifndef __HSM_POOL_H__
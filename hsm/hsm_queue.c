@@ -0,0 +1,192 @@
+/**
+ * @file hsm_queue.c
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "hsm_machine.h"
+#include "hsm_queue.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+/* ---------------------------------------------------------------------------
+   the ring is dmitry vyukov's bounded queue:
+   http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+
+   each slot's sequence says which lap of the ring it's waiting for:
+     sequence == pos    : empty, ready for the producer claiming pos.
+     sequence == pos+1  : full, ready for the consumer reading pos.
+   producers race to claim pos by bumping tail; the single consumer just walks head.
+
+   pending counts the events published but not yet run; its owned bit says a ready callback has the machine.
+   whoever sets the bit hands the machine over, and the consumer clears it in the same step that takes the count to zero.
+ * --------------------------------------------------------------------------- */
+#define HSM_QUEUE_OWNED (1L << 30)
+#define HSM_QUEUE_COUNT (HSM_QUEUE_OWNED-1)
+
+//---------------------------------------------------------------------------
+// take an unowned machine with pending events for the ready callback; only one caller can succeed.
+static hsm_bool HsmQueueClaim( hsm_queue_t* queue )
+{
+  for (;;) {
+    const long pending= HsmAtomicLoad( &queue->pending );
+    if (!(pending & HSM_QUEUE_COUNT) || (pending & HSM_QUEUE_OWNED)) {
+      return HSM_FALSE;
+    }
+    if (HsmAtomicCas( &queue->pending, pending, pending | HSM_QUEUE_OWNED )) {
+      return HSM_TRUE;
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+// one event has run: returns whether any remain; the last one gives up ownership.
+static hsm_bool HsmQueueFinish( hsm_queue_t* queue )
+{
+  for (;;) {
+    const long pending= HsmAtomicLoad( &queue->pending );
+    const long left= (pending & HSM_QUEUE_COUNT) - 1;
+    if (HsmAtomicCas( &queue->pending, pending, left ? pending-1 : 0 )) {
+      return left > 0;
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+hsm_bool HsmMachineQueue( hsm_machine hsm, hsm_queue_t* queue, hsm_queue_slot_t* slots, int capacity )
+{
+  const hsm_bool okay= hsm && queue && slots && (capacity > 0) && (capacity < HSM_QUEUE_OWNED) && ((capacity & (capacity-1)) == 0);
+  HSM_ASSERT( okay && "queue capacity must be a power of two" );
+  if (okay) {
+    int i;
+    for (i=0; i<capacity; ++i) {
+      slots[i].sequence= i;
+      slots[i].evt= NULL;
+    }
+    queue->slots= slots;
+    queue->mask= capacity-1;
+    queue->tail= 0;
+    queue->head= 0;
+    queue->pending= 0;
+    queue->ready= NULL;
+    queue->ready_data= NULL;
+    queue->done= NULL;
+    queue->user_data= NULL;
+    hsm->queue= queue;
+  }
+  return okay;
+}
+
+//---------------------------------------------------------------------------
+hsm_bool HsmQueueReady( hsm_machine hsm, hsm_callback_queue_ready ready, void * ready_data )
+{
+  hsm_queue_t* queue= hsm ? hsm->queue : NULL;
+  HSM_ASSERT( queue && "machine has no queue" );
+  if (queue) {
+    queue->ready_data= ready_data;
+    HsmAtomicStorePtr( &queue->ready, ready );
+    // pairs with the fence in HsmPostEvent(): either we see its event, or it sees our callback.
+    HsmAtomicFence();
+    if (ready && HsmQueueClaim( queue )) {
+      ready( hsm, ready_data );
+    }
+  }
+  return queue != NULL;
+}
+
+//---------------------------------------------------------------------------
+hsm_bool HsmPostEvent( hsm_machine hsm, hsm_event evt )
+{
+  hsm_bool okay= HSM_FALSE;
+  hsm_queue_t* queue= hsm ? hsm->queue : NULL;
+  HSM_ASSERT( queue && "machine has no queue" );
+  if (queue && evt) {
+    long pos= HsmAtomicLoad( &queue->tail );
+    hsm_queue_slot_t* slot;
+    for (;;) {
+      long dif;
+      slot= queue->slots + (pos & queue->mask);
+      dif= HsmAtomicLoad( &slot->sequence ) - pos;
+      if (dif == 0) {
+        if (HsmAtomicCas( &queue->tail, pos, pos+1 )) {
+          okay= HSM_TRUE;
+          break;
+        }
+      }
+      else
+      if (dif < 0) {
+        break; // full: the consumer hasnt freed this slot from the last lap
+      }
+      pos= HsmAtomicLoad( &queue->tail );
+    }
+    if (okay) {
+      slot->evt= evt;
+      HsmAtomicStore( &slot->sequence, pos+1 );
+      // the first event for an idle machine hands the machine to the ready callback.
+      if (HsmAtomicAdd( &queue->pending, 1 ) == 0) {
+        hsm_callback_queue_ready ready;
+        HsmAtomicFence();
+        ready= HsmAtomicLoadPtr( &queue->ready );
+        if (ready && HsmQueueClaim( queue )) {
+          ready( hsm, queue->ready_data );
+        }
+      }
+    }
+  }
+  return okay;
+}
+
+//---------------------------------------------------------------------------
+int HsmDrainEvents( hsm_machine hsm, int max )
+{
+  int count=0;
+  HsmDrainSome( hsm, max, &count );
+  return count;
+}
+
+//---------------------------------------------------------------------------
+hsm_bool HsmDrainSome( hsm_machine hsm, int max, int * processed )
+{
+  hsm_bool owned= HSM_FALSE;
+  int count=0;
+  hsm_queue_t* queue= hsm ? hsm->queue : NULL;
+  HSM_ASSERT( queue && "machine has no queue" );
+  if (queue && HsmAtomicLoad( &queue->pending ) > 0) {
+    owned= HSM_TRUE;
+    while (owned && count < max) {
+      hsm_queue_slot_t* slot= queue->slots + (queue->head & queue->mask);
+      hsm_event evt;
+      // pending counts published events, so a slot not yet full
+      // means a producer is between claiming the slot and filling it: wait for them.
+      while (HsmAtomicLoad( &slot->sequence ) != queue->head+1) {
+        HsmAtomicPause();
+      }
+      evt= slot->evt;
+      HsmAtomicStore( &slot->sequence, queue->head + queue->mask + 1 );
+      ++queue->head;
+
+      HsmSignalEvent( hsm, evt );
+      if (queue->done) {
+        queue->done( evt, queue->user_data );
+      }
+      ++count;
+      // last pending event? then the machine is idle, and the next post will announce itself.
+      owned= HsmQueueFinish( queue );
+    }
+  }
+  if (processed) {
+    *processed= count;
+  }
+  return owned;
+}
+
+//---------------------------------------------------------------------------
+int HsmPendingEvents( const hsm_machine hsm )
+{
+  return (hsm && hsm->queue) ? (int)( HsmAtomicLoad( &hsm->queue->pending ) & HSM_QUEUE_COUNT ) : 0;
+}
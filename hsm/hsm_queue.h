@@ -0,0 +1,177 @@
+/**
+ * @file hsm_queue.h
+ *
+ * Posted events: a lock-free, per machine, event queue.
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#pragma once
+#ifndef __HSM_QUEUE_H__
+#define __HSM_QUEUE_H__
+
+#include "hsm_atomic.h"
+#include "hsm_forwards.h"
+
+typedef struct hsm_queue_rec hsm_queue_t;
+typedef struct hsm_queue_slot_rec hsm_queue_slot_t;
+
+/**
+ * Hear about an event that has been posted to an idle machine.
+ * Called on the posting thread. Ownership of the machine passes to whoever this callback hands it to:
+ * until HsmDrainEvents() reports the queue idle again, no other thread will be told.
+ *
+ * @param hsm The machine that now has pending events.
+ * @param ready_data The hsm_queue_rec::ready_data.
+ */
+typedef void (*hsm_callback_queue_ready)( hsm_machine hsm, void * ready_data );
+
+/**
+ * Hear about an event that has run to completion, for instance: to free it.
+ *
+ * @param evt The event that was posted.
+ * @param user_data The hsm_queue_rec::user_data.
+ */
+typedef void (*hsm_callback_queue_done)( hsm_event evt, void * user_data );
+
+/**
+ * One slot in a queue's ring.
+ */
+struct hsm_queue_slot_rec
+{
+    /**
+     * @internal: which lap of the ring the slot is ready for.
+     */
+    hsm_atomic sequence;
+
+    /**
+     * the posted event
+     */
+    hsm_event evt;
+};
+
+//---------------------------------------------------------------------------
+/**
+ * A bounded, multiple producer, single consumer event queue.
+ *
+ * Any number of threads can HsmPostEvent() to a machine.
+ * A single thread at a time calls HsmDrainEvents(), which runs each event to completion, in order.
+ * Handlers can safely post to their own machine; unlike calling HsmSignalEvent() from a handler,
+ * the event waits for the current one to finish.
+ *
+ * @see HsmMachineQueue
+ */
+struct hsm_queue_rec
+{
+    /**
+     * ring storage, provided by the user.
+     */
+    hsm_queue_slot_t * slots;
+
+    /**
+     * size of the ring minus one; the size must be a power of two.
+     */
+    long mask;
+
+    /**
+     * @internal: next slot a producer will write.
+     */
+    hsm_atomic tail;
+
+    /**
+     * @internal: next slot the consumer will read.
+     */
+    long head;
+
+    /**
+     * @internal: events posted but not yet run to completion; the top bit is set while the ready callback owns the machine.
+     */
+    hsm_atomic pending;
+
+    /**
+     * optional: notification of work for an idle machine.
+     * once other threads might be posting, change it only through HsmQueueReady().
+     */
+    hsm_callback_queue_ready volatile ready;
+
+    /**
+     * data passed to the ready callback.
+     */
+    void * ready_data;
+
+    /**
+     * optional: notification of a completed event.
+     */
+    hsm_callback_queue_done done;
+
+    /**
+     * custom user data passed to the done callback.
+     */
+    void * user_data;
+};
+
+/**
+ * Give a machine a queue for posted events.
+ *
+ * @param hsm Machine which will receive the events.
+ * @param queue Queue to initialize. Its lifetime must exceed the machine's use of it.
+ * @param slots Storage for the queue.
+ * @param capacity Number of slots; must be a power of two, less than 2^30.
+ * @return #HSM_FALSE if the capacity isn't a power of two.
+ */
+hsm_bool HsmMachineQueue( hsm_machine hsm, hsm_queue_t* queue, hsm_queue_slot_t* slots, int capacity );
+
+/**
+ * Set the ready callback of a machine which other threads may already be posting to.
+ * If events are waiting, and no callback owns the machine yet, the new callback hears about them right away.
+ * Either this call or a racing post hands the machine over, never both.
+ *
+ * @param hsm Machine with a queue.
+ * @param ready The new hsm_queue_rec::ready.
+ * @param ready_data The new hsm_queue_rec::ready_data.
+ * @return #HSM_FALSE if the machine has no queue.
+ */
+hsm_bool HsmQueueReady( hsm_machine hsm, hsm_callback_queue_ready ready, void * ready_data );
+
+/**
+ * Post an event to a machine from any thread.
+ *
+ * @param hsm Machine with a queue.
+ * @param evt Event to post. Its lifetime must extend until it has run to completion.
+ * @return #HSM_FALSE if the queue is full, or the machine has no queue.
+ */
+hsm_bool HsmPostEvent( hsm_machine hsm, hsm_event evt );
+
+/**
+ * Run posted events to completion, in the order they were posted.
+ * Only one thread at a time may drain a machine.
+ *
+ * @param hsm Machine with a queue.
+ * @param max Maximum number of events to process.
+ * @return Number of events processed.
+ *
+ * @note Stops early once the queue is empty; the next post will trigger hsm_queue_rec::ready again.
+ */
+int HsmDrainEvents( hsm_machine hsm, int max );
+
+/**
+ * Run up to max posted events to completion, and report whether the caller still owns the machine.
+ *
+ * @param hsm Machine with a queue.
+ * @param max Maximum number of events to process.
+ * @param processed Optional, filled with the number of events processed.
+ * @return #HSM_TRUE if events remain: the caller still owns the machine and should drain it again later.
+ * #HSM_FALSE if the machine went idle: the next post will trigger hsm_queue_rec::ready.
+ */
+hsm_bool HsmDrainSome( hsm_machine hsm, int max, int * processed );
+
+/**
+ * Number of events posted but not yet run to completion.
+ */
+int HsmPendingEvents( const hsm_machine hsm );
+
+#endif // #ifndef __HSM_QUEUE_H__
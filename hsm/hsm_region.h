@@ -0,0 +1,171 @@
+/**
+ * @file hsm_region.h
+ *
+ * Orthogonal regions: parallel states whose regions run side by side.
+ *
+ * A parallel state ( #HSM_PARALLEL ) has no initial state; instead, entering it starts each of its regions ( #HSM_REGION ).
+ * Every region keeps its own current state, so the machine is in one state of every region at once.
+ * Events go to each region in turn, innermost state first; if no region handles the event, it bubbles up from the parallel state as usual.
+ *
+ * Rules:
+ * @li Regions enter in the order they're declared, each one down through its initial states before the next begins; they exit in the reverse order.
+ * @li A transition within a region stays within that region.
+ * @li A transition from a region to any state outside of it leaves the parallel state: all of the regions exit, and the machine transitions from the parallel state to the target.
+ * @li A region which reaches HsmStateFinal() stops hearing events; HsmStateError() in any region stops the whole machine.
+ * @li Transitions into a region from outside of the parallel state enter the parallel state, with every region in its initial state.
+ *
+ * Optionally, a pool can hand each event to its regions all at once ( see hsm_region_pool_rec::run ), for instance: to run them on several threads.
+ * Every region then hears the event, and once they have all finished, their results apply in declaration order:
+ * the first region, in order, to escape or to error out decides what happens next; any later escapes are dropped.
+ * Entering and exiting the regions of a parallel state still happens in order, on the thread which signaled the event.
+ *
+ * Regions share their machine's slab ( HsmMachineSlab ), timers ( HsmMachineTimers ), and history ( HsmMachineHistory ); but only without a run callback.
+ * With one, region states allocate plain contexts, HsmArmTimer() returns #HSM_FALSE, and history pseudo-states inside regions always go to their fallback.
+ * Regions never defer events: HsmDefer() from a region state leaves the event unhandled, so it bubbles to the parallel state, which can defer it instead.
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#pragma once
+#ifndef __HSM_REGION_H__
+#define __HSM_REGION_H__
+
+#include "hsm_atomic.h"
+#include "hsm_machine.h"
+
+typedef struct hsm_region_rec hsm_region_t;
+typedef struct hsm_region_pool_rec hsm_region_pool_t;
+
+/**
+ * Run a parallel state's regions for a single event.
+ * Call HsmRegionRun() once for every instance in the list, in any order, on any thread;
+ * return only after every one of them has finished.
+ *
+ * @param regions The instances, linked by hsm_region_rec::next.
+ * @param run_data The hsm_region_pool_rec::run_data.
+ */
+typedef void (*hsm_callback_regions_run)( hsm_region_t* regions, void * run_data );
+
+//---------------------------------------------------------------------------
+/**
+ * One running instance of a region, taken from a pool when its parallel state enters.
+ * Machines never share instances: two machines in the same parallel state each have their own.
+ */
+struct hsm_region_rec
+{
+    /**
+     * the region's current state, and context stack; hsm_machine_rec::flags includes #HSM_FLAGS_REGION.
+     * must be the first member.
+     */
+    hsm_context_machine_t machine;
+
+    /**
+     * the region state this instance runs.
+     */
+    hsm_state region;
+
+    /**
+     * @internal: a transition which leaves the region, waiting for the parallel state to take it.
+     */
+    hsm_state escape;
+
+    /**
+     * @internal: the event HsmRegionRun() delivers.
+     */
+    hsm_event evt;
+
+    /**
+     * @internal: whether the region handled the event HsmRegionRun() delivered.
+     */
+    hsm_bool handled;
+
+    /**
+     * next region of the same parallel state; or, while in the pool, the next free instance.
+     */
+    hsm_region_t * next;
+};
+
+/**
+ * Storage for region instances.
+ * One pool can serve many machines ( on the same thread ); size it for the most regions active at once.
+ *
+ * @see HsmRegionPool, HsmMachineRegions
+ */
+struct hsm_region_pool_rec
+{
+    /**
+     * @internal: the unused instances.
+     */
+    hsm_region_t * free;
+
+    /**
+     * number of instances in use.
+     */
+    int used;
+
+    /**
+     * total number of instances.
+     */
+    int count;
+
+    /**
+     * optional: deliver each event to all of a parallel state's regions at once.
+     * when set, every machine using the pool may take and return instances from any thread.
+     */
+    hsm_callback_regions_run run;
+
+    /**
+     * data passed to the run callback.
+     */
+    void * run_data;
+
+    /**
+     * @internal: guards the free list while the run callback is set.
+     */
+    hsm_atomic lock;
+};
+
+/**
+ * Initialize a pool of region instances.
+ *
+ * @param pool Pool to initialize.
+ * @param regions Storage for the instances. Its lifetime must exceed every machine's use of the pool.
+ * @param count Number of instances.
+ */
+void HsmRegionPool( hsm_region_pool_t* pool, hsm_region_t* regions, int count );
+
+/**
+ * Let a machine enter parallel states.
+ * Call before HsmStart(). Without a pool, parallel states act as plain states, and their regions never start.
+ *
+ * @param hsm Machine which will run the regions.
+ * @param pool Pool of instances; nested parallel states take their instances from the same pool.
+ * @return #HSM_FALSE if the machine has already started.
+ */
+hsm_bool HsmMachineRegions( hsm_machine hsm, hsm_region_pool_t* pool );
+
+/**
+ * Deliver the pending event to a single region instance; only for use by a hsm_callback_regions_run.
+ * Regions which have stopped running ignore the event.
+ *
+ * @param region An instance from the list passed to the run callback.
+ *
+ * @note The region's handlers, and any states it enters or exits, run on the calling thread.
+ */
+void HsmRegionRun( hsm_region_t* region );
+
+/**
+ * The region instances of a machine's current parallel state, in declaration order; NULL if the machine isn't in a parallel state.
+ */
+#define HsmMachineRegionList( hsm ) ((hsm)->regions)
+
+/**
+ * Machine of a region instance, for instance: to query its current state.
+ */
+#define HsmRegionMachine( region ) (&(region)->machine.core)
+
+#endif // #ifndef __HSM_REGION_H__
@@ -0,0 +1,169 @@
+/**
+ * @file hsm_slab.c
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "hsm_machine.h"
+#include "hsm_slab.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HSM_SLAB_PER_PAGE 32
+
+/* ---------------------------------------------------------------------------
+   every context in a slab is preceeded by a header naming its class,
+   so that the popped callback, which only gets the context, can find its way home.
+   the header is a union to keep the context after it aligned.
+   freed contexts link through their first pointer; contexts always start with the parent pointer anyway.
+ * --------------------------------------------------------------------------- */
+typedef union hsm_slab_header_rec
+{
+  hsm_slab_class_t* owner;
+  void* next;     // for pages: the next page
+  double align_double;
+  long align_long;
+}
+hsm_slab_header_t;
+
+#define HSM_SLAB_HEADER( ctx ) (((hsm_slab_header_t*)(ctx))-1)
+#define HSM_SLAB_NEXT( ctx )   (*(void**)(ctx))
+
+//---------------------------------------------------------------------------
+static void HsmSlabFree( hsm_context_t* ctx )
+{
+  hsm_slab_class_t* cls= HSM_SLAB_HEADER( ctx )->owner;
+  HSM_SLAB_NEXT( ctx )= cls->free;
+  cls->free= ctx;
+  ++cls->stats.frees;
+}
+
+//---------------------------------------------------------------------------
+// carve a new page into contexts for the passed class.
+static hsm_bool HsmSlabGrow( hsm_slab_class_t* cls )
+{
+  hsm_slab_t* slab= cls->slab;
+  const size_t stride= sizeof(hsm_slab_header_t) + cls->size;
+  const size_t bytes= sizeof(hsm_slab_header_t) + stride * slab->per_page;
+  hsm_slab_header_t* page= (hsm_slab_header_t*) malloc( bytes );
+  if (page) {
+    char* at= (char*)(page+1);
+    int i;
+    page->next= slab->pages;
+    slab->pages= page;
+    cls->stats.bytes+= (long) bytes;
+    // push them backwards, so they pop in address order.
+    for (i= slab->per_page-1; i>=0; --i) {
+      hsm_slab_header_t* header= (hsm_slab_header_t*)( at + i*stride );
+      void* ctx= header+1;
+      header->owner= cls;
+      HSM_SLAB_NEXT( ctx )= cls->fresh;
+      cls->fresh= ctx;
+    }
+  }
+  return page != NULL;
+}
+
+//---------------------------------------------------------------------------
+hsm_slab_t* HsmSlab( hsm_slab_t* slab, int per_page )
+{
+  HSM_ASSERT( slab );
+  if (slab) {
+    int i;
+    memset( slab, 0, sizeof(hsm_slab_t) );
+    slab->per_page= per_page > 0 ? per_page : HSM_SLAB_PER_PAGE;
+    for (i=0; i<HSM_SLAB_CLASSES; ++i) {
+      slab->classes[i].slab= slab;
+      slab->classes[i].size= 16 << i;
+    }
+  }
+  return slab;
+}
+
+//---------------------------------------------------------------------------
+void HsmSlabRelease( hsm_slab_t* slab )
+{
+  if (slab) {
+    hsm_slab_header_t* page= (hsm_slab_header_t*) slab->pages;
+    while (page) {
+      hsm_slab_header_t* next= (hsm_slab_header_t*) page->next;
+      free( page );
+      page= next;
+    }
+    HsmSlab( slab, slab->per_page );
+  }
+}
+
+//---------------------------------------------------------------------------
+hsm_context HsmSlabAlloc( hsm_slab_t* slab, size_t size )
+{
+  hsm_context_t* ctx= NULL;
+  if (!slab || size > HSM_SLAB_MAX) {
+    if (slab) {
+      ++slab->large;
+    }
+    ctx= HsmContextAlloc( size );
+  }
+  else {
+    hsm_slab_class_t* cls= slab->classes;
+    while (cls->size < (int) size) {
+      ++cls;
+    }
+    // only contexts which were freed count as hits; untouched ones from a new page dont.
+    if (cls->free) {
+      ctx= (hsm_context_t*) cls->free;
+      cls->free= HSM_SLAB_NEXT( ctx );
+      ++cls->stats.hits;
+    }
+    else if (cls->fresh || HsmSlabGrow( cls )) {
+      ctx= (hsm_context_t*) cls->fresh;
+      cls->fresh= HSM_SLAB_NEXT( ctx );
+    }
+    if (ctx) {
+      ++cls->stats.allocs;
+      memset( ctx, 0, cls->size );
+      ctx->popped= HsmSlabFree;
+    }
+  }
+  return ctx;
+}
+
+//---------------------------------------------------------------------------
+void HsmMachineSlab( hsm_machine hsm, hsm_slab_t* slab )
+{
+  HSM_ASSERT( hsm );
+  if (hsm) {
+    hsm->slab= slab;
+  }
+}
+
+//---------------------------------------------------------------------------
+hsm_context HsmMachineContextAlloc( hsm_machine hsm, size_t size )
+{
+  return HsmSlabAlloc( hsm ? hsm->slab : NULL, size );
+}
+
+//---------------------------------------------------------------------------
+void HsmSlabStats( const hsm_slab_t* slab, hsm_slab_stats_t* stats )
+{
+  if (stats) {
+    memset( stats, 0, sizeof(hsm_slab_stats_t) );
+    if (slab) {
+      int i;
+      for (i=0; i<HSM_SLAB_CLASSES; ++i) {
+        const hsm_slab_stats_t* cls= &slab->classes[i].stats;
+        stats->allocs+= cls->allocs;
+        stats->hits+= cls->hits;
+        stats->frees+= cls->frees;
+        stats->bytes+= cls->bytes;
+      }
+      stats->large= slab->large;
+    }
+  }
+}
@@ -0,0 +1,182 @@
+/**
+ * @file hsm_slab.h
+ *
+ * Size class slabs for per-state context data.
+ *
+ * HsmContextAlloc() calls calloc on every state entry, and free on every exit.
+ * A slab keeps freed contexts on a list per size class instead, so states that are entered and exited 
+ * over and over reuse the same few blocks without touching the heap.
+ *
+ * A slab isn't thread safe: it belongs to one thread at a time.
+ * Giving each machine its own slab ( HsmMachineSlab ) is always safe, even with the scheduler,
+ * because only one thread at a time runs a machine. Machines which always run on the same thread can share.
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#pragma once
+#ifndef __HSM_SLAB_H__
+#define __HSM_SLAB_H__
+
+#include "hsm_context.h"
+
+typedef struct hsm_slab_rec hsm_slab_t;
+typedef struct hsm_slab_class_rec hsm_slab_class_t;
+typedef struct hsm_slab_stats_rec hsm_slab_stats_t;
+
+/**
+ * Number of size classes: 16, 32, 64, 128, and 256 bytes.
+ * Bigger contexts come from HsmContextAlloc().
+ */
+#define HSM_SLAB_CLASSES 5
+
+/**
+ * Largest context a slab will hold.
+ */
+#define HSM_SLAB_MAX (16 << (HSM_SLAB_CLASSES-1))
+
+/**
+ * Allocation counts; for a class, or for a whole slab.
+ */
+struct hsm_slab_stats_rec
+{
+    /**
+     * contexts handed out.
+     */
+    long allocs;
+
+    /**
+     * allocations satisfied by a previously freed context.
+     * the hit rate is hits/allocs.
+     */
+    long hits;
+
+    /**
+     * contexts returned to the slab.
+     */
+    long frees;
+
+    /**
+     * allocations too big for the slab, passed on to HsmContextAlloc().
+     */
+    long large;
+
+    /**
+     * bytes requested from the heap for slab pages.
+     */
+    long bytes;
+};
+
+/**
+ * Contexts of one size.
+ */
+struct hsm_slab_class_rec
+{
+    /**
+     * @internal: the slab we belong to.
+     */
+    hsm_slab_t* slab;
+
+    /**
+     * @internal: freed contexts, ready for reuse.
+     */
+    void* free;
+
+    /**
+     * @internal: contexts carved from a page, but never handed out.
+     */
+    void* fresh;
+
+    /**
+     * largest context this class holds.
+     */
+    int size;
+
+    /**
+     * counts for this class; hsm_slab_stats_rec::large is always zero.
+     */
+    hsm_slab_stats_t stats;
+};
+
+/**
+ * A set of size classes, and the pages of memory they carve their contexts from.
+ * @see HsmSlab
+ */
+struct hsm_slab_rec
+{
+    /**
+     * each class is twice the size of the one before.
+     */
+    hsm_slab_class_t classes[HSM_SLAB_CLASSES];
+
+    /**
+     * @internal: every page allocated, newest first.
+     */
+    void* pages;
+
+    /**
+     * number of contexts carved out of each new page.
+     */
+    int per_page;
+
+    /**
+     * allocations too big for any class.
+     */
+    long large;
+};
+
+/**
+ * Initialize an empty slab.
+ *
+ * @param slab Slab to initialize.
+ * @param per_page Number of contexts to allocate at a time when a class runs dry; 0 for a default.
+ * @return The slab passed in.
+ */
+hsm_slab_t* HsmSlab( hsm_slab_t* slab, int per_page );
+
+/**
+ * Free all of a slab's pages.
+ * Every context allocated from the slab must already have been popped.
+ */
+void HsmSlabRelease( hsm_slab_t* slab );
+
+/**
+ * Create a new context object from a slab.
+ * Works like HsmContextAlloc(): the memory is zeroed, and the context returns to the slab when popped.
+ *
+ * @param slab Slab to allocate from; if NULL, falls back to HsmContextAlloc().
+ * @param size Total size of the user context structure.
+ * @return Newly allocated context data, NULL if the allocation failed.
+ */
+hsm_context HsmSlabAlloc( hsm_slab_t* slab, size_t size );
+
+/**
+ * Give a machine a slab for its contexts.
+ *
+ * @param hsm Machine which will own the slab.
+ * @param slab Slab to use, or NULL to go back to HsmContextAlloc(). The slab's lifetime must exceed the machine's use of it.
+ * @see HsmMachineContextAlloc
+ */
+void HsmMachineSlab( hsm_machine hsm, hsm_slab_t* slab );
+
+/**
+ * Create a new context object using the machine's slab, if it has one.
+ * Meant for enter callbacks: HsmMachineContextAlloc( status->hsm, sizeof(my_context_t) ).
+ *
+ * @see HsmSlabAlloc, HsmContextAlloc
+ */
+hsm_context HsmMachineContextAlloc( hsm_machine hsm, size_t size );
+
+/**
+ * Sum the counts for every class in a slab.
+ *
+ * @param slab Slab to query.
+ * @param stats Filled with the totals.
+ */
+void HsmSlabStats( const hsm_slab_t* slab, hsm_slab_stats_t* stats );
+
+#endif // #ifndef __HSM_SLAB_H__
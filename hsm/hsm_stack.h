@@ -26,8 +26,10 @@ typedef struct hsm_context_iterator_rec* hsm_context_iterator;
  * @param stack Can be NULL.
  * @param context The new context.
  * Once a valid context has been pushed it is illegal to push a NULL context
+ * @return #HSM_FALSE, leaving the stack untouched, if the stack can't record another level:
+ * a new context past #HSM_MAX_DEPTH without wide presence bits ( see HsmContextStackWide ), or out of memory for them.
  */
-void HsmContextPush( hsm_context_stack stack, hsm_context context );
+hsm_bool HsmContextPush( hsm_context_stack stack, hsm_context context );
 
 /**
  * Remove the most recently added context.
@@ -120,8 +120,73 @@ struct hsm_state_rec
      * root most state's depth == 0
      */
     int depth;
+
+    /**
+     * compiled chart containing this state, or NULL when transitions walk the tree.
+     * @see HsmChartCompile
+     */
+    const struct hsm_chart_rec * chart;
+
+    /**
+     * index of this state within its compiled chart
+     */
+    int index;
+
+    /**
+     * optional: the types of events this state's process callback can handle, one bit per type ( see #HSM_INTEREST );
+     * 0 means any type. Compiled charts use this to skip states which can't handle an event.
+     * @see HsmChartEventTypes
+     */
+    hsm_uint64 interests;
+
+    /**
+     * optional: this state's history pseudo-state ( see #HSM_HISTORY )
+     */
+    hsm_state history;
+
+    /**
+     * for history pseudo-states: #HSM_HISTORY_SHALLOW or #HSM_HISTORY_DEEP; 0 for every other state.
+     * a history pseudo-state's parent is the state whose history it remembers,
+     * and its initial state is where to go when there's nothing to remember yet.
+     */
+    int history_type;
+
+    /**
+     * for history pseudo-states: one more than its index in the machines' history tables; 0 until HsmMachineHistory() sees it.
+     */
+    int history_slot;
+
+    /**
+     * for parallel states: the first of its regions ( see #HSM_PARALLEL )
+     */
+    hsm_state regions;
+
+    /**
+     * for regions: the next region of the same parallel state ( see #HSM_REGION )
+     */
+    hsm_state next_region;
 };
 
+/**
+ * History pseudo-state which returns to the most recently active child of its parent.
+ */
+#define HSM_HISTORY_SHALLOW 1
+
+/**
+ * History pseudo-state which returns to the most recently active descendant of its parent, however deep.
+ */
+#define HSM_HISTORY_DEEP    2
+
+/**
+ * Number of event types hsm_state_rec::interests can describe.
+ */
+#define HSM_EVENT_TYPES 64
+
+/**
+ * Bit for an event type in hsm_state_rec::interests.
+ */
+#define HSM_INTEREST( type ) (((hsm_uint64)1) << (type))
+
 /**
  * Macro for declaring a state.
  *
@@ -208,7 +273,128 @@ struct hsm_state_rec
             return &myinfo; \
         } \
         hsm_state Parent##Lookup##State() { return State(); }
- 
+
+
+/**
+ * Macro for declaring a shallow history pseudo-state.
+ * Transitioning to the history returns to whichever child of parent was last active, 
+ * and then follows that child's initial states as usual.
+ *
+ * @param state      User defined name for the pseudo-state.
+ * @param parent     A user defined state name: the state whose history gets remembered.
+ * @param fallback   A child of parent to enter when there's no history yet, or 0 to enter the parent itself ( and its initial states. )
+ *
+ * @note Machines only remember history given a history table, see HsmMachineHistory().
+ */
+#define HSM_HISTORY( state, parent, fallback ) \
+        _HSM_HISTORY( state, parent, fallback, HSM_HISTORY_SHALLOW )
+
+/**
+ * Macro for declaring a deep history pseudo-state.
+ * Transitioning to the history returns directly to the innermost state last active within parent.
+ *
+ * @see #HSM_HISTORY
+ */
+#define HSM_DEEP_HISTORY( state, parent, fallback ) \
+        _HSM_HISTORY( state, parent, fallback, HSM_HISTORY_DEEP )
+
+/**
+ * Verbose macro for declaring a history pseudo-state.
+ * The pseudo-state registers itself with its parent the first time it's looked up.
+ *
+ * @param State      User defined name for the pseudo-state.
+ * @param Parent     The user defined state whose history gets remembered.
+ * @param Fallback   Child of parent to enter when there's no history yet, or 0.
+ * @param Type       #HSM_HISTORY_SHALLOW or #HSM_HISTORY_DEEP.
+ */
+#define _HSM_HISTORY( State, Parent, Fallback, Type ) \
+        hsm_state Parent(); \
+        hsm_state Parent##Lookup##Fallback(); \
+        hsm_state State() { \
+            static struct hsm_state_rec myinfo= { 0 }; \
+            if (!myinfo.name) { \
+                myinfo.name= #State; \
+                myinfo.parent= Parent(); \
+                myinfo.depth= myinfo.parent->depth+1; \
+                myinfo.initial= Parent##Lookup##Fallback(); \
+                myinfo.history_type= Type; \
+                ((struct hsm_state_rec*)myinfo.parent)->history= &myinfo; \
+            } \
+            return &myinfo; \
+        }
+
+/**
+ * Macro for declaring a parallel state: a state whose regions all run at once.
+ *
+ * Requires:
+ * @li An event handler function: MyStateEvent; it hears the events none of the regions handle.
+ *
+ * @param state        User defined name for the state.
+ * @param parent       HsmTopState or a previously declared user defined state name.
+ * @param first_region The first of the state's regions, declared via #HSM_REGION.
+ *
+ * @note Machines only run regions given a region pool, see HsmMachineRegions().
+ * @see hsm_region.h
+ */
+#define HSM_PARALLEL( state, parent, first_region ) \
+        hsm_state state##Event( hsm_status ); \
+        _HSM_PARALLEL( state, parent, state##Event, 0, 0, first_region )
+
+/**
+ * Verbose macro for declaring a parallel state.
+ *
+ * @param State       User defined name for the state.
+ * @param Parent      A user defined state name, or HsmTopState.
+ * @param Process     Event handler function.
+ * @param Enter       Function to call on state enter, before any region enters.
+ * @param Exit        Function to call on state exit, after every region has exited.
+ * @param FirstRegion The first region of the state.
+ */
+#define _HSM_PARALLEL( State, Parent, Process, Enter, Exit, FirstRegion ) \
+        hsm_state Parent(); \
+        hsm_state State##Lookup##FirstRegion(); \
+        hsm_state State##Lookup##0() { return 0; } \
+        hsm_state State() { \
+            static struct hsm_state_rec myinfo= { 0 }; \
+            if (!myinfo.name) { \
+                myinfo.name= #State; \
+                myinfo.process= Process; \
+                myinfo.enter= Enter; \
+                myinfo.exit= Exit; \
+                myinfo.parent= Parent(); \
+                myinfo.depth= myinfo.parent ? myinfo.parent->depth+1 : 0; \
+                myinfo.regions= State##Lookup##FirstRegion(); \
+            } \
+            return &myinfo; \
+        } \
+        hsm_state Parent##Lookup##State() { return State(); }
+
+/**
+ * Macro for declaring one region of a parallel state.
+ * Regions have no callbacks of their own: they're containers for the states they run.
+ *
+ * @param State    User defined name for the region.
+ * @param Parallel The parallel state which owns the region.
+ * @param Initial  First state the region should enter.
+ * @param Next     The parallel state's next region, or 0 for the last region.
+ */
+#define HSM_REGION( State, Parallel, Initial, Next ) \
+        hsm_state Parallel(); \
+        hsm_state State##Lookup##Initial(); \
+        hsm_state State##Lookup##0() { return 0; } \
+        hsm_state Parallel##Lookup##Next(); \
+        hsm_state State() { \
+            static struct hsm_state_rec myinfo= { 0 }; \
+            if (!myinfo.name) { \
+                myinfo.name= #State; \
+                myinfo.parent= Parallel(); \
+                myinfo.depth= myinfo.parent->depth+1; \
+                myinfo.initial= State##Lookup##Initial(); \
+                myinfo.next_region= Parallel##Lookup##Next(); \
+            } \
+            return &myinfo; \
+        } \
+        hsm_state Parallel##Lookup##State() { return State(); }
 
 #endif // #ifndef __HSM_STATE_H__
 
@@ -0,0 +1,273 @@
+/**
+ * @file hsm_stats.c
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "hsm_machine.h"
+#include "hsm_chart.h"
+#include "hsm_stats.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#define HSM_STATS_CYCLES() __rdtsc()
+#elif defined(__i386__) || defined(__x86_64__)
+#define HSM_STATS_CYCLES() __builtin_ia32_rdtsc()
+#endif
+
+// calibrating the cycle counter against the clock takes this long.
+#define HSM_STATS_CALIBRATE_NS 5000000
+
+// clock ticks to nanoseconds; the same for every stats, so calibrated only once.
+static double gNsPerTick= 0;
+
+//---------------------------------------------------------------------------
+static hsm_uint64 HsmStatsNanoseconds()
+{
+#ifdef WIN32
+  LARGE_INTEGER count, frequency;
+  QueryPerformanceCounter( &count );
+  QueryPerformanceFrequency( &frequency );
+  return (hsm_uint64)( count.QuadPart * (1e9 / frequency.QuadPart) );
+#else
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return (hsm_uint64) ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+hsm_uint64 HsmStatsClock()
+{
+#ifdef HSM_STATS_CYCLES
+  return HSM_STATS_CYCLES();
+#else
+  return HsmStatsNanoseconds();
+#endif
+}
+
+//---------------------------------------------------------------------------
+static void HsmStatsCalibrate()
+{
+  if (!gNsPerTick) {
+#ifdef HSM_STATS_CYCLES
+    const hsm_uint64 start= HsmStatsClock(), start_ns= HsmStatsNanoseconds();
+    hsm_uint64 now, now_ns;
+    do {
+      now= HsmStatsClock();
+      now_ns= HsmStatsNanoseconds();
+    }
+    while (now_ns - start_ns < HSM_STATS_CALIBRATE_NS);
+    gNsPerTick= (double)(now_ns - start_ns) / (double)(now - start);
+#else
+    gNsPerTick= 1.0;
+#endif
+  }
+}
+
+//---------------------------------------------------------------------------
+// Histograms
+//---------------------------------------------------------------------------
+#define SUB_COUNT (1 << HSM_HISTOGRAM_SUB_BITS)
+
+static int HsmHistogramBucket( hsm_uint64 ns )
+{
+  int bucket;
+  if (ns < 2*SUB_COUNT) {
+    bucket= (int) ns;
+  }
+  else {
+    // the top bit picks the power of two, the next few bits the sub-bucket.
+    int top= HSM_HISTOGRAM_SUB_BITS+1;
+    while (top < HSM_HISTOGRAM_MAX_BITS && (ns >> (top+1))) {
+      ++top;
+    }
+    if (ns >> (top+1)) {
+      bucket= HSM_HISTOGRAM_BUCKETS-1;
+    }
+    else {
+      bucket= ((top - HSM_HISTOGRAM_SUB_BITS) << HSM_HISTOGRAM_SUB_BITS) + (int)(ns >> (top - HSM_HISTOGRAM_SUB_BITS));
+    }
+  }
+  return bucket;
+}
+
+// the largest time a bucket holds
+static hsm_uint64 HsmHistogramBucketMax( int bucket )
+{
+  hsm_uint64 max;
+  if (bucket < 2*SUB_COUNT) {
+    max= bucket;
+  }
+  else {
+    const int top= (bucket >> HSM_HISTOGRAM_SUB_BITS) + HSM_HISTOGRAM_SUB_BITS - 1;
+    const hsm_uint64 sub= SUB_COUNT + (bucket & (SUB_COUNT-1));
+    max= ((sub+1) << (top - HSM_HISTOGRAM_SUB_BITS)) - 1;
+  }
+  return max;
+}
+
+//---------------------------------------------------------------------------
+void HsmHistogramRecord( hsm_histogram_t* histogram, hsm_uint64 ns )
+{
+  if (!histogram->count || ns < histogram->min) {
+    histogram->min= ns;
+  }
+  if (ns > histogram->max) {
+    histogram->max= ns;
+  }
+  ++histogram->count;
+  histogram->total+= ns;
+  ++histogram->buckets[ HsmHistogramBucket( ns ) ];
+}
+
+//---------------------------------------------------------------------------
+hsm_uint64 HsmHistogramPercentile( const hsm_histogram_t* histogram, double percentile )
+{
+  hsm_uint64 ns= 0;
+  if (histogram && histogram->count) {
+    const double want= histogram->count * (percentile / 100.0);
+    hsm_uint64 seen= 0;
+    int i;
+    for (i=0; i<HSM_HISTOGRAM_BUCKETS; ++i) {
+      seen+= histogram->buckets[i];
+      if (seen && seen >= want) {
+        ns= HsmHistogramBucketMax( i );
+        break;
+      }
+    }
+    // a bucket's bound can overshoot what was actually recorded
+    ns= ns < histogram->max ? ns : histogram->max;
+    ns= ns > histogram->min ? ns : histogram->min;
+  }
+  return ns;
+}
+
+//---------------------------------------------------------------------------
+void HsmHistogramPrint( const hsm_histogram_t* histogram, const char * label, FILE* out )
+{
+  if (histogram && out) {
+    fprintf( out, "%-32s %10llu  mean %9.0f  min %8llu  p50 %8llu  p90 %8llu  p99 %8llu  max %10llu ns\n",
+      label, (unsigned long long) histogram->count,
+      histogram->count ? (double) histogram->total / histogram->count : 0.0,
+      (unsigned long long) histogram->min,
+      (unsigned long long) HsmHistogramPercentile( histogram, 50 ),
+      (unsigned long long) HsmHistogramPercentile( histogram, 90 ),
+      (unsigned long long) HsmHistogramPercentile( histogram, 99 ),
+      (unsigned long long) histogram->max );
+  }
+}
+
+//---------------------------------------------------------------------------
+// Stats
+//---------------------------------------------------------------------------
+hsm_bool HsmStatsCreate( hsm_stats_t* stats, const hsm_chart_t* chart )
+{
+  hsm_bool okay= stats && chart && chart->count > 0;
+  HSM_ASSERT( okay && "stats need a compiled chart" );
+  if (okay) {
+    stats->chart= chart;
+    stats->histograms= (hsm_histogram_t*) calloc( chart->count * HSM_STATS_KINDS, sizeof(hsm_histogram_t) );
+    okay= stats->histograms != NULL;
+    HsmStatsCalibrate();
+  }
+  return okay;
+}
+
+//---------------------------------------------------------------------------
+void HsmStatsRelease( hsm_stats_t* stats )
+{
+  if (stats) {
+    free( stats->histograms );
+    memset( stats, 0, sizeof(hsm_stats_t) );
+  }
+}
+
+//---------------------------------------------------------------------------
+void HsmStatsReset( hsm_stats_t* stats )
+{
+  if (stats && stats->histograms) {
+    memset( stats->histograms, 0, stats->chart->count * HSM_STATS_KINDS * sizeof(hsm_histogram_t) );
+  }
+}
+
+//---------------------------------------------------------------------------
+const hsm_histogram_t* HsmStatsHistogram( const hsm_stats_t* stats, hsm_state state, int kind )
+{
+  const hsm_histogram_t* histogram= NULL;
+  if (stats && stats->histograms && state && state->chart == stats->chart && kind >= 0 && kind < HSM_STATS_KINDS) {
+    histogram= stats->histograms + state->index*HSM_STATS_KINDS + kind;
+  }
+  return histogram;
+}
+
+//---------------------------------------------------------------------------
+void HsmStatsDump( const hsm_stats_t* stats, FILE* out )
+{
+  static const char * kinds[ HSM_STATS_KINDS ]= { "enter", "exit", "process" };
+  if (stats && stats->histograms && out) {
+    int i, k;
+    for (i=0; i<stats->chart->count; ++i) {
+      for (k=0; k<HSM_STATS_KINDS; ++k) {
+        const hsm_histogram_t* histogram= stats->histograms + i*HSM_STATS_KINDS + k;
+        if (histogram->count) {
+          char label[64];
+          sprintf( label, "%.23s %s", stats->chart->names[i] ? stats->chart->names[i] : "?", kinds[k] );
+          HsmHistogramPrint( histogram, label, out );
+        }
+      }
+    }
+  }
+}
+
+#ifdef HSM_USE_STATS
+//---------------------------------------------------------------------------
+// Machine hooks
+//---------------------------------------------------------------------------
+hsm_bool HsmMachineStats( hsm_machine hsm, hsm_machine_stats_t* machine_stats, hsm_stats_t* stats )
+{
+  const hsm_bool okay= hsm && machine_stats;
+  HSM_ASSERT( okay );
+  if (okay) {
+    memset( machine_stats, 0, sizeof(hsm_machine_stats_t) );
+    machine_stats->stats= stats;
+    hsm->stats= machine_stats;
+    HsmStatsCalibrate();
+  }
+  return okay;
+}
+
+//---------------------------------------------------------------------------
+static hsm_uint64 HsmStatsElapsed( hsm_uint64 start )
+{
+  return (hsm_uint64)( (HsmStatsClock() - start) * gNsPerTick );
+}
+
+//---------------------------------------------------------------------------
+void HsmStatsCallback( hsm_machine hsm, hsm_state state, int kind, hsm_uint64 start )
+{
+  hsm_stats_t* stats= hsm->stats->stats;
+  if (stats && state->chart == stats->chart) {
+    HsmHistogramRecord( stats->histograms + state->index*HSM_STATS_KINDS + kind, HsmStatsElapsed( start ) );
+  }
+}
+
+//---------------------------------------------------------------------------
+void HsmStatsRun( hsm_machine hsm, hsm_uint64 start )
+{
+  HsmHistogramRecord( &hsm->stats->run, HsmStatsElapsed( start ) );
+}
+#endif
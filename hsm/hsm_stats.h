@@ -0,0 +1,182 @@
+/**
+ * @file hsm_stats.h
+ *
+ * Latency statistics: how long each state's callbacks take, and how long each machine takes to run an event to completion.
+ *
+ * Only machines built with HSM_USE_STATS defined record anything.
+ * Without it, the machine has no hooks at all: there is nothing to pay for.
+ * Like HSM_USE_EXTERNAL_TRANSITIONS, it changes the machine record, so define it for the whole project.
+ * The histograms, and the functions to read them, are always available.
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#pragma once
+#ifndef __HSM_STATS_H__
+#define __HSM_STATS_H__
+
+#include "hsm_forwards.h"
+#include <stdio.h>
+
+typedef struct hsm_histogram_rec hsm_histogram_t;
+typedef struct hsm_stats_rec hsm_stats_t;
+typedef struct hsm_machine_stats_rec hsm_machine_stats_t;
+
+/**
+ * Which callback of a state a histogram times.
+ */
+typedef enum hsm_stats_kind
+{
+    HSM_STATS_ENTER,
+    HSM_STATS_EXIT,
+    HSM_STATS_PROCESS,
+    HSM_STATS_KINDS
+}
+hsm_stats_kind_t;
+
+/**
+ * Sub-buckets per power of two, as a power of two: 3 keeps each bucket within 12.5% of its values.
+ */
+#define HSM_HISTOGRAM_SUB_BITS 3
+
+/**
+ * Largest power of two a histogram tells apart; longer times all land in the last bucket. 2^40 ns is about 18 minutes.
+ */
+#define HSM_HISTOGRAM_MAX_BITS 40
+
+/**
+ * Number of buckets in a histogram.
+ */
+#define HSM_HISTOGRAM_BUCKETS ((HSM_HISTOGRAM_MAX_BITS - HSM_HISTOGRAM_SUB_BITS + 1) << HSM_HISTOGRAM_SUB_BITS)
+
+//---------------------------------------------------------------------------
+/**
+ * Nanosecond times in log spaced buckets, in the manner of HdrHistogram:
+ * exact below 2^(#HSM_HISTOGRAM_SUB_BITS+1), then #HSM_HISTOGRAM_SUB_BITS bits of precision per power of two.
+ */
+struct hsm_histogram_rec
+{
+    hsm_uint64 count;
+    hsm_uint64 total;
+    hsm_uint64 min;
+    hsm_uint64 max;
+    unsigned int buckets[ HSM_HISTOGRAM_BUCKETS ];
+};
+
+/**
+ * Histograms for every state of a compiled chart, and every kind of callback; shared by every machine running the chart.
+ * Machines on different threads can share one, but their counts may then come up short.
+ *
+ * @see HsmStatsCreate, HsmMachineStats
+ */
+struct hsm_stats_rec
+{
+    /**
+     * the chart whose states are timed; states from outside the chart aren't.
+     */
+    const hsm_chart_t * chart;
+
+    /**
+     * chart->count * #HSM_STATS_KINDS histograms, by state index and then kind.
+     */
+    hsm_histogram_t * histograms;
+};
+
+/**
+ * A single machine's run to completion times, for every event signaled to it.
+ */
+struct hsm_machine_stats_rec
+{
+    /**
+     * shared per state histograms.
+     */
+    hsm_stats_t * stats;
+
+    /**
+     * time from signaling an event to the machine settling.
+     */
+    hsm_histogram_t run;
+};
+
+/**
+ * Allocate empty histograms for a chart.
+ * The first call calibrates the clock, which takes a few milliseconds.
+ *
+ * @param stats Record to initialize.
+ * @param chart A compiled chart; it must outlive the stats.
+ * @return #HSM_FALSE if out of memory.
+ */
+hsm_bool HsmStatsCreate( hsm_stats_t* stats, const hsm_chart_t* chart );
+
+/**
+ * Free the histograms.
+ */
+void HsmStatsRelease( hsm_stats_t* stats );
+
+/**
+ * Empty every histogram.
+ */
+void HsmStatsReset( hsm_stats_t* stats );
+
+#ifdef HSM_USE_STATS
+/**
+ * Time a machine's callbacks, and its events.
+ *
+ * @param hsm Machine to time.
+ * @param machine_stats Record to initialize, for the machine's own times. Its lifetime must exceed the machine's use of it.
+ * @param stats Shared histograms to add the machine's state times to; NULL records only the machine's own times.
+ */
+hsm_bool HsmMachineStats( hsm_machine hsm, hsm_machine_stats_t* machine_stats, hsm_stats_t* stats );
+
+/**
+ * @internal
+ * Record a callback the machine timed.
+ */
+void HsmStatsCallback( hsm_machine hsm, hsm_state state, int kind, hsm_uint64 start );
+
+/**
+ * @internal
+ * Record an event the machine timed.
+ */
+void HsmStatsRun( hsm_machine hsm, hsm_uint64 start );
+#endif
+
+/**
+ * Clock the stats use: cycles where the cpu has a counter, otherwise nanoseconds.
+ */
+hsm_uint64 HsmStatsClock();
+
+/**
+ * The histogram for one state's callback; NULL if the state isn't part of the stats' chart.
+ */
+const hsm_histogram_t* HsmStatsHistogram( const hsm_stats_t* stats, hsm_state state, int kind );
+
+/**
+ * Add a time to a histogram.
+ */
+void HsmHistogramRecord( hsm_histogram_t* histogram, hsm_uint64 ns );
+
+/**
+ * Time below which the passed percentage of recorded times fall, accurate to a bucket.
+ *
+ * @param histogram The histogram.
+ * @param percentile 0 to 100.
+ * @return Nanoseconds; 0 if the histogram is empty.
+ */
+hsm_uint64 HsmHistogramPercentile( const hsm_histogram_t* histogram, double percentile );
+
+/**
+ * Print one line summarizing a histogram: count, mean, min, median, 90th, 99th, max.
+ */
+void HsmHistogramPrint( const hsm_histogram_t* histogram, const char * label, FILE* out );
+
+/**
+ * Print every state callback that has been timed, one line each.
+ */
+void HsmStatsDump( const hsm_stats_t* stats, FILE* out );
+
+#endif // #ifndef __HSM_STATS_H__
@@ -0,0 +1,238 @@
+/**
+ * @file hsm_timer.c
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "hsm_machine.h"
+#include "hsm_queue.h"
+#include "hsm_timer.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#define HSM_WHEEL_MASK (HSM_WHEEL_SLOTS-1)
+
+//---------------------------------------------------------------------------
+static void HsmTimerLink( hsm_timer_t** head, hsm_timer_t* timer )
+{
+  timer->next= *head;
+  if (timer->next) {
+    timer->next->prev= &timer->next;
+  }
+  timer->prev= head;
+  *head= timer;
+}
+
+//---------------------------------------------------------------------------
+static void HsmTimerUnlink( hsm_timer_t* timer )
+{
+  *timer->prev= timer->next;
+  if (timer->next) {
+    timer->next->prev= timer->prev;
+  }
+  timer->next= NULL;
+  timer->prev= NULL;
+}
+
+//---------------------------------------------------------------------------
+// take an unlinked timer out of its machine's armed list, and make it available again.
+static void HsmTimerRelease( hsm_timers_t* timers, hsm_timer_t* timer )
+{
+  *timer->prev_sibling= timer->sibling;
+  if (timer->sibling) {
+    timer->sibling->prev_sibling= timer->prev_sibling;
+  }
+  timer->prev_sibling= NULL;
+  timer->sibling= timers->free;
+  timers->free= timer;
+  --timers->wheel->count;
+  --timers->armed;
+}
+
+//---------------------------------------------------------------------------
+/**
+ * @internal
+ * Place a timer in the lowest level whose span covers it, in the slot its expiry falls in.
+ */
+static void HsmWheelInsert( hsm_wheel_t* wheel, hsm_timer_t* timer )
+{
+  const unsigned long delta= timer->expires - wheel->now;
+  int level;
+  for (level=0; level < HSM_WHEEL_LEVELS-1; ++level) {
+    if (delta < (1UL << (HSM_WHEEL_BITS*(level+1)))) {
+      break;
+    }
+  }
+  if (delta >= (1UL << (HSM_WHEEL_BITS*HSM_WHEEL_LEVELS))) {
+    // out of range: park it in the top slot furthest away, it gets placed again once that comes around.
+    HsmTimerLink( &wheel->slots[ level ][ ((wheel->now >> (HSM_WHEEL_BITS*level)) - 1) & HSM_WHEEL_MASK ], timer );
+  }
+  else {
+    HsmTimerLink( &wheel->slots[ level ][ (timer->expires >> (HSM_WHEEL_BITS*level)) & HSM_WHEEL_MASK ], timer );
+  }
+}
+
+//---------------------------------------------------------------------------
+// move the timers of a higher slot down a level ( or further )
+static void HsmWheelCascade( hsm_wheel_t* wheel, int level )
+{
+  hsm_timer_t** slot= &wheel->slots[ level ][ (wheel->now >> (HSM_WHEEL_BITS*level)) & HSM_WHEEL_MASK ];
+  hsm_timer_t* timer= *slot;
+  *slot= NULL;
+  while (timer) {
+    hsm_timer_t* next= timer->next;
+    HsmWheelInsert( wheel, timer );
+    timer= next;
+  }
+}
+
+//---------------------------------------------------------------------------
+void HsmWheel( hsm_wheel_t* wheel, unsigned long now )
+{
+  HSM_ASSERT( wheel );
+  if (wheel) {
+    int level, slot;
+    for (level=0; level < HSM_WHEEL_LEVELS; ++level) {
+      for (slot=0; slot < HSM_WHEEL_SLOTS; ++slot) {
+        wheel->slots[ level ][ slot ]= NULL;
+      }
+    }
+    wheel->now= now;
+    wheel->count= 0;
+  }
+}
+
+//---------------------------------------------------------------------------
+int HsmWheelAdvance( hsm_wheel_t* wheel, unsigned long now )
+{
+  int fired=0;
+  hsm_timer_t* due;
+  if (wheel) {
+    long ticks= (long)(now - wheel->now);
+    for (;;) {
+      // detach the whole slot: expiring one timer might cancel, or arm, others.
+      // ( a timer armed for 0 ticks lands in the fresh slot, and waits for the next advance. )
+      hsm_timer_t** slot= &wheel->slots[ 0 ][ wheel->now & HSM_WHEEL_MASK ];
+      due= *slot;
+      *slot= NULL;
+      if (due) {
+        due->prev= &due;
+      }
+      while (due) {
+        hsm_timer_t* timer= due;
+        hsm_machine hsm= timer->hsm;
+        HsmTimerUnlink( timer );
+        HsmTimerRelease( hsm->timers, timer );
+        ++fired;
+        if (hsm->queue) {
+          HsmPostEvent( hsm, timer->evt );
+        }
+        else {
+          HsmSignalEvent( hsm, timer->evt );
+        }
+      }
+      if (ticks <= 0) {
+        break;
+      }
+      // nothing armed: skip straight to the end
+      if (!wheel->count) {
+        wheel->now= now;
+        break;
+      }
+      else {
+        int level;
+        --ticks;
+        ++wheel->now;
+        // each time a level wraps, the next level's slot falls due.
+        for (level=1; level < HSM_WHEEL_LEVELS; ++level) {
+          if ((wheel->now >> (HSM_WHEEL_BITS*(level-1))) & HSM_WHEEL_MASK) {
+            break;
+          }
+          HsmWheelCascade( wheel, level );
+        }
+      }
+    }
+  }
+  return fired;
+}
+
+//---------------------------------------------------------------------------
+hsm_bool HsmMachineTimers( hsm_machine hsm, hsm_timers_t* timers, hsm_wheel_t* wheel, hsm_timer_t* storage, int count )
+{
+  const hsm_bool okay= hsm && timers && wheel && storage && (count > 0) && !hsm->current;
+  HSM_ASSERT( okay && "timers need a wheel, storage, and an unstarted machine" );
+  if (okay) {
+    int i;
+    for (i=0; i<count; ++i) {
+      storage[i].next= NULL;
+      storage[i].prev= NULL;
+      storage[i].sibling= (i+1 < count) ? storage+i+1 : NULL;
+      storage[i].prev_sibling= NULL;
+      storage[i].hsm= hsm;
+      storage[i].state= NULL;
+      storage[i].evt= NULL;
+      storage[i].expires= 0;
+    }
+    timers->wheel= wheel;
+    timers->timers= storage;
+    timers->count= count;
+    timers->armed= 0;
+    timers->free= storage;
+    timers->active= NULL;
+    hsm->timers= timers;
+  }
+  return okay;
+}
+
+//---------------------------------------------------------------------------
+hsm_bool HsmArmTimer( hsm_status status, unsigned long ticks, hsm_event evt )
+{
+  hsm_bool okay= HSM_FALSE;
+  hsm_timers_t* timers= status ? status->hsm->timers : NULL;
+  HSM_ASSERT( (timers || (status && (status->hsm->flags & HSM_FLAGS_REGION))) && "machine has no timers" );
+  if (timers && status->state && timers->free) {
+    hsm_wheel_t* wheel= timers->wheel;
+    hsm_timer_t* timer= timers->free;
+    timers->free= timer->sibling;
+    // push onto the armed list
+    timer->sibling= timers->active;
+    if (timer->sibling) {
+      timer->sibling->prev_sibling= &timer->sibling;
+    }
+    timer->prev_sibling= &timers->active;
+    timers->active= timer;
+    timer->state= status->state;
+    timer->evt= evt;
+    timer->expires= wheel->now + ticks;
+    HsmWheelInsert( wheel, timer );
+    ++wheel->count;
+    ++timers->armed;
+    okay= HSM_TRUE;
+  }
+  return okay;
+}
+
+//---------------------------------------------------------------------------
+int HsmCancelTimers( hsm_machine hsm, hsm_state state )
+{
+  int cancelled=0;
+  hsm_timers_t* timers= hsm ? hsm->timers : NULL;
+  if (timers) {
+    hsm_timer_t* timer= timers->active;
+    while (timer) {
+      hsm_timer_t* next= timer->sibling;
+      if (timer->state == state) {
+        HsmTimerUnlink( timer );
+        HsmTimerRelease( timers, timer );
+        ++cancelled;
+      }
+      timer= next;
+    }
+  }
+  return cancelled;
+}
@@ -0,0 +1,199 @@
+/**
+ * @file hsm_timer.h
+ *
+ * State timeouts: timers armed by a state, cancelled when it exits, and kept on a hierarchical timing wheel.
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#pragma once
+#ifndef __HSM_TIMER_H__
+#define __HSM_TIMER_H__
+
+#include "hsm_forwards.h"
+
+typedef struct hsm_timer_rec hsm_timer_t;
+typedef struct hsm_timers_rec hsm_timers_t;
+typedef struct hsm_wheel_rec hsm_wheel_t;
+
+/**
+ * Levels of the timing wheel; each level covers #HSM_WHEEL_SLOTS times the span of the one below.
+ */
+#define HSM_WHEEL_LEVELS 4
+
+/**
+ * Slots per level, as a power of two.
+ */
+#define HSM_WHEEL_BITS 6
+#define HSM_WHEEL_SLOTS (1<<HSM_WHEEL_BITS)
+
+//---------------------------------------------------------------------------
+/**
+ * A single timeout. Provided by the user, in bulk, via HsmMachineTimers().
+ */
+struct hsm_timer_rec
+{
+    /**
+     * @internal: next timer in the same wheel slot.
+     */
+    hsm_timer_t * next;
+
+    /**
+     * @internal: the link pointing to this timer; NULL when the timer isn't armed.
+     */
+    hsm_timer_t ** prev;
+
+    /**
+     * @internal: next timer armed by the same machine; or, when not armed, the next free timer.
+     */
+    hsm_timer_t * sibling;
+
+    /**
+     * @internal: the link pointing to this timer in the machine's list of armed timers.
+     */
+    hsm_timer_t ** prev_sibling;
+
+    /**
+     * machine to notify.
+     */
+    hsm_machine hsm;
+
+    /**
+     * state which armed the timer; exiting it cancels the timer.
+     */
+    hsm_state state;
+
+    /**
+     * event sent when the timer expires.
+     */
+    hsm_event evt;
+
+    /**
+     * tick on which the timer expires.
+     */
+    unsigned long expires;
+};
+
+/**
+ * A machine's timers.
+ *
+ * @see HsmMachineTimers
+ */
+struct hsm_timers_rec
+{
+    /**
+     * wheel the timers run on.
+     */
+    hsm_wheel_t * wheel;
+
+    /**
+     * storage, provided by the user.
+     */
+    hsm_timer_t * timers;
+
+    /**
+     * number of timers.
+     */
+    int count;
+
+    /**
+     * number of timers currently armed.
+     */
+    int armed;
+
+    /**
+     * @internal: timers ready to arm.
+     */
+    hsm_timer_t * free;
+
+    /**
+     * @internal: timers currently armed, most recent first.
+     */
+    hsm_timer_t * active;
+};
+
+/**
+ * A hierarchical timing wheel: the time keeper for any number of machines.
+ *
+ * Level 0 has a slot per tick; each slot of a higher level spans a whole turn of the level below.
+ * Arming a timer, and removing it from the wheel, are constant time; exiting a state only looks at the timers its machine has armed.
+ * As time advances, a higher slot falls due once per turn of the level below, and its timers drop down a level; only the slots passed, and the timers in them, cost anything.
+ * Timers further out than the wheel spans ride around the top level until they come in range.
+ *
+ * Expired timers post their event to machines with a queue ( see HsmMachineQueue ), and signal it to all others.
+ *
+ * The wheel, and the machines using it, belong to a single thread.
+ */
+struct hsm_wheel_rec
+{
+    /**
+     * @internal: timers per level and slot.
+     */
+    hsm_timer_t * slots[ HSM_WHEEL_LEVELS ][ HSM_WHEEL_SLOTS ];
+
+    /**
+     * the current tick.
+     */
+    unsigned long now;
+
+    /**
+     * number of armed timers.
+     */
+    int count;
+};
+
+/**
+ * Initialize a timing wheel.
+ *
+ * @param wheel Wheel to initialize.
+ * @param now The current tick; ticks are whatever unit the user advances the wheel by.
+ */
+void HsmWheel( hsm_wheel_t* wheel, unsigned long now );
+
+/**
+ * Move time forward, expiring every timer due up to and including the new tick.
+ * Timers expire in tick order; each timer's event runs to completion before the next timer expires.
+ *
+ * @param wheel The wheel.
+ * @param now The new current tick; ticks already passed are ignored.
+ * @return Number of timers which expired.
+ */
+int HsmWheelAdvance( hsm_wheel_t* wheel, unsigned long now );
+
+/**
+ * Give a machine storage for timers.
+ * Call before HsmStart().
+ *
+ * @param hsm Machine which will arm timers.
+ * @param timers Record to initialize. Its lifetime must exceed the machine's use of it.
+ * @param wheel Wheel the timers run on.
+ * @param storage Timers; the most the machine's states will have armed at once.
+ * @param count Number of timers.
+ * @return #HSM_FALSE if the machine has already started.
+ */
+hsm_bool HsmMachineTimers( hsm_machine hsm, hsm_timers_t* timers, hsm_wheel_t* wheel, hsm_timer_t* storage, int count );
+
+/**
+ * Arm a timeout for the current state; for instance: from the state's enter callback.
+ * The timer is cancelled when the state exits; otherwise the machine hears the event once the ticks have passed.
+ *
+ * @param status The status passed to the callback: hsm_status_rec::state arms the timer.
+ * @param ticks Ticks from now; 0 expires on the next advance.
+ * @param evt The event to send; its lifetime must exceed the timer's.
+ * @return #HSM_FALSE if the machine has no timers, or all of them are armed.
+ */
+hsm_bool HsmArmTimer( hsm_status status, unsigned long ticks, hsm_event evt );
+
+/**
+ * Cancel every timer a state armed.
+ * Walks the timers the machine has armed, not the whole of its storage.
+ *
+ * @return Number of timers cancelled.
+ */
+int HsmCancelTimers( hsm_machine hsm, hsm_state state );
+
+#endif // #ifndef __HSM_TIMER_H__
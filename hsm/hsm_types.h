@@ -50,12 +50,22 @@ typedef unsigned long hsm_uint32;
  */
 typedef unsigned short hsm_uint16;
 
+/**
+ * 64 bit unsigned integer
+ */
+#if defined(_MSC_VER)
+typedef unsigned __int64 hsm_uint64;
+#else
+typedef unsigned long long hsm_uint64;
+#endif
+
 /**
  * @brief 16
  *
  * Maximum depth of a machine with context.
  * 16 is a decent amt of hiearchy depth.
  * nesting of regions will yield new sets of 16.
+ * Deeper machines can use a wide context stack: see HsmMachineWithWideContext().
  */
 #define HSM_MAX_DEPTH 16
 
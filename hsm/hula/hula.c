@@ -206,6 +206,76 @@ static hula_callback_is_event HulaGetIsEvent( lua_State * L )
   return cb;
 }
 
+//---------------------------------------------------------------------------
+/**
+ * @internal
+ * user data for every lua event handler: the target of a handler never changes,
+ * so it gets resolved once, rather than by name on every event.
+ */
+typedef struct hula_handler_rec hula_handler_t;
+struct hula_handler_rec
+{
+  /**
+   * the event, as named in the lua table; shares memory with the state table's key.
+   */
+  const char * eventspec;
+
+  /**
+   * builder id of the target, for { event = 'target' }; 0 for { event = function() end }
+   */
+  int target;
+
+  /**
+   * the target, once resolved.
+   */
+  hsm_state resolved;
+
+  /**
+   * the name a handler function last returned, and its state.
+   * lua interns strings: so long as the state table keeps last_name alive, the same pointer is the same name.
+   */
+  const char * last_name;
+  hsm_state last_state;
+};
+
+/**
+ * @internal
+ * create the user data for a handler; the state table keeps it alive, for as long as the state itself.
+ */
+static hula_handler_t* HulaNewHandler( lua_State* L, int state_table, const char * eventspec, int value_idx )
+{
+  hula_handler_t* handler= (hula_handler_t*) lua_newuserdata( L, sizeof(hula_handler_t) );
+  handler->eventspec= eventspec;
+  handler->target= lua_isfunction( L, value_idx ) ? 0 : hsmState( lua_tostring( L, value_idx ) );
+  handler->resolved= NULL;
+  handler->last_name= NULL;
+  handler->last_state= NULL;
+  lua_pushlightuserdata( L, handler );
+  lua_insert( L, -2 );
+  lua_rawset( L, state_table ); // state_table[ handler ]= userdata
+  return handler;
+}
+
+/**
+ * @internal
+ * resolve the name on top of the stack, which a handler function returned.
+ */
+static hsm_state HulaResolveReturned( lua_State* L, hsm_state state, hula_handler_t* handler )
+{
+  const char * name= lua_tostring( L, -1 );
+  if (name != handler->last_name) {
+    // anchor the name, so its pointer can't be reused by some other string.
+    const int state_table= HulaGetStateTable( L, state );
+    lua_pushlightuserdata( L, &handler->last_name );
+    lua_pushvalue( L, -3 );
+    lua_rawset( L, state_table ); // state_table[ &last_name ]= name
+    lua_remove( L, state_table );
+    handler->last_name= name;
+    handler->last_state= hsmResolve( name );
+  }
+  return handler->last_state;
+}
+
 //---------------------------------------------------------------------------
 // Run time callbacks:
 //---------------------------------------------------------------------------
@@ -344,7 +414,7 @@ hsm_bool HulaMatchEvent( const char * spec, const char *test )
  * @internal
  * callback for every action in lua that was assigned a function()
  * @param status hsm_status_rec::ctx contains hula_context_t setup in HulaEnter
- * @param user_data is the const char * of the event string
+ * @param user_data is the hula_handler_t for the event
  */
 static hsm_state HulaRunUD( hsm_status status, void * user_data )
 {
@@ -355,7 +425,8 @@ static hsm_state HulaRunUD( hsm_status status, void * user_data )
   if (ctx) {
     lua_State* L= ctx->L;
     const int event_table= lua_gettop(L);
-    const char * eventspec= (const char*) user_data;
+    hula_handler_t* handler= (hula_handler_t*) user_data;
+    const char * eventspec= handler->eventspec;
    
     // is this the event that's being processed one we care about?
     hsm_bool matches= HSM_FALSE;
@@ -372,6 +443,14 @@ static hsm_state HulaRunUD( hsm_status status, void * user_data )
       lua_pop( L, 1 );
     }
     
+    if (matches && handler->target) {
+      // named target: no need to look at the state table
+      if (!handler->resolved) {
+        handler->resolved= hsmResolveId( handler->target );
+      }
+      ret= handler->resolved ? handler->resolved : HsmStateError();
+    }
+    else
     if (matches){
       // push the relevant entry from the state table
       const int evthandler= HulaGetEvent( L, status->state, 0, eventspec );
@@ -397,8 +476,7 @@ static hsm_state HulaRunUD( hsm_status status, void * user_data )
         else {
           // evaluate the results
           if (lua_isstring( L, -1 )) {
-            const char * name= lua_tostring( L, -1 );
-            ret= hsmResolve( name );
+            ret= HulaResolveReturned( L, status->state, handler );
           }
           else
           if (lua_isboolean( L, -1 ) && lua_toboolean( L, -1 )) {
@@ -580,7 +658,7 @@ static hula_error HulaBuildBody( lua_State*L, const int table, nstring_t statena
             // Event: ex. { event = 'name' }, or: { event = function() end }
             else {
               const char *eventspec= keyname.string;
-              hsmOnEventUD( HulaRunUD, (void*) eventspec );
+              hsmOnEventUD( HulaRunUD, HulaNewHandler( L, state_table, eventspec, value_idx ) );
               // store state_table[ 'eventspec' ]= target.
               // to ensure HulaUserIsEvent has a valid 'eventspec' pointer.
               // not officially supported, but sharing string memory works.
@@ -0,0 +1,227 @@
+/**
+ * @file hsm_region_threads.c
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include <hsm/hsm_machine.h>
+#include <hsm/hsm_region.h>
+#include "hsm_region_threads.h"
+#include "hsm_thread.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+typedef struct hsm_region_task_rec hsm_region_task_t;
+
+//---------------------------------------------------------------------------
+/**
+ * One region waiting for a thread, and the count of its event's unfinished regions.
+ */
+struct hsm_region_task_rec
+{
+    hsm_region_t* region;
+    hsm_atomic* remaining;
+};
+
+struct hsm_region_threads_rec
+{
+    hsm_thread_t* threads;
+    int count;
+    int started;
+
+    // tasks waiting for a thread: a ring, grown as needed.
+    hsm_mutex_t lock;
+    hsm_region_task_t* tasks;
+    int tasks_size, tasks_head, tasks_count;
+
+    // idle threads wait on 'wake'; signaling threads with nothing left to help with wait on 'done'.
+    hsm_cond_t wake;
+    hsm_cond_t done;
+    hsm_atomic stopping;
+};
+
+//---------------------------------------------------------------------------
+// call with the lock held.
+static hsm_bool TaskPush( hsm_region_threads_t* threads, hsm_region_t* region, hsm_atomic* remaining )
+{
+    hsm_region_task_t* task;
+    if (threads->tasks_count == threads->tasks_size) {
+        // grow, unwrapping the ring as we go
+        const int size= threads->tasks_size ? threads->tasks_size*2 : 64;
+        hsm_region_task_t* tasks= (hsm_region_task_t*) malloc( size * sizeof(hsm_region_task_t) );
+        int i;
+        if (!tasks) {
+            return HSM_FALSE;
+        }
+        for (i=0; i<threads->tasks_count; ++i) {
+            tasks[i]= threads->tasks[ (threads->tasks_head + i) % threads->tasks_size ];
+        }
+        free( threads->tasks );
+        threads->tasks= tasks;
+        threads->tasks_size= size;
+        threads->tasks_head= 0;
+    }
+    task= threads->tasks + (threads->tasks_head + threads->tasks_count) % threads->tasks_size;
+    task->region= region;
+    task->remaining= remaining;
+    ++threads->tasks_count;
+    return HSM_TRUE;
+}
+
+//---------------------------------------------------------------------------
+// call with the lock held.
+static hsm_bool TaskPop( hsm_region_threads_t* threads, hsm_region_task_t* task )
+{
+    const hsm_bool okay= threads->tasks_count > 0;
+    if (okay) {
+        *task= threads->tasks[ threads->tasks_head ];
+        threads->tasks_head= (threads->tasks_head+1) % threads->tasks_size;
+        --threads->tasks_count;
+    }
+    return okay;
+}
+
+//---------------------------------------------------------------------------
+static void TaskRun( hsm_region_threads_t* threads, const hsm_region_task_t* task )
+{
+    HsmRegionRun( task->region );
+    // the last region of an event wakes whoever signaled it.
+    if (HsmAtomicAdd( task->remaining, -1 ) == 1) {
+        HsmMutexLock( &threads->lock );
+        HsmCondBroadcast( &threads->done );
+        HsmMutexUnlock( &threads->lock );
+    }
+}
+
+//---------------------------------------------------------------------------
+static void RegionThreadMain( void * data )
+{
+    hsm_region_threads_t* threads= (hsm_region_threads_t*) data;
+    HsmMutexLock( &threads->lock );
+    while (!HsmAtomicLoad( &threads->stopping )) {
+        hsm_region_task_t task;
+        if (TaskPop( threads, &task )) {
+            HsmMutexUnlock( &threads->lock );
+            TaskRun( threads, &task );
+            HsmMutexLock( &threads->lock );
+        }
+        else {
+            HsmCondWait( &threads->wake, &threads->lock, 10 );
+        }
+    }
+    HsmMutexUnlock( &threads->lock );
+}
+
+//---------------------------------------------------------------------------
+/**
+ * hsm_callback_regions_run: share out all but the first region, run that one here, then help with the rest.
+ * Regions of nested parallel states come back through here on whichever thread runs them;
+ * since waiting threads take any task, not just their own, every task always has a thread.
+ */
+static void HsmRegionThreadsRun( hsm_region_t* regions, void * run_data )
+{
+    hsm_region_threads_t* threads= (hsm_region_threads_t*) run_data;
+    hsm_atomic remaining= 0;
+    hsm_region_task_t task;
+    hsm_region_t* it;
+
+    HsmMutexLock( &threads->lock );
+    for (it= regions->next; it; it= it->next) {
+        if (TaskPush( threads, it, &remaining )) {
+            HsmAtomicAdd( &remaining, 1 );
+        }
+        else {
+            // out of memory: run it ourselves
+            HsmMutexUnlock( &threads->lock );
+            HsmRegionRun( it );
+            HsmMutexLock( &threads->lock );
+        }
+    }
+    // threads waiting on their own regions can help with these too.
+    HsmCondBroadcast( &threads->wake );
+    HsmCondBroadcast( &threads->done );
+    HsmMutexUnlock( &threads->lock );
+
+    HsmRegionRun( regions );
+
+    HsmMutexLock( &threads->lock );
+    while (HsmAtomicLoad( &remaining ) > 0) {
+        if (TaskPop( threads, &task )) {
+            HsmMutexUnlock( &threads->lock );
+            TaskRun( threads, &task );
+            HsmMutexLock( &threads->lock );
+        }
+        else {
+            HsmCondWait( &threads->done, &threads->lock, 10 );
+        }
+    }
+    HsmMutexUnlock( &threads->lock );
+}
+
+//---------------------------------------------------------------------------
+// Interface
+//---------------------------------------------------------------------------
+hsm_region_threads_t* HsmRegionThreadsCreate( int count )
+{
+    hsm_region_threads_t* threads= (hsm_region_threads_t*) calloc( 1, sizeof(hsm_region_threads_t) );
+    if (threads) {
+        const int cores= HsmThreadCores();
+        threads->count= count > 0 ? count : (cores > 1 ? cores-1 : 1);
+        threads->threads= (hsm_thread_t*) calloc( threads->count, sizeof(hsm_thread_t) );
+        HsmMutexInit( &threads->lock );
+        HsmCondInit( &threads->wake );
+        HsmCondInit( &threads->done );
+        if (threads->threads) {
+            int i;
+            for (i=0; i<threads->count; ++i) {
+                if (!HsmThreadStart( &threads->threads[i], RegionThreadMain, threads )) {
+                    break;
+                }
+                threads->started= i+1;
+            }
+        }
+        if (threads->started < threads->count) {
+            HsmRegionThreadsDestroy( threads );
+            threads= NULL;
+        }
+    }
+    return threads;
+}
+
+//---------------------------------------------------------------------------
+void HsmRegionThreadsDestroy( hsm_region_threads_t* threads )
+{
+    if (threads) {
+        int i;
+        HsmAtomicStore( &threads->stopping, 1 );
+        HsmMutexLock( &threads->lock );
+        HsmCondBroadcast( &threads->wake );
+        HsmMutexUnlock( &threads->lock );
+        for (i=0; i<threads->started; ++i) {
+            HsmThreadJoin( &threads->threads[i] );
+        }
+        HsmCondDestroy( &threads->done );
+        HsmCondDestroy( &threads->wake );
+        HsmMutexDestroy( &threads->lock );
+        free( threads->tasks );
+        free( threads->threads );
+        free( threads );
+    }
+}
+
+//---------------------------------------------------------------------------
+hsm_bool HsmRegionThreadsAttach( hsm_region_threads_t* threads, hsm_region_pool_t* pool )
+{
+    const hsm_bool okay= pool && !pool->used;
+    HSM_ASSERT( okay && "attach threads before the pool is in use" );
+    if (okay) {
+        pool->run= threads ? HsmRegionThreadsRun : NULL;
+        pool->run_data= threads;
+    }
+    return okay;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file hsm_region_threads.h
+ *
+ * Run the regions of a parallel state on several threads at once.
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#pragma once
+#ifndef __HSM_REGION_THREADS_H__
+#define __HSM_REGION_THREADS_H__
+
+// #include <hsm/hsm_machine.h>
+// #include <hsm/hsm_region.h>
+
+/**
+ * Opaque pool of region threads.
+ *
+ * Once attached to a region pool, each event that reaches a parallel state goes to all of its regions at the same time:
+ * the thread which signaled the event runs the first region itself, and the pool's threads take the rest.
+ * The signaling thread helps out until every region has finished, then the event continues as usual ( see hsm_region.h. )
+ *
+ * Worth it when regions do real work per event; for cheap handlers, the hand off costs more than it saves.
+ * Handlers, and the info callbacks, of different regions run at the same time: anything they share needs its own locking.
+ *
+ * 1. HsmRegionPool(), then HsmRegionThreadsCreate() and HsmRegionThreadsAttach() it to the pool.
+ * 2. HsmMachineRegions() and HsmStart() machines as usual.
+ * 3. HsmRegionThreadsDestroy() once no machine is signaling events.
+ */
+typedef struct hsm_region_threads_rec hsm_region_threads_t;
+
+/**
+ * Start a pool of region threads.
+ *
+ * @param threads Number of threads in addition to the signaling thread; 0 uses one per core, less one.
+ * @return The new pool, or NULL if it couldn't be started.
+ */
+hsm_region_threads_t* HsmRegionThreadsCreate( int threads );
+
+/**
+ * Stop the threads, and free the pool.
+ */
+void HsmRegionThreadsDestroy( hsm_region_threads_t* threads );
+
+/**
+ * Have the passed region pool run its regions on the threads.
+ * Call before any machine using the region pool starts.
+ * One set of threads can serve many region pools.
+ *
+ * @param threads The threads; NULL turns concurrent regions back off.
+ * @param pool An initialized region pool, see HsmRegionPool().
+ * @return #HSM_FALSE if the pool has instances in use.
+ */
+hsm_bool HsmRegionThreadsAttach( hsm_region_threads_t* threads, hsm_region_pool_t* pool );
+
+#endif // #ifndef __HSM_REGION_THREADS_H__
@@ -0,0 +1,391 @@
+/**
+ * @file hsm_scheduler.c
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include <hsm/hsm_machine.h>
+#include <hsm/hsm_queue.h>
+#include "hsm_scheduler.h"
+#include "hsm_thread.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct hsm_deque_rec  hsm_deque_t;
+typedef struct hsm_worker_rec hsm_worker_t;
+
+// slots per worker deque; when full, machines go to the shared queue instead.
+#define HSM_DEQUE_SIZE 4096
+
+// padding to keep the data each thread writes on its own cache line.
+#define HSM_CACHE_LINE 64
+
+//---------------------------------------------------------------------------
+/**
+ * chase and lev's work stealing deque, fixed size.
+ * http://dl.acm.org/citation.cfm?id=1073974
+ * the owner pushes and pops the bottom, thieves take from the top.
+ */
+struct hsm_deque_rec
+{
+    hsm_atomic top;
+    char pad0[ HSM_CACHE_LINE - sizeof(hsm_atomic) ];
+    hsm_atomic bottom;
+    char pad1[ HSM_CACHE_LINE - sizeof(hsm_atomic) ];
+    hsm_machine volatile slots[ HSM_DEQUE_SIZE ];
+};
+
+struct hsm_worker_rec
+{
+    hsm_deque_t deque;
+    hsm_scheduler_t* scheduler;
+    hsm_thread_t thread;
+    unsigned int seed;      // for picking victims
+};
+
+struct hsm_scheduler_rec
+{
+    hsm_worker_t* workers;
+    int count;
+    int started;
+    int batch;
+
+    // machines made ready by threads outside the pool, or requeued after a full batch.
+    // a machine sits in at most one place at a time, so room for every attached machine never runs out.
+    hsm_mutex_t lock;
+    hsm_machine* shared;
+    int shared_size, shared_head;
+    hsm_atomic shared_count;
+    int attached;
+
+    // sleeping workers wait on 'wake'; HsmSchedulerWait() waits on 'idle'.
+    hsm_cond_t wake;
+    hsm_cond_t idle;
+    hsm_atomic sleepers;
+
+    // machines with pending events: incremented on ready, decremented on idle.
+    hsm_atomic busy;
+    hsm_atomic stopping;
+};
+
+// the worker running on this thread, if any.
+static HSM_THREAD_LOCAL hsm_worker_t* tWorker= NULL;
+
+//---------------------------------------------------------------------------
+// Deque
+//---------------------------------------------------------------------------
+static hsm_bool DequePush( hsm_deque_t* deque, hsm_machine hsm )
+{
+    const long b= deque->bottom;
+    const long t= HsmAtomicLoad( &deque->top );
+    hsm_bool okay= (b - t) < HSM_DEQUE_SIZE;
+    if (okay) {
+        deque->slots[ b & (HSM_DEQUE_SIZE-1) ]= hsm;
+        HsmAtomicStore( &deque->bottom, b+1 );
+    }
+    return okay;
+}
+
+static hsm_machine DequePop( hsm_deque_t* deque )
+{
+    hsm_machine hsm= NULL;
+    const long b= deque->bottom - 1;
+    long t;
+    HsmAtomicStore( &deque->bottom, b );
+    HsmAtomicFence();
+    t= HsmAtomicLoad( &deque->top );
+    if (t <= b) {
+        hsm= deque->slots[ b & (HSM_DEQUE_SIZE-1) ];
+        if (t == b) {
+            // last one: race the thieves for it
+            if (!HsmAtomicCas( &deque->top, t, t+1 )) {
+                hsm= NULL;
+            }
+            HsmAtomicStore( &deque->bottom, b+1 );
+        }
+    }
+    else {
+        HsmAtomicStore( &deque->bottom, b+1 );
+    }
+    return hsm;
+}
+
+static hsm_machine DequeSteal( hsm_deque_t* deque )
+{
+    hsm_machine hsm= NULL;
+    const long t= HsmAtomicLoad( &deque->top );
+    long b;
+    HsmAtomicFence();
+    b= HsmAtomicLoad( &deque->bottom );
+    if (t < b) {
+        hsm= deque->slots[ t & (HSM_DEQUE_SIZE-1) ];
+        if (!HsmAtomicCas( &deque->top, t, t+1 )) {
+            hsm= NULL; // someone else got it
+        }
+    }
+    return hsm;
+}
+
+//---------------------------------------------------------------------------
+// Shared queue
+//---------------------------------------------------------------------------
+// make room for one more attached machine; called with the lock held.
+static hsm_bool SharedReserve( hsm_scheduler_t* scheduler )
+{
+    hsm_bool okay= scheduler->attached < scheduler->shared_size;
+    if (!okay) {
+        // grow, unwrapping the ring as we go
+        const int size= scheduler->shared_size ? scheduler->shared_size*2 : 256;
+        hsm_machine* shared= (hsm_machine*) malloc( size * sizeof(hsm_machine) );
+        if (shared) {
+            int i;
+            for (i=0; i<scheduler->shared_count; ++i) {
+                shared[i]= scheduler->shared[ (scheduler->shared_head + i) % scheduler->shared_size ];
+            }
+            free( scheduler->shared );
+            scheduler->shared= shared;
+            scheduler->shared_size= size;
+            scheduler->shared_head= 0;
+            okay= HSM_TRUE;
+        }
+    }
+    if (okay) {
+        ++scheduler->attached;
+    }
+    return okay;
+}
+
+// never allocates: posting can't fail once the machine is attached.
+static void SharedPush( hsm_scheduler_t* scheduler, hsm_machine hsm )
+{
+    HsmMutexLock( &scheduler->lock );
+    HSM_ASSERT( scheduler->shared_count < scheduler->shared_size );
+    scheduler->shared[ (scheduler->shared_head + scheduler->shared_count) % scheduler->shared_size ]= hsm;
+    HsmAtomicAdd( &scheduler->shared_count, 1 );
+    HsmMutexUnlock( &scheduler->lock );
+}
+
+static hsm_machine SharedPop( hsm_scheduler_t* scheduler )
+{
+    hsm_machine hsm= NULL;
+    if (HsmAtomicLoad( &scheduler->shared_count ) > 0) {
+        HsmMutexLock( &scheduler->lock );
+        if (scheduler->shared_count > 0) {
+            hsm= scheduler->shared[ scheduler->shared_head ];
+            scheduler->shared_head= (scheduler->shared_head+1) % scheduler->shared_size;
+            HsmAtomicAdd( &scheduler->shared_count, -1 );
+        }
+        HsmMutexUnlock( &scheduler->lock );
+    }
+    return hsm;
+}
+
+//---------------------------------------------------------------------------
+// Workers
+//---------------------------------------------------------------------------
+// call after publishing work. the fence orders that publication before reading the sleepers count;
+// WorkerMain orders the other way, see there.
+static void WakeWorker( hsm_scheduler_t* scheduler )
+{
+    HsmAtomicFence();
+    if (HsmAtomicLoad( &scheduler->sleepers ) > 0) {
+        HsmMutexLock( &scheduler->lock );
+        HsmCondSignal( &scheduler->wake );
+        HsmMutexUnlock( &scheduler->lock );
+    }
+}
+
+//---------------------------------------------------------------------------
+// queue ready callback: the posting thread has handed us the machine.
+static void HsmSchedulerReady( hsm_machine hsm, void * ready_data )
+{
+    hsm_scheduler_t* scheduler= (hsm_scheduler_t*) ready_data;
+    hsm_worker_t* worker= tWorker;
+    HsmAtomicAdd( &scheduler->busy, 1 );
+    if (!worker || worker->scheduler != scheduler || !DequePush( &worker->deque, hsm )) {
+        SharedPush( scheduler, hsm );
+    }
+    WakeWorker( scheduler );
+}
+
+//---------------------------------------------------------------------------
+static hsm_machine FindWork( hsm_worker_t* worker )
+{
+    hsm_scheduler_t* scheduler= worker->scheduler;
+    hsm_machine hsm= DequePop( &worker->deque );
+    if (!hsm) {
+        hsm= SharedPop( scheduler );
+    }
+    if (!hsm && scheduler->count > 1) {
+        // try every other worker once, starting somewhere random
+        int i, start;
+        worker->seed= worker->seed * 1103515245 + 12345;
+        start= (int)((worker->seed >> 16) % scheduler->count);
+        for (i=0; !hsm && i<scheduler->count; ++i) {
+            hsm_worker_t* victim= scheduler->workers + ((start+i) % scheduler->count);
+            if (victim != worker) {
+                hsm= DequeSteal( &victim->deque );
+            }
+        }
+    }
+    return hsm;
+}
+
+//---------------------------------------------------------------------------
+static hsm_bool AnyWork( hsm_scheduler_t* scheduler )
+{
+    hsm_bool work= HsmAtomicLoad( &scheduler->shared_count ) > 0;
+    int i;
+    for (i=0; !work && i<scheduler->count; ++i) {
+        hsm_deque_t* deque= &scheduler->workers[i].deque;
+        work= HsmAtomicLoad( &deque->bottom ) > HsmAtomicLoad( &deque->top );
+    }
+    return work;
+}
+
+//---------------------------------------------------------------------------
+static void WorkerMain( void * data )
+{
+    hsm_worker_t* worker= (hsm_worker_t*) data;
+    hsm_scheduler_t* scheduler= worker->scheduler;
+    tWorker= worker;
+
+    while (!HsmAtomicLoad( &scheduler->stopping )) {
+        hsm_machine hsm= FindWork( worker );
+        if (hsm) {
+            if (HsmDrainSome( hsm, scheduler->batch, NULL )) {
+                // still ours: let everyone else have a turn first
+                SharedPush( scheduler, hsm );
+                WakeWorker( scheduler );
+            }
+            else
+            if (HsmAtomicAdd( &scheduler->busy, -1 ) == 1) {
+                HsmMutexLock( &scheduler->lock );
+                HsmCondBroadcast( &scheduler->idle );
+                HsmMutexUnlock( &scheduler->lock );
+            }
+        }
+        else {
+            // a store followed by a load of some other location can be reordered, so both sides need a full fence:
+            // here between counting ourselves a sleeper and checking for work; in WakeWorker() between publishing work
+            // ( a release store of the deque bottom, or the shared count ) and reading the sleepers count.
+            // with both in place, either the poster sees the sleeper and signals it under the lock, or the sleeper sees the work.
+            HsmMutexLock( &scheduler->lock );
+            HsmAtomicAdd( &scheduler->sleepers, 1 );
+            HsmAtomicFence();
+            if (!AnyWork( scheduler ) && !HsmAtomicLoad( &scheduler->stopping )) {
+                HsmCondWait( &scheduler->wake, &scheduler->lock, 10 );
+            }
+            HsmAtomicAdd( &scheduler->sleepers, -1 );
+            HsmMutexUnlock( &scheduler->lock );
+        }
+    }
+    tWorker= NULL;
+}
+
+//---------------------------------------------------------------------------
+// Interface
+//---------------------------------------------------------------------------
+hsm_scheduler_t* HsmSchedulerCreate( int threads )
+{
+    hsm_scheduler_t* scheduler= (hsm_scheduler_t*) calloc( 1, sizeof(hsm_scheduler_t) );
+    if (scheduler) {
+        const int count= threads > 0 ? threads : HsmThreadCores();
+        scheduler->workers= (hsm_worker_t*) calloc( count, sizeof(hsm_worker_t) );
+        scheduler->batch= 64;
+        HsmMutexInit( &scheduler->lock );
+        HsmCondInit( &scheduler->wake );
+        HsmCondInit( &scheduler->idle );
+        if (scheduler->workers) {
+            int i;
+            // set before any thread starts: workers read it when stealing.
+            scheduler->count= count;
+            for (i=0; i<count; ++i) {
+                hsm_worker_t* worker= scheduler->workers + i;
+                worker->scheduler= scheduler;
+                worker->seed= 1 + i;
+            }
+            for (i=0; i<count; ++i) {
+                if (!HsmThreadStart( &scheduler->workers[i].thread, WorkerMain, scheduler->workers+i )) {
+                    break;
+                }
+                scheduler->started= i+1;
+            }
+        }
+        if (!scheduler->count || scheduler->started < scheduler->count) {
+            HsmSchedulerDestroy( scheduler );
+            scheduler= NULL;
+        }
+    }
+    return scheduler;
+}
+
+//---------------------------------------------------------------------------
+void HsmSchedulerDestroy( hsm_scheduler_t* scheduler )
+{
+    if (scheduler) {
+        int i;
+        HsmAtomicStore( &scheduler->stopping, 1 );
+        HsmMutexLock( &scheduler->lock );
+        HsmCondBroadcast( &scheduler->wake );
+        HsmMutexUnlock( &scheduler->lock );
+        for (i=0; i<scheduler->started; ++i) {
+            HsmThreadJoin( &scheduler->workers[i].thread );
+        }
+        HsmCondDestroy( &scheduler->idle );
+        HsmCondDestroy( &scheduler->wake );
+        HsmMutexDestroy( &scheduler->lock );
+        free( scheduler->shared );
+        free( scheduler->workers );
+        free( scheduler );
+    }
+}
+
+//---------------------------------------------------------------------------
+int HsmSchedulerThreads( const hsm_scheduler_t* scheduler )
+{
+    return scheduler ? scheduler->count : 0;
+}
+
+//---------------------------------------------------------------------------
+hsm_bool HsmSchedulerAttach( hsm_scheduler_t* scheduler, hsm_machine hsm )
+{
+    hsm_bool okay= scheduler && hsm && hsm->queue;
+    HSM_ASSERT( okay && "machine needs a queue" );
+    if (okay) {
+        HsmMutexLock( &scheduler->lock );
+        okay= SharedReserve( scheduler );
+        HsmMutexUnlock( &scheduler->lock );
+    }
+    if (okay) {
+        // events posted before, or while, attaching get handed over exactly once.
+        HsmQueueReady( hsm, HsmSchedulerReady, scheduler );
+    }
+    return okay;
+}
+
+//---------------------------------------------------------------------------
+void HsmSchedulerWait( hsm_scheduler_t* scheduler )
+{
+    if (scheduler) {
+        HsmMutexLock( &scheduler->lock );
+        while (HsmAtomicLoad( &scheduler->busy ) > 0) {
+            HsmCondWait( &scheduler->idle, &scheduler->lock, 10 );
+        }
+        HsmMutexUnlock( &scheduler->lock );
+    }
+}
+
+//---------------------------------------------------------------------------
+void HsmSchedulerBatch( hsm_scheduler_t* scheduler, int events )
+{
+    if (scheduler && events > 0) {
+        scheduler->batch= events;
+    }
+}
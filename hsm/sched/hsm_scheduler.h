@@ -0,0 +1,81 @@
+/**
+ * @file hsm_scheduler.h
+ *
+ * Run many machines across a pool of worker threads.
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#pragma once
+#ifndef __HSM_SCHEDULER_H__
+#define __HSM_SCHEDULER_H__
+
+// #include <hsm/hsm_machine.h>
+// #include <hsm/hsm_queue.h>
+
+/**
+ * Opaque scheduler object.
+ *
+ * The scheduler owns a pool of worker threads. Machines attached to the scheduler are handed to a worker
+ * whenever an event is posted to them while idle ( see hsm_queue_rec::ready. )
+ * The posted event queue guarantees only one worker owns a machine at a time,
+ * so every event still runs to completion exactly as it does with HsmSignalEvent().
+ *
+ * Each worker keeps a work-stealing deque of the machines it owns:
+ * machines made ready by a worker ( ex. one machine posting to another ) stay on that worker,
+ * machines made ready by other threads are shared through a common queue,
+ * and idle workers steal from busy ones.
+ *
+ * 1. HsmSchedulerCreate()
+ * 2. Give each machine a queue via HsmMachineQueue(), then HsmSchedulerAttach() it.
+ * 3. HsmPostEvent() from anywhere.
+ * 4. HsmSchedulerWait() for all posted events to finish, and HsmSchedulerDestroy() when done.
+ */
+typedef struct hsm_scheduler_rec hsm_scheduler_t;
+
+/**
+ * Start a scheduler.
+ *
+ * @param threads Number of worker threads; 0 uses one per core.
+ * @return The new scheduler, or NULL if it couldn't be started.
+ */
+hsm_scheduler_t* HsmSchedulerCreate( int threads );
+
+/**
+ * Stop the worker threads, and free the scheduler.
+ * Events still pending are not processed: call HsmSchedulerWait() first.
+ */
+void HsmSchedulerDestroy( hsm_scheduler_t* scheduler );
+
+/**
+ * Number of worker threads.
+ */
+int HsmSchedulerThreads( const hsm_scheduler_t* scheduler );
+
+/**
+ * Have the scheduler run the passed machine.
+ * Takes over the machine queue's ready callback; other threads may already be posting to the machine.
+ *
+ * @param scheduler The scheduler.
+ * @param hsm A machine with a queue, see HsmMachineQueue().
+ * @return #HSM_FALSE if the machine has no queue, or there wasn't memory to track it.
+ * Room is reserved here, so that posting to an attached machine never needs to allocate.
+ */
+hsm_bool HsmSchedulerAttach( hsm_scheduler_t* scheduler, hsm_machine hsm );
+
+/**
+ * Block until every posted event has run to completion.
+ */
+void HsmSchedulerWait( hsm_scheduler_t* scheduler );
+
+/**
+ * Maximum number of events a worker runs for one machine before giving other machines a turn.
+ * Defaults to 64.
+ */
+void HsmSchedulerBatch( hsm_scheduler_t* scheduler, int events );
+
+#endif // #ifndef __HSM_SCHEDULER_H__
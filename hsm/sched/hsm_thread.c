@@ -0,0 +1,141 @@
+/**
+ * @file hsm_thread.c
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "hsm_thread.h"
+#include <stdlib.h>
+
+#ifndef WIN32
+#include <errno.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+//---------------------------------------------------------------------------
+typedef struct hsm_thread_start_rec hsm_thread_start_t;
+struct hsm_thread_start_rec
+{
+    hsm_thread_fn fn;
+    void * data;
+};
+
+#ifdef WIN32
+//---------------------------------------------------------------------------
+static DWORD WINAPI HsmThreadMain( LPVOID param )
+{
+    hsm_thread_start_t start= *(hsm_thread_start_t*) param;
+    free( param );
+    start.fn( start.data );
+    return 0;
+}
+
+hsm_bool HsmThreadStart( hsm_thread_t* thread, hsm_thread_fn fn, void * data )
+{
+    hsm_bool okay= HSM_FALSE;
+    hsm_thread_start_t* start= (hsm_thread_start_t*) malloc( sizeof(hsm_thread_start_t) );
+    if (start) {
+        start->fn= fn;
+        start->data= data;
+        *thread= CreateThread( NULL, 0, HsmThreadMain, start, 0, NULL );
+        okay= *thread != NULL;
+        if (!okay) {
+            free( start );
+        }
+    }
+    return okay;
+}
+
+void HsmThreadJoin( hsm_thread_t* thread )
+{
+    WaitForSingleObject( *thread, INFINITE );
+    CloseHandle( *thread );
+}
+
+int HsmThreadCores()
+{
+    SYSTEM_INFO info;
+    GetSystemInfo( &info );
+    return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+}
+
+void HsmMutexInit( hsm_mutex_t* m )    { InitializeCriticalSection( m ); }
+void HsmMutexDestroy( hsm_mutex_t* m ) { DeleteCriticalSection( m ); }
+void HsmMutexLock( hsm_mutex_t* m )    { EnterCriticalSection( m ); }
+void HsmMutexUnlock( hsm_mutex_t* m )  { LeaveCriticalSection( m ); }
+
+void HsmCondInit( hsm_cond_t* c )      { InitializeConditionVariable( c ); }
+void HsmCondDestroy( hsm_cond_t* c )   { }
+void HsmCondSignal( hsm_cond_t* c )    { WakeConditionVariable( c ); }
+void HsmCondBroadcast( hsm_cond_t* c ) { WakeAllConditionVariable( c ); }
+
+void HsmCondWait( hsm_cond_t* c, hsm_mutex_t* m, int milliseconds )
+{
+    SleepConditionVariableCS( c, m, milliseconds );
+}
+
+#else
+//---------------------------------------------------------------------------
+static void* HsmThreadMain( void * param )
+{
+    hsm_thread_start_t start= *(hsm_thread_start_t*) param;
+    free( param );
+    start.fn( start.data );
+    return NULL;
+}
+
+hsm_bool HsmThreadStart( hsm_thread_t* thread, hsm_thread_fn fn, void * data )
+{
+    hsm_bool okay= HSM_FALSE;
+    hsm_thread_start_t* start= (hsm_thread_start_t*) malloc( sizeof(hsm_thread_start_t) );
+    if (start) {
+        start->fn= fn;
+        start->data= data;
+        okay= pthread_create( thread, NULL, HsmThreadMain, start ) == 0;
+        if (!okay) {
+            free( start );
+        }
+    }
+    return okay;
+}
+
+void HsmThreadJoin( hsm_thread_t* thread )
+{
+    pthread_join( *thread, NULL );
+}
+
+int HsmThreadCores()
+{
+    long cores= sysconf( _SC_NPROCESSORS_ONLN );
+    return cores > 0 ? (int) cores : 1;
+}
+
+void HsmMutexInit( hsm_mutex_t* m )    { pthread_mutex_init( m, NULL ); }
+void HsmMutexDestroy( hsm_mutex_t* m ) { pthread_mutex_destroy( m ); }
+void HsmMutexLock( hsm_mutex_t* m )    { pthread_mutex_lock( m ); }
+void HsmMutexUnlock( hsm_mutex_t* m )  { pthread_mutex_unlock( m ); }
+
+void HsmCondInit( hsm_cond_t* c )      { pthread_cond_init( c, NULL ); }
+void HsmCondDestroy( hsm_cond_t* c )   { pthread_cond_destroy( c ); }
+void HsmCondSignal( hsm_cond_t* c )    { pthread_cond_signal( c ); }
+void HsmCondBroadcast( hsm_cond_t* c ) { pthread_cond_broadcast( c ); }
+
+void HsmCondWait( hsm_cond_t* c, hsm_mutex_t* m, int milliseconds )
+{
+    struct timeval now;
+    struct timespec until;
+    gettimeofday( &now, NULL );
+    until.tv_sec= now.tv_sec + milliseconds / 1000;
+    until.tv_nsec= (now.tv_usec + (milliseconds % 1000) * 1000L) * 1000L;
+    if (until.tv_nsec >= 1000000000L) {
+        until.tv_sec+= 1;
+        until.tv_nsec-= 1000000000L;
+    }
+    pthread_cond_timedwait( c, m, &until );
+}
+#endif
@@ -0,0 +1,73 @@
+/**
+ * @file hsm_thread.h
+ *
+ * Minimal portable threads, used by the scheduler.
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#pragma once
+#ifndef __HSM_THREAD_H__
+#define __HSM_THREAD_H__
+
+#include <hsm/hsm_types.h>
+
+#ifdef WIN32
+#include <windows.h>
+typedef HANDLE hsm_thread_t;
+typedef CRITICAL_SECTION hsm_mutex_t;
+typedef CONDITION_VARIABLE hsm_cond_t;
+#define HSM_THREAD_LOCAL __declspec(thread)
+#else
+#include <pthread.h>
+typedef pthread_t hsm_thread_t;
+typedef pthread_mutex_t hsm_mutex_t;
+typedef pthread_cond_t hsm_cond_t;
+/**
+ * Storage class for per thread variables.
+ */
+#define HSM_THREAD_LOCAL __thread
+#endif
+
+/**
+ * Body of a thread.
+ */
+typedef void (*hsm_thread_fn)( void * data );
+
+/**
+ * Start a new thread.
+ * @return #HSM_FALSE if the thread couldn't be created.
+ */
+hsm_bool HsmThreadStart( hsm_thread_t* thread, hsm_thread_fn fn, void * data );
+
+/**
+ * Wait for a thread to finish.
+ */
+void HsmThreadJoin( hsm_thread_t* thread );
+
+/**
+ * Number of hardware threads available; at least 1.
+ */
+int HsmThreadCores();
+
+void HsmMutexInit( hsm_mutex_t* );
+void HsmMutexDestroy( hsm_mutex_t* );
+void HsmMutexLock( hsm_mutex_t* );
+void HsmMutexUnlock( hsm_mutex_t* );
+
+void HsmCondInit( hsm_cond_t* );
+void HsmCondDestroy( hsm_cond_t* );
+void HsmCondSignal( hsm_cond_t* );
+void HsmCondBroadcast( hsm_cond_t* );
+
+/**
+ * Wait for a signal, or for the timeout to expire.
+ * The mutex must be locked; it's locked again on return.
+ */
+void HsmCondWait( hsm_cond_t*, hsm_mutex_t*, int milliseconds );
+
+#endif // #ifndef __HSM_THREAD_H__
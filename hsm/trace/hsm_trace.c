@@ -0,0 +1,305 @@
+/**
+ * @file hsm_trace.c
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include <hsm/hsm_machine.h>
+#include <hsm/hsm_atomic.h>
+#include <hsm/hsm_chart.h>
+#include <hsm/hsm_info.h>
+#include <hsm/sched/hsm_thread.h>
+#include "hsm_trace.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef WIN32
+#include <time.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#define HSM_TRACE_CYCLES() __rdtsc()
+#elif defined(__i386__) || defined(__x86_64__)
+#define HSM_TRACE_CYCLES() __builtin_ia32_rdtsc()
+#endif
+
+typedef struct hsm_trace_ring_rec hsm_trace_ring_t;
+
+// calibrating the cycle counter against the clock takes at least this long.
+#define HSM_TRACE_CALIBRATE_NS 10000000
+
+//---------------------------------------------------------------------------
+/**
+ * One thread's records. Only the owning thread writes; dumps read from any thread.
+ */
+struct hsm_trace_ring_rec
+{
+    hsm_trace_ring_t* next;
+    const void * owner;
+    hsm_atomic head;    // records ever written; the oldest are overwritten
+    long mask;
+    hsm_trace_record_t* records;
+};
+
+struct hsm_trace_rec
+{
+    hsm_info_t info;
+    const hsm_chart_t* chart;
+    hsm_trace_ring_t* volatile rings;
+    int size;
+    hsm_uint64 start;
+    hsm_uint64 start_ns;
+    long serial;
+};
+
+// every trace gets a serial number, never reused: a new trace can land at the address of a destroyed one.
+static hsm_atomic gTraceSerial= 0;
+
+// each thread remembers its ring for the trace it last wrote to, by serial number;
+// the address of tRing doubles as the thread's identity.
+static HSM_THREAD_LOCAL long tSerial= 0;
+static HSM_THREAD_LOCAL hsm_trace_ring_t* tRing= NULL;
+
+//---------------------------------------------------------------------------
+// Clock
+//---------------------------------------------------------------------------
+static hsm_uint64 HsmTraceNanoseconds()
+{
+#ifdef WIN32
+    LARGE_INTEGER count, frequency;
+    QueryPerformanceCounter( &count );
+    QueryPerformanceFrequency( &frequency );
+    return (hsm_uint64)( count.QuadPart * (1e9 / frequency.QuadPart) );
+#else
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (hsm_uint64) ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+hsm_uint64 HsmTraceClock()
+{
+#ifdef HSM_TRACE_CYCLES
+    return HSM_TRACE_CYCLES();
+#else
+    return HsmTraceNanoseconds();
+#endif
+}
+
+//---------------------------------------------------------------------------
+// Rings
+//---------------------------------------------------------------------------
+static hsm_trace_ring_t* HsmTraceRing( hsm_trace_t* trace )
+{
+    hsm_trace_ring_t* ring;
+    // a thread which wrote to this trace before, then to another
+    for (ring= (hsm_trace_ring_t*) HsmAtomicLoadPtr( &trace->rings ); ring; ring= ring->next) {
+        if (ring->owner == &tRing) {
+            break;
+        }
+    }
+    if (!ring) {
+        ring= (hsm_trace_ring_t*) calloc( 1, sizeof(hsm_trace_ring_t) );
+        if (ring) {
+            ring->records= (hsm_trace_record_t*) calloc( trace->size, sizeof(hsm_trace_record_t) );
+            if (!ring->records) {
+                free( ring );
+                ring= NULL;
+            }
+        }
+        if (ring) {
+            hsm_trace_ring_t* head;
+            ring->owner= &tRing;
+            ring->mask= trace->size-1;
+            do {
+                head= (hsm_trace_ring_t*) HsmAtomicLoadPtr( &trace->rings );
+                ring->next= head;
+            }
+            while (!HsmAtomicCasPtr( &trace->rings, head, ring ));
+        }
+    }
+    if (ring) {
+        tSerial= trace->serial;
+        tRing= ring;
+    }
+    return ring;
+}
+
+//---------------------------------------------------------------------------
+void HsmTraceWrite( hsm_trace_t* trace, int kind, const hsm_machine hsm, hsm_state state, hsm_event evt )
+{
+    hsm_trace_ring_t* ring= (tSerial == trace->serial) ? tRing : HsmTraceRing( trace );
+    if (ring) {
+        // only this thread writes the ring: no need for anything but publishing the new head.
+        const long head= ring->head;
+        hsm_trace_record_t* record= ring->records + (head & ring->mask);
+        const hsm_state typed= state ? state : hsm->current;
+        const hsm_chart_t* chart= typed ? typed->chart : NULL;
+        record->time= HsmTraceClock();
+        record->machine= HsmTraceMachineId( hsm );
+        record->state= (hsm_uint16)( (state && state->chart) ? state->index : HSM_TRACE_NO_STATE );
+        record->event_type= (unsigned char)( (evt && chart && chart->event_type) ? chart->event_type( evt ) : HSM_TRACE_NO_TYPE );
+        record->kind= (unsigned char) kind;
+        HsmAtomicStore( &ring->head, (long)((unsigned long) head + 1) );
+    }
+}
+
+//---------------------------------------------------------------------------
+// Callbacks
+//---------------------------------------------------------------------------
+static void HsmTraceInit( hsm_status status, void * user_data )
+{
+    HsmTraceWrite( (hsm_trace_t*) user_data, HSM_TRACE_INIT, status->hsm, status->state, status->evt );
+}
+
+static void HsmTraceEntered( hsm_status status, void * user_data )
+{
+    HsmTraceWrite( (hsm_trace_t*) user_data, HSM_TRACE_ENTER, status->hsm, status->state, status->evt );
+}
+
+static void HsmTraceExiting( hsm_status status, void * user_data )
+{
+    HsmTraceWrite( (hsm_trace_t*) user_data, HSM_TRACE_EXIT, status->hsm, status->state, status->evt );
+}
+
+static void HsmTraceUnhandled( hsm_status status, void * user_data )
+{
+    HsmTraceWrite( (hsm_trace_t*) user_data, HSM_TRACE_UNHANDLED, status->hsm, NULL, status->evt );
+}
+
+static void HsmTraceHandled( hsm_status status, hsm_state next_state, void * user_data )
+{
+    const int kind= next_state == HsmStateHandled() ? HSM_TRACE_HANDLED : HSM_TRACE_TRANSITION;
+    HsmTraceWrite( (hsm_trace_t*) user_data, kind, status->hsm, status->state, status->evt );
+}
+
+//---------------------------------------------------------------------------
+// Interface
+//---------------------------------------------------------------------------
+hsm_trace_t* HsmTraceCreate( int records )
+{
+    hsm_trace_t* trace= (hsm_trace_t*) calloc( 1, sizeof(hsm_trace_t) );
+    if (trace) {
+        int size= 64;
+        while (size < records) {
+            size*= 2;
+        }
+        trace->size= size;
+        trace->serial= HsmAtomicAdd( &gTraceSerial, 1 ) + 1;
+        trace->info.user_data= trace;
+        trace->info.on_init= HsmTraceInit;
+        trace->info.on_entered= HsmTraceEntered;
+        trace->info.on_exiting= HsmTraceExiting;
+        trace->info.on_unhandled_event= HsmTraceUnhandled;
+        trace->info.on_handled_event= HsmTraceHandled;
+        trace->start= HsmTraceClock();
+        trace->start_ns= HsmTraceNanoseconds();
+    }
+    return trace;
+}
+
+//---------------------------------------------------------------------------
+void HsmTraceDestroy( hsm_trace_t* trace )
+{
+    if (trace) {
+        hsm_trace_ring_t* ring= trace->rings;
+        while (ring) {
+            hsm_trace_ring_t* next= ring->next;
+            free( ring->records );
+            free( ring );
+            ring= next;
+        }
+        if (tSerial == trace->serial) {
+            tSerial= 0;
+            tRing= NULL;
+        }
+        free( trace );
+    }
+}
+
+//---------------------------------------------------------------------------
+const hsm_info_t* HsmTraceInfo( hsm_trace_t* trace )
+{
+    return trace ? &trace->info : NULL;
+}
+
+//---------------------------------------------------------------------------
+void HsmTraceChart( hsm_trace_t* trace, const hsm_chart_t* chart )
+{
+    if (trace) {
+        trace->chart= chart;
+    }
+}
+
+//---------------------------------------------------------------------------
+hsm_bool HsmTraceDump( hsm_trace_t* trace, const char * path )
+{
+    hsm_bool okay= HSM_FALSE;
+    FILE* file= (trace && path) ? fopen( path, "wb" ) : NULL;
+    hsm_trace_record_t* copy= trace ? (hsm_trace_record_t*) malloc( trace->size * sizeof(hsm_trace_record_t) ) : NULL;
+    if (file && copy) {
+        hsm_trace_header_t header;
+        hsm_trace_ring_t* rings= (hsm_trace_ring_t*) HsmAtomicLoadPtr( &trace->rings );
+        hsm_trace_ring_t* ring;
+        hsm_uint64 now, now_ns;
+        unsigned int i;
+
+        // calibrate the clock against nanoseconds, over the life of the trace.
+        do {
+            now= HsmTraceClock();
+            now_ns= HsmTraceNanoseconds();
+        }
+        while (now_ns - trace->start_ns < HSM_TRACE_CALIBRATE_NS);
+
+        memset( &header, 0, sizeof(header) );
+        memcpy( header.magic, HSM_TRACE_MAGIC, sizeof(header.magic) );
+        header.version= HSM_TRACE_VERSION;
+        header.record_size= sizeof(hsm_trace_record_t);
+        header.ticks_per_ns= (double)(now - trace->start) / (double)(now_ns - trace->start_ns);
+        header.start= trace->start;
+        header.names= trace->chart ? trace->chart->count : 0;
+        for (ring= rings; ring; ring= ring->next) {
+            ++header.threads;
+        }
+        okay= fwrite( &header, sizeof(header), 1, file ) == 1;
+
+        for (i=0; okay && i<header.names; ++i) {
+            const char * name= trace->chart->names[i] ? trace->chart->names[i] : "";
+            const hsm_uint16 len= (hsm_uint16) strlen( name );
+            okay= fwrite( &len, sizeof(len), 1, file ) == 1 && fwrite( name, 1, len, file ) == len;
+        }
+
+        for (ring= rings; okay && ring; ring= ring->next) {
+            const unsigned long size= (unsigned long) trace->size;
+            const unsigned long end= (unsigned long) HsmAtomicLoad( &ring->head );
+            unsigned long count= end < size ? end : size;
+            const unsigned long first= end - count;
+            unsigned long more, lost, r;
+            unsigned int written;
+            for (r=0; r<count; ++r) {
+                copy[r]= ring->records[ (first + r) & ring->mask ];
+            }
+            // the owner kept writing while we copied: drop whatever it overwrote.
+            // it may also be partway through the next record, which doesn't show in head yet: count that one too.
+            more= (unsigned long) HsmAtomicLoad( &ring->head ) - end + 1;
+            lost= more > size - count ? more - (size - count) : 0;
+            lost= lost < count ? lost : count;
+            written= (unsigned int)(count - lost);
+            okay= fwrite( &written, sizeof(written), 1, file ) == 1 &&
+                  fwrite( copy + lost, sizeof(hsm_trace_record_t), written, file ) == written;
+        }
+    }
+    if (file) {
+        okay= (fclose( file ) == 0) && okay;
+    }
+    free( copy );
+    return okay;
+}
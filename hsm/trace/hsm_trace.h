@@ -0,0 +1,181 @@
+/**
+ * @file hsm_trace.h
+ *
+ * Binary tracing: fixed size records, written to per thread rings, dumped to a file for hsmtrace to decode.
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#pragma once
+#ifndef __HSM_TRACE_H__
+#define __HSM_TRACE_H__
+
+// #include <hsm/hsm_machine.h>
+// #include <hsm/hsm_chart.h>
+
+typedef struct hsm_trace_rec hsm_trace_t;
+typedef struct hsm_trace_record_rec hsm_trace_record_t;
+typedef struct hsm_trace_header_rec hsm_trace_header_t;
+
+/**
+ * What a record records.
+ */
+typedef enum hsm_trace_kind
+{
+    HSM_TRACE_ENTER=1,      ///< state entered
+    HSM_TRACE_EXIT,         ///< state about to exit
+    HSM_TRACE_INIT,         ///< state about to take its initial transition
+    HSM_TRACE_HANDLED,      ///< state handled an event
+    HSM_TRACE_TRANSITION,   ///< state handled an event, and asked for a transition
+    HSM_TRACE_UNHANDLED,    ///< no state handled an event
+    HSM_TRACE_USER=0x80     ///< first kind free for HsmTraceWrite()
+}
+hsm_trace_kind_t;
+
+/**
+ * State index of states which aren't part of a compiled chart.
+ */
+#define HSM_TRACE_NO_STATE 0xffff
+
+/**
+ * Event type of events without one: the machine's chart has no hsm_chart_rec::event_type.
+ */
+#define HSM_TRACE_NO_TYPE 0xff
+
+//---------------------------------------------------------------------------
+/**
+ * One trace record: 16 bytes, in the dump exactly as in memory.
+ */
+struct hsm_trace_record_rec
+{
+    /**
+     * HsmTraceClock() when the record was written.
+     */
+    hsm_uint64 time;
+
+    /**
+     * id of the machine, see HsmTraceMachineId().
+     */
+    unsigned int machine;
+
+    /**
+     * hsm_state_rec::index of the state, or #HSM_TRACE_NO_STATE.
+     */
+    hsm_uint16 state;
+
+    /**
+     * the event's type, via hsm_chart_rec::event_type, or #HSM_TRACE_NO_TYPE.
+     */
+    unsigned char event_type;
+
+    /**
+     * a #hsm_trace_kind_t.
+     */
+    unsigned char kind;
+};
+
+/**
+ * Start of a dump. Followed by:
+ * @li names: for each, a 16 bit length then that many bytes, no terminator.
+ * @li threads: for each, a 32 bit count then that many records, oldest first.
+ */
+struct hsm_trace_header_rec
+{
+    /**
+     * #HSM_TRACE_MAGIC
+     */
+    char magic[8];
+
+    /**
+     * #HSM_TRACE_VERSION
+     */
+    unsigned int version;
+
+    /**
+     * sizeof( hsm_trace_record_t )
+     */
+    unsigned int record_size;
+
+    /**
+     * clock ticks per nanosecond.
+     */
+    double ticks_per_ns;
+
+    /**
+     * clock reading when tracing started.
+     */
+    hsm_uint64 start;
+
+    /**
+     * number of state names, indexed by hsm_trace_record_rec::state.
+     */
+    unsigned int names;
+
+    /**
+     * number of threads which wrote records.
+     */
+    unsigned int threads;
+};
+
+#define HSM_TRACE_MAGIC "HSMTRACE"
+#define HSM_TRACE_VERSION 1
+
+/**
+ * Start tracing.
+ *
+ * @param records Records each thread's ring holds; rounded up to a power of two. Older records are overwritten.
+ * @return The new trace, or NULL if out of memory.
+ */
+hsm_trace_t* HsmTraceCreate( int records );
+
+/**
+ * Stop tracing, and free the trace. No machine may still be using its callbacks.
+ */
+void HsmTraceDestroy( hsm_trace_t* trace );
+
+/**
+ * Callbacks which write records; install with HsmSetMachineInfo() or HsmSetInfoCallbacks().
+ */
+const hsm_info_t* HsmTraceInfo( hsm_trace_t* trace );
+
+/**
+ * Name the states of a compiled chart in dumps.
+ * The chart must outlive the trace, or at least the last dump.
+ */
+void HsmTraceChart( hsm_trace_t* trace, const hsm_chart_t* chart );
+
+/**
+ * Write a record on the calling thread's ring.
+ * The first record a thread writes allocates its ring; after that, writing is a handful of stores.
+ *
+ * @param trace The trace.
+ * @param kind A #hsm_trace_kind_t, or a user kind.
+ * @param hsm The machine; its id comes from HsmTraceMachineId().
+ * @param state The state, or NULL.
+ * @param evt The event, or NULL.
+ */
+void HsmTraceWrite( hsm_trace_t* trace, int kind, const hsm_machine hsm, hsm_state state, hsm_event evt );
+
+/**
+ * The id records use for a machine: derived from its address.
+ */
+#define HsmTraceMachineId( hsm ) ((unsigned int)((size_t)(hsm) >> 3))
+
+/**
+ * The trace's clock: a cycle counter where there is one, otherwise monotonic nanoseconds.
+ */
+hsm_uint64 HsmTraceClock();
+
+/**
+ * Write every ring to a file, for hsmtrace to decode.
+ * Threads can keep tracing while dumping; records they overwrite during the dump are left out.
+ *
+ * @return #HSM_FALSE if the file couldn't be written.
+ */
+hsm_bool HsmTraceDump( hsm_trace_t* trace, const char * path );
+
+#endif // #ifndef __HSM_TRACE_H__
@@ -8,6 +8,7 @@
  * See License.txt for complete information.
  */
 #include <hsm/hsm_machine.h>    // the state machine
+#include <hsm/hsm_region.h>     // parallel states
 #include "watch.h"
 #include "platform.h"
 
@@ -48,136 +49,29 @@ struct watch_context
     Watch * watch;
 };
 
-//---------------------------------------------------------------------------
-typedef struct hsm_region_rec hsm_region_t;
-typedef struct hsm_parallel_rec hsm_parallel_t;
-typedef struct hsm_active_rec hsm_active_t;
-/**
- * an active region.
- * note, multiple instances of the same region running at the same time
- * will need their own copies of this structure so they don't stomp each other's current state.
- */
-struct hsm_active_rec
-{
-    hsm_context_t ctx;
-    hsm_context_machine_t hsm;
-    struct hsm_active_rec* next;
-};
-
-
-/**
- * 
- */
-struct hsm_region_rec
-{
-    struct hsm_state_rec state;
-    hsm_region_t * next;
-    // TODO generate the actives dynamically; one per region 
-    struct hsm_active_rec active;
-};
-
-/**
- * a group of regions is modeled as a state, 
- * with this structure as the context for that state
- */
-struct hsm_parallel_rec
-{
-    hsm_region_t* first;
-};
-
-
-hsm_state HsmParallelEvent( hsm_status status );
-hsm_context HsmParallelEnter( hsm_parallel_t* parallel, hsm_status status );
-void HsmParallelExit( hsm_status status );
-void HsmExit( hsm_machine hsm, hsm_event cause );
-
-#define HSM_PARALLEL( Parent ) \
-        hsm_context Parent##Parallel##Enter( hsm_status status ); \
-        _HSM_STATE( Parent##Parallel, Parent, HsmParallelEvent, Parent##Parallel##Enter, HsmParallelExit, 0 ); \
-        static hsm_parallel_t Parent##parallel= { 0 }; \
-        hsm_context Parent##Parallel##Enter( hsm_status status ) { \
-            return HsmParallelEnter( &(Parent##parallel), status ); \
-        }
-
-// FIX? if Parent() took at poiner of child, we could ignore it for all but parallels
-// which would build an actual tree? then maybe we wouldnt need both parallel *and* region, just parallel
-// we could have user code pass around raw fnc ptrs instead of the state descriptors
-// going to wait till builder interface, and see how that works out there
-#define HSM_REGION( State, Parent, Initial ) \
-        hsm_state State##Lookup##Initial(); \
-        hsm_state State##Lookup##0() { return 0; } \
-        hsm_state State() { \
-            static struct hsm_region_rec myinfo= { 0 }; \
-            if (!myinfo.state.name) { \
-                myinfo.state.name= #State; \
-                myinfo.state.process= 0; \
-                myinfo.state.enter= 0; \
-                myinfo.state.exit= 0; \
-                myinfo.state.initial= State##Lookup##Initial(); \
-                myinfo.state.parent= Parent##Parallel(); \
-                myinfo.state.depth= myinfo.state.parent->depth+1; \
-                /*link in this region to the parallel*/ \
-                myinfo.next= Parent##parallel.first;  \
-                Parent##parallel.first= myinfo.next; \
-            } \
-            return &(myinfo.state); \
-        }
-
 //---------------------------------------------------------------------------
 // declare the states just like watch1_enum_events.
 //
 HSM_STATE_ENTER( ActiveState3, HsmTopState, ActiveState3Parallel );
 
-    // parallel declares a container
-    // the container is just a special kind of state, with particular functions
-    HSM_PARALLEL( ActiveState3 );
+    // a parallel state is a container for regions, which all run at the same time.
+    // each region is named along with the next region of the same parallel state.
+    HSM_PARALLEL( ActiveState3Parallel, ActiveState3, DefaultRegion3 );
 
-        HSM_REGION( DefaultRegion3, ActiveState3, StoppedState3 );
+        HSM_REGION( DefaultRegion3, ActiveState3Parallel, StoppedState3, AutoDestructRegion3 );
             HSM_STATE( StoppedState3, DefaultRegion3, 0 );
             HSM_STATE( RunningState3, DefaultRegion3, 0 );
 
-        HSM_REGION( AutoDestructRegion3, ActiveState3, TimeBombState3 );
+        HSM_REGION( AutoDestructRegion3, ActiveState3Parallel, TimeBombState3, 0 );
             HSM_STATE( TimeBombState3, AutoDestructRegion3, 0 );
-        
-hsm_context HsmParallelEnter( hsm_parallel_t* parallel, hsm_status status )
-{
-    // when we enter->ctx is the context of the previous state
-    // in the real version we need to create an 'active' for every parallel
-    // walk our list of regions and send them startups
-    hsm_region_t *it;
-    for (it= parallel->first; it; it=it->next) {
-        HsmMachineWithContext( &(it->active.hsm), status->ctx );
-        HsmStart( &(it->active.hsm.core), it->state.initial );
-    }
-
-    // finally: return our allocated regions data as context
-    return &(parallel->first->active.ctx);
-}
 
-void HsmParallelExit( hsm_status status )
-{
-    hsm_active_t* it;
-    for (it= ((hsm_active_t*)status->ctx); it; it=it->next) {
-        // hsm->current is *us*, we exit all of the substates until they're unrolled back to the top
-        while (  it->hsm.core.current != status->hsm->current ) {
-            HsmExit( &(it->hsm.core), status->evt );
-        }
-    }
-}
-
-hsm_state HsmParallelEvent( hsm_status status )
+//---------------------------------------------------------------------------
+// the parallel state hears whatever none of its regions handle.
+//
+hsm_state ActiveState3ParallelEvent( hsm_status status )
 {
-    hsm_active_t* it;
-    hsm_bool any_handled= 0;
-    // all the regions get to try the event
-    for (it= ((hsm_active_t*)status->ctx); it; it=it->next) {
-        hsm_bool handled= HsmSignalEvent( &(it->hsm.core), status->evt );
-        any_handled|= handled;
-    }
-    // if anyone handled then say so
-    return any_handled ? HsmStateHandled() :  0;
+    return NULL;
 }
-            
 
 //---------------------------------------------------------------------------
 // and here's that callback now...
@@ -299,6 +193,11 @@ int watch3region_events( int argc, char* argv[] )
     WatchContext ctx= { 0, 0, &watch };
     hsm_context_machine_t machine;
     hsm_machine hsm= HsmMachineWithContext( &machine, &ctx.ctx );
+    // one instance for each of the parallel state's two regions
+    hsm_region_t regions[2];
+    hsm_region_pool_t pool;
+    HsmRegionPool( &pool, regions, 2 );
+    HsmMachineRegions( hsm, &pool );
     
     printf( "Stop Watch Sample with State Events.\n"
         "Keys:\n"
@@ -0,0 +1,130 @@
+/**
+ * @file active_test.c
+ *
+ * Machines with an active set track their configuration with bits.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "test.h"
+#include <hsm/hsm_active.h>
+#include <hsm/hsm_chart.h>
+#include <stdio.h>
+
+//---------------------------------------------------------------------------
+// 'a' and 'b' swap the leaf states, 'x' moves to a child the chart doesnt include.
+HSM_STATE( A0, HsmTopState, A1 );
+    HSM_STATE( A1, A0, A2 );
+        HSM_STATE( A2, A1, 0 );
+        HSM_STATE( A3, A1, 0 );
+    HSM_STATE( A4, A0, 0 );
+    HSM_STATE( AOutside, A0, 0 );
+
+//---------------------------------------------------------------------------
+hsm_state A0Event( hsm_status status )
+{
+    return status->evt->ch == 'x' ? AOutside() : NULL;
+}
+
+hsm_state A1Event( hsm_status status )
+{
+    return status->evt->ch == 'c' ? A4() : NULL;
+}
+
+hsm_state A2Event( hsm_status status )
+{
+    return status->evt->ch == 'b' ? A3() : NULL;
+}
+
+hsm_state A3Event( hsm_status status )
+{
+    return status->evt->ch == 'a' ? A2() : NULL;
+}
+
+hsm_state A4Event( hsm_status status )
+{
+    return status->evt->ch == 'q' ? HsmStateFinal() : NULL;
+}
+
+hsm_state AOutsideEvent( hsm_status status )
+{
+    return status->evt->ch == 'q' ? HsmStateFinal() : NULL;
+}
+
+//---------------------------------------------------------------------------
+/**
+ * The bits, the walk, and the expectation all have to agree.
+ */
+static hsm_bool ActiveIs( hsm_machine hsm, hsm_machine plain, const hsm_chart_t* chart, const char * expect )
+{
+    hsm_bool res= HSM_TRUE;
+    int i;
+    for (i=0; i<chart->count; ++i) {
+        hsm_state state= chart->states[i];
+        const hsm_bool want= expect[ state->name[1]-'0' ] == '1';
+        if (HsmIsInState( hsm, state ) != want || HsmIsInState( plain, state ) != want) {
+            printf("%s expected %d\n", state->name, want );
+            res= HSM_FALSE;
+        }
+    }
+    return res;
+}
+
+//---------------------------------------------------------------------------
+static void ActiveSignal( hsm_machine* machines, int count, char ch )
+{
+    CharEvent evt;
+    int i;
+    evt.ch= ch;
+    for (i=0; i<count; ++i) {
+        HsmSignalEvent( machines[i], &evt );
+    }
+}
+
+//---------------------------------------------------------------------------
+int ActiveTest()
+{
+    hsm_bool res= HSM_FALSE;
+    hsm_machine_t machine, plain;
+    hsm_machine machines[2];
+    hsm_active_t active;
+    hsm_uint64 bits[ HSM_ACTIVE_WORDS(5) ];
+    hsm_chart_t chart;
+    hsm_state states[5];
+    hsm_bool results[2];
+    states[0]= A0(); states[1]= A1(); states[2]= A2(); states[3]= A3(); states[4]= A4();
+    machines[0]= HsmMachine( &machine );
+    machines[1]= HsmMachine( &plain );
+
+    if (HsmChartCompile( &chart, states, 5 ) &&
+        HsmMachineActive( machines[0], &active, &chart, bits ) && 
+        HsmStart( machines[0], A0() ) && HsmStart( machines[1], A0() )) 
+    {
+        // names are "A<digit>"; expectations are per digit.
+        res= ActiveIs( machines[0], machines[1], &chart, "11100" );
+        ActiveSignal( machines, 2, 'b' );
+        res= res && ActiveIs( machines[0], machines[1], &chart, "11010" );
+        res= res && HsmCountInState( machines, 2, A3(), results ) == 2 && results[0] && results[1];
+        res= res && HsmCountInState( machines, 2, A2(), NULL ) == 0;
+        ActiveSignal( machines, 2, 'c' );
+        res= res && ActiveIs( machines[0], machines[1], &chart, "10001" );
+        // a state outside the chart: the walk handles it, and its parent keeps its bit
+        ActiveSignal( machines, 2, 'x' );
+        res= res && ActiveIs( machines[0], machines[1], &chart, "10000" );
+        res= res && HsmIsInState( machines[0], AOutside() ) && HsmIsInState( machines[1], AOutside() );
+        // start over, this time finishing from inside the chart:
+        // final doesnt exit, but the machine isnt in any state afterwards.
+        machines[0]= HsmMachine( &machine );
+        machines[1]= HsmMachine( &plain );
+        res= res && HsmMachineActive( machines[0], &active, &chart, bits ) &&
+             HsmStart( machines[0], A0() ) && HsmStart( machines[1], A0() );
+        ActiveSignal( machines, 2, 'c' );
+        ActiveSignal( machines, 2, 'q' );
+        res= res && ActiveIs( machines[0], machines[1], &chart, "00000" ) && !HsmIsRunning( machines[0] );
+    }
+    HsmChartRelease( &chart );
+    return res;
+}
@@ -0,0 +1,59 @@
+/**
+ * @file batch_test.c
+ *
+ * HsmSignalEvents() reports each event's result, and stops once the machine is finished.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "test.h"
+#include <stdio.h>
+
+//---------------------------------------------------------------------------
+HSM_STATE( B0, HsmTopState, BA );
+    HSM_STATE( BA, B0, 0 );
+    HSM_STATE( BB, B0, 0 );
+
+hsm_state B0Event( hsm_status status )
+{
+    switch (status->evt->ch) {
+        case 'n': return HsmStateHandled();
+        case 'q': return HsmStateFinal();
+    }
+    return NULL;
+}
+
+hsm_state BAEvent( hsm_status status )
+{
+    return status->evt->ch == 'x' ? BB() : NULL;
+}
+
+hsm_state BBEvent( hsm_status status )
+{
+    return NULL;
+}
+
+//---------------------------------------------------------------------------
+int BatchTest()
+{
+    hsm_bool res= HSM_FALSE;
+    static CharEvent n= { 'n' }, u= { 'u' }, x= { 'x' }, q= { 'q' };
+    const hsm_event events[]= { &n, &u, &x, &q, &n };
+    hsm_bool results[]= { -1, -1, -1, -1, -1 };
+    hsm_machine_t machine;
+    hsm_machine hsm= HsmMachine( &machine );
+    if (HsmStart( hsm, B0() )) {
+        const int processed= HsmSignalEvents( hsm, events, sizeof(events)/sizeof(hsm_event), results );
+        res= (processed == 4) &&
+             results[0] && !results[1] && results[2] && results[3] && (results[4] == -1) &&
+             (hsm->current == HsmStateFinal());
+        if (!res) {
+            printf("processed %d events: %d %d %d %d %d\n", processed,
+                results[0], results[1], results[2], results[3], results[4] );
+        }
+    }
+    return res;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file builder_ids_cpp.cpp
+ *
+ * Builder state ids, computed by the compiler via hsm_builder.hpp.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include <hsm/builder/hsm_builder.hpp>
+
+extern "C" {
+#include "test.h"
+}
+
+//---------------------------------------------------------------------------
+namespace {
+
+// the ids really are compile time constants.
+static_assert( HSM_ID( "Top" ) == HSM_ID( "top" ), "names ignore case" );
+static_assert( HSM_ID( "Top" ) != HSM_ID( "Go" ), "different names, different ids" );
+static_assert( hsm::Hash32( "" ) == 0x811c9dc5u, "the fnv offset basis" );
+
+hsm_bool IsGo( hsm_status status )
+{
+    return status->evt->ch == 'g';
+}
+
+hsm_bool IsStop( hsm_status status )
+{
+    return status->evt->ch == 's';
+}
+
+} // namespace
+
+//---------------------------------------------------------------------------
+extern "C" int BuilderIdsCppTest()
+{
+    hsm_bool okay= HSM_FALSE;
+    if (hsmStartup()) {
+        const char * names[]= { "Top", "idle", "GoingFast", "x_1" };
+        hsm_machine_t machine;
+        hsm_machine hsm= HsmMachine( &machine );
+        CharEvent go= { 'g' }, stop= { 's' };
+        size_t i;
+
+        // the same ids the builder hashes at run time
+        okay= HSM_TRUE;
+        for (i=0; i<sizeof(names)/sizeof(names[0]); ++i) {
+            okay= okay && hsm::Id( names[i] ) == hsmState( names[i] );
+        }
+
+        hsmBegin( "Top", 0 );
+        {
+            hsmBegin( "Idle", 0 );
+            {
+                hsmIf( IsGo );
+                hsmGotoId( HSM_ID( "GoingFast" ) ); // not yet begun.
+            }
+            hsmEnd();
+            hsmBegin( "GoingFast", 0 );
+            {
+                hsmIf( IsStop );
+                hsmGotoId( HSM_ID( "idle" ) );
+            }
+            hsmEnd();
+        }
+        hsmEnd();
+
+        okay= okay &&
+              hsmResolveId( HSM_ID( "goingfast" ) ) == hsmResolve( "GoingFast" ) &&
+              hsmStartId( hsm, HSM_ID( "Top" ) ) &&
+              hsm->current == hsmResolveId( HSM_ID( "Idle" ) );
+        if (okay) {
+            HsmSignalEvent( hsm, &go );
+            okay= hsm->current == hsmResolveId( HSM_ID( "GoingFast" ) );
+        }
+        if (okay) {
+            HsmSignalEvent( hsm, &stop );
+            okay= hsm->current == hsmResolveId( HSM_ID( "Idle" ) );
+        }
+        hsmShutdown();
+    }
+    return okay;
+}
@@ -0,0 +1,119 @@
+/**
+ * @file defer_test.c
+ *
+ * Deferred events, replayed after each transition.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "test.h"
+#include <hsm/hsm_defer.h>
+#include <stdio.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+// busy defers 'd','q','t' until 'x' makes the machine ready;
+// ready handles 'd', defers 'q', and 'y' or 't' moves it on to done, which handles 'q'.
+HSM_STATE( DRoot, HsmTopState, DBusy );
+    HSM_STATE( DBusy, DRoot, 0 );
+    HSM_STATE( DReady, DRoot, 0 );
+    HSM_STATE( DDone, DRoot, 0 );
+
+// every event a state handled, rather than deferred.
+static char gHandled[64];
+
+static hsm_state Handled( hsm_status status )
+{
+    const char ch[2]= { status->evt->ch, 0 };
+    strcat( gHandled, ch );
+    return HsmStateHandled();
+}
+
+hsm_state DRootEvent( hsm_status status )
+{
+    return NULL;
+}
+
+hsm_state DBusyEvent( hsm_status status )
+{
+    hsm_state ret= NULL;
+    switch (status->evt->ch) {
+        case 'd': case 'q': case 't': ret= HsmDefer( status, sizeof(CharEvent) ); break;
+        case 'x': ret= DReady(); break;
+    }
+    return ret;
+}
+
+hsm_state DReadyEvent( hsm_status status )
+{
+    hsm_state ret= NULL;
+    switch (status->evt->ch) {
+        case 'd': ret= Handled( status ); break;
+        case 'q': ret= HsmDefer( status, sizeof(CharEvent) ); break;
+        case 't': case 'y': ret= DDone(); break;
+    }
+    return ret;
+}
+
+hsm_state DDoneEvent( hsm_status status )
+{
+    return status->evt->ch == 'q' ? Handled( status ) : NULL;
+}
+
+//---------------------------------------------------------------------------
+static hsm_bool DeferSends( hsm_machine hsm, const char * events, const char * expect, int deferred )
+{
+    hsm_bool res;
+    gHandled[0]= 0;
+    for (; *events; ++events) {
+        // the event goes out of scope right away: deferring has to copy it.
+        CharEvent evt;
+        evt.ch= *events;
+        HsmSignalEvent( hsm, &evt );
+        evt.ch= '?';
+    }
+    res= (strcmp( gHandled, expect ) == 0) && (HsmDeferredEvents( hsm ) == deferred);
+    if (!res) {
+        printf("handled '%s' expected '%s', %d deferred\n", gHandled, expect, HsmDeferredEvents( hsm ) );
+    }
+    return res;
+}
+
+//---------------------------------------------------------------------------
+static hsm_machine DeferStart( hsm_machine_t* machine, hsm_defer_t* defer, hsm_defer_slot_t* slots, int capacity )
+{
+    hsm_machine hsm= HsmMachine( machine );
+    return (HsmMachineDefer( hsm, defer, slots, capacity ) && HsmStart( hsm, DRoot() )) ? hsm : NULL;
+}
+
+//---------------------------------------------------------------------------
+int DeferTest()
+{
+    hsm_bool res;
+    hsm_machine_t one, two, three;
+    hsm_defer_t defer;
+    hsm_defer_slot_t slots[4];
+    hsm_machine hsm;
+    CharEvent extra= { 'd' };
+
+    res= (hsm= DeferStart( &one, &defer, slots, 4 )) &&
+        DeferSends( hsm, "dqd", "", 3 ) &&
+        // replayed in order; ready defers 'q' again
+        DeferSends( hsm, "x", "dd", 1 ) &&
+        DeferSends( hsm, "y", "q", 0 );
+
+    // a replayed event can itself transition: the events after it see the new state,
+    // and those deferred again get another chance.
+    res= res && (hsm= DeferStart( &two, &defer, slots, 4 )) &&
+        DeferSends( hsm, "qtd", "", 3 ) &&
+        DeferSends( hsm, "x", "q", 0 ) && HsmIsInState( hsm, DDone() );
+
+    // a full queue leaves events unhandled
+    res= res && (hsm= DeferStart( &three, &defer, slots, 4 )) &&
+        DeferSends( hsm, "dddd", "", 4 ) &&
+        !HsmSignalEvent( hsm, &extra ) && (HsmDeferredEvents( hsm ) == 4);
+    return res;
+}
@@ -0,0 +1,206 @@
+/**
+ * @file history_test.c
+ *
+ * Shallow and deep history pseudo-states, declared via macros and via the builder.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "test.h"
+#include <hsm/hsm_chart.h>
+#include <hsm/hsm_history.h>
+#include <hsm/builder/hsm_builder.h>
+#include <stdio.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+// the root routes everything:
+// 's','d' go to the shallow and deep histories; 'x' returns to idle;
+// 'p','q' jump to the second leaf of the second child of each owner.
+HSM_STATE( HRoot, HsmTopState, HIdle );
+    EMPTY_STATE( HIdle, HRoot, 0 );
+    EMPTY_STATE( HShallowOwner, HRoot, HShallowA );
+        EMPTY_STATE( HShallowA, HShallowOwner, HShallowA1 );
+            EMPTY_STATE( HShallowA1, HShallowA, 0 );
+        EMPTY_STATE( HShallowB, HShallowOwner, HShallowB1 );
+            EMPTY_STATE( HShallowB1, HShallowB, 0 );
+            EMPTY_STATE( HShallowB2, HShallowB, 0 );
+    EMPTY_STATE( HDeepOwner, HRoot, HDeepA );
+        EMPTY_STATE( HDeepA, HDeepOwner, HDeepA1 );
+            EMPTY_STATE( HDeepA1, HDeepA, 0 );
+        EMPTY_STATE( HDeepB, HDeepOwner, HDeepB1 );
+            EMPTY_STATE( HDeepB1, HDeepB, 0 );
+            EMPTY_STATE( HDeepB2, HDeepB, 0 );
+HSM_HISTORY( HShallow, HShallowOwner, 0 );
+HSM_DEEP_HISTORY( HDeep, HDeepOwner, HDeepA );
+
+hsm_state HRootEvent( hsm_status status )
+{
+    hsm_state ret= NULL;
+    switch (status->evt->ch) {
+        case 's': ret= HShallow(); break;
+        case 'd': ret= HDeep(); break;
+        case 'x': ret= HIdle(); break;
+        case 'p': ret= HShallowB2(); break;
+        case 'q': ret= HDeepB2(); break;
+    }
+    return ret;
+}
+
+//---------------------------------------------------------------------------
+// every state entered, by first letters: "HDeepB2" records as "DB2"
+static char gEntered[256];
+
+static void HistoryEntered( hsm_status status, void * user_data )
+{
+    strcat( gEntered, status->state->name+1 );
+    strcat( gEntered, " " );
+}
+
+//---------------------------------------------------------------------------
+/**
+ * Send a string of events, and compare the states entered along the way.
+ */
+static hsm_bool HistorySends( hsm_machine hsm, const char * events, const char * expect )
+{
+    hsm_bool res;
+    gEntered[0]= 0;
+    for (; *events; ++events) {
+        CharEvent evt;
+        evt.ch= *events;
+        HsmSignalEvent( hsm, &evt );
+    }
+    res= strcmp( gEntered, expect ) == 0;
+    if (!res) {
+        printf("entered '%s' expected '%s'\n", gEntered, expect );
+    }
+    return res;
+}
+
+//---------------------------------------------------------------------------
+static hsm_bool HistorySequence( hsm_machine hsm, hsm_bool remembers )
+{
+    return 
+        // nothing recorded yet: shallow goes to its parent's initial state, deep to its fallback.
+        HistorySends( hsm, "s", "ShallowOwner ShallowA ShallowA1 " ) &&
+        HistorySends( hsm, "px", "ShallowOwner ShallowB ShallowB2 Idle " ) &&
+        HistorySends( hsm, "d", "DeepOwner DeepA DeepA1 " ) &&
+        HistorySends( hsm, "qx", "DeepOwner DeepB DeepB2 Idle " ) &&
+        // shallow history returns to the child, and runs its initial state;
+        // deep history goes straight back to the leaf.
+        (remembers ? 
+            HistorySends( hsm, "s", "ShallowOwner ShallowB ShallowB1 " ) &&
+            HistorySends( hsm, "xd", "Idle DeepOwner DeepB DeepB2 " ) :
+            HistorySends( hsm, "s", "ShallowOwner ShallowA ShallowA1 " ) &&
+            HistorySends( hsm, "xd", "Idle DeepOwner DeepA DeepA1 " )) &&
+        HistorySends( hsm, "x", "Idle " );
+}
+
+//---------------------------------------------------------------------------
+int HistoryTest()
+{
+    hsm_bool res= HSM_TRUE;
+    hsm_info_t info= { 0 };
+    hsm_state states[2];
+    hsm_state last[2];
+    hsm_chart_t chart;
+    int pass;
+    info.on_entered= HistoryEntered;
+    states[0]= HShallow();
+    states[1]= HDeep();
+
+    // walking the tree, then compiled, then without a history table
+    for (pass=0; res && pass<3; ++pass) {
+        hsm_machine_t machine;
+        hsm_history_t history;
+        hsm_machine hsm= HsmMachine( &machine );
+        HsmSetMachineInfo( hsm, &info );
+        if (pass == 1) {
+            hsm_state all[]= { HRoot(), HIdle(), 
+                HShallowOwner(), HShallowA(), HShallowA1(), HShallowB(), HShallowB1(), HShallowB2(),
+                HDeepOwner(), HDeepA(), HDeepA1(), HDeepB(), HDeepB1(), HDeepB2() };
+            res= HsmChartCompile( &chart, all, sizeof(all)/sizeof(all[0]) );
+        }
+        if (pass < 2) {
+            res= res && HsmMachineHistory( hsm, &history, states, last, 2 );
+        }
+        gEntered[0]= 0;
+        res= res && HsmStart( hsm, HRoot() ) && (strcmp( gEntered, "Root Idle " ) == 0);
+        res= res && HistorySequence( hsm, pass < 2 );
+        if (pass == 1) {
+            HsmChartRelease( &chart );
+        }
+    }
+    return res;
+}
+
+//---------------------------------------------------------------------------
+hsm_bool MatchHistoryChar( hsm_status status, int user_data )
+{
+    return status->evt->ch == user_data;
+}
+
+#define IfChar( val ) hsmIfUD( (hsm_callback_guard_ud) MatchHistoryChar, (void*) val )
+
+//---------------------------------------------------------------------------
+int HistoryBuilderTest()
+{
+    hsm_bool res= HSM_FALSE;
+    hsm_machine_t machine;
+    hsm_history_t history;
+    hsm_state states[2], last[2];
+    hsm_machine hsm= HsmMachine( &machine );
+    hsm_info_t info= { 0 };
+    info.on_entered= HistoryEntered;
+    HsmSetMachineInfo( hsm, &info );
+
+    hsmStartup();
+    hsmBegin( "HRoot", 0 );
+    {
+        IfChar( 's' ); hsmGoto( "HShallow" );
+        IfChar( 'd' ); hsmGoto( "HDeep" );
+        IfChar( 'x' ); hsmGoto( "HIdle" );
+        IfChar( 'p' ); hsmGoto( "HShallowB2" );
+        IfChar( 'q' ); hsmGoto( "HDeepB2" );
+        hsmBegin( "HIdle", 0 ); hsmEnd();
+        hsmBegin( "HShallowOwner", 0 );
+        {
+            hsmHistory( "HShallow" );
+            hsmBegin( "HShallowA", 0 ); 
+                hsmBegin( "HShallowA1", 0 ); hsmEnd(); 
+            hsmEnd();
+            hsmBegin( "HShallowB", 0 ); 
+                hsmBegin( "HShallowB1", 0 ); hsmEnd(); 
+                hsmBegin( "HShallowB2", 0 ); hsmEnd(); 
+            hsmEnd();
+        }
+        hsmEnd();
+        hsmBegin( "HDeepOwner", 0 );
+        {
+            // the builder has no fallback: deep history starts at the owner's first child, same as the macros
+            hsmDeepHistory( "HDeep" );
+            hsmBegin( "HDeepA", 0 ); 
+                hsmBegin( "HDeepA1", 0 ); hsmEnd(); 
+            hsmEnd();
+            hsmBegin( "HDeepB", 0 ); 
+                hsmBegin( "HDeepB1", 0 ); hsmEnd(); 
+                hsmBegin( "HDeepB2", 0 ); hsmEnd(); 
+            hsmEnd();
+        }
+        hsmEnd();
+    }
+    hsmEnd();
+
+    states[0]= hsmResolve( "HShallow" );
+    states[1]= hsmResolve( "HDeep" );
+    if (states[0] && states[1] && HsmMachineHistory( hsm, &history, states, last, 2 )) {
+        gEntered[0]= 0;
+        res= HsmStart( hsm, hsmResolve( "HRoot" ) ) && (strcmp( gEntered, "Root Idle " ) == 0) && 
+             HistorySequence( hsm, HSM_TRUE );
+    }
+    hsmShutdown();
+    return res;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file info_test.c
+ *
+ * Per machine info callbacks replace the global ones, for that machine only.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "test.h"
+#include <stdio.h>
+
+//---------------------------------------------------------------------------
+HSM_STATE( N0, HsmTopState, NA );
+    HSM_STATE( NA, N0, 0 );
+    HSM_STATE( NB, N0, 0 );
+
+hsm_state N0Event( hsm_status status )
+{
+    return NULL;
+}
+
+hsm_state NAEvent( hsm_status status )
+{
+    return status->evt->ch == 'x' ? NB() : NULL;
+}
+
+hsm_state NBEvent( hsm_status status )
+{
+    return status->evt->ch == 'x' ? NA() : NULL;
+}
+
+//---------------------------------------------------------------------------
+static void CountEntered( hsm_status status, void * user_data )
+{
+    ++*(int*)user_data;
+}
+
+//---------------------------------------------------------------------------
+// records the state which handled the event, and where it asked to go.
+static hsm_state gHandler, gNext;
+
+static void RecordHandled( hsm_status status, hsm_state next_state, void * user_data )
+{
+    ++*(int*)user_data;
+    gHandler= status->state;
+    gNext= next_state;
+}
+
+//---------------------------------------------------------------------------
+int InfoTest()
+{
+    hsm_bool res;
+    int global=0, group=0;
+    hsm_info_t old_callbacks;
+    hsm_info_t global_info= { &global, 0, CountEntered };
+    hsm_info_t group_info= { &group, 0, CountEntered };
+    hsm_machine_t machines[3];
+    CharEvent x= { 'x' };
+    int i;
+
+    HsmSetInfoCallbacks( &global_info, &old_callbacks );
+    for (i=0; i<3; ++i) {
+        HsmMachine( &machines[i] );
+    }
+    // the first two share callbacks, the last uses the global ones.
+    HsmSetMachineInfo( &machines[0], &group_info );
+    HsmSetMachineInfo( &machines[1], &group_info );
+    for (i=0; i<3; ++i) {
+        HsmStart( &machines[i], N0() );   // enters N0, NA
+        HsmSignalEvent( &machines[i], &x ); // enters NB
+    }
+    res= (group == 6) && (global == 3);
+
+    // and the first can go back to the global callbacks.
+    res= res && (HsmSetMachineInfo( &machines[0], NULL ) == &group_info);
+    HsmSignalEvent( &machines[0], &x );
+    res= res && (group == 6) && (global == 4);
+
+    HsmSetInfoCallbacks( &old_callbacks, NULL );
+
+    // handled events report their handler; unhandled ones don't.
+    if (res) {
+        int handled=0;
+        CharEvent z= { 'z' };
+        hsm_info_t handled_info= { 0 };
+        handled_info.user_data= &handled;
+        handled_info.on_handled_event= RecordHandled;
+        HsmSetMachineInfo( &machines[2], &handled_info );
+        res= HsmSignalEvent( &machines[2], &x ) && (handled == 1) && (gHandler == NB()) && (gNext == NA()) &&
+             !HsmSignalEvent( &machines[2], &z ) && (handled == 1);
+    }
+    if (!res) {
+        printf("group %d, global %d\n", group, global );
+    }
+    return res;
+}
@@ -0,0 +1,107 @@
+/**
+ * @file interest_test.c
+ *
+ * Compiled charts with event types only call the states interested in an event.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "test.h"
+#include <hsm/hsm_chart.h>
+#include <stdio.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+// 'a' is type 0, 'b' type 1, and so on.
+#define CHAR_TYPE( ch ) ((ch) - 'a')
+
+static int gCalls[3];
+static hsm_context_t gOuter, gInner;
+
+HSM_STATE_ENTER( T0, HsmTopState, T1 );
+    HSM_STATE( T1, T0, T2 );
+        HSM_STATE_ENTER( T2, T1, 0 );
+
+//---------------------------------------------------------------------------
+static int CharType( hsm_event evt )
+{
+    return CHAR_TYPE( evt->ch );
+}
+
+//---------------------------------------------------------------------------
+hsm_context T0Enter( hsm_status status )
+{
+    return &gOuter;
+}
+
+hsm_state T0Event( hsm_status status )
+{
+    ++gCalls[0];
+    // the outer context, even though we skipped the states in between.
+    return (status->ctx == &gOuter && status->evt->ch == 'a') ? HsmStateHandled() : NULL;
+}
+
+hsm_state T1Event( hsm_status status )
+{
+    ++gCalls[1];
+    return status->evt->ch == 'b' ? HsmStateHandled() : NULL;
+}
+
+hsm_context T2Enter( hsm_status status )
+{
+    return &gInner;
+}
+
+hsm_state T2Event( hsm_status status )
+{
+    ++gCalls[2];
+    return status->evt->ch == 'c' ? HsmStateHandled() : NULL;
+}
+
+//---------------------------------------------------------------------------
+static hsm_bool InterestCalls( hsm_machine hsm, char ch, hsm_bool handled, int c0, int c1, int c2 )
+{
+    CharEvent evt;
+    hsm_bool res;
+    evt.ch= ch;
+    memset( gCalls, 0, sizeof(gCalls) );
+    res= (HsmSignalEvent( hsm, &evt ) == handled) && 
+        (gCalls[0] == c0) && (gCalls[1] == c1) && (gCalls[2] == c2);
+    if (!res) {
+        printf("'%c' calls %d %d %d\n", ch, gCalls[0], gCalls[1], gCalls[2] );
+    }
+    return res;
+}
+
+//---------------------------------------------------------------------------
+int InterestTest()
+{
+    hsm_bool res= HSM_FALSE;
+    hsm_context_machine_t machine;
+    hsm_machine hsm= HsmMachineWithContext( &machine, NULL );
+    hsm_chart_t chart;
+    hsm_state states[3];
+    states[0]= T0(); states[1]= T1(); states[2]= T2();
+    ((hsm_state_t*)states[0])->interests= HSM_INTEREST( CHAR_TYPE('a') );
+    ((hsm_state_t*)states[1])->interests= HSM_INTEREST( CHAR_TYPE('b') ) | HSM_INTEREST( CHAR_TYPE('d') );
+    ((hsm_state_t*)states[2])->interests= 0; // everything
+
+    if (HsmChartCompile( &chart, states, 3 ) && HsmChartEventTypes( &chart, CharType ) && HsmStart( hsm, T0() )) {
+        res= InterestCalls( hsm, 'a', HSM_TRUE,  1, 0, 1 ) &&
+             InterestCalls( hsm, 'b', HSM_TRUE,  0, 1, 1 ) &&
+             InterestCalls( hsm, 'c', HSM_TRUE,  0, 0, 1 ) &&
+             InterestCalls( hsm, 'd', HSM_FALSE, 0, 1, 1 ) &&
+             // out of range types go to everyone
+             InterestCalls( hsm, 'A', HSM_FALSE, 1, 1, 1 );
+        // without the table, everyone sees everything again.
+        res= res && HsmChartEventTypes( &chart, NULL ) &&
+             InterestCalls( hsm, 'a', HSM_TRUE,  1, 1, 1 );
+    }
+    HsmChartRelease( &chart );
+    // the states are static, so leave them the way we found them
+    ((hsm_state_t*)states[0])->interests= ((hsm_state_t*)states[1])->interests= 0;
+    return res;
+}
@@ -86,6 +86,51 @@ hsm_state LuaBounceEvent(hsm_status status)
   return next;
 }
 
+//---------------------------------------------------------------------------
+/**
+ * Handler targets: named ones, and names returned by functions;
+ * the same name twice in a row, and then a different name each time.
+ */
+static const char * LuaTargetsChart=
+  "return { t0 = {"
+  "  init = 't1',"
+  "  r = function() return 't1' end,"
+  "  x = function() flip= not flip; if flip then return 't1' end; return 't2' end,"
+  "  t1 = { n = 't2' },"
+  "  t2 = { n = 't1' },"
+  "} }";
+
+static hsm_bool LuaTargets( lua_State* L )
+{
+  hsm_bool res= HSM_FALSE;
+  // each event, and the state it should leave the machine in
+  const char * events= "nnrnrxxx";
+  const char * expect[]= { "t2", "t1", "t1", "t2", "t1", "t1", "t2", "t1" };
+  const int top= lua_gettop(L);
+  if (hsmStartup()) {
+    int stateid;
+    if (!luaL_loadstring( L, LuaTargetsChart ) && !lua_pcall( L, 0, 1, 0 ) &&
+        !HulaBuildState( L, lua_gettop(L), &stateid )) 
+    {
+      hsm_context_machine_t machine;
+      hsm_machine hsm= HsmMachineWithContext( &machine, 0 );
+      int i;
+      res= HsmStart( hsm, hsmResolveId( stateid ) ) && (hsm->current == hsmResolve( "t1" ));
+      for (i=0; res && events[i]; ++i) {
+        CharEvent evt= { events[i] };
+        lua_createtable( L, 1, 0 );
+        lua_pushlstring( L, &evt.ch, 1 );
+        lua_rawseti( L, -2, 1 );
+        res= HsmSignalEvent( hsm, &evt ) && (hsm->current == hsmResolve( expect[i] ));
+        lua_pop( L, 1 );
+      }
+    }
+    hsmShutdown();
+  }
+  lua_settop( L, top );
+  return res;
+}
+
 //---------------------------------------------------------------------------
 hsm_bool LuaTest()
 {
@@ -118,6 +163,7 @@ hsm_bool LuaTest()
         hsmShutdown();
       }
     }
+    res= res && LuaTargets( L );
   }    
   lua_close(L);
   return res;
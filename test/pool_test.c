@@ -0,0 +1,194 @@
+/**
+ * @file pool_test.c
+ *
+ * Broadcast events to a pool of machines sitting in different states.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "test.h"
+#include <hsm/hsm_chart.h>
+#include <hsm/hsm_pool.h>
+#include <hsm/hsm_region.h>
+#include <stdio.h>
+
+//---------------------------------------------------------------------------
+static int gBubbled;
+
+HSM_STATE( P0, HsmTopState, PA );
+    HSM_STATE( PA, P0, 0 );
+    HSM_STATE( PB, P0, 0 );
+
+hsm_state P0Event( hsm_status status )
+{
+    if (status->evt->ch == 't') {
+        ++gBubbled;
+        return HsmStateHandled();
+    }
+    return NULL;
+}
+
+hsm_state PAEvent( hsm_status status )
+{
+    return status->evt->ch == 't' ? PB() : NULL;
+}
+
+hsm_state PBEvent( hsm_status status )
+{
+    return NULL;
+}
+
+//---------------------------------------------------------------------------
+// every machine in the parallel state has a region of its own; 'a' moves it from PL1 to PL2.
+HSM_PARALLEL( PPar, HsmTopState, PLeft );
+    HSM_REGION( PLeft, PPar, PL1, 0 );
+        HSM_STATE( PL1, PLeft, 0 );
+        HSM_STATE( PL2, PLeft, 0 );
+
+hsm_state PParEvent( hsm_status status )
+{
+    return NULL;
+}
+
+hsm_state PL1Event( hsm_status status )
+{
+    return status->evt->ch == 'a' ? PL2() : NULL;
+}
+
+hsm_state PL2Event( hsm_status status )
+{
+    return NULL;
+}
+
+//---------------------------------------------------------------------------
+// compiled with interests: PI1 only hears 'b', PI0 only 'a'.
+static int gInterestCalls[2];
+
+HSM_STATE( PI0, HsmTopState, PI1 );
+    HSM_STATE( PI1, PI0, 0 );
+
+hsm_state PI0Event( hsm_status status )
+{
+    ++gInterestCalls[0];
+    return status->evt->ch == 'a' ? HsmStateHandled() : NULL;
+}
+
+hsm_state PI1Event( hsm_status status )
+{
+    ++gInterestCalls[1];
+    return HsmStateHandled();
+}
+
+static int PoolCharType( hsm_event evt )
+{
+    return evt->ch - 'a';
+}
+
+//---------------------------------------------------------------------------
+static void CountHandled( hsm_status status, hsm_state next_state, void * user_data )
+{
+    ++*(int*)user_data;
+}
+
+//---------------------------------------------------------------------------
+// machines in a parallel state pass broadcasts to their regions, as HsmSignalEvent() would.
+static hsm_bool PoolParallel()
+{
+    hsm_bool res= HSM_FALSE;
+    hsm_pool_t pool;
+    if (HsmPool( &pool, 3 )) {
+        CharEvent a= { 'a' };
+        hsm_region_t regions[3];
+        hsm_region_pool_t region_pool;
+        int i, handled, inL2=0;
+        HsmRegionPool( &region_pool, regions, 3 );
+        for (i=0; i<pool.count; ++i) {
+            HsmMachineRegions( HsmPoolMachine( &pool, i ), &region_pool );
+        }
+        res= (HsmPoolStart( &pool, PPar() ) == 3) && (region_pool.used == 3);
+        handled= HsmPoolBroadcast( &pool, &a );
+        for (i=0; i<pool.count; ++i) {
+            inL2+= HsmIsInState( HsmPoolMachine( &pool, i ), PL2() ) ? 1 : 0;
+        }
+        res= res && (handled == 3) && (inL2 == 3);
+        if (!res) {
+            printf("parallel: handled %d, in PL2 %d\n", handled, inL2 );
+        }
+        HsmPoolRelease( &pool );
+    }
+    return res;
+}
+
+//---------------------------------------------------------------------------
+// broadcasts skip uninterested states, as HsmSignalEvent() would.
+static hsm_bool PoolInterests()
+{
+    hsm_bool res= HSM_FALSE;
+    hsm_state states[2];
+    hsm_chart_t chart;
+    hsm_pool_t pool;
+    states[0]= PI0(); states[1]= PI1();
+    ((hsm_state_t*)states[0])->interests= HSM_INTEREST( 0 );
+    ((hsm_state_t*)states[1])->interests= HSM_INTEREST( 1 );
+    if (HsmChartCompile( &chart, states, 2 ) && HsmChartEventTypes( &chart, PoolCharType )) {
+        if (HsmPool( &pool, 4 )) {
+            CharEvent a= { 'a' }, c= { 'c' };
+            int handled[2];
+            gInterestCalls[0]= gInterestCalls[1]= 0;
+            res= HsmPoolStart( &pool, PI0() ) == 4;
+            handled[0]= HsmPoolBroadcast( &pool, &a );
+            // nobody is interested in 'c'
+            handled[1]= HsmPoolBroadcast( &pool, &c );
+            res= res && (handled[0] == 4) && (handled[1] == 0) &&
+                 (gInterestCalls[0] == 4) && (gInterestCalls[1] == 0);
+            if (!res) {
+                printf("interests: handled %d %d, calls %d %d\n", handled[0], handled[1], gInterestCalls[0], gInterestCalls[1] );
+            }
+            HsmPoolRelease( &pool );
+        }
+    }
+    HsmChartRelease( &chart );
+    // the states are static, so leave them the way we found them
+    ((hsm_state_t*)states[0])->interests= ((hsm_state_t*)states[1])->interests= 0;
+    return res;
+}
+
+//---------------------------------------------------------------------------
+int PoolTest()
+{
+    hsm_bool res= HSM_FALSE;
+    hsm_pool_t pool;
+    if (HsmPool( &pool, 7 )) {
+        CharEvent t= { 't' }, u= { 'u' };
+        int i, handled[3], inB=0, reported=0;
+        hsm_info_t info= { 0 };
+        info.user_data= &reported;
+        info.on_handled_event= CountHandled;
+        for (i=0; i<pool.count; ++i) {
+            HsmSetMachineInfo( HsmPoolMachine( &pool, i ), &info );
+            HsmStart( HsmPoolMachine( &pool, i ), (i%3) ? PA() : PB() );
+        }
+        HsmPoolRefresh( &pool );
+        gBubbled= 0;
+        // the machines in PA move to PB, the ones already in PB bubble to P0
+        handled[0]= HsmPoolBroadcast( &pool, &t );
+        res= gBubbled == 3;
+        // now everyone bubbles
+        handled[1]= HsmPoolBroadcast( &pool, &t );
+        handled[2]= HsmPoolBroadcast( &pool, &u );
+        for (i=0; i<pool.count; ++i) {
+            inB+= HsmPoolMachine( &pool, i )->current == PB() ? 1 : 0;
+        }
+        // every handled event gets reported, whether it transitioned or not.
+        res= res && (gBubbled == 3+7) && (inB == 7) && (reported == 7+7) &&
+             (handled[0] == 7) && (handled[1] == 7) && (handled[2] == 0);
+        if (!res) {
+            printf("handled %d %d %d, bubbled %d, in PB %d, reported %d\n", handled[0], handled[1], handled[2], gBubbled, inB, reported );
+        }
+        HsmPoolRelease( &pool );
+    }
+    return res && PoolParallel() && PoolInterests();
+}
@@ -0,0 +1,83 @@
+/**
+ * @file queue_test.c
+ *
+ * Posted events run to completion, even when a handler posts to its own machine.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "test.h"
+#include <hsm/hsm_queue.h>
+#include <stdio.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+static char gLog[32];
+
+static void Log( char ch )
+{
+    size_t len= strlen( gLog );
+    if (len < sizeof(gLog)-1) {
+        gLog[len]= ch;
+    }
+}
+
+//---------------------------------------------------------------------------
+HSM_STATE( Q0, HsmTopState, QA );
+    HSM_STATE_ENTER( QA, Q0, 0 );
+    HSM_STATE_ENTER( QB, Q0, 0 );
+
+hsm_state Q0Event( hsm_status status )
+{
+    return NULL;
+}
+
+hsm_context QAEnter( hsm_status status )
+{
+    Log('A');
+    return status->ctx;
+}
+
+hsm_state QAEvent( hsm_status status )
+{
+    static CharEvent y= { 'y' };
+    if (status->evt->ch == 'x') {
+        // posting 'y' from here means it gets handled by QB, after this transition finishes.
+        HsmPostEvent( status->hsm, &y );
+        return QB();
+    }
+    return NULL;
+}
+
+hsm_context QBEnter( hsm_status status )
+{
+    Log('B');
+    return status->ctx;
+}
+
+hsm_state QBEvent( hsm_status status )
+{
+    return (status->evt->ch == 'y') ? QA() : NULL;
+}
+
+//---------------------------------------------------------------------------
+hsm_bool QueueTest()
+{
+    hsm_bool okay;
+    hsm_machine_t machine;
+    hsm_queue_t queue;
+    hsm_queue_slot_t slots[4];
+    CharEvent x= { 'x' };
+    hsm_machine hsm= HsmMachine( &machine );
+    int processed;
+
+    gLog[0]=0;
+    okay= HsmMachineQueue( hsm, &queue, slots, 4 ) && HsmStart( hsm, Q0() );
+    okay= okay && HsmPostEvent( hsm, &x ) && HsmPendingEvents( hsm ) == 1;
+    processed= HsmDrainEvents( hsm, 100 );
+    printf( "\tprocessed %d events: %s\n", processed, gLog );
+    return okay && processed == 2 && strcmp( gLog, "ABA" ) == 0 && HsmPendingEvents( hsm ) == 0;
+}
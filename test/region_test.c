@@ -0,0 +1,361 @@
+/**
+ * @file region_test.c
+ *
+ * Parallel states, and their orthogonal regions.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "test.h"
+#include <hsm/hsm_chart.h>
+#include <hsm/hsm_defer.h>
+#include <hsm/hsm_history.h>
+#include <hsm/hsm_region.h>
+#include <hsm/hsm_timer.h>
+#include <stdio.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+HSM_STATE( RTop, HsmTopState, RIdle );
+    EMPTY_STATE( RIdle, RTop, 0 );
+    HSM_PARALLEL( RPar, RTop, RLeft );
+        HSM_REGION( RLeft, RPar, RL1, RRight );
+            HSM_STATE( RL1, RLeft, 0 );
+            HSM_STATE( RL2, RLeft, 0 );
+        HSM_REGION( RRight, RPar, RR1, 0 );
+            HSM_STATE( RR1, RRight, 0 );
+            HSM_STATE( RR2, RRight, 0 );
+
+static int gParallelHeard;
+
+//---------------------------------------------------------------------------
+// 'o' opens the parallel state; 'r' targets a state inside one of its regions.
+hsm_state RTopEvent( hsm_status status )
+{
+    hsm_state ret= NULL;
+    switch (status->evt->ch) {
+        case 'o': ret= RPar(); break;
+        case 'r': ret= RR2(); break;
+    }
+    return ret;
+}
+
+// 'p' only the parallel state handles; 's' restarts it.
+hsm_state RParEvent( hsm_status status )
+{
+    hsm_state ret= NULL;
+    switch (status->evt->ch) {
+        case 'p': ++gParallelHeard; ret= HsmStateHandled(); break;
+        case 's': ret= RPar(); break;
+    }
+    return ret;
+}
+
+// 'a' toggles both regions; 'e' in either second state escapes the parallel state, but to different places.
+hsm_state RL1Event( hsm_status status )
+{
+    return status->evt->ch == 'a' ? RL2() : NULL;
+}
+
+hsm_state RL2Event( hsm_status status )
+{
+    hsm_state ret= NULL;
+    switch (status->evt->ch) {
+        case 'a': ret= RL1(); break;
+        case 'e': ret= RIdle(); break;
+    }
+    return ret;
+}
+
+hsm_state RR1Event( hsm_status status )
+{
+    return status->evt->ch == 'a' ? RR2() : NULL;
+}
+
+hsm_state RR2Event( hsm_status status )
+{
+    hsm_state ret= NULL;
+    switch (status->evt->ch) {
+        case 'a': ret= RR1(); break;
+        case 'e': ret= RPar(); break;
+    }
+    return ret;
+}
+
+//---------------------------------------------------------------------------
+// "RL1" records as "L1", exits as "-L1"
+static char gLog[512];
+
+static void RegionEntered( hsm_status status, void * user_data )
+{
+    strcat( gLog, status->state->name+1 );
+    strcat( gLog, " " );
+}
+
+static void RegionExiting( hsm_status status, void * user_data )
+{
+    strcat( gLog, "-" );
+    RegionEntered( status, user_data );
+}
+
+// counts handled events, per RegionSends()
+static int gHandledReports;
+
+static void RegionHandled( hsm_status status, hsm_state next_state, void * user_data )
+{
+    ++gHandledReports;
+}
+
+//---------------------------------------------------------------------------
+static hsm_bool RegionSends( hsm_machine hsm, const char * events, hsm_bool handled, const char * expect )
+{
+    hsm_bool res= HSM_TRUE;
+    gLog[0]= 0;
+    gHandledReports= 0;
+    for (; *events; ++events) {
+        CharEvent evt;
+        evt.ch= *events;
+        res= (HsmSignalEvent( hsm, &evt ) == handled) && res;
+    }
+    res= res && (strcmp( gLog, expect ) == 0);
+    if (!res) {
+        printf("logged '%s' expected '%s'\n", gLog, expect );
+    }
+    return res;
+}
+
+//---------------------------------------------------------------------------
+static hsm_bool RegionSequence( hsm_machine hsm, hsm_machine other, hsm_region_pool_t* pool )
+{
+    hsm_bool res=
+        HsmStart( hsm, RTop() ) && HsmStart( other, RTop() ) &&
+        // regions enter in order, each all the way down, before the next.
+        RegionSends( hsm, "o", HSM_TRUE, "-Idle Par Left L1 Right R1 " ) &&
+        HsmIsInState( hsm, RL1() ) && HsmIsInState( hsm, RR1() ) && HsmIsInState( hsm, RPar() ) && 
+        !HsmIsInState( hsm, RL2() ) && (pool->used == 2) &&
+        // every region hears every event
+        RegionSends( hsm, "a", HSM_TRUE, "-L1 L2 -R1 R2 " ) &&
+        // events no region handles bubble up from the parallel state
+        RegionSends( hsm, "p", HSM_TRUE, "" ) && (gParallelHeard == 1) &&
+        RegionSends( hsm, "z", HSM_FALSE, "" ) &&
+        // the other machine has its own regions
+        RegionSends( other, "o", HSM_TRUE, "-Idle Par Left L1 Right R1 " ) && (pool->used == 4) &&
+        HsmIsInState( other, RL1() ) && HsmIsInState( hsm, RL2() ) &&
+        // self transition restarts every region; exits go in reverse.
+        RegionSends( hsm, "s", HSM_TRUE, "-R2 -Right -L2 -Left -Par Par Left L1 Right R1 " ) &&
+        // leaving a region leaves them all; the escape gets reported once, by the region which handled it.
+        RegionSends( hsm, "ae", HSM_TRUE, "-L1 L2 -R1 R2 -R2 -Right -L2 -Left -Par Idle " ) && (gHandledReports == 2+1) &&
+        (pool->used == 2) && HsmIsInState( hsm, RIdle() ) && !HsmIsInState( hsm, RL2() ) &&
+        // targets inside a region enter the parallel state
+        RegionSends( hsm, "r", HSM_TRUE, "-Idle Par Left L1 Right R1 " );
+    return res;
+}
+
+//---------------------------------------------------------------------------
+// stands in for running the regions on threads: everyone hears the event, but last region first.
+static int gRuns;
+
+static void RunBackwards( hsm_region_t* regions, void * run_data )
+{
+    hsm_region_t* order[8];
+    int count=0;
+    for (; regions; regions= regions->next) {
+        order[count++]= regions;
+    }
+    while (count) {
+        HsmRegionRun( order[--count] );
+    }
+    ++gRuns;
+}
+
+static hsm_bool RegionRunSequence( hsm_machine hsm, hsm_region_pool_t* pool )
+{
+    hsm_bool res=
+        HsmStart( hsm, RTop() ) &&
+        // entering still goes in declaration order
+        RegionSends( hsm, "o", HSM_TRUE, "-Idle Par Left L1 Right R1 " ) && (gRuns == 0) &&
+        RegionSends( hsm, "a", HSM_TRUE, "-R1 R2 -L1 L2 " ) && (gRuns == 1) &&
+        // as does exiting
+        RegionSends( hsm, "s", HSM_TRUE, "-R2 -Right -L2 -Left -Par Par Left L1 Right R1 " ) && (gRuns == 2) &&
+        // both regions escape: the first declared wins, no matter who ran first.
+        RegionSends( hsm, "ae", HSM_TRUE, "-R1 R2 -L1 L2 -R2 -Right -L2 -Left -Par Idle " ) &&
+        HsmIsInState( hsm, RIdle() ) && (pool->used == 0) && (gRuns == 4);
+    return res;
+}
+
+//---------------------------------------------------------------------------
+int RegionRunTest()
+{
+    hsm_bool res;
+    hsm_info_t info= { 0 };
+    hsm_region_t regions[2];
+    hsm_region_pool_t pool;
+    hsm_context_machine_t machine;
+    hsm_machine hsm= HsmMachineWithContext( &machine, NULL );
+    info.on_entered= RegionEntered;
+    info.on_exiting= RegionExiting;
+    gRuns= 0;
+    HsmRegionPool( &pool, regions, 2 );
+    pool.run= RunBackwards;
+    res= HsmMachineRegions( hsm, &pool ) &&
+         HsmSetMachineInfo( hsm, &info ) == NULL &&
+         RegionRunSequence( hsm, &pool );
+    return res;
+}
+
+//---------------------------------------------------------------------------
+// region states using their machine's timers and history; and trying to defer, which regions can't.
+HSM_STATE( SvTop, HsmTopState, SvIdle );
+    EMPTY_STATE( SvIdle, SvTop, 0 );
+    HSM_PARALLEL( SvPar, SvTop, SvTimed );
+        HSM_REGION( SvTimed, SvPar, SvWait, SvKept );
+            HSM_STATE_ENTER( SvWait, SvTimed, 0 );
+            EMPTY_STATE( SvDone, SvTimed, 0 );
+        HSM_REGION( SvKept, SvPar, SvOwner, 0 );
+            HSM_STATE( SvOwner, SvKept, SvOne );
+                HSM_HISTORY( SvBack, SvOwner, 0 );
+                HSM_STATE( SvOne, SvOwner, 0 );
+                HSM_STATE( SvTwo, SvOwner, 0 );
+            HSM_STATE( SvAway, SvKept, 0 );
+
+static CharEvent gRegionTimeout= { 't' };
+static int gParallelDeferred;
+
+hsm_state SvTopEvent( hsm_status status )
+{
+    return status->evt->ch == 'o' ? SvPar() : NULL;
+}
+
+// 'd' reaches here because the region couldn't defer it; 'e' leaves the parallel state.
+hsm_state SvParEvent( hsm_status status )
+{
+    hsm_state ret= NULL;
+    switch (status->evt->ch) {
+        case 'd': ++gParallelDeferred; ret= HsmStateHandled(); break;
+        case 'e': ret= SvIdle(); break;
+    }
+    return ret;
+}
+
+hsm_context SvWaitEnter( hsm_status status )
+{
+    HsmArmTimer( status, 2, &gRegionTimeout );
+    return status->ctx;
+}
+
+hsm_state SvWaitEvent( hsm_status status )
+{
+    return status->evt->ch == 't' ? SvDone() : NULL;
+}
+
+hsm_state SvOwnerEvent( hsm_status status )
+{
+    return status->evt->ch == 'x' ? SvAway() : NULL;
+}
+
+hsm_state SvOneEvent( hsm_status status )
+{
+    return status->evt->ch == 'n' ? SvTwo() : NULL;
+}
+
+hsm_state SvTwoEvent( hsm_status status )
+{
+    return status->evt->ch == 'd' ? HsmDefer( status, sizeof(CharEvent) ) : NULL;
+}
+
+hsm_state SvAwayEvent( hsm_status status )
+{
+    return status->evt->ch == 'h' ? SvBack() : NULL;
+}
+
+//---------------------------------------------------------------------------
+static void SvSend( hsm_machine hsm, const char * events )
+{
+    for (; *events; ++events) {
+        CharEvent evt;
+        evt.ch= *events;
+        HsmSignalEvent( hsm, &evt );
+    }
+}
+
+int RegionServicesTest()
+{
+    hsm_bool res;
+    hsm_region_t regions[2];
+    hsm_region_pool_t pool;
+    hsm_wheel_t wheel;
+    hsm_timers_t timers;
+    hsm_timer_t storage[2];
+    hsm_history_t history;
+    hsm_state states[1];
+    hsm_state last[1];
+    hsm_context_machine_t machine;
+    hsm_machine hsm= HsmMachineWithContext( &machine, NULL );
+    states[0]= SvBack();
+    gParallelDeferred= 0;
+    HsmRegionPool( &pool, regions, 2 );
+    HsmWheel( &wheel, 0 );
+    res= HsmMachineRegions( hsm, &pool ) &&
+         HsmMachineTimers( hsm, &timers, &wheel, storage, 2 ) &&
+         HsmMachineHistory( hsm, &history, states, last, 1 ) &&
+         HsmStart( hsm, SvTop() );
+    if (res) {
+        SvSend( hsm, "o" );
+        res= HsmIsInState( hsm, SvWait() ) && HsmIsInState( hsm, SvOne() ) && (timers.armed == 1);
+        // the history pseudo-state inside the region remembers where it was.
+        SvSend( hsm, "nxh" );
+        res= res && HsmIsInState( hsm, SvTwo() ) && (last[0] == SvTwo());
+        // the region can't defer, so the parallel state hears it.
+        SvSend( hsm, "d" );
+        res= res && (gParallelDeferred == 1);
+        // the region's timer goes off.
+        res= res && (HsmWheelAdvance( &wheel, 2 ) == 1) && HsmIsInState( hsm, SvDone() ) && (timers.armed == 0);
+        // restarting the parallel state arms the timer again; leaving cancels it.
+        SvSend( hsm, "eo" );
+        res= res && HsmIsInState( hsm, SvWait() ) && (timers.armed == 1);
+        SvSend( hsm, "e" );
+        res= res && HsmIsInState( hsm, SvIdle() ) && (timers.armed == 0) && (pool.used == 0) &&
+             (HsmWheelAdvance( &wheel, 10 ) == 0);
+        if (!res) {
+            printf("armed %d, deferred %d, used %d\n", timers.armed, gParallelDeferred, pool.used );
+        }
+    }
+    return res;
+}
+
+//---------------------------------------------------------------------------
+int RegionTest()
+{
+    hsm_bool res= HSM_TRUE;
+    hsm_info_t info= { 0 };
+    hsm_region_t regions[4];
+    hsm_region_pool_t pool;
+    hsm_chart_t chart;
+    int pass;
+    info.on_entered= RegionEntered;
+    info.on_exiting= RegionExiting;
+    info.on_handled_event= RegionHandled;
+
+    // walking the tree, then compiled
+    for (pass=0; res && pass<2; ++pass) {
+        hsm_context_machine_t machine, other;
+        hsm_machine hsm= HsmMachineWithContext( &machine, NULL );
+        hsm_machine two= HsmMachineWithContext( &other, NULL );
+        if (pass == 1) {
+            hsm_state all[]= { RTop(), RIdle(), RPar(), RLeft(), RL1(), RL2(), RRight(), RR1(), RR2() };
+            res= HsmChartCompile( &chart, all, sizeof(all)/sizeof(all[0]) );
+        }
+        HsmRegionPool( &pool, regions, 4 );
+        gParallelHeard= 0;
+        res= res && HsmMachineRegions( hsm, &pool ) && HsmMachineRegions( two, &pool ) &&
+             HsmSetMachineInfo( hsm, &info ) == NULL && HsmSetMachineInfo( two, &info ) == NULL &&
+             RegionSequence( hsm, two, &pool );
+        if (pass == 1) {
+            HsmChartRelease( &chart );
+        }
+    }
+    return res;
+}
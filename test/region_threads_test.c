@@ -0,0 +1,147 @@
+/**
+ * @file region_threads_test.c
+ *
+ * Parallel states, nested ones included, with their regions running on region threads.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "test.h"
+#include <hsm/hsm_atomic.h>
+#include <hsm/hsm_region.h>
+#include <hsm/sched/hsm_region_threads.h>
+#include <stdio.h>
+
+//---------------------------------------------------------------------------
+HSM_STATE( TtTop, HsmTopState, TtIdle );
+    EMPTY_STATE( TtIdle, TtTop, 0 );
+    HSM_PARALLEL( TtPar, TtTop, TtA );
+        HSM_REGION( TtA, TtPar, TtA1, TtB );
+            HSM_STATE( TtA1, TtA, 0 );
+        HSM_REGION( TtB, TtPar, TtNest, TtC );
+            HSM_PARALLEL( TtNest, TtB, TtN1 );
+                HSM_REGION( TtN1, TtNest, TtN11, TtN2 );
+                    HSM_STATE( TtN11, TtN1, 0 );
+                HSM_REGION( TtN2, TtNest, TtN21, 0 );
+                    HSM_STATE( TtN21, TtN2, 0 );
+        HSM_REGION( TtC, TtPar, TtC1, 0 );
+            HSM_STATE( TtC1, TtC, 0 );
+
+// region instances while in TtPar: TtA, TtB, TtC, and TtNest's TtN1 and TtN2
+#define TT_INSTANCES 5
+// states which exit when TtPar does, TtPar included
+#define TT_EXITS 11
+#define TT_LEAVES 4
+#define TT_ROUNDS 64
+#define TT_EVENTS 16
+
+// times each leaf heard 'w', and states exited; regions run on several threads at once.
+static hsm_atomic gLeafHeard[TT_LEAVES];
+static hsm_atomic gExited;
+
+static hsm_state TtLeaf( hsm_status status, int leaf )
+{
+    hsm_state ret= NULL;
+    if (status->evt->ch == 'w') {
+        HsmAtomicAdd( &gLeafHeard[leaf], 1 );
+        ret= HsmStateHandled();
+    }
+    return ret;
+}
+
+//---------------------------------------------------------------------------
+// 'o' opens the parallel state; 'w' every leaf handles; 'e' escapes from a single region.
+hsm_state TtTopEvent( hsm_status status )
+{
+    return status->evt->ch == 'o' ? TtPar() : NULL;
+}
+
+hsm_state TtParEvent( hsm_status status ) { return NULL; }
+hsm_state TtAEvent( hsm_status status ) { return NULL; }
+hsm_state TtBEvent( hsm_status status ) { return NULL; }
+hsm_state TtCEvent( hsm_status status ) { return NULL; }
+hsm_state TtNestEvent( hsm_status status ) { return NULL; }
+hsm_state TtN1Event( hsm_status status ) { return NULL; }
+hsm_state TtN2Event( hsm_status status ) { return NULL; }
+
+hsm_state TtA1Event( hsm_status status ) { return TtLeaf( status, 0 ); }
+hsm_state TtN11Event( hsm_status status ) { return TtLeaf( status, 1 ); }
+hsm_state TtN21Event( hsm_status status ) { return TtLeaf( status, 2 ); }
+
+hsm_state TtC1Event( hsm_status status )
+{
+    return status->evt->ch == 'e' ? TtIdle() : TtLeaf( status, 3 );
+}
+
+static void TtExiting( hsm_status status, void * user_data )
+{
+    HsmAtomicAdd( &gExited, 1 );
+}
+
+//---------------------------------------------------------------------------
+static hsm_bool TtSend( hsm_machine hsm, char ch )
+{
+    CharEvent evt;
+    evt.ch= ch;
+    return HsmSignalEvent( hsm, &evt );
+}
+
+// open the parallel state, have every region handle a few events, then escape.
+static hsm_bool TtRound( hsm_machine hsm, hsm_region_pool_t* pool )
+{
+    hsm_bool res= TtSend( hsm, 'o' ) && (pool->used == TT_INSTANCES) &&
+                  HsmIsInState( hsm, TtA1() ) && HsmIsInState( hsm, TtN11() ) &&
+                  HsmIsInState( hsm, TtN21() ) && HsmIsInState( hsm, TtC1() );
+    int i;
+    for (i=0; i<TT_LEAVES; ++i) {
+        gLeafHeard[i]= 0;
+    }
+    for (i=0; res && i<TT_EVENTS; ++i) {
+        res= TtSend( hsm, 'w' );
+    }
+    // every region, nested ones too, heard every event exactly once
+    for (i=0; res && i<TT_LEAVES; ++i) {
+        res= HsmAtomicLoad( &gLeafHeard[i] ) == TT_EVENTS;
+        if (!res) {
+            printf("leaf %d heard %ld events, expected %d\n", i, (long) gLeafHeard[i], TT_EVENTS );
+        }
+    }
+    // one region escaping exits all the others
+    gExited= 0;
+    res= res && TtSend( hsm, 'e' ) &&
+         HsmIsInState( hsm, TtIdle() ) && !HsmIsInState( hsm, TtPar() ) &&
+         !HsmIsInState( hsm, TtA1() ) && !HsmIsInState( hsm, TtN11() ) &&
+         !HsmIsInState( hsm, TtN21() ) && !HsmIsInState( hsm, TtC1() ) &&
+         (HsmAtomicLoad( &gExited ) == TT_EXITS) && (pool->used == 0);
+    return res;
+}
+
+//---------------------------------------------------------------------------
+hsm_bool RegionThreadsTest()
+{
+    hsm_bool res= HSM_FALSE;
+    hsm_region_threads_t* threads= HsmRegionThreadsCreate( 2 );
+    if (threads) {
+        hsm_info_t info= { 0 };
+        hsm_region_t regions[8];
+        hsm_region_pool_t pool;
+        hsm_context_machine_t machine;
+        hsm_machine hsm= HsmMachineWithContext( &machine, NULL );
+        int round;
+        info.on_exiting= TtExiting;
+        HsmRegionPool( &pool, regions, 8 );
+        res= HsmRegionThreadsAttach( threads, &pool ) &&
+             HsmMachineRegions( hsm, &pool ) &&
+             HsmSetMachineInfo( hsm, &info ) == NULL &&
+             HsmStart( hsm, TtTop() );
+        for (round=0; res && round<TT_ROUNDS; ++round) {
+            res= TtRound( hsm, &pool );
+        }
+        // returns only once every thread has joined
+        HsmRegionThreadsDestroy( threads );
+    }
+    return res;
+}
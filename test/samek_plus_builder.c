@@ -16,6 +16,7 @@
 #include <stdio.h>
 #include "samek_plus.h"
 #include <hsm/builder/hsm_builder.h>
+#include <hsm/hsm_chart.h>
 
 //---------------------------------------------------------------------------
 typedef struct sp_context_rec sp_context_t;
@@ -45,6 +46,12 @@ hsm_bool MatchChar( hsm_status status, int user_data )
 #define IfChar( val ) hsmIfUD( (hsm_callback_guard_ud) MatchChar, (void*) val )
 #define AndTest( fn, val ) hsmAndUD( (hsm_callback_guard_ud) fn, (void*) val )
 #define Run( fn, val ) hsmRunUD( (hsm_callback_guard_ud) fn, (void*) val )
+#define OnChar( val ) hsmOnEventId( val )
+
+int CharKey( hsm_event evt )
+{
+    return evt->ch;
+}
 
 //---------------------------------------------------------------------------
 hsm_state buildMachine()
@@ -121,3 +128,107 @@ hsm_bool SamekPlusBuilderTest()
     hsmShutdown();
     return res;
 }
+
+//---------------------------------------------------------------------------
+hsm_bool SamekPlusBuilderChartTest()
+{
+    hsm_bool res= HSM_FALSE;
+    hsm_context_machine_t machine;
+    hsm_chart_t chart;
+    sp_context_t ctx={0};
+    hsm_state first;
+
+    hsmStartup();
+    first= buildMachine();
+    if (hsmCompile( "s0", &chart )) {
+        res= TestEventSequence( 
+                HsmMachineWithContext( &machine, &ctx.ctx ), 
+                first, 
+                SamekPlusSequence() );
+        HsmChartRelease( &chart );
+    }
+    hsmShutdown();
+    return res;
+}
+
+//---------------------------------------------------------------------------
+/**
+ * the same machine, but with its handlers keyed by event;
+ * s0 keeps one unkeyed handler to check that both kinds run together.
+ */
+hsm_state buildKeyedMachine()
+{
+    int state;
+    hsmEventIds( CharKey );
+    state=
+    hsmBegin( "s0", 0 );
+    {
+        IfChar( 'e' ); hsmGoto( "s211" );
+        OnChar( 'i' ); hsmGoto( "s12" );     
+        hsmBegin( "s1", 0 );
+        {
+            OnChar( 'a' ); hsmGoto( "s1" );
+            OnChar( 'b' ); hsmGoto( "s11" );
+            OnChar( 'c' ); hsmGoto( "s2" );
+            OnChar( 'd' ); hsmGoto( "s0" );
+            OnChar( 'f' ); hsmGoto( "s211" );
+            hsmBegin( "s11", 0 );
+            {
+                OnChar( 'g' ); 
+                    hsmGoto( "s211" );
+
+                OnChar( 'h' ); 
+                AndTest( TestFoo, 1 ); 
+                    Run( SetFoo, 0 );
+            }
+            hsmEnd();
+
+            hsmBegin( "s12", 0 );
+            hsmEnd();
+        }
+        hsmEnd();
+        hsmBegin( "s2", 0 );
+        {
+            OnChar( 'c' ); hsmGoto( "s1" );
+            OnChar( 'f' ); hsmGoto( "s11" );
+            hsmBegin( "s21", 0 );
+            {
+                OnChar( 'b' ); 
+                    hsmGoto( "s211" );
+
+                OnChar( 'h' ); 
+                AndTest(  TestFoo, 0 );
+                    Run( SetFoo, 1 );
+                    hsmGoto( "s21" );
+
+                hsmBegin( "s211", 0 );
+                {
+                    OnChar( 'd' ); hsmGoto( "s21" );
+                    OnChar( 'g' ); hsmGoto( "s0" );
+                }
+                hsmEnd();
+            }
+            hsmEnd();
+        }
+        hsmEnd();
+    }
+    hsmEnd();
+    return hsmResolveId( state );
+}
+
+//---------------------------------------------------------------------------
+hsm_bool SamekPlusBuilderKeyedTest()
+{
+    hsm_bool res;
+    hsm_context_machine_t machine;
+    sp_context_t ctx={0};
+
+    hsmStartup();
+    res= TestEventSequence( 
+            HsmMachineWithContext( &machine, &ctx.ctx ), 
+            buildKeyedMachine(), 
+            SamekPlusSequence() );
+
+    hsmShutdown();
+    return res;
+}
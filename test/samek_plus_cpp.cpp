@@ -0,0 +1,172 @@
+/**
+ * @file samek_plus_cpp.cpp
+ *
+ * Samek's test, with the chart defined at compile time via hsm_chart.hpp.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include <hsm/hsm_chart.hpp>
+
+extern "C" {
+#include "test.h"
+#include "samek_plus.h"
+}
+
+//---------------------------------------------------------------------------
+namespace {
+
+struct sp_context_t {
+    hsm_context_t ctx;
+    int foo;
+};
+
+struct s0; struct s1; struct s11; struct s12; struct s2; struct s21; struct s211;
+typedef hsm::Chart< s0, s1, s11, s12, s2, s21, s211 > SamekPlus;
+
+struct s0 : hsm::State< s0, hsm::Top, s1, SamekPlus > {
+    static constexpr const char* name= "s0";
+    static hsm_state Process( hsm_status status );
+};
+
+struct s1 : hsm::State< s1, s0, s11, SamekPlus > {
+    static constexpr const char* name= "s1";
+    static hsm_state Process( hsm_status status );
+};
+
+struct s11 : hsm::State< s11, s1, void, SamekPlus > {
+    static constexpr const char* name= "s11";
+    static hsm_state Process( hsm_status status );
+};
+
+struct s12 : hsm::State< s12, s1, void, SamekPlus > {
+    static constexpr const char* name= "s12";
+    static hsm_state Process( hsm_status status );
+};
+
+struct s2 : hsm::State< s2, s0, s21, SamekPlus > {
+    static constexpr const char* name= "s2";
+    static hsm_state Process( hsm_status status );
+};
+
+struct s21 : hsm::State< s21, s2, s211, SamekPlus > {
+    static constexpr const char* name= "s21";
+    static hsm_state Process( hsm_status status );
+};
+
+struct s211 : hsm::State< s211, s21, void, SamekPlus > {
+    static constexpr const char* name= "s211";
+    static hsm_state Process( hsm_status status );
+};
+
+//---------------------------------------------------------------------------
+// handlers come after every state is complete, so they can refer to any of them.
+
+//---------------------------------------------------------------------------
+hsm_state s0::Process( hsm_status status )
+{
+    switch (status->evt->ch) {
+        case 'e': return hsm::StateOf< s211 >();
+        case 'i': return hsm::StateOf< s12 >();
+    }
+    return 0;
+}
+
+//---------------------------------------------------------------------------
+hsm_state s1::Process( hsm_status status )
+{
+    switch (status->evt->ch) {
+        case 'a': return hsm::StateOf< s1 >();
+        case 'b': return hsm::StateOf< s11 >();
+        case 'c': return hsm::StateOf< s2 >();
+        case 'd': return hsm::StateOf< s0 >();
+        case 'f': return hsm::StateOf< s211 >();
+    }
+    return 0;
+}
+
+//---------------------------------------------------------------------------
+hsm_state s11::Process( hsm_status status )
+{
+    sp_context_t* sp= (sp_context_t*) status->ctx;
+    switch (status->evt->ch) {
+        case 'g': return hsm::StateOf< s211 >();
+        case 'h':
+            if (sp->foo) {
+                sp->foo= 0;
+                return HsmStateHandled();
+            }
+            break;
+    }
+    return 0;
+}
+
+//---------------------------------------------------------------------------
+hsm_state s12::Process( hsm_status status )
+{
+    switch (status->evt->ch) {
+        case 'e': return hsm::StateOf< s211 >();
+        case 'i': return hsm::StateOf< s12 >();
+    }
+    return 0;
+}
+
+//---------------------------------------------------------------------------
+hsm_state s2::Process( hsm_status status )
+{
+    switch (status->evt->ch) {
+        case 'c': return hsm::StateOf< s1 >();
+        case 'f': return hsm::StateOf< s11 >();
+    }
+    return 0;
+}
+
+//---------------------------------------------------------------------------
+hsm_state s21::Process( hsm_status status )
+{
+    sp_context_t* sp= (sp_context_t*) status->ctx;
+    switch (status->evt->ch) {
+        case 'b': return hsm::StateOf< s211 >();
+        case 'h':
+            if (!sp->foo) {
+                sp->foo= 1;
+                return hsm::StateOf< s21 >();
+            }
+            break;
+    }
+    return 0;
+}
+
+//---------------------------------------------------------------------------
+hsm_state s211::Process( hsm_status status )
+{
+    switch (status->evt->ch) {
+        case 'd': return hsm::StateOf< s21 >();
+        case 'g': return hsm::StateOf< s0 >();
+    }
+    return 0;
+}
+
+HSM_CHART_CHECK( SamekPlus );
+
+// the tables really are compile time constants.
+static_assert( s211::depth == 3, "depth" );
+static_assert( hsm::Lca< s211, s11 >::depth == 0, "lca across branches" );
+static_assert( hsm::Lca< s1, s1 >::exits == 1, "self transitions exit the source" );
+static_assert( hsm::Lca< s0, s12 >::entries == 2, "entries from source to target" );
+
+} // namespace
+
+//---------------------------------------------------------------------------
+extern "C" int SamekPlusCppTest()
+{
+    hsm_context_machine_t machine;
+    sp_context_t ctx= {};
+    return TestEventSequence( HsmMachineWithContext( &machine, &ctx.ctx ), hsm::StateOf< s0 >(), SamekPlusSequence() ) &&
+           // states know their chart from the start
+           hsm::StateOf< s211 >()->chart == &SamekPlus::chart &&
+           SamekPlus::chart.lca[ 6*SamekPlus::count + 2 ] == 0;
+}
@@ -12,6 +12,7 @@
 #include "test.h"
 #include <stdio.h>
 #include "samek_plus.h"
+#include <hsm/hsm_chart.h>
 
 //---------------------------------------------------------------------------
 typedef struct sp_context_rec sp_context_t;
@@ -119,3 +120,21 @@ int SamekPlusTest()
     sp_context_t ctx={0};
     return TestEventSequence( HsmMachineWithContext( &machine, &ctx.ctx ), s0(), SamekPlusSequence() );
 }
+
+//---------------------------------------------------------------------------
+/**
+ * the same test, but with the transitions precomputed.
+ */
+int SamekPlusChartTest()
+{
+    hsm_bool res= HSM_FALSE;
+    hsm_chart_t chart;
+    const hsm_state states[]= { s0(), s1(), s11(), s12(), s2(), s21(), s211() };
+    if (HsmChartCompile( &chart, states, sizeof(states)/sizeof(hsm_state) )) {
+        hsm_context_machine_t machine;
+        sp_context_t ctx={0};
+        res= TestEventSequence( HsmMachineWithContext( &machine, &ctx.ctx ), s0(), SamekPlusSequence() );
+        HsmChartRelease( &chart );
+    }
+    return res;
+}
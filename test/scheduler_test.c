@@ -0,0 +1,135 @@
+/**
+ * @file scheduler_test.c
+ *
+ * Every event posted to scheduled machines runs exactly once, in the order it was posted,
+ * even while the machines are being attached, while handlers post to each other from the workers,
+ * and while idle workers steal them.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "test.h"
+#include <hsm/hsm_atomic.h>
+#include <hsm/hsm_queue.h>
+#include <hsm/sched/hsm_scheduler.h>
+#include <hsm/sched/hsm_thread.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SCHED_MACHINES 16
+#define SCHED_EVENTS 256
+#define SCHED_SLOTS 512 // room for every posted and relayed event: handlers never see a full queue.
+
+//---------------------------------------------------------------------------
+// 'p' events are posted from the test thread; each one relays an 'r' event to the next machine from a worker.
+typedef struct sched_test_rec sched_test_t;
+struct sched_test_rec {
+    hsm_machine_t machine; // first, so the machine pointer is the test pointer
+    hsm_queue_t queue;
+    hsm_queue_slot_t slots[SCHED_SLOTS];
+    int next[2];                        // next expected sequence number, for posted and relayed events
+    int ran[2][SCHED_EVENTS];           // times each event ran
+    int errors;
+};
+
+static sched_test_t gSched[SCHED_MACHINES];
+static CharEvent gPosted[SCHED_MACHINES][SCHED_EVENTS];
+static CharEvent gRelayed[SCHED_MACHINES][SCHED_EVENTS];
+
+//---------------------------------------------------------------------------
+HSM_STATE( SchRun, HsmTopState, 0 );
+
+hsm_state SchRunEvent( hsm_status status )
+{
+    sched_test_t* test= (sched_test_t*) status->hsm;
+    const int which= (int)(test - gSched);
+    const int relayed= status->evt->ch == 'r';
+    const int seq= (int)(status->evt - (relayed ? gRelayed[which] : gPosted[which]));
+    if (seq < 0 || seq >= SCHED_EVENTS || seq != test->next[relayed]) {
+        ++test->errors;
+    }
+    else {
+        ++test->next[relayed];
+        ++test->ran[relayed][seq];
+        if (!relayed) {
+            // only this machine relays to its neighbour, so the relays keep its order.
+            const int next= (which+1) % SCHED_MACHINES;
+            if (!HsmPostEvent( &gSched[next].machine, &gRelayed[next][seq] )) {
+                ++test->errors;
+            }
+        }
+    }
+    return HsmStateHandled();
+}
+
+//---------------------------------------------------------------------------
+static hsm_bool SchedCheck()
+{
+    hsm_bool res= HSM_TRUE;
+    int i, k, seq;
+    for (i=0; i<SCHED_MACHINES; ++i) {
+        const sched_test_t* test= &gSched[i];
+        hsm_bool okay= !test->errors && test->next[0] == SCHED_EVENTS && test->next[1] == SCHED_EVENTS;
+        for (k=0; okay && k<2; ++k) {
+            for (seq=0; okay && seq<SCHED_EVENTS; ++seq) {
+                okay= test->ran[k][seq] == 1;
+            }
+        }
+        if (!okay) {
+            printf("machine %d: %d errors, ran %d posted and %d relayed events\n", i, test->errors, test->next[0], test->next[1] );
+            res= HSM_FALSE;
+        }
+    }
+    return res;
+}
+
+//---------------------------------------------------------------------------
+// posts every 'p' event, racing the test thread as it attaches the machines.
+static void SchedPoster( void * data )
+{
+    int i, seq;
+    for (seq=0; seq<SCHED_EVENTS; ++seq) {
+        for (i=0; i<SCHED_MACHINES; ++i) {
+            // a queue fills up until its machine gets attached
+            while (!HsmPostEvent( &gSched[i].machine, &gPosted[i][seq] )) {
+                HsmAtomicPause();
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+hsm_bool SchedulerTest()
+{
+    hsm_bool res= HSM_FALSE;
+    hsm_scheduler_t* scheduler= HsmSchedulerCreate( 4 );
+    if (scheduler) {
+        hsm_thread_t poster;
+        int i, seq, attached=0;
+        memset( gSched, 0, sizeof(gSched) );
+        // small batches: machines get requeued, and change hands, often.
+        HsmSchedulerBatch( scheduler, 4 );
+        for (i=0; i<SCHED_MACHINES; ++i) {
+            hsm_machine hsm= HsmMachine( &gSched[i].machine );
+            for (seq=0; seq<SCHED_EVENTS; ++seq) {
+                gPosted[i][seq].ch= 'p';
+                gRelayed[i][seq].ch= 'r';
+            }
+            HsmMachineQueue( hsm, &gSched[i].queue, gSched[i].slots, SCHED_SLOTS );
+            HsmStart( hsm, SchRun() );
+        }
+        if (HsmThreadStart( &poster, SchedPoster, NULL )) {
+            for (i=0; i<SCHED_MACHINES; ++i) {
+                attached+= HsmSchedulerAttach( scheduler, &gSched[i].machine ) ? 1 : 0;
+            }
+            HsmThreadJoin( &poster );
+            HsmSchedulerWait( scheduler );
+            res= (attached == SCHED_MACHINES) && SchedCheck();
+        }
+        HsmSchedulerDestroy( scheduler );
+    }
+    return res;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file slab_test.c
+ *
+ * Contexts allocated from a machine's slab are reused after they're popped.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "test.h"
+#include <hsm/hsm_slab.h>
+#include <stdio.h>
+
+//---------------------------------------------------------------------------
+typedef struct slab_context_rec slab_context_t;
+struct slab_context_rec {
+    hsm_context_t ctx;
+    int entered;
+};
+
+// a big context, too large for the slab's classes
+typedef struct big_context_rec big_context_t;
+struct big_context_rec {
+    hsm_context_t ctx;
+    char data[ HSM_SLAB_MAX ];
+};
+
+//---------------------------------------------------------------------------
+HSM_STATE( L0, HsmTopState, LA );
+    HSM_STATE_ENTER( LA, L0, 0 );
+    HSM_STATE_ENTER( LB, L0, 0 );
+
+hsm_state L0Event( hsm_status status )
+{
+    return NULL;
+}
+
+hsm_context LAEnter( hsm_status status )
+{
+    slab_context_t* ctx= (slab_context_t*) HsmMachineContextAlloc( status->hsm, sizeof(slab_context_t) );
+    // the memory should always come back zeroed
+    if (ctx && !ctx->entered) {
+        ctx->entered= 1;
+    }
+    return &ctx->ctx;
+}
+
+hsm_state LAEvent( hsm_status status )
+{
+    return (status->evt->ch == 'x') ? LB() : NULL;
+}
+
+hsm_context LBEnter( hsm_status status )
+{
+    return HsmMachineContextAlloc( status->hsm, sizeof(big_context_t) );
+}
+
+hsm_state LBEvent( hsm_status status )
+{
+    return (status->evt->ch == 'x') ? LA() : NULL;
+}
+
+//---------------------------------------------------------------------------
+int SlabTest()
+{
+    hsm_bool res= HSM_FALSE;
+    static CharEvent x= { 'x' };
+    hsm_slab_t slab;
+    hsm_slab_stats_t stats;
+    hsm_context_machine_t machine;
+    hsm_machine hsm= HsmMachineWithContext( &machine, NULL );
+    hsm_context first;
+    int i;
+
+    HsmSlab( &slab, 4 );
+    HsmMachineSlab( hsm, &slab );
+    if (HsmStart( hsm, L0() )) {
+        first= machine.stack.context;
+        res= HSM_TRUE;
+        // LA -> LB -> LA; every trip through LA should reuse the same block.
+        for (i=0; res && i<10; ++i) {
+            HsmSignalEvent( hsm, &x );
+            HsmSignalEvent( hsm, &x );
+            res= machine.stack.context == first && ((slab_context_t*)first)->entered == 1;
+        }
+        HsmSignalEvent( hsm, &x );
+        HsmSlabStats( &slab, &stats );
+        res= res && (stats.allocs == 11) && (stats.hits == 10) && (stats.frees == 11) && (stats.large == 11) &&
+             (slab.classes[1].stats.allocs == 11) && (stats.bytes > 0);
+        if (!res) {
+            printf("allocs %ld hits %ld frees %ld large %ld\n", stats.allocs, stats.hits, stats.frees, stats.large );
+        }
+        HsmSignalEvent( hsm, &x );
+    }
+    HsmSlabRelease( &slab );
+    // contexts never freed before aren't hits, even when their page already exists.
+    if (res) {
+        hsm_context a= HsmSlabAlloc( &slab, sizeof(slab_context_t) );
+        hsm_context b= HsmSlabAlloc( &slab, sizeof(slab_context_t) );
+        HsmSlabStats( &slab, &stats );
+        res= a && b && (stats.allocs == 2) && (stats.hits == 0) && (slab.classes[1].stats.bytes > 0);
+        a->popped( a );
+        a= HsmSlabAlloc( &slab, sizeof(slab_context_t) );
+        HsmSlabStats( &slab, &stats );
+        res= res && (stats.allocs == 3) && (stats.hits == 1);
+        HsmSlabRelease( &slab );
+    }
+    return res;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file stats_test.c
+ *
+ * Latency histograms: bucketing, percentiles, and, when built with HSM_USE_STATS, timing a machine.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "test.h"
+#include <hsm/hsm_chart.h>
+#include <hsm/hsm_stats.h>
+#include <stdio.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+// 'b' enters busy, 'i' goes back to idle.
+HSM_STATE( SRoot, HsmTopState, SIdle );
+    HSM_STATE( SIdle, SRoot, 0 );
+    HSM_STATE_ENTER( SBusy, SRoot, 0 );
+
+hsm_state SRootEvent( hsm_status status )
+{
+    return status->evt->ch == 'i' ? SIdle() : NULL;
+}
+
+hsm_state SIdleEvent( hsm_status status )
+{
+    return status->evt->ch == 'b' ? SBusy() : NULL;
+}
+
+hsm_context SBusyEnter( hsm_status status )
+{
+    return status->ctx;
+}
+
+hsm_state SBusyEvent( hsm_status status )
+{
+    return NULL;
+}
+
+//---------------------------------------------------------------------------
+// every recorded value lands in a bucket whose bound is within an eighth of it.
+int HistogramTest()
+{
+    static hsm_histogram_t histogram;
+    hsm_bool res= HSM_TRUE;
+    hsm_uint64 v;
+    memset( &histogram, 0, sizeof(histogram) );
+    res= (HsmHistogramPercentile( &histogram, 50 ) == 0);
+
+    for (v=1; res && v < ((hsm_uint64)1 << 36); v= v*3/2 + 1) {
+        hsm_uint64 bound;
+        memset( &histogram, 0, sizeof(histogram) );
+        HsmHistogramRecord( &histogram, v );
+        HsmHistogramRecord( &histogram, v*2 );
+        // the median's bucket holds v: its bound is at least v, and not much more.
+        bound= HsmHistogramPercentile( &histogram, 50 );
+        res= (bound >= v) && (bound - v <= v/8) && (HsmHistogramPercentile( &histogram, 100 ) == v*2);
+        if (!res) {
+            printf("value %llu bound %llu\n", (unsigned long long) v, (unsigned long long) bound );
+        }
+    }
+
+    // 1..100: percentiles come out close to themselves.
+    memset( &histogram, 0, sizeof(histogram) );
+    for (v=1; v<=100; ++v) {
+        HsmHistogramRecord( &histogram, v );
+    }
+    res= res && (histogram.count == 100) && (histogram.total == 5050) &&
+        (histogram.min == 1) && (histogram.max == 100) &&
+        (HsmHistogramPercentile( &histogram, 0 ) == 1) &&
+        (HsmHistogramPercentile( &histogram, 50 ) >= 50) && (HsmHistogramPercentile( &histogram, 50 ) <= 55) &&
+        (HsmHistogramPercentile( &histogram, 99 ) >= 99) && (HsmHistogramPercentile( &histogram, 100 ) == 100);
+
+    // huge values pile into the last bucket, but keep their max.
+    HsmHistogramRecord( &histogram, (hsm_uint64)-1 );
+    res= res && (histogram.buckets[ HSM_HISTOGRAM_BUCKETS-1 ] == 1) && (histogram.max == (hsm_uint64)-1);
+    return res;
+}
+
+//---------------------------------------------------------------------------
+int StatsTest()
+{
+    hsm_bool res= HSM_FALSE;
+    hsm_state states[]= { SRoot(), SIdle(), SBusy() };
+    hsm_chart_t chart;
+    hsm_stats_t stats;
+    if (HsmChartCompile( &chart, states, 3 )) {
+        if (HsmStatsCreate( &stats, &chart )) {
+            res= (HsmStatsHistogram( &stats, SBusy(), HSM_STATS_ENTER ) != NULL) &&
+                 (HsmStatsHistogram( &stats, HsmStateError(), HSM_STATS_ENTER ) == NULL) &&
+                 (HsmStatsHistogram( &stats, SBusy(), HSM_STATS_KINDS ) == NULL);
+#ifdef HSM_USE_STATS
+            {
+                hsm_machine_t machine;
+                hsm_machine_stats_t machine_stats;
+                hsm_machine hsm= HsmMachine( &machine );
+                CharEvent busy= { 'b' }, idle= { 'i' };
+                int i;
+                res= res && HsmMachineStats( hsm, &machine_stats, &stats ) && HsmStart( hsm, SRoot() );
+                for (i=0; res && i<10; ++i) {
+                    res= HsmSignalEvent( hsm, &busy ) && HsmSignalEvent( hsm, &idle );
+                }
+                // busy processes nothing itself, so every 'i' asks busy and then root.
+                res= res && (machine_stats.run.count == 20) &&
+                    (HsmStatsHistogram( &stats, SBusy(), HSM_STATS_ENTER )->count == 10) &&
+                    (HsmStatsHistogram( &stats, SBusy(), HSM_STATS_PROCESS )->count == 10) &&
+                    (HsmStatsHistogram( &stats, SRoot(), HSM_STATS_PROCESS )->count == 10) &&
+                    (HsmStatsHistogram( &stats, SIdle(), HSM_STATS_PROCESS )->count == 10) &&
+                    (HsmStatsHistogram( &stats, SRoot(), HSM_STATS_ENTER )->count == 0);
+                HsmStatsReset( &stats );
+                res= res && (HsmStatsHistogram( &stats, SBusy(), HSM_STATS_ENTER )->count == 0);
+            }
+#endif
+            HsmStatsRelease( &stats );
+        }
+        HsmChartRelease( &chart );
+    }
+    return res;
+}
@@ -0,0 +1,492 @@
+/**
+ * @file stress.c
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "test.h"
+#include "stress.h"
+#include <hsm/hsm_chart.h>
+#include <hsm/hsm_context.h>
+#include <hsm/builder/hsm_builder.h>
+#include <stdlib.h>
+#include <string.h>
+
+// events signaled together in STRESS_BATCH
+#define STRESS_BATCH_SIZE 64
+
+// kinds of records hashed by a run
+#define STRESS_RECORD_ENTER   1
+#define STRESS_RECORD_EXIT    2
+#define STRESS_RECORD_HANDLED 3
+
+//---------------------------------------------------------------------------
+/**
+ * The checker's view of a machine: the states it believes are active, and their contexts.
+ * Callbacks compare what the machine tells them against this, and then update it.
+ */
+typedef struct stress_check_rec stress_check_t;
+struct stress_check_rec {
+    const stress_chart_t* chart;
+    hsm_state* lookup;          // index to the state the mode's machine sees.
+    hsm_context_t root;         // context for the whole machine.
+    int* active;                // state index, by depth.
+    hsm_context* contexts;      // context of each active state, by depth.
+    int top;                    // number of active states.
+    stress_result_t* result;
+};
+
+// the run in progress; the harness is single threaded.
+static stress_check_t* gCheck;
+
+//---------------------------------------------------------------------------
+// xorshift: the same charts, and events, everywhere.
+static unsigned int StressRandom( unsigned int* seed )
+{
+    unsigned int x= *seed;
+    x^= x << 13;
+    x^= x >> 17;
+    x^= x << 5;
+    return *seed= x;
+}
+
+//---------------------------------------------------------------------------
+static void StressFail( stress_check_t* check, const char * why )
+{
+    if (!check->result->failures++) {
+        check->result->why= why;
+    }
+}
+
+//---------------------------------------------------------------------------
+static void StressRecord( stress_check_t* check, int kind, int index )
+{
+    const unsigned int record= (kind << 24) | index;
+    int i;
+    for (i=0; i<4; ++i) {
+        check->result->hash= (check->result->hash ^ ((record >> (8*i)) & 0xff)) * 1099511628211ull;
+    }
+}
+
+//---------------------------------------------------------------------------
+// Checked callbacks: shared by the records and the builder.
+//---------------------------------------------------------------------------
+static hsm_context StressOnEnter( hsm_status status, int index )
+{
+    stress_check_t* check= gCheck;
+    const stress_node_t* node= check->chart->nodes + index;
+    const hsm_context parent_ctx= check->top ? check->contexts[ check->top-1 ] : &check->root;
+    hsm_context ctx= status->ctx;
+    if (node->depth != check->top) {
+        StressFail( check, "entered a state at the wrong depth" );
+    }
+    else
+    if (check->top ? check->active[ check->top-1 ] != node->parent : node->parent >= 0) {
+        StressFail( check, "entered a state before its parent" );
+    }
+    else
+    if (status->ctx != parent_ctx) {
+        StressFail( check, "enter didn't get its parent's context" );
+    }
+    if (node->owns_context) {
+        ctx= &check->chart->contexts[ index ];
+    }
+    if (check->top <= check->chart->max_depth) {
+        check->active[ check->top ]= index;
+        check->contexts[ check->top ]= ctx;
+        ++check->top;
+    }
+    ++check->result->enters;
+    StressRecord( check, STRESS_RECORD_ENTER, index );
+    return ctx;
+}
+
+//---------------------------------------------------------------------------
+static void StressOnExit( hsm_status status, int index )
+{
+    stress_check_t* check= gCheck;
+    if (!check->top || check->active[ check->top-1 ] != index) {
+        StressFail( check, "exited a state that wasn't the innermost" );
+    }
+    else {
+        if (status->ctx != check->contexts[ check->top-1 ]) {
+            StressFail( check, "exit didn't get the context enter made" );
+        }
+        --check->top;
+    }
+    ++check->result->exits;
+    StressRecord( check, STRESS_RECORD_EXIT, index );
+}
+
+//---------------------------------------------------------------------------
+static void StressOnHandled( hsm_status status, int index )
+{
+    stress_check_t* check= gCheck;
+    const int depth= check->chart->nodes[ index ].depth;
+    if (depth >= check->top || check->active[ depth ] != index) {
+        StressFail( check, "an inactive state handled an event" );
+    }
+    else
+    if (status->ctx != check->contexts[ depth ]) {
+        StressFail( check, "handler didn't get its state's context" );
+    }
+    ++check->result->handled;
+    StressRecord( check, STRESS_RECORD_HANDLED, index );
+}
+
+//---------------------------------------------------------------------------
+// after every event: the machine and the checker agree, and the machine sits in a leaf.
+static void StressSettled( stress_check_t* check, hsm_machine hsm )
+{
+    if (!check->top || check->lookup[ check->active[ check->top-1 ] ] != hsm->current) {
+        StressFail( check, "machine isn't in the state the checker expects" );
+    }
+    else
+    if (hsm->current->depth != check->top-1) {
+        StressFail( check, "machine depth disagrees with the checker" );
+    }
+    else
+    if (check->chart->nodes[ check->active[ check->top-1 ] ].child_count) {
+        StressFail( check, "machine settled in a state with children" );
+    }
+}
+
+//---------------------------------------------------------------------------
+// HSM_STATE style callbacks: the state's position in the records is its index.
+//---------------------------------------------------------------------------
+static hsm_context StressEnter( hsm_status status )
+{
+    return StressOnEnter( status, (int)(status->state - gCheck->chart->states) );
+}
+
+static void StressExit( hsm_status status )
+{
+    StressOnExit( status, (int)(status->state - gCheck->chart->states) );
+}
+
+static hsm_state StressEvent( hsm_status status )
+{
+    hsm_state ret= NULL;
+    const int index= (int)(status->state - gCheck->chart->states);
+    const int handler= gCheck->chart->nodes[ index ].handlers[ (int) status->evt->ch ];
+    if (handler != STRESS_PASS) {
+        StressOnHandled( status, index );
+        ret= handler == STRESS_HANDLED ? HsmStateHandled() : gCheck->chart->states + handler;
+    }
+    return ret;
+}
+
+//---------------------------------------------------------------------------
+// builder callbacks: the index rides along as user data.
+//---------------------------------------------------------------------------
+static hsm_context StressEnterUD( hsm_status status, void * index )
+{
+    return StressOnEnter( status, (int)(size_t) index );
+}
+
+static void StressExitUD( hsm_status status, void * index )
+{
+    StressOnExit( status, (int)(size_t) index );
+}
+
+static hsm_bool StressGuardUD( hsm_status status, void * type )
+{
+    return status->evt->ch == (char)(size_t) type;
+}
+
+static void StressRunUD( hsm_status status, void * index )
+{
+    StressOnHandled( status, (int)(size_t) index );
+}
+
+static int StressEventType( hsm_event evt )
+{
+    return evt->ch;
+}
+
+//---------------------------------------------------------------------------
+// Generator
+//---------------------------------------------------------------------------
+hsm_bool StressGenerate( stress_chart_t* chart, const stress_spec_t* spec )
+{
+    hsm_bool okay;
+    const int max= spec->max_states > 0 ? spec->max_states : 1;
+    unsigned int seed= spec->seed ? spec->seed : 1;
+    memset( chart, 0, sizeof(stress_chart_t) );
+    chart->nodes= (stress_node_t*) calloc( max, sizeof(stress_node_t) );
+    chart->states= (struct hsm_state_rec*) calloc( max, sizeof(struct hsm_state_rec) );
+    chart->names= (char(*)[16]) calloc( max, sizeof(chart->names[0]) );
+    chart->contexts= (hsm_context_t*) calloc( max, sizeof(hsm_context_t) );
+    okay= chart->nodes && chart->states && chart->names && chart->contexts;
+    if (!okay) {
+        StressRelease( chart );
+    }
+    else {
+        int i, t;
+        // breadth first: every state's children are contiguous, and come after it.
+        chart->nodes[0].parent= -1;
+        chart->count= 1;
+        for (i=0; i<chart->count; ++i) {
+            stress_node_t* node= chart->nodes + i;
+            node->first_child= -1;
+            if (node->depth < spec->depth) {
+                // states can be leaves at any depth, but first children always continue:
+                // so the chart reaches the full depth.
+                int children= (int)(StressRandom( &seed ) % (spec->width + 1));
+                if (!children && (!i || chart->nodes[ node->parent ].first_child == i)) {
+                    children= 1;
+                }
+                if (children > max - chart->count) {
+                    children= max - chart->count;
+                }
+                if (children) {
+                    int c;
+                    node->first_child= chart->count;
+                    node->child_count= children;
+                    for (c=0; c<children; ++c) {
+                        stress_node_t* child= chart->nodes + chart->count++;
+                        child->parent= i;
+                        child->depth= node->depth+1;
+                        if (child->depth > chart->max_depth) {
+                            chart->max_depth= child->depth;
+                        }
+                    }
+                }
+            }
+        }
+        for (i=0; i<chart->count; ++i) {
+            stress_node_t* node= chart->nodes + i;
+            struct hsm_state_rec* state= chart->states + i;
+            hsm_bool handles= HSM_FALSE;
+            node->owns_context= (StressRandom( &seed ) % 3) == 0;
+            for (t=0; t<STRESS_EVENT_TYPES; ++t) {
+                int handler= STRESS_PASS;
+                if ((int)(StressRandom( &seed ) % 100) < spec->density) {
+                    handler= (StressRandom( &seed ) % 4) == 0 ? STRESS_HANDLED : (int)(StressRandom( &seed ) % chart->count);
+                    state->interests|= HSM_INTEREST( t );
+                    handles= HSM_TRUE;
+                }
+                node->handlers[t]= handler;
+            }
+            sprintf( chart->names[i], "S%d", i );
+            state->name= chart->names[i];
+            state->process= handles ? StressEvent : NULL;
+            state->enter= StressEnter;
+            state->exit= StressExit;
+            state->parent= node->parent >= 0 ? chart->states + node->parent : NULL;
+            state->depth= node->depth;
+            state->initial= node->first_child >= 0 ? chart->states + node->first_child : NULL;
+        }
+    }
+    return okay;
+}
+
+//---------------------------------------------------------------------------
+void StressRelease( stress_chart_t* chart )
+{
+    free( chart->nodes );
+    free( chart->states );
+    free( chart->names );
+    free( chart->contexts );
+    memset( chart, 0, sizeof(stress_chart_t) );
+}
+
+//---------------------------------------------------------------------------
+void StressWriteChart( const stress_chart_t* chart, FILE* out )
+{
+    int i, t;
+    fprintf( out, "// %d states, events are CharEvents with ch 0 to %d\n", chart->count, STRESS_EVENT_TYPES-1 );
+    for (i=0; i<chart->count; ++i) {
+        const stress_node_t* node= chart->nodes + i;
+        fprintf( out, "HSM_STATE_ENTERX( S%d, ", i );
+        if (node->parent >= 0) {
+            fprintf( out, "S%d, ", node->parent );
+        }
+        else {
+            fprintf( out, "HsmTopState, " );
+        }
+        if (node->first_child >= 0) {
+            fprintf( out, "S%d );\n", node->first_child );
+        }
+        else {
+            fprintf( out, "0 );\n" );
+        }
+    }
+    for (i=0; i<chart->count; ++i) {
+        const stress_node_t* node= chart->nodes + i;
+        fprintf( out, "\nhsm_context S%dEnter( hsm_status status ) { return %s; }\n", i,
+            node->owns_context ? "HsmContextAlloc( sizeof(hsm_context_t) )" : "status->ctx" );
+        fprintf( out, "void S%dExit( hsm_status status ) {}\n", i );
+        fprintf( out, "hsm_state S%dEvent( hsm_status status )\n{\n    switch (status->evt->ch) {\n", i );
+        for (t=0; t<STRESS_EVENT_TYPES; ++t) {
+            if (node->handlers[t] == STRESS_HANDLED) {
+                fprintf( out, "        case %d: return HsmStateHandled();\n", t );
+            }
+            else
+            if (node->handlers[t] >= 0) {
+                fprintf( out, "        case %d: return S%d();\n", t, node->handlers[t] );
+            }
+        }
+        fprintf( out, "    }\n    return NULL;\n}\n" );
+    }
+}
+
+//---------------------------------------------------------------------------
+// Runner
+//---------------------------------------------------------------------------
+const char * StressModeName( stress_mode_t mode )
+{
+    static const char * names[ STRESS_MODES ]= {
+        "walk", "compiled", "interests", "wide", "dense", "batch", "builder", "builder compiled"
+    };
+    return (mode >= 0 && mode < STRESS_MODES) ? names[ mode ] : "unknown";
+}
+
+//---------------------------------------------------------------------------
+// build a state, and its children, with the same handlers the records have.
+static void StressBuild( const stress_chart_t* chart, const int* ids, int index )
+{
+    const stress_node_t* node= chart->nodes + index;
+    int t, c;
+    hsmBegin( chart->names[ index ], 0 );
+    hsmOnEnterUD( StressEnterUD, (void*)(size_t) index );
+    hsmOnExitUD( StressExitUD, (void*)(size_t) index );
+    for (t=0; t<STRESS_EVENT_TYPES; ++t) {
+        if (node->handlers[t] != STRESS_PASS) {
+            hsmIfUD( StressGuardUD, (void*)(size_t) t );
+            hsmRunUD( StressRunUD, (void*)(size_t) index );
+            if (node->handlers[t] >= 0) {
+                hsmGotoId( ids[ node->handlers[t] ] );
+            }
+        }
+    }
+    // the first child built becomes the initial state
+    for (c=0; c<node->child_count; ++c) {
+        StressBuild( chart, ids, node->first_child + c );
+    }
+    hsmEnd();
+}
+
+//---------------------------------------------------------------------------
+static void StressSignal( stress_check_t* check, hsm_machine hsm, stress_mode_t mode, long events, unsigned int seed )
+{
+    CharEvent batch[ STRESS_BATCH_SIZE ];
+    hsm_event pointers[ STRESS_BATCH_SIZE ];
+    long sent= 0;
+    int i;
+    for (i=0; i<STRESS_BATCH_SIZE; ++i) {
+        pointers[i]= &batch[i];
+    }
+    seed= seed ? seed : 1;
+    while (sent < events && !check->result->failures) {
+        if (mode == STRESS_BATCH) {
+            const int count= events-sent < STRESS_BATCH_SIZE ? (int)(events-sent) : STRESS_BATCH_SIZE;
+            for (i=0; i<count; ++i) {
+                batch[i].ch= (char)(StressRandom( &seed ) % STRESS_EVENT_TYPES);
+            }
+            if (HsmSignalEvents( hsm, pointers, count, NULL ) != count) {
+                StressFail( check, "batch stopped early" );
+            }
+            sent+= count;
+        }
+        else {
+            batch[0].ch= (char)(StressRandom( &seed ) % STRESS_EVENT_TYPES);
+            HsmSignalEvent( hsm, &batch[0] );
+            ++sent;
+        }
+        StressSettled( check, hsm );
+    }
+    check->result->events= sent;
+}
+
+//---------------------------------------------------------------------------
+hsm_bool StressRun( const stress_chart_t* chart, stress_mode_t mode, long events, unsigned int seed, stress_result_t* result )
+{
+    hsm_bool okay= HSM_FALSE;
+    const hsm_bool builder= (mode == STRESS_BUILDER || mode == STRESS_BUILDER_COMPILED);
+    const hsm_bool compiled= (mode == STRESS_COMPILED || mode == STRESS_INTERESTS || mode == STRESS_DENSE ||
+                              mode == STRESS_BATCH || mode == STRESS_BUILDER_COMPILED);
+    // charts too deep for the default stack always get a wide one.
+    const hsm_bool wide= (mode == STRESS_WIDE || mode == STRESS_DENSE || chart->max_depth+1 >= HSM_MAX_DEPTH);
+    stress_check_t check;
+    hsm_context_machine_t machine;
+    hsm_context_wide_t wide_bits;
+    hsm_chart_t compiled_chart;
+    hsm_bool have_chart= HSM_FALSE, started= HSM_FALSE;
+    hsm_machine hsm;
+    int* ids= NULL;
+    int i;
+
+    memset( result, 0, sizeof(stress_result_t) );
+    result->hash= 14695981039346656037ull;
+    memset( &check, 0, sizeof(check) );
+    check.chart= chart;
+    check.result= result;
+    check.lookup= (hsm_state*) malloc( chart->count * sizeof(hsm_state) );
+    check.active= (int*) malloc( (chart->max_depth+1) * sizeof(int) );
+    check.contexts= (hsm_context*) malloc( (chart->max_depth+1) * sizeof(hsm_context) );
+    okay= check.lookup && check.active && check.contexts;
+
+    if (okay && builder) {
+        ids= (int*) malloc( chart->count * sizeof(int) );
+        okay= started= ids && hsmStartup();
+        if (okay) {
+            for (i=0; i<chart->count; ++i) {
+                ids[i]= hsmState( chart->names[i] );
+            }
+            StressBuild( chart, ids, 0 );
+            for (i=0; okay && i<chart->count; ++i) {
+                okay= (check.lookup[i]= hsmResolveId( ids[i] )) != NULL;
+            }
+        }
+    }
+    else if (okay) {
+        for (i=0; i<chart->count; ++i) {
+            check.lookup[i]= chart->states + i;
+        }
+    }
+
+    if (okay && compiled) {
+        okay= have_chart= builder ? hsmCompileId( ids[0], &compiled_chart ) : HsmChartCompile( &compiled_chart, check.lookup, chart->count );
+        if (okay && mode == STRESS_INTERESTS) {
+            okay= HsmChartEventTypes( &compiled_chart, StressEventType );
+        }
+    }
+
+    if (okay) {
+        hsm_context* dense= NULL;
+        hsm= wide ? HsmMachineWithWideContext( &machine, &wide_bits, &check.root ) : HsmMachineWithContext( &machine, &check.root );
+        if (mode == STRESS_DENSE) {
+            dense= (hsm_context*) malloc( (chart->max_depth+1) * sizeof(hsm_context) );
+            if (dense) {
+                HsmContextStackDense( &machine.stack, dense, chart->max_depth+1 );
+            }
+        }
+        gCheck= &check;
+        okay= HsmStart( hsm, check.lookup[0] );
+        if (okay) {
+            StressSettled( &check, hsm );
+            StressSignal( &check, hsm, mode, events, seed );
+        }
+        gCheck= NULL;
+        free( dense );
+        if (wide) {
+            HsmContextWideRelease( &wide_bits );
+        }
+    }
+
+    if (have_chart) {
+        HsmChartRelease( &compiled_chart );
+    }
+    if (started) {
+        hsmShutdown();
+    }
+    free( ids );
+    free( check.lookup );
+    free( check.active );
+    free( check.contexts );
+    return okay;
+}
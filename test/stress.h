@@ -0,0 +1,152 @@
+/**
+ * @file stress.h
+ *
+ * Random charts, driven by random events, checked without strings.
+ *
+ * A generated chart exists both as HSM_STATE style records and as builder calls;
+ * every mode of the engine runs the same chart on the same events,
+ * a binary checker validates each callback as it happens,
+ * and the modes must agree on a hash of everything entered, exited, and handled.
+ *
+ * \internal
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#pragma once
+#ifndef __STRESS_H__
+#define __STRESS_H__
+
+#include <hsm/hsm_machine.h>
+#include <stdio.h>
+
+// event types: events are CharEvents with ch from 0 to STRESS_EVENT_TYPES-1
+#define STRESS_EVENT_TYPES 8
+
+// handler entries which aren't state indices
+#define STRESS_PASS     -1
+#define STRESS_HANDLED  -2
+
+typedef struct stress_spec_rec stress_spec_t;
+typedef struct stress_node_rec stress_node_t;
+typedef struct stress_chart_rec stress_chart_t;
+typedef struct stress_result_rec stress_result_t;
+
+//---------------------------------------------------------------------------
+/**
+ * Shape of a chart to generate.
+ */
+struct stress_spec_rec
+{
+    int depth;          // deepest state; the root is depth 0.
+    int width;          // most children of any one state.
+    int density;        // percent chance that a state handles any given event type.
+    int max_states;     // cap on the total number of states.
+    unsigned int seed;  // same seed, same chart.
+};
+
+/**
+ * One generated state, by index; the root is index 0, and children follow their parents.
+ */
+struct stress_node_rec
+{
+    int parent;
+    int depth;
+    int first_child;    // also the initial state; -1 for leaves.
+    int child_count;
+    hsm_bool owns_context;
+    int handlers[ STRESS_EVENT_TYPES ]; // target index, STRESS_HANDLED, or STRESS_PASS.
+};
+
+/**
+ * A generated chart.
+ */
+struct stress_chart_rec
+{
+    int count;
+    int max_depth;
+    stress_node_t* nodes;
+
+    /**
+     * the same records HSM_STATE declares, one per node.
+     */
+    struct hsm_state_rec* states;
+
+    /**
+     * storage for the state names.
+     */
+    char (*names)[16];
+
+    /**
+     * storage for the context of every state which owns one.
+     */
+    hsm_context_t* contexts;
+};
+
+/**
+ * Ways to run a chart; each must produce the same result.
+ */
+typedef enum stress_mode
+{
+    STRESS_WALK,            // records, walking parents
+    STRESS_COMPILED,        // records, in a compiled chart
+    STRESS_INTERESTS,       // compiled, skipping states uninterested in an event
+    STRESS_WIDE,            // walking, with a wide context stack
+    STRESS_DENSE,           // compiled, with a wide stack and a dense context array
+    STRESS_BATCH,           // compiled, events signaled in batches
+    STRESS_BUILDER,         // the same chart via builder calls
+    STRESS_BUILDER_COMPILED,// builder states, in a compiled chart
+    STRESS_MODES
+}
+stress_mode_t;
+
+/**
+ * Everything a run saw.
+ */
+struct stress_result_rec
+{
+    hsm_uint64 hash;        // fnv-1a of every enter, exit, and handled record, in order.
+    long events;
+    long enters;
+    long exits;
+    long handled;
+    long failures;          // invariants broken.
+    const char * why;       // the first invariant broken.
+};
+
+/**
+ * Generate a random chart.
+ * @return HSM_FALSE if out of memory.
+ */
+hsm_bool StressGenerate( stress_chart_t* chart, const stress_spec_t* spec );
+
+/**
+ * Free a generated chart.
+ */
+void StressRelease( stress_chart_t* chart );
+
+/**
+ * Write the chart as C source using HSM_STATE, for reproducing a failure outside the harness.
+ */
+void StressWriteChart( const stress_chart_t* chart, FILE* out );
+
+/**
+ * Start a chart in the given mode, and signal it random events, checking every callback.
+ *
+ * @param chart Generated chart.
+ * @param mode Engine mode.
+ * @param events Number of events to signal.
+ * @param seed Same seed, same events.
+ * @param result Filled with what the run saw.
+ * @return HSM_FALSE if the run couldn't start.
+ */
+hsm_bool StressRun( const stress_chart_t* chart, stress_mode_t mode, long events, unsigned int seed, stress_result_t* result );
+
+/**
+ * Name of a mode, for reporting.
+ */
+const char * StressModeName( stress_mode_t mode );
+
+#endif // #ifndef __STRESS_H__
@@ -0,0 +1,80 @@
+/**
+ * @file stress_test.c
+ *
+ * Random charts, random events: every engine mode must pass the checker, and agree with every other mode.
+ * Define STRESS_EVENTS for longer runs.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "test.h"
+#include "stress.h"
+#include <stdio.h>
+
+#ifndef STRESS_EVENTS
+#define STRESS_EVENTS 100000
+#endif
+
+//---------------------------------------------------------------------------
+static hsm_bool StressCompareModes( const stress_spec_t* spec, long events )
+{
+    hsm_bool res= HSM_FALSE;
+    stress_chart_t chart;
+    if (StressGenerate( &chart, spec )) {
+        stress_result_t first= { 0 };
+        int mode;
+        printf( "\t%d states, depth %d\n", chart.count, chart.max_depth );
+        res= HSM_TRUE;
+        for (mode=0; res && mode<STRESS_MODES; ++mode) {
+            stress_result_t result;
+            res= StressRun( &chart, (stress_mode_t) mode, events, spec->seed ^ 0x5eed, &result );
+            if (!res) {
+                printf( "\t%s: couldn't run\n", StressModeName( mode ) );
+            }
+            else
+            if (result.failures) {
+                printf( "\t%s: %ld failures, first: %s\n", StressModeName( mode ), result.failures, result.why );
+                res= HSM_FALSE;
+            }
+            else
+            if (!mode) {
+                first= result;
+            }
+            else
+            if (result.hash != first.hash || result.enters != first.enters ||
+                result.exits != first.exits || result.handled != first.handled) {
+                printf( "\t%s: disagrees with %s\n", StressModeName( mode ), StressModeName( 0 ) );
+                res= HSM_FALSE;
+            }
+        }
+        if (res) {
+            printf( "\t%ld events: %ld enters, %ld exits, %ld handled\n", first.events, first.enters, first.exits, first.handled );
+        }
+        else {
+            StressWriteChart( &chart, stdout );
+        }
+        StressRelease( &chart );
+    }
+    return res;
+}
+
+//---------------------------------------------------------------------------
+int StressTest()
+{
+    const stress_spec_t specs[]= {
+        //depth, width, density, max_states, seed
+        {  3,  6, 30,  100, 1 },
+        {  6,  3, 15,  300, 2 },
+        { 12,  2, 40,  500, 3 },
+        { 40,  2, 25,  600, 4 },  // deeper than HSM_MAX_DEPTH: wide stacks only
+    };
+    hsm_bool res= HSM_TRUE;
+    int i;
+    for (i=0; res && i< sizeof(specs)/sizeof(specs[0]); ++i) {
+        res= StressCompareModes( &specs[i], STRESS_EVENTS );
+    }
+    return res;
+}
@@ -113,7 +113,35 @@ hsm_bool InitSequence()
 //---------------------------------------------------------------------------
 
 hsm_bool SamekPlusTest();
+hsm_bool SamekPlusChartTest();
 hsm_bool SamekPlusBuilderTest();
+hsm_bool SamekPlusBuilderChartTest();
+hsm_bool SamekPlusBuilderKeyedTest();
+hsm_bool QueueTest();
+hsm_bool BatchTest();
+hsm_bool PoolTest();
+hsm_bool InfoTest();
+hsm_bool SlabTest();
+hsm_bool WideTest();
+hsm_bool WideDenseTest();
+hsm_bool InterestTest();
+hsm_bool ActiveTest();
+hsm_bool HistoryTest();
+hsm_bool HistoryBuilderTest();
+hsm_bool RegionTest();
+hsm_bool RegionRunTest();
+hsm_bool RegionServicesTest();
+hsm_bool DeferTest();
+hsm_bool TimerTest();
+hsm_bool TimerManyTest();
+hsm_bool HistogramTest();
+hsm_bool StatsTest();
+hsm_bool StressTest();
+hsm_bool TraceTest();
+hsm_bool SchedulerTest();
+hsm_bool RegionThreadsTest();
+hsm_bool SamekPlusCppTest();
+hsm_bool BuilderIdsCppTest();
 
 // this is turned on in test.vcxproj
 #ifdef TEST_LUA
@@ -143,7 +171,35 @@ int main(int argc, char* argv[])
   tests+= RUN_TEST( EmptySequence );
   tests+= RUN_TEST( InitSequence );
   tests+= RUN_TEST( SamekPlusTest );
+  tests+= RUN_TEST( SamekPlusChartTest );
   tests+= RUN_TEST( SamekPlusBuilderTest );
+  tests+= RUN_TEST( SamekPlusBuilderChartTest );
+  tests+= RUN_TEST( SamekPlusBuilderKeyedTest );
+  tests+= RUN_TEST( SamekPlusCppTest );
+  tests+= RUN_TEST( BuilderIdsCppTest );
+  tests+= RUN_TEST( QueueTest );
+  tests+= RUN_TEST( BatchTest );
+  tests+= RUN_TEST( PoolTest );
+  tests+= RUN_TEST( InfoTest );
+  tests+= RUN_TEST( SlabTest );
+  tests+= RUN_TEST( WideTest );
+  tests+= RUN_TEST( WideDenseTest );
+  tests+= RUN_TEST( InterestTest );
+  tests+= RUN_TEST( ActiveTest );
+  tests+= RUN_TEST( HistoryTest );
+  tests+= RUN_TEST( HistoryBuilderTest );
+  tests+= RUN_TEST( RegionTest );
+  tests+= RUN_TEST( RegionRunTest );
+  tests+= RUN_TEST( RegionServicesTest );
+  tests+= RUN_TEST( DeferTest );
+  tests+= RUN_TEST( TimerTest );
+  tests+= RUN_TEST( TimerManyTest );
+  tests+= RUN_TEST( HistogramTest );
+  tests+= RUN_TEST( StatsTest );
+  tests+= RUN_TEST( StressTest );
+  tests+= RUN_TEST( TraceTest );
+  tests+= RUN_TEST( SchedulerTest );
+  tests+= RUN_TEST( RegionThreadsTest );
 #ifdef TEST_LUA
   tests+= RUN_TEST( MatchEvents );
   tests+= RUN_TEST( LuaTest );
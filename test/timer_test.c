@@ -0,0 +1,169 @@
+/**
+ * @file timer_test.c
+ *
+ * State timeouts on a shared timing wheel.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "test.h"
+#include <hsm/hsm_timer.h>
+#include <stdio.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+// 'w' waits for a short timeout, 'l' for some very long ones; either way the timeouts end up done.
+HSM_STATE( TRoot, HsmTopState, TIdle );
+    HSM_STATE( TIdle, TRoot, 0 );
+    HSM_STATE_ENTER( TWait, TRoot, 0 );
+    HSM_STATE_ENTER( TLong, TRoot, 0 );
+    HSM_STATE( TDone, TRoot, 0 );
+
+static CharEvent gTimeout= { 't' };
+static CharEvent gLevel3= { 'x' };
+static CharEvent gBeyond= { 'y' };
+static CharEvent gNever= { 'n' };
+static int gLevel3Heard;
+
+// the longest the wheel spans without riding around the top level
+#define TIMER_SPAN (1UL << (HSM_WHEEL_BITS*HSM_WHEEL_LEVELS))
+
+hsm_state TRootEvent( hsm_status status )
+{
+    // nothing should ever hear this: its timer gets cancelled.
+    return status->evt->ch == 'n' ? HsmStateError() : NULL;
+}
+
+hsm_state TIdleEvent( hsm_status status )
+{
+    hsm_state ret= NULL;
+    switch (status->evt->ch) {
+        case 'w': ret= TWait(); break;
+        case 'l': ret= TLong(); break;
+    }
+    return ret;
+}
+
+hsm_context TWaitEnter( hsm_status status )
+{
+    HsmArmTimer( status, 10, &gTimeout );
+    HsmArmTimer( status, 100000, &gNever );
+    return status->ctx;
+}
+
+hsm_state TWaitEvent( hsm_status status )
+{
+    return status->evt->ch == 't' ? TDone() : NULL;
+}
+
+hsm_context TLongEnter( hsm_status status )
+{
+    HsmArmTimer( status, 300000, &gLevel3 );
+    HsmArmTimer( status, TIMER_SPAN + 12345, &gBeyond );
+    return status->ctx;
+}
+
+hsm_state TLongEvent( hsm_status status )
+{
+    hsm_state ret= NULL;
+    switch (status->evt->ch) {
+        case 'x': ++gLevel3Heard; ret= HsmStateHandled(); break;
+        case 'y': ret= TDone(); break;
+    }
+    return ret;
+}
+
+hsm_state TDoneEvent( hsm_status status )
+{
+    return NULL;
+}
+
+//---------------------------------------------------------------------------
+static hsm_bool TimerSend( hsm_machine hsm, char ch )
+{
+    CharEvent evt;
+    evt.ch= ch;
+    return HsmSignalEvent( hsm, &evt );
+}
+
+//---------------------------------------------------------------------------
+int TimerTest()
+{
+    hsm_bool res;
+    hsm_wheel_t wheel;
+    hsm_machine_t one, two;
+    hsm_timers_t timers1, timers2;
+    hsm_timer_t storage1[2], storage2[2];
+    hsm_machine hsm1= HsmMachine( &one );
+    hsm_machine hsm2= HsmMachine( &two );
+    // start off near the top of the tick range, so the wheel has to wrap
+    const unsigned long start= ((unsigned long)-1) - 1000;
+    HsmWheel( &wheel, start );
+    gLevel3Heard= 0;
+
+    res= HsmMachineTimers( hsm1, &timers1, &wheel, storage1, 2 ) &&
+         HsmMachineTimers( hsm2, &timers2, &wheel, storage2, 2 ) &&
+         HsmStart( hsm1, TRoot() ) && HsmStart( hsm2, TRoot() );
+
+    // a short timeout, with a longer one that gets cancelled on exit
+    res= res && TimerSend( hsm1, 'w' ) && (timers1.armed == 2) && (wheel.count == 2) &&
+        (HsmWheelAdvance( &wheel, start+9 ) == 0) && HsmIsInState( hsm1, TWait() ) &&
+        (HsmWheelAdvance( &wheel, start+10 ) == 1) && HsmIsInState( hsm1, TDone() ) &&
+        (timers1.armed == 0) && (wheel.count == 0);
+
+    // long timeouts: from the top level, and from beyond the wheel's span
+    res= res && TimerSend( hsm2, 'l' ) && (wheel.count == 2) &&
+        (HsmWheelAdvance( &wheel, start+10+299999 ) == 0) && (gLevel3Heard == 0) &&
+        (HsmWheelAdvance( &wheel, start+10+300000 ) == 1) && (gLevel3Heard == 1) &&
+        (HsmWheelAdvance( &wheel, start+10+TIMER_SPAN+12344 ) == 0) && HsmIsInState( hsm2, TLong() ) &&
+        (HsmWheelAdvance( &wheel, start+10+TIMER_SPAN+12345 ) == 1) && HsmIsInState( hsm2, TDone() ) &&
+        (wheel.count == 0);
+
+    // time passing without timers costs nothing, and going backwards does nothing.
+    res= res && (HsmWheelAdvance( &wheel, wheel.now + 1000000000UL ) == 0) &&
+         (HsmWheelAdvance( &wheel, wheel.now - 5 ) == 0);
+    return res;
+}
+
+//---------------------------------------------------------------------------
+// many machines, each waiting a different amount: only the machine due hears anything.
+int TimerManyTest()
+{
+    #define TIMER_MACHINES 200
+    hsm_bool res= HSM_TRUE;
+    static hsm_machine_t machines[ TIMER_MACHINES ];
+    static hsm_timers_t timers[ TIMER_MACHINES ];
+    static hsm_timer_t storage[ TIMER_MACHINES ][ 2 ];
+    hsm_wheel_t wheel;
+    unsigned long tick;
+    int i;
+    HsmWheel( &wheel, 0 );
+    for (i=0; res && i<TIMER_MACHINES; ++i) {
+        hsm_machine hsm= HsmMachine( &machines[i] );
+        hsm_status_t status;
+        res= HsmMachineTimers( hsm, &timers[i], &wheel, storage[i], 2 ) &&
+             HsmStart( hsm, TRoot() ) && TimerSend( hsm, 'w' ) &&
+             // cancel the timers entering armed, and arm one of our own: machine i waits 37*i ticks.
+             (HsmCancelTimers( hsm, TWait() ) == 2);
+        status.hsm= hsm;
+        status.state= TWait();
+        status.ctx= NULL;
+        status.evt= NULL;
+        res= res && HsmArmTimer( &status, 37*i, &gTimeout );
+    }
+    for (tick=0; res && tick <= 37*TIMER_MACHINES; ++tick) {
+        const int fired= HsmWheelAdvance( &wheel, tick );
+        const int expect= (tick % 37 == 0) && (tick/37 < TIMER_MACHINES);
+        res= (fired == expect);
+        for (i=0; res && i<TIMER_MACHINES; ++i) {
+            res= HsmIsInState( &machines[i], (37UL*i <= tick) ? TDone() : TWait() );
+        }
+        if (!res) {
+            printf("tick %lu fired %d\n", tick, fired );
+        }
+    }
+    return res && (wheel.count == 0);
+}
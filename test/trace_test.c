@@ -0,0 +1,200 @@
+/**
+ * @file trace_test.c
+ *
+ * Trace machines on two threads, dump the rings, and read the dump back the way hsmtrace does.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "test.h"
+#include <hsm/hsm_atomic.h>
+#include <hsm/hsm_chart.h>
+#include <hsm/hsm_info.h>
+#include <hsm/sched/hsm_thread.h>
+#include <hsm/trace/hsm_trace.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+// 'b' moves from TrA to TrB, which handles 'h'; nobody handles 'z'.
+HSM_STATE( TrTop, HsmTopState, TrA );
+    HSM_STATE( TrA, TrTop, 0 );
+    HSM_STATE( TrB, TrTop, 0 );
+
+hsm_state TrTopEvent( hsm_status status )
+{
+    return NULL;
+}
+
+hsm_state TrAEvent( hsm_status status )
+{
+    return status->evt->ch == 'b' ? TrB() : NULL;
+}
+
+hsm_state TrBEvent( hsm_status status )
+{
+    return status->evt->ch == 'h' ? HsmStateHandled() : NULL;
+}
+
+//---------------------------------------------------------------------------
+typedef struct trace_job_rec trace_job_t;
+struct trace_job_rec {
+    hsm_trace_t* trace;
+    hsm_machine_t machine;
+};
+
+// rings belong to live threads: keep both alive until both have written, so that they get a ring each.
+static hsm_atomic gTraceArrived;
+
+static void TraceMeet( long count )
+{
+    HsmAtomicAdd( &gTraceArrived, 1 );
+    while (HsmAtomicLoad( &gTraceArrived ) < count) {
+        HsmAtomicPause();
+    }
+}
+
+static void TraceThread( void * data )
+{
+    trace_job_t* job= (trace_job_t*) data;
+    hsm_machine hsm= HsmMachine( &job->machine );
+    const char * events= "bhz";
+    HsmSetMachineInfo( hsm, HsmTraceInfo( job->trace ) );
+    TraceMeet( 2 );
+    HsmStart( hsm, TrTop() );
+    for (; *events; ++events) {
+        CharEvent evt;
+        evt.ch= *events;
+        HsmSignalEvent( hsm, &evt );
+    }
+    TraceMeet( 4 );
+}
+
+//---------------------------------------------------------------------------
+// what every machine should have written, oldest first.
+typedef struct trace_expect_rec trace_expect_t;
+struct trace_expect_rec {
+    int kind;
+    hsm_state (*state)();
+};
+
+static hsm_state TrNone() { return NULL; }
+
+static const trace_expect_t gTraceExpect[]= {
+    { HSM_TRACE_ENTER, TrTop },
+    { HSM_TRACE_INIT, TrTop },
+    { HSM_TRACE_ENTER, TrA },
+    { HSM_TRACE_TRANSITION, TrA },
+    { HSM_TRACE_EXIT, TrA },
+    { HSM_TRACE_ENTER, TrB },
+    { HSM_TRACE_HANDLED, TrB },
+    { HSM_TRACE_UNHANDLED, TrNone },
+};
+
+#define TRACE_EXPECTED (sizeof(gTraceExpect)/sizeof(gTraceExpect[0]))
+
+//---------------------------------------------------------------------------
+// check one thread's records against the expected sequence.
+static hsm_bool TraceCheckThread( FILE* in, const trace_job_t* jobs, int* seen )
+{
+    hsm_bool res= HSM_FALSE;
+    unsigned int count, r;
+    if (fread( &count, sizeof(count), 1, in ) == 1 && count == TRACE_EXPECTED) {
+        hsm_trace_record_t records[ TRACE_EXPECTED ];
+        if (fread( records, sizeof(hsm_trace_record_t), count, in ) == count) {
+            // whichever machine this thread ran, all of its records name it.
+            int which= records[0].machine == HsmTraceMachineId( &jobs[1].machine ) ? 1 : 0;
+            res= records[0].machine == HsmTraceMachineId( &jobs[which].machine );
+            ++seen[which];
+            for (r=0; res && r<count; ++r) {
+                hsm_state state= gTraceExpect[r].state();
+                const int index= state ? state->index : HSM_TRACE_NO_STATE;
+                res= (records[r].machine == records[0].machine) &&
+                     (records[r].kind == gTraceExpect[r].kind) &&
+                     (records[r].state == index) &&
+                     (records[r].event_type == HSM_TRACE_NO_TYPE) &&
+                     (!r || records[r].time >= records[r-1].time);
+                if (!res) {
+                    printf("record %u: kind %d state %d, expected kind %d state %d\n", r, records[r].kind, records[r].state, gTraceExpect[r].kind, index );
+                }
+            }
+        }
+    }
+    else {
+        printf("thread wrote %u records, expected %u\n", count, (unsigned int) TRACE_EXPECTED );
+    }
+    return res;
+}
+
+//---------------------------------------------------------------------------
+static hsm_bool TraceCheckDump( const char * path, const hsm_chart_t* chart, const trace_job_t* jobs )
+{
+    hsm_bool res= HSM_FALSE;
+    FILE* in= fopen( path, "rb" );
+    hsm_trace_header_t header;
+    if (in && fread( &header, sizeof(header), 1, in ) == 1) {
+        int seen[2]= { 0, 0 };
+        unsigned int i;
+        res= (memcmp( header.magic, HSM_TRACE_MAGIC, sizeof(header.magic) ) == 0) &&
+             (header.version == HSM_TRACE_VERSION) &&
+             (header.record_size == sizeof(hsm_trace_record_t)) &&
+             (header.ticks_per_ns > 0) &&
+             (header.names == (unsigned int) chart->count) &&
+             (header.threads == 2);
+        // names, by state index
+        for (i=0; res && i<header.names; ++i) {
+            char name[32];
+            hsm_uint16 len;
+            res= fread( &len, sizeof(len), 1, in ) == 1 && len < sizeof(name) &&
+                 fread( name, 1, len, in ) == len;
+            if (res) {
+                name[len]= 0;
+                res= strcmp( name, chart->names[i] ) == 0;
+            }
+        }
+        for (i=0; res && i<header.threads; ++i) {
+            res= TraceCheckThread( in, jobs, seen );
+        }
+        // each thread ran its own machine
+        res= res && seen[0] == 1 && seen[1] == 1 && fgetc( in ) == EOF;
+    }
+    if (in) {
+        fclose( in );
+    }
+    return res;
+}
+
+//---------------------------------------------------------------------------
+int TraceTest()
+{
+    hsm_bool res= HSM_FALSE;
+    const char * path= "trace_test.bin";
+    hsm_state states[]= { TrTop(), TrA(), TrB() };
+    hsm_chart_t chart;
+    if (HsmChartCompile( &chart, states, 3 )) {
+        hsm_trace_t* trace= HsmTraceCreate( 64 );
+        trace_job_t jobs[2];
+        hsm_thread_t threads[2];
+        int i, started=0;
+        if (trace) {
+            HsmTraceChart( trace, &chart );
+            gTraceArrived= 0;
+            for (i=0; i<2; ++i) {
+                jobs[i].trace= trace;
+                started+= HsmThreadStart( &threads[i], TraceThread, &jobs[i] ) ? 1 : 0;
+            }
+            for (i=0; i<started; ++i) {
+                HsmThreadJoin( &threads[i] );
+            }
+            res= (started == 2) && HsmTraceDump( trace, path ) && TraceCheckDump( path, &chart, jobs );
+            remove( path );
+            HsmTraceDestroy( trace );
+        }
+        HsmChartRelease( &chart );
+    }
+    return res;
+}
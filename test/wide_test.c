@@ -0,0 +1,177 @@
+/**
+ * @file wide_test.c
+ *
+ * A machine with a wide context stack keeps track of contexts far deeper than HSM_MAX_DEPTH:
+ * deeper even than the 64 levels held directly in the wide record.
+ * With a dense array, the machine finds each level's context directly, and gets the same answers.
+ * Without a wide stack, the machine stops in the error state rather than lose a context past HSM_MAX_DEPTH.
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include "test.h"
+#include <stdio.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+// a trunk of states, splitting into a short branch and a long one.
+#define WIDE_TRUNK 20
+#define WIDE_SHORT 20
+#define WIDE_LONG  60
+#define WIDE_COUNT (WIDE_TRUNK+WIDE_SHORT+WIDE_LONG)
+
+static struct hsm_state_rec gWide[ WIDE_COUNT ];
+static hsm_context_t gWideCtx[ WIDE_COUNT ];
+static hsm_state gWideLeaf[2];
+static int gWideLive, gWideErrors;
+
+// every third level creates a context
+#define WIDE_HAS_CONTEXT( state ) (((state)->depth % 3)==0)
+
+//---------------------------------------------------------------------------
+static void WidePopped( hsm_context_t* ctx )
+{
+    --gWideLive;
+}
+
+//---------------------------------------------------------------------------
+static hsm_context WideExpected( hsm_state state )
+{
+    while (!WIDE_HAS_CONTEXT( state )) {
+        state= state->parent;
+    }
+    return &gWideCtx[ state - gWide ];
+}
+
+//---------------------------------------------------------------------------
+static hsm_context WideEnter( hsm_status status )
+{
+    hsm_context ctx= status->ctx;
+    if (WIDE_HAS_CONTEXT( status->state )) {
+        ctx= &gWideCtx[ status->state - gWide ];
+        ctx->popped= WidePopped;
+        ++gWideLive;
+    }
+    return ctx;
+}
+
+//---------------------------------------------------------------------------
+static hsm_state WideEvent( hsm_status status )
+{
+    hsm_state ret= NULL;
+    if (status->ctx != WideExpected( status->state )) {
+        ++gWideErrors;
+    }
+    if (status->state == gWideLeaf[0] || status->state == gWideLeaf[1]) {
+        if (status->evt->ch == 't') {
+            ret= status->state == gWideLeaf[0] ? gWideLeaf[1] : gWideLeaf[0];
+        }
+    }
+    else
+    if (!status->state->parent && status->evt->ch == 'x') {
+        ret= HsmStateHandled();
+    }
+    return ret;
+}
+
+//---------------------------------------------------------------------------
+static struct hsm_state_rec* WideChain( struct hsm_state_rec* parent, int at, int count )
+{
+    int i;
+    for (i=0; i<count; ++i) {
+        struct hsm_state_rec* state= &gWide[at+i];
+        state->name= "wide";
+        state->process= WideEvent;
+        state->enter= WideEnter;
+        state->parent= parent;
+        state->depth= parent ? parent->depth+1 : 0;
+        parent= state;
+    }
+    return parent;
+}
+
+//---------------------------------------------------------------------------
+// every level of the current state's path should report the expected context.
+static hsm_bool WideContextsAt( hsm_context_stack stack, hsm_state state )
+{
+    hsm_bool okay= HsmContextAt( stack, state->depth+1 ) == NULL;
+    for (; okay && state; state= state->parent) {
+        okay= HsmContextAt( stack, state->depth ) == WideExpected( state );
+    }
+    return okay;
+}
+
+//---------------------------------------------------------------------------
+static hsm_bool WideRun( hsm_bool use_dense )
+{
+    hsm_bool res= HSM_FALSE;
+    static CharEvent x= { 'x' }, t= { 't' };
+    hsm_context_machine_t machine;
+    hsm_context_wide_t wide;
+    hsm_context dense[ WIDE_COUNT ];
+    hsm_machine hsm= HsmMachineWithWideContext( &machine, &wide, NULL );
+    struct hsm_state_rec* trunk;
+    int i;
+    if (use_dense) {
+        HsmContextStackDense( &machine.stack, dense, WIDE_COUNT );
+    }
+
+    memset( gWide, 0, sizeof(gWide) );
+    gWideLive= gWideErrors= 0;
+    trunk= WideChain( NULL, 0, WIDE_TRUNK );
+    gWideLeaf[0]= WideChain( trunk, WIDE_TRUNK, WIDE_SHORT );
+    gWideLeaf[1]= WideChain( trunk, WIDE_TRUNK+WIDE_SHORT, WIDE_LONG );
+
+    if (HsmStart( hsm, gWideLeaf[0] )) {
+        // bubble all the way up, then hop between the branches
+        res= HsmSignalEvent( hsm, &x ) && (machine.stack.count == WIDE_TRUNK+WIDE_SHORT);
+        for (i=0; res && i<4; ++i) {
+            const int depth= (i&1) ? WIDE_TRUNK+WIDE_SHORT : WIDE_TRUNK+WIDE_LONG;
+            res= HsmSignalEvent( hsm, &t ) && 
+                 HsmSignalEvent( hsm, &x ) && 
+                 (machine.stack.count == depth) &&
+                 (machine.stack.context == WideExpected( hsm->current )) &&
+                 WideContextsAt( &machine.stack, hsm->current ) &&
+                 (gWideLive == (depth+2)/3);
+        }
+        res= res && !gWideErrors;
+        if (!res) {
+            printf("count %d live %d errors %d\n", machine.stack.count, gWideLive, gWideErrors );
+        }
+    }
+    HsmContextWideRelease( &wide );
+    return res;
+}
+
+//---------------------------------------------------------------------------
+// the first context past HSM_MAX_DEPTH stops a narrow machine, and gets released.
+static hsm_bool WideNarrow()
+{
+    hsm_bool res;
+    hsm_context_machine_t machine;
+    hsm_machine hsm= HsmMachineWithContext( &machine, NULL );
+    memset( gWide, 0, sizeof(gWide) );
+    gWideLive= gWideErrors= 0;
+    gWideLeaf[0]= WideChain( NULL, 0, WIDE_TRUNK );
+    res= !HsmStart( hsm, gWideLeaf[0] ) && (hsm->current == HsmStateError()) &&
+         (machine.stack.count == HSM_MAX_DEPTH+2) && (gWideLive == (HSM_MAX_DEPTH+2)/3);
+    if (!res) {
+        printf("narrow: count %d live %d\n", machine.stack.count, gWideLive );
+    }
+    return res;
+}
+
+//---------------------------------------------------------------------------
+int WideTest()
+{
+    return WideRun( HSM_FALSE ) && WideNarrow();
+}
+
+//---------------------------------------------------------------------------
+int WideDenseTest()
+{
+    return WideRun( HSM_TRUE );
+}
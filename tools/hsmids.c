@@ -0,0 +1,161 @@
+/**
+ * @file hsmids.c
+ *
+ * Write the builder's state ids to a C header, so that C code never hashes a name at run time.
+ *
+ *   hsmids [-p prefix] names.txt [out.h]
+ *
+ * Names are read one per line; blank lines, and lines starting with #, are skipped.
+ * Each becomes a define of the id hsmState() returns for it: prefix, then the name with anything
+ * other than letters, digits, and underscores turned into underscores. The prefix defaults to HSM_ID_.
+ *
+ *   hsmGotoId( HSM_ID_Top );   // same as hsmGoto( "Top" ), without the hash
+ *
+ * Names differing only by case are the same state, and get the same id.
+ * Two different names with the same id, or the same define, are an error: better found here than at run time.
+ * ( hsm/builder/hsm_builder.hpp does the same job at compile time for C++. )
+ *
+ * Build: cc -I. tools/hsmids.c hsm/hsm_*.c hsm/builder/[a-z]*.c -o hsmids
+ * or: make -C tools hsmids; and make -C tools check, to test a generated header against hsmState().
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include <hsm/hsm_machine.h>
+#include <hsm/builder/hsm_builder.h>
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_NAME 256
+
+//---------------------------------------------------------------------------
+typedef struct name_rec name_t;
+struct name_rec {
+    char name[ MAX_NAME ];
+    char define[ MAX_NAME+64 ];
+    unsigned int id;
+    int line;
+};
+
+//---------------------------------------------------------------------------
+static void Trim( char * line )
+{
+    size_t len= strlen( line );
+    char * start= line;
+    while (len && isspace( (unsigned char) line[len-1] )) {
+        line[--len]= 0;
+    }
+    while (*start && isspace( (unsigned char) *start )) {
+        ++start;
+    }
+    memmove( line, start, strlen( start )+1 );
+}
+
+//---------------------------------------------------------------------------
+// the builder ignores case
+static int SameName( const char * a, const char * b )
+{
+    for (; *a && tolower( (unsigned char) *a ) == tolower( (unsigned char) *b ); ++a, ++b) {
+    }
+    return tolower( (unsigned char) *a ) == tolower( (unsigned char) *b );
+}
+
+//---------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+    const char * prefix= "HSM_ID_";
+    int arg= 1, count= 0, capacity= 0, line= 0, errors= 0, i, j;
+    char buffer[ MAX_NAME ];
+    name_t* names= NULL;
+    FILE* in, *out= stdout;
+
+    if (arg+1 < argc && strcmp( argv[arg], "-p" ) == 0) {
+        prefix= argv[arg+1];
+        arg+= 2;
+    }
+    if (arg >= argc) {
+        fprintf( stderr, "usage: hsmids [-p prefix] names.txt [out.h]\n" );
+        return 2;
+    }
+    in= fopen( argv[arg], "r" );
+    if (!in) {
+        fprintf( stderr, "hsmids: couldn't read %s\n", argv[arg] );
+        return 1;
+    }
+
+    while (fgets( buffer, sizeof(buffer), in )) {
+        ++line;
+        Trim( buffer );
+        if (buffer[0] && buffer[0] != '#') {
+            name_t* name;
+            char * d;
+            const char * s;
+            if (count == capacity) {
+                capacity= capacity ? capacity*2 : 64;
+                names= (name_t*) realloc( names, capacity * sizeof(name_t) );
+                if (!names) {
+                    fprintf( stderr, "hsmids: out of memory\n" );
+                    return 1;
+                }
+            }
+            name= names + count++;
+            strcpy( name->name, buffer );
+            name->id= (unsigned int) HSM_HASH32( buffer );
+            name->line= line;
+            d= name->define + sprintf( name->define, "%s", prefix );
+            for (s= buffer; *s; ++s) {
+                *d++= (isalnum( (unsigned char) *s ) || *s == '_') ? *s : '_';
+            }
+            *d= 0;
+        }
+    }
+    fclose( in );
+
+    for (i=0; i<count; ++i) {
+        for (j=0; j<i; ++j) {
+            if (names[i].id == names[j].id && !SameName( names[i].name, names[j].name )) {
+                fprintf( stderr, "%s:%d: '%s' has the same id as '%s' on line %d\n",
+                    argv[arg], names[i].line, names[i].name, names[j].name, names[j].line );
+                ++errors;
+            }
+            else
+            if (!strcmp( names[i].define, names[j].define ) && strcmp( names[i].name, names[j].name )) {
+                fprintf( stderr, "%s:%d: '%s' and '%s' on line %d both become %s\n",
+                    argv[arg], names[i].line, names[i].name, names[j].name, names[j].line, names[i].define );
+                ++errors;
+            }
+        }
+    }
+    if (errors) {
+        return 1;
+    }
+
+    if (arg+1 < argc) {
+        out= fopen( argv[arg+1], "w" );
+        if (!out) {
+            fprintf( stderr, "hsmids: couldn't write %s\n", argv[arg+1] );
+            return 1;
+        }
+    }
+    fprintf( out, "/* generated by hsmids from %s: the ids hsmState() returns. */\n", argv[arg] );
+    fprintf( out, "#pragma once\n\n" );
+    for (i=0; i<count; ++i) {
+        // repeats are harmless, but only need defining once
+        for (j=0; j<i && strcmp( names[i].name, names[j].name ); ++j) {
+        }
+        if (j == i) {
+            fprintf( out, "#define %s ((int)0x%08xu) /* %s */\n", names[i].define, names[i].id, names[i].name );
+        }
+    }
+    if (out != stdout) {
+        fclose( out );
+    }
+    free( names );
+    return 0;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file hsmids_check.c
+ *
+ * Check the header hsmids writes from hsmids_check.txt: every define must be the id hsmState() gives its name.
+ *
+ *   make check
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include <hsm/hsm_machine.h>
+#include <hsm/builder/hsm_builder.h>
+
+#include <stdio.h>
+
+#include "hsmids_check.h"
+
+//---------------------------------------------------------------------------
+typedef struct expected_rec expected_t;
+struct expected_rec {
+    int id;
+    const char * name;
+};
+
+//---------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+    const expected_t expected[]= {
+        { HSM_ID_Top, "Top" },
+        { HSM_ID_top, "top" },
+        { HSM_ID_Top, "TOP" },         // the builder ignores case
+        { HSM_ID_Idle, "Idle" },
+        { HSM_ID_Running_Fast, "Running.Fast" },
+        { HSM_ID_running_slow, "running-slow" },
+        { HSM_ID_s211, "s211" },
+    };
+    int i, failures= 0;
+    if (!hsmStartup()) {
+        fprintf( stderr, "hsmids_check: couldn't start the builder\n" );
+        return 1;
+    }
+    for (i=0; i< (int)(sizeof(expected)/sizeof(expected[0])); ++i) {
+        const int id= hsmState( expected[i].name );
+        if (id != expected[i].id) {
+            fprintf( stderr, "hsmids_check: '%s' is %08x, but hsmState() says %08x\n",
+                expected[i].name, (unsigned int) expected[i].id, (unsigned int) id );
+            ++failures;
+        }
+    }
+    // and the builder finds states by them
+    if (hsmBegin( "Top", 0 )) {
+        hsmBegin( "Idle", 0 );
+        hsmEnd();
+        hsmEnd();
+    }
+    if (!hsmResolveId( HSM_ID_Idle ) || hsmResolveId( HSM_ID_Idle ) != hsmResolve( "idle" )) {
+        fprintf( stderr, "hsmids_check: HSM_ID_Idle doesn't resolve to Idle\n" );
+        ++failures;
+    }
+    hsmShutdown();
+    printf( "hsmids_check: %s\n", failures ? "FAILS." : "passes." );
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,208 @@
+/**
+ * @file hsmtrace.c
+ *
+ * Decode a dump written by HsmTraceDump(), as text or as chrome://tracing json.
+ *
+ *   hsmtrace [-json] dump.bin [out]
+ *
+ * Records from every thread are merged into time order.
+ * Text lines read: microseconds since tracing started, thread, machine, kind, state, event type.
+ * Json puts each machine on its own track, whichever threads ran it: states appear as spans from enter to exit,
+ * everything else as instant events. The thread which wrote each record is in its args.
+ *
+ * Build: cc -I. tools/hsmtrace.c -o hsmtrace
+ * or: make -C tools hsmtrace
+ *
+ * Copyright (c) 2012, everMany, LLC.
+ * All rights reserved.
+ *
+ * Code licensed under the "New BSD" (BSD 3-Clause) License
+ * See License.txt for complete information.
+ */
+#include <hsm/hsm_machine.h>
+#include <hsm/hsm_chart.h>
+#include <hsm/trace/hsm_trace.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+typedef struct decoded_rec decoded_t;
+struct decoded_rec {
+    hsm_trace_record_t record;
+    unsigned int thread;
+    unsigned long order; // position in the dump, keeps the sort stable
+};
+
+static const char * KindName( int kind )
+{
+    switch (kind) {
+        case HSM_TRACE_ENTER: return "enter";
+        case HSM_TRACE_EXIT: return "exit";
+        case HSM_TRACE_INIT: return "init";
+        case HSM_TRACE_HANDLED: return "handled";
+        case HSM_TRACE_TRANSITION: return "transition";
+        case HSM_TRACE_UNHANDLED: return "unhandled";
+    }
+    return "user";
+}
+
+static int CompareTime( const void * a, const void * b )
+{
+    const decoded_t* x= (const decoded_t*) a;
+    const decoded_t* y= (const decoded_t*) b;
+    if (x->record.time != y->record.time) {
+        return x->record.time < y->record.time ? -1 : 1;
+    }
+    return x->order < y->order ? -1 : (x->order > y->order);
+}
+
+//---------------------------------------------------------------------------
+// builder and hula names can be any string at all.
+static void WriteQuoted( FILE* out, const char * name )
+{
+    fputc( '"', out );
+    for (; *name; ++name) {
+        const unsigned char ch= (unsigned char) *name;
+        if (ch == '"' || ch == '\\') {
+            fprintf( out, "\\%c", ch );
+        }
+        else
+        if (ch < 0x20) {
+            fprintf( out, "\\u%04x", ch );
+        }
+        else {
+            fputc( ch, out );
+        }
+    }
+    fputc( '"', out );
+}
+
+//---------------------------------------------------------------------------
+static void WriteName( FILE* out, char ** names, unsigned int count, int state, int quoted )
+{
+    if (state >= 0 && (unsigned int) state < count) {
+        if (quoted) {
+            WriteQuoted( out, names[state] );
+        }
+        else {
+            fprintf( out, "%s", names[state] );
+        }
+    }
+    else
+    if (state == HSM_TRACE_NO_STATE) {
+        fprintf( out, quoted ? "\"-\"" : "-" );
+    }
+    else {
+        fprintf( out, quoted ? "\"#%d\"" : "#%d", state );
+    }
+}
+
+//---------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+    int json= 0, arg= 1;
+    FILE* in, *out= stdout;
+    hsm_trace_header_t header;
+    char ** names= NULL;
+    decoded_t* records= NULL;
+    unsigned long total= 0, i;
+    unsigned int t;
+
+    if (arg < argc && strcmp( argv[arg], "-json" ) == 0) {
+        json= 1;
+        ++arg;
+    }
+    if (arg >= argc) {
+        fprintf( stderr, "usage: hsmtrace [-json] dump.bin [out]\n" );
+        return 2;
+    }
+    in= fopen( argv[arg], "rb" );
+    if (!in || fread( &header, sizeof(header), 1, in ) != 1 ||
+        memcmp( header.magic, HSM_TRACE_MAGIC, sizeof(header.magic) ) != 0 ||
+        header.version != HSM_TRACE_VERSION || header.record_size != sizeof(hsm_trace_record_t)) {
+        fprintf( stderr, "hsmtrace: %s isn't a trace dump from this platform\n", argv[arg] );
+        return 1;
+    }
+    if (arg+1 < argc) {
+        out= fopen( argv[arg+1], "w" );
+        if (!out) {
+            fprintf( stderr, "hsmtrace: couldn't write %s\n", argv[arg+1] );
+            return 1;
+        }
+    }
+
+    names= (char**) calloc( header.names+1, sizeof(char*) );
+    for (i=0; names && i<header.names; ++i) {
+        hsm_uint16 len;
+        if (fread( &len, sizeof(len), 1, in ) != 1 || !(names[i]= (char*) calloc( len+1, 1 )) ||
+            fread( names[i], 1, len, in ) != len) {
+            fprintf( stderr, "hsmtrace: truncated names\n" );
+            return 1;
+        }
+    }
+    for (t=0; t<header.threads; ++t) {
+        unsigned int count, r;
+        decoded_t* grown;
+        if (fread( &count, sizeof(count), 1, in ) != 1 ||
+            !(grown= (decoded_t*) realloc( records, (total+count+1) * sizeof(decoded_t) ))) {
+            fprintf( stderr, "hsmtrace: truncated thread %u\n", t );
+            return 1;
+        }
+        records= grown;
+        for (r=0; r<count; ++r, ++total) {
+            if (fread( &records[total].record, sizeof(hsm_trace_record_t), 1, in ) != 1) {
+                fprintf( stderr, "hsmtrace: truncated thread %u\n", t );
+                return 1;
+            }
+            records[total].thread= t;
+            records[total].order= total;
+        }
+    }
+    fclose( in );
+    qsort( records, total, sizeof(decoded_t), CompareTime );
+
+    if (json) {
+        fprintf( out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n" );
+    }
+    for (i=0; i<total; ++i) {
+        const hsm_trace_record_t* record= &records[i].record;
+        const double us= (double)(record->time - header.start) / header.ticks_per_ns / 1000.0;
+        if (json) {
+            const char * phase= record->kind == HSM_TRACE_ENTER ? "B" : record->kind == HSM_TRACE_EXIT ? "E" : "i";
+            fprintf( out, "%s{\"name\":", i ? ",\n" : "" );
+            if (record->kind == HSM_TRACE_ENTER || record->kind == HSM_TRACE_EXIT) {
+                WriteName( out, names, header.names, record->state, 1 );
+            }
+            else {
+                fprintf( out, "\"%s\"", KindName( record->kind ) );
+            }
+            // a machine can move between threads: keep its spans on one track, so every enter meets its exit.
+            fprintf( out, ",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%u%s,\"args\":{\"thread\":%u,\"state\":",
+                phase, us, record->machine, *phase == 'i' ? ",\"s\":\"t\"" : "", records[i].thread );
+            WriteName( out, names, header.names, record->state, 1 );
+            fprintf( out, ",\"event\":%d}}", record->event_type == HSM_TRACE_NO_TYPE ? -1 : record->event_type );
+        }
+        else {
+            fprintf( out, "%14.3f us  thread %-3u machine %08x  %-10s ", us, records[i].thread, record->machine, KindName( record->kind ) );
+            WriteName( out, names, header.names, record->state, 0 );
+            if (record->event_type != HSM_TRACE_NO_TYPE) {
+                fprintf( out, "  event %d", record->event_type );
+            }
+            fprintf( out, "\n" );
+        }
+    }
+    if (json) {
+        fprintf( out, "\n]}\n" );
+    }
+    if (out != stdout) {
+        fclose( out );
+    }
+    for (i=0; names && i<header.names; ++i) {
+        free( names[i] );
+    }
+    free( names );
+    free( records );
+    return 0;
+}